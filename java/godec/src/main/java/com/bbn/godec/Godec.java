@@ -1,6 +1,8 @@
 package com.bbn.godec;
 
 import java.io.File;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
 import java.util.ArrayList;
 import java.util.HashMap;
 import java.util.List;
@@ -30,7 +32,9 @@ public class Godec
   private native void JLoadGodec(File jsonFile, GodecJsonOverrides overrides, GodecPushEndpoints pushEndpoints, GodecPullEndpoints pullEndpoints, boolean quiet);
   private native void JPushMessage(String endpointName, DecoderMessage msg);
   private native HashMap<String,DecoderMessage> JPullMessage(String endpointName, float maxTimeout);
+  private native HashMap<String,DecoderMessage> JPullMessageIntoBuffers(String endpointName, float maxTimeout, HashMap<String,FloatBuffer> targetBuffers);
   private native ArrayList<HashMap<String,DecoderMessage>> JPullAllMessages(String endpointName, float maxTimeout);
+  private native void JSetListener(String endpointName, GodecListener listener, int maxBlocksPerCall);
   private native void JBlockingShutdown();
 
   /*
@@ -69,6 +73,19 @@ public class Godec
     return JPullMessage(endpointName, maxTimeout);
   }
 
+  /*
+   * Same as PullMessage, but the audio or feature payload of the message in a stream gets written into the caller-provided direct buffer for that stream (if there is one), instead of into a newly allocated float[].
+   * The returned message's Vector/Matrix then wraps the buffer (whose limit is set to the payload size), so the buffer contents are only valid until it is used for the next pull.
+   * Buffers have to be direct and in native byte order, i.e. created with ByteBuffer.allocateDirect(numBytes).order(ByteOrder.nativeOrder()).asFloatBuffer(). If a payload does not fit into the buffer, that message is returned the regular way.
+   * @param targetBuffers buffers indexed by stream name
+  */
+  public HashMap<String,DecoderMessage> PullMessage(String endpointName, float maxTimeout, HashMap<String,FloatBuffer> targetBuffers) throws ChannelClosedException {
+    for(FloatBuffer buffer : targetBuffers.values()) {
+      if (!buffer.isDirect() || buffer.order() != ByteOrder.nativeOrder()) throw new IllegalArgumentException("Target buffers need to be direct and in native byte order");
+    }
+    return JPullMessageIntoBuffers(endpointName, maxTimeout, targetBuffers);
+  }
+
   /*
    * PullAllMessages
    * Same as PullMessage, but will return all blocks of messages that can be retrieved
@@ -77,6 +94,17 @@ public class Godec
     return JPullAllMessages(endpointName, maxTimeout);
   }
 
+  /*
+   * Alternative to polling with PullMessage/PullAllMessages: The listener gets the endpoint's blocks of messages pushed to it as soon as they are available. After this call, pulling from the endpoint returns nothing
+   * @param endpointName name of the endpoint (which was defined during construction)
+   * @param listener receives the messages, from one of Godec's delivery threads
+   * @param maxBlocksPerCall upper limit on how many blocks get handed over in one onMessages() call
+  */
+  public void SetListener(String endpointName, GodecListener listener, int maxBlocksPerCall) {
+    listener = Objects.requireNonNull(listener);
+    JSetListener(endpointName, listener, maxBlocksPerCall);
+  }
+
   /*
    * This call blocks until the Godec network has shut itself down
   */
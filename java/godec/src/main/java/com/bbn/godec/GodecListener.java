@@ -0,0 +1,12 @@
+package com.bbn.godec;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+
+/* Receives the output of a pull endpoint as it gets produced, see Godec.SetListener(). Both methods get called from Godec's delivery threads, calls for one endpoint never overlap. They must not call BlockingShutdown(), Godec's shutdown waits for the listeners to finish */
+public interface GodecListener {
+  /* Called with one or more blocks of messages, in the same format PullAllMessages() returns */
+  void onMessages(ArrayList<HashMap<String,DecoderMessage>> msgBlocks);
+  /* Called once after the last block, when the endpoint has shut down */
+  void onClosed();
+}
@@ -1,7 +1,14 @@
 package com.bbn.godec;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+
 public class Matrix {
   private Vector[] cols;
+  // Alternative storage: A direct buffer holding the matrix in column-major order (see Vector for the buffer requirements)
+  private FloatBuffer mBuffer;
+  private int mBufferRows;
 
   public Matrix(int numRows, int numCols) {
     cols = new Vector[numCols];
@@ -14,50 +21,84 @@ public class Matrix {
     cols = _cols;
   }
 
-  public int cols() {return cols.length;}
-  public int rows() {return cols[0].size();}
+  /* Wraps the remaining elements of a direct, native-order buffer as a column-major matrix with numRows rows (no copy) */
+  public Matrix(FloatBuffer buffer, int numRows) {
+    if (!buffer.isDirect()) throw new IllegalArgumentException("Matrix can only wrap direct FloatBuffers");
+    if (buffer.order() != ByteOrder.nativeOrder()) throw new IllegalArgumentException("Matrix can only wrap FloatBuffers in native byte order");
+    if (numRows <= 0 || buffer.remaining() % numRows != 0) throw new IllegalArgumentException("Buffer size "+buffer.remaining()+" is not a multiple of the number of rows "+numRows);
+    mBuffer = buffer.slice();
+    mBufferRows = numRows;
+  }
+  public Matrix(ByteBuffer buffer, int numRows) {
+    this(buffer.duplicate().order(ByteOrder.nativeOrder()).asFloatBuffer(), numRows);
+  }
+
+  public int cols() {return (mBuffer != null) ? mBuffer.capacity()/mBufferRows : cols.length;}
+  public int rows() {return (mBuffer != null) ? mBufferRows : cols[0].size();}
 
   public boolean compareTo(Matrix m) {
     if (cols() != m.cols() || rows() != m.rows()) return false;
-    for(int rowIdx = 0; rowIdx < cols[0].size(); rowIdx++) {
-      for(int colIdx = 0; colIdx < cols.length; colIdx++) {
+    for(int rowIdx = 0; rowIdx < rows(); rowIdx++) {
+      for(int colIdx = 0; colIdx < cols(); colIdx++) {
         if (get(rowIdx, colIdx) != m.get(rowIdx, colIdx)) return false;
       }
     }
     return true;
   }
 
+  // The columns as separate vectors. For buffer-backed matrices this is a copy
+  private Vector[] columns() {
+    if (mBuffer == null) return cols;
+    Vector[] out = new Vector[cols()];
+    FloatBuffer src = mBuffer.duplicate();
+    for(int colIdx = 0; colIdx < out.length; colIdx++) {
+      out[colIdx] = new Vector(mBufferRows);
+      src.get(out[colIdx].mData);
+    }
+    return out;
+  }
+
   public void conservativeResize(int newNumRows, int newNumCols) {
+    Vector[] oldCols = columns();
     Vector[] newCols = new Vector[newNumCols];
-    System.arraycopy(cols, 0, newCols, 0, Math.min(cols.length, newNumCols));
-    for(int idx = Math.min(cols.length, newNumCols); idx < newNumCols; idx++) {
+    System.arraycopy(oldCols, 0, newCols, 0, Math.min(oldCols.length, newNumCols));
+    for(int idx = Math.min(oldCols.length, newNumCols); idx < newNumCols; idx++) {
       newCols[idx] = new Vector(newNumRows);
     }
     for(int idx = 0; idx < newNumCols; idx++) {
       newCols[idx].conservativeResize(newNumRows);
     }
     cols = newCols;
+    mBuffer = null;
   }
 
   public void addColumns(Matrix addCols) {
-    Vector[] newCols = new Vector[cols.length+addCols.cols.length];
-    System.arraycopy(cols, 0, newCols, 0, cols.length);
-    System.arraycopy(addCols.cols, 0, newCols, cols.length, addCols.cols.length);
+    Vector[] oldCols = columns();
+    Vector[] extraCols = addCols.columns();
+    Vector[] newCols = new Vector[oldCols.length+extraCols.length];
+    System.arraycopy(oldCols, 0, newCols, 0, oldCols.length);
+    System.arraycopy(extraCols, 0, newCols, oldCols.length, extraCols.length);
     cols = newCols;
+    mBuffer = null;
   }
 
   public float get(int row, int col) {
-    return cols[col].mData[row];
+    if (mBuffer != null) return mBuffer.get(col*mBufferRows+row);
+    return cols[col].get(row);
   }
   public void set(int row, int col, float val) {
-    cols[col].mData[row] = val;
+    if (mBuffer != null) {
+      mBuffer.put(col*mBufferRows+row, val);
+      return;
+    }
+    cols[col].set(row, val);
   }
 
   @Override
     public String toString() {
       String out = "";
-      for(int rowIdx = 0; rowIdx < cols[0].size(); rowIdx++) {
-        for(int colIdx = 0; colIdx < cols.length; colIdx++) {
+      for(int rowIdx = 0; rowIdx < rows(); rowIdx++) {
+        for(int colIdx = 0; colIdx < cols(); colIdx++) {
           out += get(rowIdx, colIdx)+" ";
         }
         out += "\n";
@@ -1,11 +1,16 @@
 package com.bbn.godec;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
 import java.util.Arrays;
 
 /* Note, this class exists as a replacement for com.bbn.godec.Vector because com.bbn.godec.Vector is not nearly as easily converted through JNI as a simple float[] that this class here has. Also, Java doesn't have a Matrix class, so we'd otherwise have two vastly different classes */
 
 public class Vector {
   public float[] mData;
+  // Alternative storage: A direct (off-heap) buffer in native byte order. Godec copies the contents straight from/into its memory, without an intermediate float[]
+  public FloatBuffer mBuffer;
 
   public Vector(int size) {
     mData = new float[size];	
@@ -26,32 +31,62 @@ public class Vector {
     mData = newData;
   }
 
+  /* Wraps the remaining elements of a direct buffer (no copy). The buffer needs to be in native byte order, i.e. created with ByteBuffer.allocateDirect(numBytes).order(ByteOrder.nativeOrder()).asFloatBuffer() */
+  public Vector(FloatBuffer buffer) {
+    if (!buffer.isDirect()) throw new IllegalArgumentException("Vector can only wrap direct FloatBuffers");
+    if (buffer.order() != ByteOrder.nativeOrder()) throw new IllegalArgumentException("Vector can only wrap FloatBuffers in native byte order");
+    mBuffer = buffer.slice();
+  }
+  /* Wraps the remaining bytes of a direct buffer as native-order floats (no copy) */
+  public Vector(ByteBuffer buffer) {
+    this(buffer.duplicate().order(ByteOrder.nativeOrder()).asFloatBuffer());
+  }
+
   public boolean compareTo(Vector v) {
-    if (mData.length != v.mData.length) return false;
-    return Arrays.equals(mData, v.mData);
+    if (size() != v.size()) return false;
+    if (mBuffer == null && v.mBuffer == null) return Arrays.equals(mData, v.mData);
+    for(int idx = 0; idx < size(); idx++) {
+      if (get(idx) != v.get(idx)) return false;
+    }
+    return true;
   }
 
   public int size() { 
+    if (mBuffer != null) return mBuffer.capacity();
     int s = (mData == null) ? 0 : mData.length;
     return s;
   }
 
+  // Returns the contents as an array. For buffer-backed vectors this is a copy
+  public float[] toArray() {
+    if (mBuffer == null) return mData;
+    float[] out = new float[mBuffer.capacity()];
+    mBuffer.duplicate().get(out);
+    return out;
+  }
+
   void conservativeResize(int newSize) {
     float[] newData = new float[newSize];
-    System.arraycopy(mData, 0, newData, 0, Math.min(size(), newSize));
+    System.arraycopy(toArray(), 0, newData, 0, Math.min(size(), newSize));
     mData = newData;
+    mBuffer = null;
   }
   public void addData(Vector featureTimings) {
     int prevSize = size();
     conservativeResize(prevSize+featureTimings.size());
-    System.arraycopy(featureTimings.mData, 0, mData, prevSize, featureTimings.size());
+    System.arraycopy(featureTimings.toArray(), 0, mData, prevSize, featureTimings.size());
   }
 
   public float get(int idx) {
+    if (mBuffer != null) return mBuffer.get(idx);
     return mData[idx];
   }
 
   public void set(int idx, float f) {
+    if (mBuffer != null) {
+      mBuffer.put(idx, f);
+      return;
+    }
     mData[idx] = f;
   }
 }
@@ -0,0 +1,176 @@
+package com.bbn.godec.regression;
+
+import java.io.File;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.HashSet;
+
+import com.bbn.godec.ChannelClosedException;
+import com.bbn.godec.DecoderMessage;
+import com.bbn.godec.FeaturesDecoderMessage;
+import com.bbn.godec.Godec;
+import com.bbn.godec.GodecJsonOverrides;
+import com.bbn.godec.GodecPullEndpoints;
+import com.bbn.godec.GodecPushEndpoints;
+import com.bbn.godec.Matrix;
+import com.bbn.godec.NbestDecoderMessage;
+import com.bbn.godec.NbestEntry;
+
+/* Measures the throughput of the push/pull API for messages of realistic size. Every message gets converted from Java and back again, the Nbests also get fed through the Java component inside the graph (see jni_test.json). Fails if a message doesn't come back unchanged */
+public class JNIBenchmark {
+
+  Godec mEngine = null;
+  int mNumMessages;
+  // What the current Run() pushed, and how many of those have come back so far
+  ArrayList<DecoderMessage> mPushedMsgs;
+  int mNumPulled;
+
+  public JNIBenchmark(String rootJson, int numMessages) {
+    mNumMessages = numMessages;
+    GodecPushEndpoints pushList = new GodecPushEndpoints();
+    GodecPullEndpoints pullList = new GodecPullEndpoints();
+    String[] msgTypes = {"FeaturesDecoderMessage", "NbestDecoderMessage"};
+    for(String msgType : msgTypes) {
+      pushList.addPushEndpoint(msgType+"_in");
+      HashSet<String> pullStreams = new HashSet<String>();
+      pullStreams.add(msgType+"_in");
+      pullList.addPullEndpoint(msgType+"_out", pullStreams);
+    }
+    mEngine = new Godec(new File(rootJson), new GodecJsonOverrides(), pushList, pullList, true);
+
+    // 1 second of 40-dimensional features at 100 frames per second
+    int numFrames = 100;
+    Matrix feats = new Matrix(40, numFrames);
+    for(int colIdx = 0; colIdx < numFrames; colIdx++) {
+      for(int rowIdx = 0; rowIdx < 40; rowIdx++) {
+        feats.set(rowIdx, colIdx, rowIdx*0.1f+colIdx);
+      }
+    }
+    ArrayList<DecoderMessage> featMsgs = new ArrayList<DecoderMessage>();
+    for(int msgIdx = 0; msgIdx < mNumMessages; msgIdx++) {
+      long[] timestamps = new long[numFrames];
+      for(int frameIdx = 0; frameIdx < numFrames; frameIdx++) {
+        timestamps[frameIdx] = (long)msgIdx*numFrames+frameIdx+1;
+      }
+      featMsgs.add(new FeaturesDecoderMessage("dummy", timestamps[numFrames-1], "utt_id", feats, timestamps, "RAW[0:39]%f"));
+    }
+    Run("FeaturesDecoderMessage", featMsgs, 40*numFrames*4, null);
+
+    // Same features, but living in direct buffers on the way in and out
+    FloatBuffer featBuffer = ByteBuffer.allocateDirect(40*numFrames*4).order(ByteOrder.nativeOrder()).asFloatBuffer();
+    for(int colIdx = 0; colIdx < numFrames; colIdx++) {
+      for(int rowIdx = 0; rowIdx < 40; rowIdx++) {
+        featBuffer.put(rowIdx*0.1f+colIdx);
+      }
+    }
+    featBuffer.flip();
+    Matrix directFeats = new Matrix(featBuffer, 40);
+    ArrayList<DecoderMessage> directFeatMsgs = new ArrayList<DecoderMessage>();
+    long timeOffset = (long)mNumMessages*numFrames;
+    for(int msgIdx = 0; msgIdx < mNumMessages; msgIdx++) {
+      long[] timestamps = new long[numFrames];
+      for(int frameIdx = 0; frameIdx < numFrames; frameIdx++) {
+        timestamps[frameIdx] = timeOffset+(long)msgIdx*numFrames+frameIdx+1;
+      }
+      directFeatMsgs.add(new FeaturesDecoderMessage("dummy", timestamps[numFrames-1], "utt_id", directFeats, timestamps, "RAW[0:39]%f"));
+    }
+    HashMap<String, FloatBuffer> targetBuffers = new HashMap<String, FloatBuffer>();
+    targetBuffers.put("FeaturesDecoderMessage_in", ByteBuffer.allocateDirect(40*numFrames*4).order(ByteOrder.nativeOrder()).asFloatBuffer());
+    Run("FeaturesDecoderMessage", directFeatMsgs, 40*numFrames*4, targetBuffers);
+
+    // A 10-best list with 20 words per entry
+    ArrayList<DecoderMessage> nbestMsgs = new ArrayList<DecoderMessage>();
+    for(int msgIdx = 0; msgIdx < mNumMessages; msgIdx++) {
+      ArrayList<NbestEntry> entries = new ArrayList<NbestEntry>();
+      for(int entryIdx = 0; entryIdx < 10; entryIdx++) {
+        int[] words = new int[20];
+        long[] alignment = new long[20];
+        String[] text = new String[20];
+        float[] confidences = new float[20];
+        for(int wordIdx = 0; wordIdx < 20; wordIdx++) {
+          words[wordIdx] = wordIdx;
+          alignment[wordIdx] = (long)msgIdx*20+wordIdx+1;
+          text[wordIdx] = "word"+wordIdx;
+          confidences[wordIdx] = 0.5f;
+        }
+        entries.add(new NbestEntry(words, alignment, text, confidences));
+      }
+      nbestMsgs.add(new NbestDecoderMessage("dummy", (long)msgIdx*20+20, entries));
+    }
+    Run("NbestDecoderMessage", nbestMsgs, 0, null);
+
+    mEngine.BlockingShutdown();
+  }
+
+  // With targetBuffers, messages get pulled one at a time into those buffers
+  void Run(String msgType, ArrayList<DecoderMessage> msgs, long payloadBytesPerMsg, HashMap<String, FloatBuffer> targetBuffers) {
+    mPushedMsgs = msgs;
+    mNumPulled = 0;
+    long startTime = System.nanoTime();
+    long lastTime = msgs.get(msgs.size()-1).mTime;
+    long pulledUntil = -1;
+    try {
+      for(DecoderMessage msg : msgs) {
+        mEngine.PushMessage(msgType+"_in", msg);
+        pulledUntil = Pull(msgType, 0.0f, pulledUntil, targetBuffers);
+      }
+      while(pulledUntil < lastTime) {
+        long newPulledUntil = Pull(msgType, 1000.0f, pulledUntil, targetBuffers);
+        if (newPulledUntil == pulledUntil) {
+          System.err.println(msgType+": Timed out waiting for messages");
+          System.exit(-1);
+        }
+        pulledUntil = newPulledUntil;
+      }
+    } catch (ChannelClosedException e) {
+      System.err.println(e.getMessage());
+      System.exit(-1);
+    }
+    double seconds = (System.nanoTime()-startTime)/1e9;
+    if (mNumPulled != msgs.size()) {
+      System.err.println(msgType+": Pushed "+msgs.size()+" messages, but pulled "+mNumPulled);
+      System.exit(-1);
+    }
+    if (targetBuffers != null) msgType += " (direct buffers)";
+    String line = String.format("%s: %d messages in %.3fs, %.0f messages/s", msgType, msgs.size(), seconds, msgs.size()/seconds);
+    if (payloadBytesPerMsg > 0) line += String.format(", %.1f MB/s each way", msgs.size()*payloadBytesPerMsg/seconds/1e6);
+    System.out.println(line);
+  }
+
+  // Returns the time of the last message pulled so far
+  long Pull(String msgType, float timeout, long pulledUntil, HashMap<String, FloatBuffer> targetBuffers) throws ChannelClosedException {
+    if (targetBuffers != null) {
+      HashMap<String, DecoderMessage> msgBlock = mEngine.PullMessage(msgType+"_out", timeout, targetBuffers);
+      while(msgBlock != null) {
+        for(DecoderMessage msg : msgBlock.values()) pulledUntil = Math.max(pulledUntil, CheckPulled(msg));
+        msgBlock = mEngine.PullMessage(msgType+"_out", 0.0f, targetBuffers);
+      }
+      return pulledUntil;
+    }
+    ArrayList<HashMap<String, DecoderMessage>> msgBlocks = mEngine.PullAllMessages(msgType+"_out", timeout);
+    if (msgBlocks == null) return pulledUntil;
+    for(HashMap<String, DecoderMessage> msgBlock : msgBlocks) {
+      for(DecoderMessage msg : msgBlock.values()) pulledUntil = Math.max(pulledUntil, CheckPulled(msg));
+    }
+    return pulledUntil;
+  }
+
+  // Messages have to come back unchanged and in the order they were pushed. Direct-buffer messages get overwritten by the next pull, so this has to happen right away
+  long CheckPulled(DecoderMessage msg) {
+    if (mNumPulled >= mPushedMsgs.size() || !mPushedMsgs.get(mNumPulled).compareTo(msg)) {
+      System.err.println("Pulled message "+mNumPulled+" is not the one that was pushed");
+      System.exit(-1);
+    }
+    mNumPulled++;
+    return msg.mTime;
+  }
+
+  public static void main(String[] args) {
+    int numMessages = args.length > 1 ? Integer.parseInt(args[1]) : 1000;
+    JNIBenchmark benchmark = new JNIBenchmark(args[0], numMessages);
+  }
+
+}
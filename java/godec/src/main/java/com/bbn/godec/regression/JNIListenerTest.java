@@ -0,0 +1,82 @@
+package com.bbn.godec.regression;
+
+import java.io.File;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.HashSet;
+
+import com.bbn.godec.DecoderMessage;
+import com.bbn.godec.Godec;
+import com.bbn.godec.GodecJsonOverrides;
+import com.bbn.godec.GodecListener;
+import com.bbn.godec.GodecPullEndpoints;
+import com.bbn.godec.GodecPushEndpoints;
+import com.bbn.godec.NbestDecoderMessage;
+import com.bbn.godec.NbestEntry;
+
+/* Checks that a listener set with Godec.SetListener() gets every pushed message in order, in blocks no larger than requested, and onClosed() exactly once at the end */
+public class JNIListenerTest implements GodecListener {
+
+  static final int NumMessages = 20;
+  static final int MaxBlocksPerCall = 3;
+
+  ArrayList<DecoderMessage> mReceived = new ArrayList<DecoderMessage>();
+  int mNumClosed = 0;
+  String mError = null;
+
+  public synchronized void onMessages(ArrayList<HashMap<String,DecoderMessage>> msgBlocks) {
+    if (mNumClosed != 0) mError = "onMessages() was called after onClosed()";
+    if (msgBlocks.size() > MaxBlocksPerCall) mError = "Got "+msgBlocks.size()+" blocks in one call, asked for at most "+MaxBlocksPerCall;
+    for(HashMap<String,DecoderMessage> msgBlock : msgBlocks) mReceived.addAll(msgBlock.values());
+  }
+
+  public synchronized void onClosed() {
+    mNumClosed++;
+  }
+
+  NbestDecoderMessage MakeMessage(int msgIdx) {
+    ArrayList<NbestEntry> entries = new ArrayList<NbestEntry>();
+    long ticks = 100+msgIdx;
+    entries.add(new NbestEntry(new int[] {msgIdx}, new long[] {ticks}, new String[] {"word"+msgIdx}, new float[] {0.5f}));
+    return new NbestDecoderMessage("dummy", ticks, entries);
+  }
+
+  public JNIListenerTest(String rootJson) {
+    GodecPushEndpoints pushList = new GodecPushEndpoints();
+    pushList.addPushEndpoint("NbestDecoderMessage_in");
+    GodecPullEndpoints pullList = new GodecPullEndpoints();
+    HashSet<String> pullStreams = new HashSet<String>();
+    pullStreams.add("NbestDecoderMessage_in");
+    pullList.addPullEndpoint("listener_out", pullStreams);
+    Godec engine = new Godec(new File(rootJson), new GodecJsonOverrides(), pushList, pullList, true);
+    engine.SetListener("listener_out", this, MaxBlocksPerCall);
+
+    ArrayList<DecoderMessage> pushed = new ArrayList<DecoderMessage>();
+    for(int msgIdx = 0; msgIdx < NumMessages; msgIdx++) {
+      pushed.add(MakeMessage(msgIdx));
+      engine.PushMessage("NbestDecoderMessage_in", MakeMessage(msgIdx));
+    }
+    // Only returns once the listener has seen the close
+    engine.BlockingShutdown();
+
+    synchronized(this) {
+      if (mError != null) Fail(mError);
+      if (mNumClosed != 1) Fail("onClosed() was called "+mNumClosed+" times");
+      if (mReceived.size() != NumMessages) Fail("Listener got "+mReceived.size()+" of "+NumMessages+" messages");
+      for(int msgIdx = 0; msgIdx < NumMessages; msgIdx++) {
+        if (!pushed.get(msgIdx).compareTo(mReceived.get(msgIdx))) Fail("Message "+msgIdx+" not the same");
+      }
+    }
+    System.out.println("Listener got all messages.");
+  }
+
+  static void Fail(String error) {
+    System.err.println(error);
+    System.exit(-1);
+  }
+
+  public static void main(String[] args) {
+    JNIListenerTest listenerTest = new JNIListenerTest(args[0]);
+  }
+
+}
@@ -30,7 +30,8 @@ public class JNITest {
 
   Godec mEngine = null;
 
-  public JNITest(String rootJson, String testModes) {
+  // With batchSlices > 0, only checks that the Java component in jni_test.json processes Nbests in batches of that size
+  public JNITest(String rootJson, String testModes, int batchSlices) {
     GodecPushEndpoints pushList = new GodecPushEndpoints();
     GodecPullEndpoints pullList = new GodecPullEndpoints();
 
@@ -42,7 +43,19 @@ public class JNITest {
     }
 
     GodecJsonOverrides insideOv = new GodecJsonOverrides();
+    if (batchSlices > 0) {
+      HashSet<String> pullStreams = new HashSet<String>();
+      pullStreams.add("NbestDecoderMessage_out");
+      pullList.addPullEndpoint("java_out", pullStreams);
+      insideOv.addOverride("java.!batch_slices", Integer.toString(batchSlices));
+    }
     mEngine = new Godec(new File(rootJson), insideOv, pushList, pullList, true);
+    if (batchSlices > 0) {
+      System.out.println("Checking batched Java calls");
+      BatchPushPullCompare(batchSlices);
+      mEngine.BlockingShutdown();
+      return;
+    }
     long ticks = 100;
     if (testModes.contains("ConversationStateDecoderMessage"))
     {
@@ -130,6 +143,14 @@ public class JNITest {
           commEntries
           );
       PushPullCompare(msg);
+
+      // A subclass has no converter of its own, it gets the one of the closest registered superclass. Twice, the second time the lookup comes from the cache
+      System.out.println("Checking nbest message subclass");
+      for(int msgIdx = 0; msgIdx < 2; msgIdx++) {
+        ticks++;
+        NbestDecoderMessage subclassMsg = new NbestDecoderMessage("dummy", ticks, commEntries) {};
+        PushPullCompare(subclassMsg);
+      }
     }
 
     mEngine.BlockingShutdown();
@@ -138,7 +159,9 @@ public class JNITest {
 
   void PushPullCompare(DecoderMessage inMsg) {
     System.out.print("  Push, ");
-    String slot = inMsg.getClass().getSimpleName();
+    Class<?> msgClass = inMsg.getClass();
+    while (msgClass.isAnonymousClass()) msgClass = msgClass.getSuperclass();
+    String slot = msgClass.getSimpleName();
     mEngine.PushMessage(slot+"_in", inMsg);
     ArrayList<HashMap<String, DecoderMessage>> msgBlocks = null;
     System.out.print("Pull, ");
@@ -161,8 +184,47 @@ public class JNITest {
     System.out.println("Same.");
   }
 
+  NbestDecoderMessage MakeSingleWordNbest(long ticks, int wordIdx, String word) {
+    ArrayList<NbestEntry> entries = new ArrayList<NbestEntry>();
+    entries.add(new NbestEntry(new int[] {wordIdx}, new long[] {ticks}, new String[] {word}, new float[] {0.5f}));
+    return new NbestDecoderMessage("dummy", ticks, entries);
+  }
+
+  // Pushes two batches worth of Nbests through the Java component (TextTransform, which uppercases the text) and pulls its output
+  void BatchPushPullCompare(int batchSlices) {
+    int numMsgs = 2*batchSlices;
+    ArrayList<DecoderMessage> expectedMsgs = new ArrayList<DecoderMessage>();
+    for(int msgIdx = 0; msgIdx < numMsgs; msgIdx++) {
+      long ticks = 100+msgIdx;
+      mEngine.PushMessage("NbestDecoderMessage_in", MakeSingleWordNbest(ticks, msgIdx, "word"+msgIdx));
+      expectedMsgs.add(MakeSingleWordNbest(ticks, msgIdx, "WORD"+msgIdx));
+    }
+    ArrayList<DecoderMessage> outMsgs = new ArrayList<DecoderMessage>();
+    try {
+      while(outMsgs.size() < numMsgs) {
+        ArrayList<HashMap<String, DecoderMessage>> msgBlocks = mEngine.PullAllMessages("java_out", 1000.0f*30);
+        if (msgBlocks == null) {
+          System.err.println("Timed out after "+outMsgs.size()+" of "+numMsgs+" batched messages");
+          System.exit(-1);
+        }
+        for(HashMap<String, DecoderMessage> msgBlock : msgBlocks) outMsgs.addAll(msgBlock.values());
+      }
+    } catch (ChannelClosedException e1) {
+      System.err.println(e1.getMessage());
+      System.exit(-1);
+    }
+    for(int msgIdx = 0; msgIdx < numMsgs; msgIdx++) {
+      if (!expectedMsgs.get(msgIdx).compareTo(outMsgs.get(msgIdx))) {
+        System.err.println("Batched message "+msgIdx+" not as expected");
+        System.exit(-1);
+      }
+    }
+    System.out.println("Same.");
+  }
+
   public static void main(String[] args) {
-    JNITest jniTest = new JNITest(args[0], args[1]);
+    int batchSlices = args.length > 2 ? Integer.parseInt(args[2]) : 0;
+    JNITest jniTest = new JNITest(args[0], args[1], batchSlices);
   }
 
 }
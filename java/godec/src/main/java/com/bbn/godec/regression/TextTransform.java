@@ -57,4 +57,14 @@ public class TextTransform {
     return outMap;
   }
 
+  // Gets called instead of ProcessMessage when the component has "batch_slices" set
+  public ArrayList<HashMap<String, DecoderMessage>> ProcessMessageBatch(ArrayList<HashMap<String, DecoderMessage>> maps, long[] times) {
+    System.out.println("ProcessMessageBatch was called with "+maps.size()+" slices");
+    ArrayList<HashMap<String, DecoderMessage>> outMaps = new ArrayList<HashMap<String, DecoderMessage>>(maps.size());
+    for (int sliceIdx = 0; sliceIdx < maps.size(); sliceIdx++) {
+      outMaps.add(ProcessMessage(maps.get(sliceIdx), times[sliceIdx]));
+    }
+    return outMaps;
+  }
+
 }
@@ -10,6 +10,7 @@
 #include <boost/uuid/uuid_io.hpp>
 #include <time.h>
 #include <fstream>
+#include <future>
 
 namespace Godec {
 
@@ -37,6 +38,9 @@ std::string LoopProcessor::SlotFst = "fst";
 std::string LoopProcessor::SlotCnetLattice = "cnet_lattice";
 std::string LoopProcessor::GatherRuntimeStats = "gather_runtime_stats";
 std::string LoopProcessor::QuietGodec = "quiet_godec";
+std::string LoopProcessor::CountSlicePoolMisses = "count_slice_pool_misses";
+std::string LoopProcessor::MaxSlicePoolMisses = "max_slice_pool_misses";
+const uint64_t LoopProcessor::SlicePoolMissWarmup = 20;
 std::string LoopProcessor::SlotTimeMap = "time_map";
 std::string LoopProcessor::SlotControl = "control";
 std::string LoopProcessor::SlotSearchOutput = "fst_search_output";
@@ -52,20 +56,19 @@ std::string DecoderMessage::describeThyself() const {
 }
 
 void DecoderMessage::JNIGetDecoderMessageVals(JNIEnv* env, jobject& jMsg, std::string& tag, uint64_t& time, std::string& descriptor) {
-    jclass DecoderMessageClass = env->FindClass("com/bbn/godec/DecoderMessage");
-    jfieldID jTagId = env->GetFieldID(DecoderMessageClass, "mTag", "Ljava/lang/String;");
-    jfieldID jTimeId = env->GetFieldID(DecoderMessageClass, "mTime", "J");
-    jstring jTagObj = (jstring)env->GetObjectField(jMsg, jTagId);
+    const JNIIds& ids = GetJNIIds(env);
+    jstring jTagObj = (jstring)env->GetObjectField(jMsg, ids.mDecoderMessageTag);
     const char* tagChars = env->GetStringUTFChars(jTagObj, 0);
     tag = tagChars;
     env->ReleaseStringUTFChars(jTagObj, tagChars);
-    time = env->GetLongField(jMsg, jTimeId);
+    env->DeleteLocalRef(jTagObj);
+    time = env->GetLongField(jMsg, ids.mDecoderMessageTime);
 
-    jmethodID jGetDescriptor = env->GetMethodID(DecoderMessageClass, "getFullDescriptorString", "()Ljava/lang/String;");
-    jstring jDescriptor = (jstring)env->CallObjectMethod(jMsg, jGetDescriptor);
+    jstring jDescriptor = (jstring)env->CallObjectMethod(jMsg, ids.mDecoderMessageGetFullDescriptor);
     const char* descriptorChars = env->GetStringUTFChars(jDescriptor, 0);
     descriptor = descriptorChars;
     env->ReleaseStringUTFChars(jDescriptor, descriptorChars);
+    env->DeleteLocalRef(jDescriptor);
 }
 
 #ifndef ANDROID
@@ -86,7 +89,7 @@ void DecoderMessage::PythonGetDecoderMessageVals(PyObject* pMsg, std::string& ta
 /*
 ############ Loop processor ###################
 */
-LoopProcessor::LoopProcessor(std::string id, ComponentGraphConfig* pt) : mVerbose(false), mIsFinished(false) {
+LoopProcessor::LoopProcessor(std::string id, ComponentGraphConfig* pt) : mVerbose(false), mIsFinished(false), mBatchSlices(0), mBatchLatencyMs(-1.0f) {
     mId = id;
 
     mComponentGraph = pt->GetComponentGraph();
@@ -94,7 +97,7 @@ LoopProcessor::LoopProcessor(std::string id, ComponentGraphConfig* pt) : mVerbos
     if (pt->get_optional_READ_DECLARATION_BEFORE_USE<bool>("verbose")) {
         mVerbose = pt->get<bool>("verbose", "Shows incoming and outgoing messages, as well as internal proceedings of the component");
     }
-    if (pt->globalVals.get<bool>(GatherRuntimeStats)) {
+    if (pt->globalVals.get<bool>(GatherRuntimeStats) || (pt->globalVals.exists(CountSlicePoolMisses) && pt->globalVals.get<bool>(CountSlicePoolMisses))) {
         mRuntimeStats[getLPId(false, true)] = boost::shared_ptr<RuntimeStats>(new RuntimeStats());
     }
 
@@ -111,6 +114,38 @@ LoopProcessor::LoopProcessor(std::string id, ComponentGraphConfig* pt) : mVerbos
         debugSlicing = pt->get<bool>("debug_slicing", "Show how the component tries to slice the messages");
     }
     mFullStream.setIdVerbose(id, debugSlicing);
+
+    // Slice coalescing, for components that prefer to process larger blocks at once
+    if (pt->get_optional_READ_DECLARATION_BEFORE_USE<int64_t>("min_slice_ticks")) {
+        int64_t minSliceTicks = pt->get<int64_t>("min_slice_ticks", "Hold back incoming slices until they span at least this many ticks (released earlier at utterance end)");
+        float maxSliceLatencyMs = -1.0f;
+        if (pt->get_optional_READ_DECLARATION_BEFORE_USE<float>("max_slice_latency_ms")) {
+            maxSliceLatencyMs = pt->get<float>("max_slice_latency_ms", "Maximum time in milliseconds a slice is held back for min_slice_ticks");
+        }
+        mFullStream.setCoalescing(minSliceTicks, maxSliceLatencyMs);
+    }
+
+    // Thread placement. Component-level values override the ones in global_opts
+    boost::optional<std::string> cpuAffinity = pt->get_optional_READ_DECLARATION_BEFORE_USE<std::string>("cpu_affinity");
+    if (cpuAffinity) cpuAffinity = pt->get<std::string>("cpu_affinity", "CPUs this component's threads are pinned to, e.g. '0-3,8'");
+    else if (pt->globalVals.exists("cpu_affinity")) cpuAffinity = pt->globalVals.get<std::string>("cpu_affinity");
+    if (cpuAffinity) mThreadPlacement.mCpus = ParseCpuList(*cpuAffinity);
+
+    if (pt->get_optional_READ_DECLARATION_BEFORE_USE<int>("numa_node")) {
+        mThreadPlacement.mNumaNode = pt->get<int>("numa_node", "NUMA node this component's threads and buffers should be placed on");
+    } else if (pt->globalVals.exists("numa_node")) {
+        mThreadPlacement.mNumaNode = pt->globalVals.get<int>("numa_node");
+    }
+
+    if (pt->get_optional_READ_DECLARATION_BEFORE_USE<int>("thread_priority")) {
+        mThreadPlacement.mPriority = pt->get<int>("thread_priority", "Thread scheduling priority (0=default, 1..99=real-time, negative=background)");
+    } else if (pt->globalVals.exists("thread_priority")) {
+        mThreadPlacement.mPriority = pt->globalVals.get<int>("thread_priority");
+    }
+
+    // Test mode for catching steady-state allocation regressions
+    mCountSlicePoolMisses = pt->globalVals.exists(CountSlicePoolMisses) && pt->globalVals.get<bool>(CountSlicePoolMisses);
+    mMaxSlicePoolMisses = pt->globalVals.exists(MaxSlicePoolMisses) ? pt->globalVals.get<int64_t>(MaxSlicePoolMisses) : -1;
     mPt = pt;
 }
 
@@ -245,8 +280,27 @@ std::string LoopProcessor::getLPId(bool withTime, bool trimmed) {
 }
 
 void LoopProcessor::startDecodingLoop() {
-    mProcThread = boost::thread(&LoopProcessor::ProcessLoop, this);
-    RegisterThreadForLogging(mProcThread, mLogPtr, isVerbose());
+    mProcThread = startPlacedThread(boost::bind(&LoopProcessor::ProcessLoop, this), "processing");
+}
+
+boost::thread LoopProcessor::startPlacedThread(boost::function<void()> func, const std::string& role) {
+    ThreadPlacement placement = mThreadPlacement;
+    auto statsIt = mRuntimeStats.find(getLPId(false, true));
+    AllocationCounters* allocCounters = statsIt != mRuntimeStats.end() ? &statsIt->second->mAllocations : nullptr;
+    // The thread places itself before it does anything else, and reports back what it applied so it can be logged here
+    auto placementResult = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> placementDescription = placementResult->get_future();
+    boost::thread thread([placement, allocCounters, func, placementResult]() {
+        placementResult->set_value(placement.isSet() ? placement.applyToCurrentThread() : "");
+        placement.bindMemoryOfCurrentThread();
+        SetThreadAllocationCounters(allocCounters);
+        func();
+    });
+    RegisterThreadForLogging(thread, mLogPtr, isVerbose());
+    if (mThreadPlacement.isSet()) {
+        GODEC_INFO << getLPId(false) << ": " << role << " thread placement: " << placementDescription.get() << std::endl;
+    }
+    return thread;
 }
 
 void LoopProcessor::ProcessLoopMessages() {
@@ -264,8 +318,9 @@ void LoopProcessor::ProcessLoopMessages() {
                 leastFilledSlot = mFullStream.getLeastFilledSlot();
                 statsPtr->mDetailedTimer.start();
             }
-            res = mInputChannel.get(newMessage, FLT_MAX);
+            res = mInputChannel.get(newMessage, std::min(mFullStream.getSecondsUntilDeadline(), getSecondsUntilBatchDeadline()));
             if (res == ChannelClosed)  break;
+            if (res == ChannelTimeout) break; // A held-back slice or slice batch is due
 
             if (statsPtr != nullptr) {
                 boost::chrono::duration<float> seconds = boost::chrono::nanoseconds(statsPtr->mDetailedTimer.elapsed().wall);
@@ -308,10 +363,18 @@ void LoopProcessor::ProcessLoopMessages() {
         do {
             gotCoherent = false;
             int64_t prevCutoff = timeCutoff;
-            auto newMessages = mFullStream.getNewCoherent(timeCutoff);
+            uint64_t poolMissesBefore = GetThreadPoolMisses();
+            auto newMessages = mFullStream.getNewCoherent(timeCutoff, res == ChannelClosed);
             if (newMessages.size() > 0) {
                 DecoderMessageBlock msgBlock(getLPId(false), newMessages, prevCutoff);
-                ProcessMessage(msgBlock);
+                if (mBatchSlices > 0) {
+                    if (mPendingBatch.empty()) mPendingBatchSince = boost::chrono::steady_clock::now();
+                    mPendingBatch.push_back(msgBlock);
+                    if ((int)mPendingBatch.size() >= mBatchSlices) flushSliceBatch();
+                } else {
+                    ProcessMessage(msgBlock);
+                }
+                if (mCountSlicePoolMisses) recordSlicePoolMisses(*statsPtr, GetThreadPoolMisses() - poolMissesBefore);
                 if ((statsPtr != nullptr) && isVerbose()) {
                     boost::chrono::duration<double> seconds = boost::chrono::nanoseconds(statsPtr->mDetailedTimer.elapsed().wall);
                     GODEC_INFO << "LP " << getLPId() << ": Took " << seconds.count() << "s to process " << (timeCutoff-prevCutoff) << " ticks" << std::endl;
@@ -319,6 +382,7 @@ void LoopProcessor::ProcessLoopMessages() {
                 gotCoherent = true;
             }
         } while (gotCoherent);
+        if (!mPendingBatch.empty() && (res == ChannelClosed || getSecondsUntilBatchDeadline() <= 0.0f)) flushSliceBatch();
         if (statsPtr != nullptr) statsPtr->mTotalNumTicks = timeCutoff;
         if (res == ChannelClosed)  break;
     }
@@ -327,6 +391,45 @@ void LoopProcessor::ProcessLoopMessages() {
     }
 }
 
+void LoopProcessor::recordSlicePoolMisses(RuntimeStats& stats, uint64_t numMisses) {
+    stats.mNumSlices++;
+    stats.mSlicePoolMisses += numMisses;
+    if (isVerbose()) GODEC_INFO << "LP " << getLPId() << ": " << numMisses << " message pool misses in this slice" << std::endl;
+    if (stats.mNumSlices <= SlicePoolMissWarmup) return;
+    stats.mMaxSteadySlicePoolMisses = std::max(stats.mMaxSteadySlicePoolMisses, numMisses);
+    if (mMaxSlicePoolMisses >= 0 && numMisses > (uint64_t)mMaxSlicePoolMisses) {
+        GODEC_ERR << getLPId(false) << ": Slice " << stats.mNumSlices << " caused " << numMisses << " message pool misses, more than max_slice_pool_misses=" << mMaxSlicePoolMisses;
+    }
+}
+
+void LoopProcessor::enableSliceBatching(ComponentGraphConfig* pt) {
+    if (pt->get_optional_READ_DECLARATION_BEFORE_USE<int>("batch_slices")) {
+        mBatchSlices = pt->get<int>("batch_slices", "Maximum number of consecutive slices handed to the component in one call");
+        if (mBatchSlices < 1) GODEC_ERR << getLPId(false) << ": batch_slices needs to be at least 1";
+        if (pt->get_optional_READ_DECLARATION_BEFORE_USE<float>("batch_latency_ms")) {
+            mBatchLatencyMs = pt->get<float>("batch_latency_ms", "Maximum time in milliseconds the first slice of a batch waits for the batch to fill up");
+        }
+    }
+}
+
+void LoopProcessor::ProcessMessageBatch(const std::vector<DecoderMessageBlock>& msgBlocks) {
+    for (auto blockIt = msgBlocks.begin(); blockIt != msgBlocks.end(); blockIt++) {
+        ProcessMessage(*blockIt);
+    }
+}
+
+float LoopProcessor::getSecondsUntilBatchDeadline() {
+    if (mPendingBatch.empty() || mBatchLatencyMs < 0) return FLT_MAX;
+    boost::chrono::duration<float> waited = boost::chrono::steady_clock::now() - mPendingBatchSince;
+    return std::max(0.0f, mBatchLatencyMs/1000.0f - waited.count());
+}
+
+void LoopProcessor::flushSliceBatch() {
+    if (isVerbose()) GODEC_INFO << "LP " << getLPId() << ": Processing batch of " << mPendingBatch.size() << " slices" << std::endl;
+    ProcessMessageBatch(mPendingBatch);
+    mPendingBatch.clear();
+}
+
 void LoopProcessor::ProcessLoop() {
     ProcessLoopMessages();
     Shutdown();
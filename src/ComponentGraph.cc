@@ -97,6 +97,7 @@ ComponentGraph::ComponentGraph(std::string prefix, std::string inFile, Component
             }
             mGlobalDllName2Handle->insert(subModuleComponent->mCgraph->mGlobalDllName2Handle->begin(),
                     subModuleComponent->mCgraph->mGlobalDllName2Handle->end());
+            mMessageConverters.merge(subModuleComponent->mCgraph->mMessageConverters);
         }
 
         subConfig->ParameterCheck();
@@ -147,6 +148,7 @@ LoopProcessor* ComponentGraph::LoadComponent(std::string compType, std::string c
     } else {
         dllHandle = LoadGodecLibrary(dllName);
         (*mGlobalDllName2Handle)[dllName] = dllHandle;
+        mMessageConverters.addLibrary(dllName, dllHandle);
     }
 #ifdef _MSC_VER
     GodecGetComponentFunc loadFunc = (GodecGetComponentFunc)GetProcAddress(dllHandle,"GodecGetComponent");
@@ -170,6 +172,24 @@ void ComponentGraph::ListComponents(std::string dllName) {
     listFunc();
 }
 
+int ComponentGraph::RunWorker(std::string kind, std::string config) {
+    DllPtr dllHandle = LoadGodecLibrary("libgodec_core");
+#ifdef _MSC_VER
+    GodecRunWorkerFunc runFunc = (GodecRunWorkerFunc)GetProcAddress(dllHandle,"GodecRunWorker");
+#else
+    GodecRunWorkerFunc runFunc = (GodecRunWorkerFunc)dlsym(dllHandle, "GodecRunWorker");
+#endif
+    if (runFunc == NULL) GODEC_ERR << "Could not get GodecRunWorker() function from libgodec_core";
+    return runFunc(kind, config);
+}
+
+std::vector<std::string> ComponentGraph::GetLoadedLibraries() const {
+    std::vector<std::string> out;
+    if (mGlobalDllName2Handle == nullptr) return out;
+    for (auto dllNameIt = mGlobalDllName2Handle->begin(); dllNameIt != mGlobalDllName2Handle->end(); dllNameIt++) out.push_back(dllNameIt->first);
+    return out;
+}
+
 DllPtr ComponentGraph::LoadGodecLibrary(std::string dllName) {
     DllPtr dllHandle;
 #ifdef _MSC_VER
@@ -239,6 +259,24 @@ ComponentGraph::~ComponentGraph() {
             }
         }
         if (ss.str() != "") GODEC_INFO << "################## " << mId << ": Component throughput in ticks/second ###########" << std::endl << ss.str() << "###########################" << std::endl;
+
+        std::stringstream allocSs;
+        for (auto compIt = pairs.begin(); compIt != pairs.end(); compIt++) {
+            const AllocationCounters& allocs = compIt->second.mAllocations;
+            if (allocs.mMessages == 0 && allocs.mPayloadsFresh == 0 && allocs.mPayloadsReused == 0) continue;
+            allocSs << std::left << std::setw(longestName) << compIt->first << ": ";
+            allocSs << allocs.mMessages << " messages, " << allocs.mPayloadsFresh << " fresh payloads (" << allocs.mPayloadBytesFresh << " bytes), " << allocs.mPayloadsReused << " reused payloads" << std::endl;
+        }
+        if (allocSs.str() != "") GODEC_INFO << "################## " << mId << ": Component message allocations ###########" << std::endl << allocSs.str() << "###########################" << std::endl;
+
+        std::stringstream sliceSs;
+        for (auto compIt = pairs.begin(); compIt != pairs.end(); compIt++) {
+            const RuntimeStats& stats = compIt->second;
+            if (stats.mNumSlices == 0) continue;
+            sliceSs << std::left << std::setw(longestName) << compIt->first << ": ";
+            sliceSs << stats.mNumSlices << " slices, " << (stats.mSlicePoolMisses / (double)stats.mNumSlices) << " per slice, at most " << stats.mMaxSteadySlicePoolMisses << " after the first " << LoopProcessor::SlicePoolMissWarmup << " slices" << std::endl;
+        }
+        if (sliceSs.str() != "") GODEC_INFO << "################## " << mId << ": Message pool misses per slice ###########" << std::endl << sliceSs.str() << "###########################" << std::endl;
     }
 
     mComponents.clear(); // This should call the respective destructors (which might lie across the DLL boundary)
@@ -307,6 +345,7 @@ void ComponentGraph::DeleteApiEndpoint(std::string endpointName) {
 }
 
 void ComponentGraph::WaitTilShutdown() {
+    if (ApiEndpoint::OnCallbackThread()) GODEC_ERR << "WaitTilShutdown() can not be called from inside an endpoint callback, the endpoints wait for their callbacks before shutting down";
     bool allShutdown = true;
     do {
         allShutdown = true;
@@ -337,17 +376,141 @@ ChannelReturnResult ComponentGraph::PullAllMessages(std::string channelName, flo
     return endpoint->PullAllMessages(newSlice, maxTimeout);
 }
 
+void ComponentGraph::SetApiEndpointCallback(std::string channelName, ApiEndpointSliceCallback onSlices, ApiEndpointClosedCallback onClosed, int maxSlicesPerCall) {
+    auto endpoint = GetApiEndpoint(channelName);
+    endpoint->SetCallback(onSlices, onClosed, maxSlicesPerCall);
+}
+
 DecoderMessage_ptr ComponentGraph::JNIToDecoderMsg(JNIEnv *env, jobject jMsg) {
-    for(auto it = mGlobalDllName2Handle->begin(); it != mGlobalDllName2Handle->end(); it++) {
-        std::string dllName = it->first;
-        DllPtr dllHandle = it->second;
+    return mMessageConverters.fromJNI(env, jMsg);
+}
+
+DecoderMessage_ptr ComponentGraph::WireToDecoderMsg(WireReader& reader) {
+    return mMessageConverters.fromWire(reader);
+}
+
+#ifndef ANDROID
+DecoderMessage_ptr ComponentGraph::PythonToDecoderMsg(PyObject* pMsg) {
+    return mMessageConverters.fromPython(pMsg);
+}
+#endif
+
+/*
+############ Message converter registry ###################
+*/
+
+void MessageConverterRegistry::addLibrary(const std::string& dllName, DllPtr dllHandle) {
 #ifdef _MSC_VER
-        GodecJNIToMsgFunc jniToMsgFunc = (GodecJNIToMsgFunc)GetProcAddress(dllHandle,"GodecJNIToMsg");
+    GodecGetMessageConvertersFunc convertersFunc = (GodecGetMessageConvertersFunc)GetProcAddress(dllHandle,"GodecGetMessageConverters");
 #else
-        GodecJNIToMsgFunc jniToMsgFunc = (GodecJNIToMsgFunc)dlsym(dllHandle, "GodecJNIToMsg");
+    GodecGetMessageConvertersFunc convertersFunc = (GodecGetMessageConvertersFunc)dlsym(dllHandle, "GodecGetMessageConverters");
 #endif
-        if (jniToMsgFunc == NULL) GODEC_ERR << "Could not get GodecJNIToMsg function from DLL " << dllName;
-        DecoderMessage_ptr newMsg = jniToMsgFunc(env, jMsg);
+    if (convertersFunc != NULL) {
+        addConverters(dllName, convertersFunc());
+        return;
+    }
+#ifdef _MSC_VER
+    GodecJNIToMsgFunc jniToMsgFunc = (GodecJNIToMsgFunc)GetProcAddress(dllHandle,"GodecJNIToMsg");
+#else
+    GodecJNIToMsgFunc jniToMsgFunc = (GodecJNIToMsgFunc)dlsym(dllHandle, "GodecJNIToMsg");
+#endif
+    if (jniToMsgFunc != NULL) {
+        mUnregisteredJNIConverters[dllName] = jniToMsgFunc;
+        clearJNIClassCache();
+    }
+#ifndef ANDROID
+#ifdef _MSC_VER
+    GodecPythonToMsgFunc pythonToMsgFunc = (GodecPythonToMsgFunc)GetProcAddress(dllHandle,"GodecPythonToMsg");
+#else
+    GodecPythonToMsgFunc pythonToMsgFunc = (GodecPythonToMsgFunc)dlsym(dllHandle, "GodecPythonToMsg");
+#endif
+    if (pythonToMsgFunc != NULL) mUnregisteredPythonConverters[dllName] = pythonToMsgFunc;
+#endif
+}
+
+void MessageConverterRegistry::addConverters(const std::string& dllName, const std::vector<GodecMessageConverter>& converters) {
+    clearJNIClassCache();
+    for (auto it = converters.begin(); it != converters.end(); it++) {
+        if (it->mJavaClass != "" && it->mFromJNI != NULL) {
+            if (mJavaClass2Converter.find(it->mJavaClass) != mJavaClass2Converter.end()) GODEC_ERR << dllName << ": Java message class " << it->mJavaClass << " is already registered by another library";
+            mJavaClass2Converter[it->mJavaClass] = it->mFromJNI;
+        }
+#ifndef ANDROID
+        if (it->mPythonType != "" && it->mFromPython != NULL) {
+            if (mPythonType2Converter.find(it->mPythonType) != mPythonType2Converter.end()) GODEC_ERR << dllName << ": Python message type " << it->mPythonType << " is already registered by another library";
+            mPythonType2Converter[it->mPythonType] = it->mFromPython;
+        }
+#endif
+        if (!it->mWireType.is_nil() && it->mFromWire != NULL) {
+            if (mWireType2Converter.find(it->mWireType) != mWireType2Converter.end()) GODEC_ERR << dllName << ": Wire format decoder for message type " << it->mWireType << " is already registered by another library";
+            mWireType2Converter[it->mWireType] = it->mFromWire;
+        }
+    }
+}
+
+void MessageConverterRegistry::merge(const MessageConverterRegistry& other) {
+    clearJNIClassCache();
+    // The same library can show up in both, so no duplicate check here
+    mWireType2Converter.insert(other.mWireType2Converter.begin(), other.mWireType2Converter.end());
+    mJavaClass2Converter.insert(other.mJavaClass2Converter.begin(), other.mJavaClass2Converter.end());
+    mUnregisteredJNIConverters.insert(other.mUnregisteredJNIConverters.begin(), other.mUnregisteredJNIConverters.end());
+#ifndef ANDROID
+    mPythonType2Converter.insert(other.mPythonType2Converter.begin(), other.mPythonType2Converter.end());
+    mUnregisteredPythonConverters.insert(other.mUnregisteredPythonConverters.begin(), other.mUnregisteredPythonConverters.end());
+#endif
+}
+
+// Walks up from the message's class until it hits one that's registered
+GodecJNIToMsgFunc MessageConverterRegistry::findJNIConverter(JNIEnv* env, jclass jMsgClass) const {
+    const JNIIds& ids = GetJNIIds(env);
+    jclass jClass = (jclass)env->NewLocalRef(jMsgClass);
+    while (jClass != nullptr) {
+        jstring jClassName = (jstring)env->CallObjectMethod(jClass, ids.mClassGetName);
+        const char* classNameChars = env->GetStringUTFChars(jClassName, 0);
+        auto converterIt = mJavaClass2Converter.find(classNameChars);
+        env->ReleaseStringUTFChars(jClassName, classNameChars);
+        env->DeleteLocalRef(jClassName);
+        if (converterIt != mJavaClass2Converter.end()) {
+            env->DeleteLocalRef(jClass);
+            return converterIt->second;
+        }
+        jclass jSuperClass = env->GetSuperclass(jClass);
+        env->DeleteLocalRef(jClass);
+        jClass = jSuperClass;
+    }
+    return nullptr;
+}
+
+// Only gets called while the graph is being built, before any messages get converted. The global references are leaked, there is no JNIEnv to release them with
+void MessageConverterRegistry::clearJNIClassCache() {
+    std::lock_guard<std::mutex> lock(mJNIClassCacheMutex);
+    mJNIClassCache.clear();
+}
+
+DecoderMessage_ptr MessageConverterRegistry::fromJNI(JNIEnv* env, jobject jMsg) const {
+    jclass jMsgClass = env->GetObjectClass(jMsg);
+    GodecJNIToMsgFunc converter = nullptr;
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(mJNIClassCacheMutex);
+        for(auto it = mJNIClassCache.begin(); it != mJNIClassCache.end(); it++) {
+            if (env->IsSameObject(it->first, jMsgClass)) {
+                converter = it->second;
+                cached = true;
+                break;
+            }
+        }
+    }
+    if (!cached) {
+        // Two threads might both end up adding the same class, which is harmless
+        converter = findJNIConverter(env, jMsgClass);
+        std::lock_guard<std::mutex> lock(mJNIClassCacheMutex);
+        mJNIClassCache.push_back(std::make_pair((jclass)env->NewGlobalRef(jMsgClass), converter));
+    }
+    env->DeleteLocalRef(jMsgClass);
+    if (converter != nullptr) return converter(env, jMsg);
+    for(auto it = mUnregisteredJNIConverters.begin(); it != mUnregisteredJNIConverters.end(); it++) {
+        DecoderMessage_ptr newMsg = it->second(env, jMsg);
         if (newMsg != NULL) return newMsg;
     }
     GODEC_ERR << "No library could convert Java message to C++";
@@ -355,22 +518,27 @@ DecoderMessage_ptr ComponentGraph::JNIToDecoderMsg(JNIEnv *env, jobject jMsg) {
 }
 
 #ifndef ANDROID
-DecoderMessage_ptr ComponentGraph::PythonToDecoderMsg(PyObject* pMsg) {
-    for(auto it = mGlobalDllName2Handle->begin(); it != mGlobalDllName2Handle->end(); it++) {
-        std::string dllName = it->first;
-        DllPtr dllHandle = it->second;
-#ifdef _MSC_VER
-        GodecPythonToMsgFunc pythonToMsgFunc = (GodecPythonToMsgFunc)GetProcAddress(dllHandle,"GodecPythonToMsg");
-#else
-        GodecPythonToMsgFunc pythonToMsgFunc = (GodecPythonToMsgFunc)dlsym(dllHandle, "GodecPythonToMsg");
-#endif
-        if (pythonToMsgFunc == NULL) GODEC_ERR << "Could not get GodecPythonToMsg function from DLL " << dllName;
-        DecoderMessage_ptr newMsg = pythonToMsgFunc(pMsg);
+DecoderMessage_ptr MessageConverterRegistry::fromPython(PyObject* pMsg) const {
+    PyObject* pType = PyDict_GetItemString(pMsg, "type");
+    if (pType == NULL) GODEC_ERR << "Passed-in Python message did not have a 'type' key. Invalid message";
+    const char* type = PyUnicode_AsUTF8(pType);
+    if (type == NULL) GODEC_ERR << "The 'type' entry of a Python message needs to be a string";
+    auto converterIt = mPythonType2Converter.find(type);
+    if (converterIt != mPythonType2Converter.end()) return converterIt->second(pMsg);
+    for(auto it = mUnregisteredPythonConverters.begin(); it != mUnregisteredPythonConverters.end(); it++) {
+        DecoderMessage_ptr newMsg = it->second(pMsg);
         if (newMsg != NULL) return newMsg;
     }
-    GODEC_ERR << "No library could convert Python message to C++";
+    GODEC_ERR << "No library could convert Python message of type " << type << " to C++";
     return nullptr;
 }
 #endif
 
+DecoderMessage_ptr MessageConverterRegistry::fromWire(WireReader& reader) const {
+    WireMessageHeader header = ReadWireMessageHeader(reader);
+    auto converterIt = mWireType2Converter.find(header.mType);
+    if (converterIt == mWireType2Converter.end()) GODEC_ERR << "No library can decode wire format message of type " << header.mType;
+    return ReadWireMessageBody(reader, header, converterIt->second);
+}
+
 }
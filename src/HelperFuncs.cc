@@ -1,9 +1,20 @@
 #include <iostream>
 #include <godec/HelperFuncs.h>
+#include <godec/MessagePool.h>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/optional/optional.hpp>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
 
 namespace Godec {
 
@@ -23,12 +34,88 @@ std::string Json2String(json js) {
 }
 
 unordered_map<std::string, std::pair<bool, FILE*>> GlobalThreadId2LogHandle;
+// Threads of several graphs (e.g. "godec batch") register while others are logging
+static std::mutex GlobalThreadId2LogHandleMutex;
 
 void RegisterThreadForLogging(boost::thread& thread, FILE* logPtr, bool verbose) {
     std::string threadId = boost::lexical_cast<std::string>(thread.get_id());
+    std::lock_guard<std::mutex> lock(GlobalThreadId2LogHandleMutex);
     GlobalThreadId2LogHandle[threadId] = std::make_pair(verbose, logPtr);
 }
 
+std::vector<int> ParseCpuList(const std::string& cpuList) {
+    std::vector<int> out;
+    std::vector<std::string> ranges;
+    std::string trimmedList = boost::algorithm::trim_copy(cpuList);
+    if (trimmedList == "") return out;
+    boost::split(ranges, trimmedList, boost::is_any_of(","));
+    for (auto it = ranges.begin(); it != ranges.end(); it++) {
+        std::vector<std::string> fromTo;
+        boost::split(fromTo, *it, boost::is_any_of("-"));
+        try {
+            int from = boost::lexical_cast<int>(boost::algorithm::trim_copy(fromTo[0]));
+            int to = fromTo.size() == 2 ? boost::lexical_cast<int>(boost::algorithm::trim_copy(fromTo[1])) : from;
+            if (fromTo.size() > 2 || from < 0 || to < from) throw std::invalid_argument("");
+            for (int cpu = from; cpu <= to; cpu++) out.push_back(cpu);
+        } catch (const std::exception& e) {
+            GODEC_ERR << "Malformed CPU list '" << cpuList << "'. Expected format is e.g. '0-3,8,10-11'";
+        }
+    }
+    return out;
+}
+
+std::string ThreadPlacement::applyToCurrentThread() const {
+    std::stringstream ss;
+#ifdef __linux__
+    std::vector<int> cpus = mCpus;
+    if (cpus.empty() && mNumaNode >= 0) {
+        std::ifstream nodeCpus("/sys/devices/system/node/node" + boost::lexical_cast<std::string>(mNumaNode) + "/cpulist");
+        std::string nodeCpuList;
+        if (!nodeCpus.fail() && std::getline(nodeCpus, nodeCpuList)) cpus = ParseCpuList(nodeCpuList);
+        else ss << "[NUMA node " << mNumaNode << " not found, not pinning] ";
+    }
+    if (!cpus.empty()) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (auto it = cpus.begin(); it != cpus.end(); it++) {
+            if (*it < CPU_SETSIZE) CPU_SET(*it, &cpuSet);
+        }
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+        ss << "cpus=";
+        for (auto it = cpus.begin(); it != cpus.end(); it++) ss << (it == cpus.begin() ? "" : ",") << *it;
+        if (ret != 0) ss << " [FAILED: " << strerror(ret) << "]";
+    } else {
+        ss << "cpus=any";
+    }
+    ss << ", numa_node=" << (mNumaNode >= 0 ? boost::lexical_cast<std::string>(mNumaNode) : "any");
+    if (mPriority != 0) {
+        sched_param param;
+        int policy = mPriority > 0 ? SCHED_FIFO : SCHED_BATCH;
+        param.sched_priority = mPriority > 0 ? std::min(mPriority, sched_get_priority_max(SCHED_FIFO)) : 0;
+        int ret = pthread_setschedparam(pthread_self(), policy, &param);
+        ss << ", priority=" << (mPriority > 0 ? "SCHED_FIFO:" + boost::lexical_cast<std::string>(param.sched_priority) : "SCHED_BATCH");
+        if (ret != 0) ss << " [FAILED: " << strerror(ret) << (ret == EPERM ? ", real-time scheduling requires CAP_SYS_NICE or an rtprio limit" : "") << "]";
+    } else {
+        ss << ", priority=default";
+    }
+#else
+    ss << "not supported on this platform, ignored";
+#endif
+    return ss.str();
+}
+
+void ThreadPlacement::bindMemoryOfCurrentThread() const {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    if (mNumaNode < 0) return;
+    // Equivalent of libnuma's numa_set_preferred(), without pulling in the dependency. Falls back to other nodes if the preferred one is full
+    const int MPOL_PREFERRED_MODE = 1;
+    const int numBitsPerLong = 8*sizeof(unsigned long);
+    std::vector<unsigned long> nodeMask(mNumaNode / numBitsPerLong + 1, 0);
+    nodeMask[mNumaNode / numBitsPerLong] |= 1UL << (mNumaNode % numBitsPerLong);
+    syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, nodeMask.data(), nodeMask.size()*numBitsPerLong + 1);
+#endif
+}
+
 GodecErrorLogger::GodecErrorLogger(LogMessageEnvelope::Severity severity, const char *func, const char *file, int32_t line) {
     // Obviously, we assume the strings survive the destruction of this object.
     envelope_.severity = severity;
@@ -70,7 +157,12 @@ void GodecErrorLogger::HandleMessage(const LogMessageEnvelope &envelope, const c
     }
 
     std::string threadId = boost::lexical_cast<std::string>(boost::this_thread::get_id());
-    auto logPair = (GlobalThreadId2LogHandle.find(threadId) != GlobalThreadId2LogHandle.end()) ? GlobalThreadId2LogHandle[threadId] : std::make_pair(true, stderr);
+    std::pair<bool, FILE*> logPair = std::make_pair(true, stderr);
+    {
+        std::lock_guard<std::mutex> lock(GlobalThreadId2LogHandleMutex);
+        auto logIt = GlobalThreadId2LogHandle.find(threadId);
+        if (logIt != GlobalThreadId2LogHandle.end()) logPair = logIt->second;
+    }
     if (logPair.first || envelope.severity == LogMessageEnvelope::kError) {
         fprintf(logPair.second, "%s\n", outString.str().c_str());
         fflush(logPair.second);
@@ -164,24 +256,240 @@ void OverlayPropertyTrees(const json& tree1, const std::string& tree1Path, const
 
 /* JNI helpers */
 
-jobject CreateJNIVector(JNIEnv* env, Vector& data) {
-    jclass VectorClass = env->FindClass("com/bbn/godec/Vector");
-    jmethodID jVectorInit = env->GetMethodID(VectorClass, "<init>", "([F)V");
-    jfloatArray jAudioArrayObj = env->NewFloatArray((jsize)data.size());
-    env->SetFloatArrayRegion(jAudioArrayObj, 0, (jsize)data.size(), data.data());
-    return env->NewObject(VectorClass, jVectorInit, jAudioArrayObj);
+static jclass FindJNIClass(JNIEnv* env, const char* name) {
+    jclass localClass = env->FindClass(name);
+    if (localClass == nullptr) {
+        env->ExceptionClear();
+        GODEC_ERR << "Could not find Java class " << name << ", make sure the Godec jar is in the class path";
+    }
+    jclass globalClass = (jclass)env->NewGlobalRef(localClass);
+    env->DeleteLocalRef(localClass);
+    return globalClass;
+}
+
+static jmethodID FindJNIMethod(JNIEnv* env, jclass clazz, const char* name, const char* signature) {
+    jmethodID id = env->GetMethodID(clazz, name, signature);
+    if (id == nullptr) {
+        env->ExceptionClear();
+        GODEC_ERR << "Could not find Java method " << name << signature << ", is the Godec jar the same version as the library?";
+    }
+    return id;
+}
+
+static jfieldID FindJNIField(JNIEnv* env, jclass clazz, const char* name, const char* signature) {
+    jfieldID id = env->GetFieldID(clazz, name, signature);
+    if (id == nullptr) {
+        env->ExceptionClear();
+        GODEC_ERR << "Could not find Java field " << name << " (" << signature << "), is the Godec jar the same version as the library?";
+    }
+    return id;
+}
+
+JNIIds::JNIIds(JNIEnv* env) {
+    mHashMap = FindJNIClass(env, "java/util/HashMap");
+    mHashMapInit = FindJNIMethod(env, mHashMap, "<init>", "(I)V");
+    mHashMapPut = FindJNIMethod(env, mHashMap, "put", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+    mHashMapGet = FindJNIMethod(env, mHashMap, "get", "(Ljava/lang/Object;)Ljava/lang/Object;");
+    mHashMapKeySet = FindJNIMethod(env, mHashMap, "keySet", "()Ljava/util/Set;");
+    mSet = FindJNIClass(env, "java/util/Set");
+    mSetToArray = FindJNIMethod(env, mSet, "toArray", "()[Ljava/lang/Object;");
+    mArrayList = FindJNIClass(env, "java/util/ArrayList");
+    mArrayListInit = FindJNIMethod(env, mArrayList, "<init>", "(I)V");
+    mArrayListAdd = FindJNIMethod(env, mArrayList, "add", "(Ljava/lang/Object;)Z");
+    mArrayListGet = FindJNIMethod(env, mArrayList, "get", "(I)Ljava/lang/Object;");
+    mArrayListSize = FindJNIMethod(env, mArrayList, "size", "()I");
+    mString = FindJNIClass(env, "java/lang/String");
+    mClass = FindJNIClass(env, "java/lang/Class");
+    mClassGetName = FindJNIMethod(env, mClass, "getName", "()Ljava/lang/String;");
+
+    mDecoderMessage = FindJNIClass(env, "com/bbn/godec/DecoderMessage");
+    mDecoderMessageTag = FindJNIField(env, mDecoderMessage, "mTag", "Ljava/lang/String;");
+    mDecoderMessageTime = FindJNIField(env, mDecoderMessage, "mTime", "J");
+    mDecoderMessageGetFullDescriptor = FindJNIMethod(env, mDecoderMessage, "getFullDescriptorString", "()Ljava/lang/String;");
+    mDecoderMessageSetFullDescriptor = FindJNIMethod(env, mDecoderMessage, "setFullDescriptorString", "(Ljava/lang/String;)V");
+    mVector = FindJNIClass(env, "com/bbn/godec/Vector");
+    mVectorInit = FindJNIMethod(env, mVector, "<init>", "([F)V");
+    mVectorInitBuffer = FindJNIMethod(env, mVector, "<init>", "(Ljava/nio/FloatBuffer;)V");
+    mVectorData = FindJNIField(env, mVector, "mData", "[F");
+    mVectorBuffer = FindJNIField(env, mVector, "mBuffer", "Ljava/nio/FloatBuffer;");
+    mMatrix = FindJNIClass(env, "com/bbn/godec/Matrix");
+    mMatrixInit = FindJNIMethod(env, mMatrix, "<init>", "([Lcom/bbn/godec/Vector;)V");
+    mMatrixInitBuffer = FindJNIMethod(env, mMatrix, "<init>", "(Ljava/nio/FloatBuffer;I)V");
+    mMatrixCols = FindJNIField(env, mMatrix, "cols", "[Lcom/bbn/godec/Vector;");
+    mMatrixBuffer = FindJNIField(env, mMatrix, "mBuffer", "Ljava/nio/FloatBuffer;");
+    mMatrixBufferRows = FindJNIField(env, mMatrix, "mBufferRows", "I");
+    mBuffer = FindJNIClass(env, "java/nio/Buffer");
+    mBufferLimit = FindJNIMethod(env, mBuffer, "limit", "(I)Ljava/nio/Buffer;");
+    mBufferPosition = FindJNIMethod(env, mBuffer, "position", "(I)Ljava/nio/Buffer;");
+
+    mAudioMsg = FindJNIClass(env, "com/bbn/godec/AudioDecoderMessage");
+    mAudioMsgInit = FindJNIMethod(env, mAudioMsg, "<init>", "(Ljava/lang/String;JLcom/bbn/godec/Vector;FF)V");
+    mAudioMsgAudio = FindJNIField(env, mAudioMsg, "mAudio", "Lcom/bbn/godec/Vector;");
+    mAudioMsgSampleRate = FindJNIField(env, mAudioMsg, "mSampleRate", "F");
+    mAudioMsgTicksPerSample = FindJNIField(env, mAudioMsg, "mTicksPerSample", "F");
+    mFeaturesMsg = FindJNIClass(env, "com/bbn/godec/FeaturesDecoderMessage");
+    mFeaturesMsgInit = FindJNIMethod(env, mFeaturesMsg, "<init>", "(Ljava/lang/String;JLjava/lang/String;Lcom/bbn/godec/Matrix;[JLjava/lang/String;)V");
+    mFeaturesMsgUtteranceId = FindJNIField(env, mFeaturesMsg, "mUtteranceId", "Ljava/lang/String;");
+    mFeaturesMsgFeatureNames = FindJNIField(env, mFeaturesMsg, "mFeatureNames", "Ljava/lang/String;");
+    mFeaturesMsgTimestamps = FindJNIField(env, mFeaturesMsg, "mFeatureTimestamps", "[J");
+    mFeaturesMsgFeatures = FindJNIField(env, mFeaturesMsg, "mFeatures", "Lcom/bbn/godec/Matrix;");
+    mNbestMsg = FindJNIClass(env, "com/bbn/godec/NbestDecoderMessage");
+    mNbestMsgInit = FindJNIMethod(env, mNbestMsg, "<init>", "(Ljava/lang/String;JLjava/util/ArrayList;)V");
+    mNbestMsgEntries = FindJNIField(env, mNbestMsg, "mEntries", "Ljava/util/ArrayList;");
+    mNbestEntry = FindJNIClass(env, "com/bbn/godec/NbestEntry");
+    mNbestEntryInit = FindJNIMethod(env, mNbestEntry, "<init>", "([I[J[Ljava/lang/String;[F)V");
+    mNbestEntryWords = FindJNIField(env, mNbestEntry, "words", "[I");
+    mNbestEntryAlignment = FindJNIField(env, mNbestEntry, "alignment", "[J");
+    mNbestEntryText = FindJNIField(env, mNbestEntry, "text", "[Ljava/lang/String;");
+    mNbestEntryConfidences = FindJNIField(env, mNbestEntry, "wordConfidences", "[F");
+    mConvStateMsg = FindJNIClass(env, "com/bbn/godec/ConversationStateDecoderMessage");
+    mConvStateMsgInit = FindJNIMethod(env, mConvStateMsg, "<init>", "(Ljava/lang/String;JLjava/lang/String;ZLjava/lang/String;Z)V");
+    mConvStateMsgUtteranceId = FindJNIField(env, mConvStateMsg, "mUtteranceId", "Ljava/lang/String;");
+    mConvStateMsgConvoId = FindJNIField(env, mConvStateMsg, "mConvoId", "Ljava/lang/String;");
+    mConvStateMsgLastChunkInUtt = FindJNIField(env, mConvStateMsg, "mLastChunkInUtt", "Z");
+    mConvStateMsgLastChunkInConvo = FindJNIField(env, mConvStateMsg, "mLastChunkInConvo", "Z");
+    mBinaryMsg = FindJNIClass(env, "com/bbn/godec/BinaryDecoderMessage");
+    mBinaryMsgInit = FindJNIMethod(env, mBinaryMsg, "<init>", "(Ljava/lang/String;J[BLjava/lang/String;)V");
+    mBinaryMsgData = FindJNIField(env, mBinaryMsg, "mData", "[B");
+    mBinaryMsgFormat = FindJNIField(env, mBinaryMsg, "mFormat", "Ljava/lang/String;");
+    mJsonMsg = FindJNIClass(env, "com/bbn/godec/JsonDecoderMessage");
+    mJsonMsgInit = FindJNIMethod(env, mJsonMsg, "<init>", "(Ljava/lang/String;JLjava/lang/String;)V");
+    mJsonMsgToString = FindJNIMethod(env, mJsonMsg, "toString", "()Ljava/lang/String;");
+}
+
+const JNIIds& GetJNIIds(JNIEnv* env) {
+    // Deliberately never destroyed, the global references are needed until the JVM goes away
+    static JNIIds* ids = new JNIIds(env);
+    return *ids;
+}
+
+// Copies "size" floats into a direct FloatBuffer and makes the buffer's contents exactly that. Returns false if the buffer isn't direct or too small
+static bool FillJNIDirectBuffer(JNIEnv* env, jobject directBuffer, const float* data, Eigen::Index size) {
+    if (directBuffer == nullptr) return false;
+    float* target = (float*)env->GetDirectBufferAddress(directBuffer);
+    if (target == nullptr || env->GetDirectBufferCapacity(directBuffer) < size) return false;
+    const JNIIds& ids = GetJNIIds(env);
+    memcpy(target, data, size * sizeof(float));
+    env->DeleteLocalRef(env->CallObjectMethod(directBuffer, ids.mBufferLimit, (jint)size));
+    env->DeleteLocalRef(env->CallObjectMethod(directBuffer, ids.mBufferPosition, (jint)0));
+    return true;
+}
+
+// The memory of a buffer-backed com.bbn.godec.Vector/Matrix. The Java constructors have already checked the buffer is direct and in native byte order
+static const float* GetJNIDirectBufferData(JNIEnv* env, jobject jBuffer, jlong& size) {
+    const float* data = (const float*)env->GetDirectBufferAddress(jBuffer);
+    if (data == nullptr) GODEC_ERR << "Vector/Matrix buffer is not a direct buffer";
+    size = env->GetDirectBufferCapacity(jBuffer);
+    return data;
 }
 
-jobject CreateJNIMatrix(JNIEnv* env, Matrix& data) {
-    jclass VectorClass = env->FindClass("com/bbn/godec/Vector");
-    jclass MatrixClass = env->FindClass("com/bbn/godec/Matrix");
-    jmethodID jMatrixInit = env->GetMethodID(MatrixClass, "<init>", "([Lcom/bbn/godec/Vector;)V");
-    jobjectArray jVectorArray = env->NewObjectArray((jsize)data.cols(), VectorClass, NULL);
+jobject CreateJNIVector(JNIEnv* env, Vector& data, jobject directBuffer) {
+    const JNIIds& ids = GetJNIIds(env);
+    if (FillJNIDirectBuffer(env, directBuffer, data.data(), data.size())) {
+        return env->NewObject(ids.mVector, ids.mVectorInitBuffer, directBuffer);
+    }
+    jfloatArray jDataArray = env->NewFloatArray((jsize)data.size());
+    env->SetFloatArrayRegion(jDataArray, 0, (jsize)data.size(), data.data());
+    jobject jVector = env->NewObject(ids.mVector, ids.mVectorInit, jDataArray);
+    env->DeleteLocalRef(jDataArray);
+    return jVector;
+}
+
+jobject CreateJNIMatrix(JNIEnv* env, Matrix& data, jobject directBuffer) {
+    const JNIIds& ids = GetJNIIds(env);
+    // Eigen matrices are column-major, just like the buffer-backed Java ones. A matrix without rows can't be expressed that way though
+    if (data.rows() > 0 && FillJNIDirectBuffer(env, directBuffer, data.data(), data.size())) {
+        return env->NewObject(ids.mMatrix, ids.mMatrixInitBuffer, directBuffer, (jint)data.rows());
+    }
+    jobjectArray jVectorArray = env->NewObjectArray((jsize)data.cols(), ids.mVector, NULL);
     for (int colIdx = 0; colIdx < data.cols(); colIdx++) {
-        Vector featCol = data.col(colIdx);
-        env->SetObjectArrayElement(jVectorArray, colIdx, CreateJNIVector(env, featCol));
+        jfloatArray jColArray = env->NewFloatArray((jsize)data.rows());
+        env->SetFloatArrayRegion(jColArray, 0, (jsize)data.rows(), data.col(colIdx).data());
+        jobject jCol = env->NewObject(ids.mVector, ids.mVectorInit, jColArray);
+        env->SetObjectArrayElement(jVectorArray, colIdx, jCol);
+        env->DeleteLocalRef(jCol);
+        env->DeleteLocalRef(jColArray);
+    }
+    jobject jMatrix = env->NewObject(ids.mMatrix, ids.mMatrixInit, jVectorArray);
+    env->DeleteLocalRef(jVectorArray);
+    return jMatrix;
+}
+
+// Size of a com.bbn.godec.Vector, whichever way it stores its data
+static jlong GetJNIVectorSize(JNIEnv* env, jobject jVector) {
+    const JNIIds& ids = GetJNIIds(env);
+    jlong size = 0;
+    jobject jBuffer = env->GetObjectField(jVector, ids.mVectorBuffer);
+    if (jBuffer != nullptr) {
+        GetJNIDirectBufferData(env, jBuffer, size);
+        env->DeleteLocalRef(jBuffer);
+        return size;
     }
-    return env->NewObject(MatrixClass, jMatrixInit, jVectorArray);
+    jfloatArray jData = (jfloatArray)env->GetObjectField(jVector, ids.mVectorData);
+    if (jData != nullptr) {
+        size = env->GetArrayLength(jData);
+        env->DeleteLocalRef(jData);
+    }
+    return size;
+}
+
+static void CopyJNIVector(JNIEnv* env, jobject jVector, float* out, jlong size) {
+    const JNIIds& ids = GetJNIIds(env);
+    jobject jBuffer = env->GetObjectField(jVector, ids.mVectorBuffer);
+    if (jBuffer != nullptr) {
+        jlong bufferSize;
+        const float* data = GetJNIDirectBufferData(env, jBuffer, bufferSize);
+        if (bufferSize != size) GODEC_ERR << "Vector size mismatch, expected " << size << ", got " << bufferSize;
+        memcpy(out, data, size * sizeof(float));
+        env->DeleteLocalRef(jBuffer);
+        return;
+    }
+    jfloatArray jData = (jfloatArray)env->GetObjectField(jVector, ids.mVectorData);
+    jlong arraySize = (jData != nullptr) ? env->GetArrayLength(jData) : 0;
+    if (arraySize != size) GODEC_ERR << "Vector size mismatch, expected " << size << ", got " << arraySize;
+    if (size > 0) env->GetFloatArrayRegion(jData, 0, (jsize)size, out);
+    env->DeleteLocalRef(jData);
+    if (env->ExceptionCheck()) { env->ExceptionDescribe(); GODEC_ERR << "Could not copy Java float array"; }
+}
+
+Vector JNIVectorToEigen(JNIEnv* env, jobject jVector) {
+    jlong size = GetJNIVectorSize(env, jVector);
+    Vector out = AcquireVector(size);
+    CopyJNIVector(env, jVector, out.data(), size);
+    return out;
+}
+
+Matrix JNIMatrixToEigen(JNIEnv* env, jobject jMatrix) {
+    const JNIIds& ids = GetJNIIds(env);
+    jobject jBuffer = env->GetObjectField(jMatrix, ids.mMatrixBuffer);
+    if (jBuffer != nullptr) {
+        jlong size;
+        const float* data = GetJNIDirectBufferData(env, jBuffer, size);
+        jint numRows = env->GetIntField(jMatrix, ids.mMatrixBufferRows);
+        if (numRows <= 0 || size % numRows != 0) GODEC_ERR << "Matrix buffer of size " << size << " can not hold columns of " << numRows << " rows";
+        Matrix out = AcquireMatrix(numRows, size / numRows);
+        memcpy(out.data(), data, out.size() * sizeof(float));
+        env->DeleteLocalRef(jBuffer);
+        return out;
+    }
+    jobjectArray jCols = (jobjectArray)env->GetObjectField(jMatrix, ids.mMatrixCols);
+    jsize numCols = env->GetArrayLength(jCols);
+    jlong numRows = 0;
+    if (numCols > 0) {
+        jobject jFirstCol = env->GetObjectArrayElement(jCols, 0);
+        numRows = GetJNIVectorSize(env, jFirstCol);
+        env->DeleteLocalRef(jFirstCol);
+    }
+    Matrix out = AcquireMatrix(numRows, numCols);
+    // Every column has to have the same length as the first one, CopyJNIVector() checks that
+    for (jsize colIdx = 0; colIdx < numCols; colIdx++) {
+        jobject jCol = env->GetObjectArrayElement(jCols, colIdx);
+        if (jCol == nullptr) GODEC_ERR << "Matrix column " << colIdx << " is null";
+        CopyJNIVector(env, jCol, out.col(colIdx).data(), numRows);
+        env->DeleteLocalRef(jCol);
+    }
+    env->DeleteLocalRef(jCols);
+    return out;
 }
 
 void StripJSONComment(const std::string& str, size_t start, size_t end, std::string& out) {
@@ -0,0 +1,159 @@
+#include <godec/MessagePool.h>
+#include <mutex>
+#include <vector>
+
+namespace Godec {
+
+static thread_local AllocationCounters* threadAllocationCounters = nullptr;
+static thread_local uint64_t threadPoolMisses = 0;
+
+void SetThreadAllocationCounters(AllocationCounters* counters) {
+    threadAllocationCounters = counters;
+}
+
+AllocationCounters* GetThreadAllocationCounters() {
+    return threadAllocationCounters;
+}
+
+uint64_t GetThreadPoolMisses() {
+    return threadPoolMisses;
+}
+
+/*
+############ Message object pool ###################
+*/
+
+static const std::size_t MessageBlockGranularity = 16;
+static const std::size_t MessageBlockNumClasses = 64; // i.e. blocks up to 1kB get pooled
+static const std::size_t MessageBlockMaxFreePerClass = 4096;
+
+struct MessageBlockClass {
+    std::mutex mMutex;
+    std::vector<void*> mFree;
+};
+
+// Deliberately never destroyed, messages can outlive static destruction (e.g. when they are still sitting in a channel at exit)
+static MessageBlockClass* GetMessageBlockClasses() {
+    static MessageBlockClass* classes = new MessageBlockClass[MessageBlockNumClasses];
+    return classes;
+}
+
+void* AllocateMessageBlock(std::size_t bytes) {
+    std::size_t classIdx = (bytes + MessageBlockGranularity - 1) / MessageBlockGranularity;
+    if (classIdx == 0 || classIdx > MessageBlockNumClasses) {
+        threadPoolMisses++;
+        return ::operator new(bytes);
+    }
+    MessageBlockClass& blockClass = GetMessageBlockClasses()[classIdx - 1];
+    {
+        std::lock_guard<std::mutex> lock(blockClass.mMutex);
+        if (!blockClass.mFree.empty()) {
+            void* block = blockClass.mFree.back();
+            blockClass.mFree.pop_back();
+            return block;
+        }
+    }
+    threadPoolMisses++;
+    return ::operator new(classIdx * MessageBlockGranularity);
+}
+
+void ReleaseMessageBlock(void* block, std::size_t bytes) {
+    std::size_t classIdx = (bytes + MessageBlockGranularity - 1) / MessageBlockGranularity;
+    if (classIdx == 0 || classIdx > MessageBlockNumClasses) {
+        ::operator delete(block);
+        return;
+    }
+    MessageBlockClass& blockClass = GetMessageBlockClasses()[classIdx - 1];
+    {
+        std::lock_guard<std::mutex> lock(blockClass.mMutex);
+        if (blockClass.mFree.size() < MessageBlockMaxFreePerClass) {
+            blockClass.mFree.push_back(block);
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+/*
+############ Eigen payload pool ###################
+*/
+
+static const std::size_t PayloadPoolMaxBytes = 128 * 1024 * 1024;
+static const std::size_t PayloadPoolMaxPerSize = 64;
+
+struct PayloadPool {
+    std::mutex mMutex;
+    unordered_map<Eigen::Index, std::vector<Matrix>> mMatrices;
+    unordered_map<Eigen::Index, std::vector<Vector>> mVectors;
+    std::size_t mPooledBytes = 0;
+};
+
+static PayloadPool& GetPayloadPool() {
+    static PayloadPool* pool = new PayloadPool();
+    return *pool;
+}
+
+template<class EigenType>
+static bool TakeFromPool(unordered_map<Eigen::Index, std::vector<EigenType>>& buckets, PayloadPool& pool, Eigen::Index size, EigenType& out) {
+    std::lock_guard<std::mutex> lock(pool.mMutex);
+    auto bucketIt = buckets.find(size);
+    if (bucketIt == buckets.end() || bucketIt->second.empty()) return false;
+    out = std::move(bucketIt->second.back());
+    bucketIt->second.pop_back();
+    pool.mPooledBytes -= size * sizeof(float);
+    return true;
+}
+
+template<class EigenType>
+static void PutIntoPool(unordered_map<Eigen::Index, std::vector<EigenType>>& buckets, PayloadPool& pool, EigenType&& payload) {
+    Eigen::Index size = payload.size();
+    if (size == 0) return;
+    std::lock_guard<std::mutex> lock(pool.mMutex);
+    if (pool.mPooledBytes + size * sizeof(float) > PayloadPoolMaxBytes) return;
+    std::vector<EigenType>& bucket = buckets[size];
+    if (bucket.size() >= PayloadPoolMaxPerSize) return;
+    bucket.push_back(std::move(payload));
+    pool.mPooledBytes += size * sizeof(float);
+}
+
+static void CountPayload(bool reused, Eigen::Index size) {
+    if (!reused && size != 0) threadPoolMisses++;
+    AllocationCounters* counters = GetThreadAllocationCounters();
+    if (counters == nullptr || size == 0) return;
+    if (reused) {
+        counters->mPayloadsReused++;
+    } else {
+        counters->mPayloadsFresh++;
+        counters->mPayloadBytesFresh += size * sizeof(float);
+    }
+}
+
+Matrix AcquireMatrix(Eigen::Index rows, Eigen::Index cols) {
+    Matrix out;
+    PayloadPool& pool = GetPayloadPool();
+    bool reused = rows * cols != 0 && TakeFromPool(pool.mMatrices, pool, rows * cols, out);
+    out.resize(rows, cols);
+    CountPayload(reused, rows * cols);
+    return out;
+}
+
+Vector AcquireVector(Eigen::Index size) {
+    Vector out;
+    PayloadPool& pool = GetPayloadPool();
+    bool reused = size != 0 && TakeFromPool(pool.mVectors, pool, size, out);
+    out.resize(size);
+    CountPayload(reused, size);
+    return out;
+}
+
+void ReleasePayload(Matrix&& mat) {
+    PayloadPool& pool = GetPayloadPool();
+    PutIntoPool(pool.mMatrices, pool, std::move(mat));
+}
+
+void ReleasePayload(Vector&& vec) {
+    PayloadPool& pool = GetPayloadPool();
+    PutIntoPool(pool.mVectors, pool, std::move(vec));
+}
+
+} // namespace Godec
@@ -0,0 +1,235 @@
+#include <godec/OutputSink.h>
+#include <godec/ComponentGraph.h>
+#include <boost/bind/bind.hpp>
+#include <iomanip>
+
+namespace Godec {
+
+OutputSinkOptions OutputSinkOptions::FromConfig(ComponentGraphConfig* configPt) {
+    OutputSinkOptions options;
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<int64_t>("sink_buffer_kb")) {
+        int64_t kb = configPt->get<int64_t>("sink_buffer_kb", "Size of the output buffers in kilobytes");
+        if (kb < 1) GODEC_ERR << "sink_buffer_kb needs to be at least 1";
+        options.mBufferBytes = kb * 1024;
+    }
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<int64_t>("sink_max_pending_kb")) {
+        int64_t kb = configPt->get<int64_t>("sink_max_pending_kb", "How many kilobytes can wait for the writer thread before writing blocks");
+        if (kb < 1) GODEC_ERR << "sink_max_pending_kb needs to be at least 1";
+        options.mMaxPendingBytes = kb * 1024;
+    }
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<int64_t>("sink_flush_ms")) {
+        options.mFlushMs = configPt->get<int64_t>("sink_flush_ms", "Maximum time in milliseconds that output stays in the buffer (0 = no limit)");
+        if (options.mFlushMs < 0) GODEC_ERR << "sink_flush_ms can not be negative";
+    }
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<bool>("sink_flush_on_utterance_end")) {
+        options.mFlushOnUtteranceEnd = configPt->get<bool>("sink_flush_on_utterance_end", "Write out the buffer at the end of every utterance");
+    }
+    return options;
+}
+
+OutputSink::OutputSink(const OutputSinkOptions& options, LoopProcessor* owner, std::string id) :
+    mOptions(options), mId(id), mFileOpen(false), mFilePos(0), mPendingBytes(0), mWriterBusy(false), mStop(false),
+    mBytesWritten(0), mBlocked(0), mWriting(0) {
+    mCurrent.reserve(mOptions.mBufferBytes);
+    auto loop = boost::bind(&OutputSink::WriteLoop, this);
+    if (owner != NULL) mWriteThread = owner->startPlacedThread(loop, "writer");
+    else mWriteThread = boost::thread(loop);
+}
+
+OutputSink::~OutputSink() {
+    try {
+        close();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void OutputSink::CheckError() {
+    if (!mError.empty()) GODEC_ERR << mId << ": " << mError;
+}
+
+void OutputSink::Enqueue(Op& op, boost::unique_lock<boost::mutex>& lock) {
+    size_t size = op.mData.size();
+    if (mPendingBytes > 0 && mPendingBytes + size > mOptions.mMaxPendingBytes) {
+        auto start = boost::chrono::steady_clock::now();
+        while (mPendingBytes > 0 && mPendingBytes + size > mOptions.mMaxPendingBytes && mError.empty()) mCond.wait(lock);
+        mBlocked += boost::chrono::steady_clock::now() - start;
+        CheckError();
+    }
+    mPendingBytes += size;
+    mQueue.push_back(std::move(op));
+    mCond.notify_all();
+}
+
+void OutputSink::HandOverCurrent(boost::unique_lock<boost::mutex>& lock) {
+    if (mCurrent.empty()) return;
+    Op op;
+    op.mType = OpData;
+    op.mData.swap(mCurrent);
+    if (!mFreeBuffers.empty()) {
+        mCurrent.swap(mFreeBuffers.back());
+        mFreeBuffers.pop_back();
+    } else {
+        mCurrent.reserve(mOptions.mBufferBytes);
+    }
+    Enqueue(op, lock);
+}
+
+void OutputSink::open(std::string fileName) {
+    if (mFileOpen) closeFile();
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    CheckError();
+    Op op;
+    op.mType = OpOpen;
+    op.mFileName = fileName;
+    Enqueue(op, lock);
+    mFileOpen = true;
+    mFilePos = 0;
+}
+
+void OutputSink::write(const char* data, size_t size) {
+    if (!mFileOpen) GODEC_ERR << mId << ": Writing without an open file";
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    CheckError();
+    if (mCurrent.empty()) mCurrentSince = boost::chrono::steady_clock::now();
+    mCurrent.insert(mCurrent.end(), data, data + size);
+    mFilePos += size;
+    if (mCurrent.size() >= mOptions.mBufferBytes) HandOverCurrent(lock);
+}
+
+void OutputSink::patch(uint64_t offset, const char* data, size_t size) {
+    if (!mFileOpen) GODEC_ERR << mId << ": Writing without an open file";
+    if (offset + size > mFilePos) GODEC_ERR << mId << ": Can only patch bytes that have been written already";
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    CheckError();
+    HandOverCurrent(lock);
+    Op op;
+    op.mType = OpPatch;
+    op.mOffset = offset;
+    op.mData.assign(data, data + size);
+    Enqueue(op, lock);
+}
+
+void OutputSink::endOfUtterance() {
+    if (!mOptions.mFlushOnUtteranceEnd) return;
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    CheckError();
+    HandOverCurrent(lock);
+}
+
+void OutputSink::flush() {
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    CheckError();
+    HandOverCurrent(lock);
+    auto start = boost::chrono::steady_clock::now();
+    while ((!mQueue.empty() || mWriterBusy) && mError.empty()) mCond.wait(lock);
+    mBlocked += boost::chrono::steady_clock::now() - start;
+    CheckError();
+}
+
+void OutputSink::closeFile() {
+    if (!mFileOpen) return;
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    HandOverCurrent(lock);
+    Op op;
+    op.mType = OpClose;
+    Enqueue(op, lock);
+    mFileOpen = false;
+}
+
+void OutputSink::close() {
+    if (!mWriteThread.joinable()) return;
+    closeFile();
+    {
+        boost::unique_lock<boost::mutex> lock(mMutex);
+        mStop = true;
+        mCond.notify_all();
+    }
+    mWriteThread.join();
+    CheckError();
+}
+
+void OutputSink::WriteLoop() {
+    FILE* fp = NULL;
+    std::string fileName;
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    while (true) {
+        if (mQueue.empty()) {
+            if (mStop) break;
+            if (mOptions.mFlushMs > 0 && !mCurrent.empty()) {
+                auto deadline = mCurrentSince + boost::chrono::milliseconds(mOptions.mFlushMs);
+                if (boost::chrono::steady_clock::now() >= deadline) {
+                    // Nothing is pending, so this never blocks
+                    HandOverCurrent(lock);
+                } else {
+                    mCond.wait_until(lock, deadline);
+                }
+            } else {
+                mCond.wait(lock);
+            }
+            continue;
+        }
+        Op op = std::move(mQueue.front());
+        mQueue.pop_front();
+        mWriterBusy = true;
+        bool failed = !mError.empty();
+        lock.unlock();
+
+        auto start = boost::chrono::steady_clock::now();
+        std::string error;
+        if (!failed) {
+            if (op.mType == OpOpen) {
+                fileName = op.mFileName;
+                fp = fopen(fileName.c_str(), "wb");
+                if (fp == NULL) error = "Couldn't open '" + fileName + "' for writing";
+                else setvbuf(fp, NULL, _IONBF, 0);
+            } else if (op.mType == OpData) {
+                if (fwrite(op.mData.data(), 1, op.mData.size(), fp) != op.mData.size()) error = "Failed writing to '" + fileName + "'";
+            } else if (op.mType == OpPatch) {
+                if (fseek(fp, op.mOffset, SEEK_SET) != 0 ||
+                        fwrite(op.mData.data(), 1, op.mData.size(), fp) != op.mData.size() ||
+                        fseek(fp, 0, SEEK_END) != 0) error = "Failed patching '" + fileName + "'";
+            } else if (op.mType == OpClose) {
+                if (fclose(fp) != 0) error = "Failed closing '" + fileName + "'";
+                fp = NULL;
+            }
+        }
+        auto elapsed = boost::chrono::steady_clock::now() - start;
+
+        lock.lock();
+        mWriting += elapsed;
+        if (!failed && error.empty() && op.mType == OpData) mBytesWritten += op.mData.size();
+        if (mError.empty()) mError = error;
+        mPendingBytes -= op.mData.size();
+        if (op.mType == OpData && mFreeBuffers.size() < 4) {
+            op.mData.clear();
+            mFreeBuffers.push_back(std::move(op.mData));
+        }
+        mWriterBusy = false;
+        mCond.notify_all();
+    }
+    if (fp != NULL) fclose(fp);
+}
+
+uint64_t OutputSink::getBytesWritten() {
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    return mBytesWritten;
+}
+
+double OutputSink::getSecondsBlocked() {
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    return boost::chrono::duration<double>(mBlocked).count();
+}
+
+double OutputSink::getSecondsWriting() {
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    return boost::chrono::duration<double>(mWriting).count();
+}
+
+std::string OutputSink::describeStats() {
+    std::stringstream ss;
+    ss << "wrote " << getBytesWritten() << " bytes in " << std::fixed << std::setprecision(3) << getSecondsWriting() << "s, blocked " << getSecondsBlocked() << "s on I/O";
+    return ss.str();
+}
+
+}
@@ -8,6 +8,41 @@
 
 namespace Godec {
 
+TimeStreams::TimeStreams() : mVerbose(false), mMinSliceTicks(0), mMaxSliceLatencyMs(-1.0f), mIsHolding(false) {
+}
+
+void TimeStreams::setCoalescing(int64_t minSliceTicks, float maxSliceLatencyMs) {
+    mMinSliceTicks = minSliceTicks;
+    mMaxSliceLatencyMs = maxSliceLatencyMs;
+}
+
+float TimeStreams::getSecondsUntilDeadline() {
+    if (!mIsHolding || mMaxSliceLatencyMs < 0) return FLT_MAX;
+    boost::chrono::duration<float> held = boost::chrono::steady_clock::now() - mHoldingSince;
+    return std::max(0.0f, mMaxSliceLatencyMs/1000.0f - held.count());
+}
+
+// Decides whether a slice that is too small for min_slice_ticks should still go out now
+bool TimeStreams::shouldReleaseSlice(uint64_t sliceTime, int64_t previousCutoff) {
+    if ((int64_t)sliceTime - previousCutoff >= mMinSliceTicks) return true;
+    for (auto slotIt = mStream.begin(); slotIt != mStream.end(); slotIt++) {
+        auto& stream = slotIt->second;
+        auto& firstMsg = stream[0];
+        // A slice never spans message borders, so it can't grow any further if that first message is already followed by another one
+        if (stream.size() >= 2 && firstMsg->getTime() == sliceTime) return true;
+        // Utterance or conversation end
+        if (firstMsg->getUUID() == UUID_ConversationStateDecoderMessage && firstMsg->getTime() == sliceTime) {
+            auto convStateMsg = boost::static_pointer_cast<const ConversationStateDecoderMessage>(firstMsg);
+            if (convStateMsg->mLastChunkInUtt || convStateMsg->mLastChunkInConvo) return true;
+        }
+    }
+    if (!mIsHolding) {
+        mIsHolding = true;
+        mHoldingSince = boost::chrono::steady_clock::now();
+    }
+    return getSecondsUntilDeadline() <= 0.0f;
+}
+
 // Add a new stream
 void TimeStreams::addStream(std::string streamName) {
     mStream[streamName] = SingleTimeStream();
@@ -126,7 +161,7 @@ std::string TimeStreams::print() {
 }
 
 // The key function that slices out a continguous ("coherent") chunk of messages
-unordered_map<std::string, DecoderMessage_ptr> TimeStreams::getNewCoherent(int64_t& previousCutoff) {
+unordered_map<std::string, DecoderMessage_ptr> TimeStreams::getNewCoherent(int64_t& previousCutoff, bool flush) {
     // Hmm, the following loop seems to do just about the same as getLeastFilledSlot(). Might have to revisit if this ever exhibits a bug or is shown to be inefficient. It establishes the lowest timestamp across the streams
     uint64_t lastFullyAccountedForTime = std::numeric_limits<uint64_t>::max();
     for (auto slotIt = mStream.begin(); slotIt != mStream.end(); slotIt++) {
@@ -212,6 +247,15 @@ unordered_map<std::string, DecoderMessage_ptr> TimeStreams::getNewCoherent(int64
             return outList;
         }
 
+        // Slice coalescing: Hold back small slices, the streams keep merging new messages into them in the meantime
+        if (mMinSliceTicks > 0 && !flush) {
+            if (!shouldReleaseSlice(sliceTime, previousCutoff)) {
+                if (mVerbose) GODEC_INFO << mId << ": Holding back slice at " << sliceTime << ", only " << ((int64_t)sliceTime - previousCutoff) << " of " << mMinSliceTicks << " ticks" << std::endl;
+                return outList;
+            }
+        }
+        mIsHolding = false;
+
         //Actually slice
         for (auto slotIt = mStream.begin(); slotIt != mStream.end(); slotIt++) {
             std::string slot = slotIt->first;
@@ -0,0 +1,219 @@
+#include <godec/WireFormat.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace Godec {
+
+static const bool WireIsNativeOrder = boost::endian::order::native == boost::endian::order::little;
+
+void DecoderMessage::toWire(WireWriter& writer) const {
+    GODEC_ERR << "Message type " << getUUID() << " does not implement toWire(), can not encode it";
+}
+
+/*
+############ Writer ###################
+*/
+
+void WireWriter::align() {
+    size_t padding = (GODEC_WIRE_BLOCK_ALIGNMENT - size() % GODEC_WIRE_BLOCK_ALIGNMENT) % GODEC_WIRE_BLOCK_ALIGNMENT;
+    mBuffer.resize(mBuffer.size() + padding, 0);
+}
+
+void WireWriter::writeBlock(const void* data, size_t numBytes) {
+    if (numBytes < mExternalThreshold) {
+        writeRaw(data, numBytes);
+        return;
+    }
+    ExternalBlock block;
+    block.mBufferOffset = mBuffer.size();
+    block.mData = (const char*)data;
+    block.mSize = numBytes;
+    mExternal.push_back(block);
+    mExternalBytes += numBytes;
+}
+
+// Logical offset (as in size()) to offset into the buffer
+size_t WireWriter::bufferOffset(size_t offset) const {
+    size_t externalBefore = 0;
+    for(auto it = mExternal.begin(); it != mExternal.end(); it++) {
+        size_t blockStart = it->mBufferOffset + externalBefore;
+        if (offset < blockStart) break;
+        if (offset < blockStart + it->mSize) GODEC_ERR << "WireWriter: Can not patch inside an external block";
+        externalBefore += it->mSize;
+    }
+    return offset - externalBefore;
+}
+
+void WireWriter::appendSegments(std::vector<Segment>& out) const {
+    size_t bufferPos = 0;
+    for(auto it = mExternal.begin(); it != mExternal.end(); it++) {
+        if (it->mBufferOffset > bufferPos) out.push_back(Segment{mBuffer.data() + bufferPos, it->mBufferOffset - bufferPos});
+        out.push_back(Segment{it->mData, it->mSize});
+        bufferPos = it->mBufferOffset;
+    }
+    if (mBuffer.size() > bufferPos) out.push_back(Segment{mBuffer.data() + bufferPos, mBuffer.size() - bufferPos});
+}
+
+void WireWriter::writeFloatBlock(const float* data, size_t count) {
+    writeU64(count);
+    align();
+    if (WireIsNativeOrder) {
+        writeBlock(data, count * sizeof(float));
+        return;
+    }
+    for(size_t idx = 0; idx < count; idx++) writeFloat(data[idx]);
+}
+
+void WireWriter::writeU64Block(const uint64_t* data, size_t count) {
+    writeU64(count);
+    align();
+    if (WireIsNativeOrder) {
+        writeBlock(data, count * sizeof(uint64_t));
+        return;
+    }
+    for(size_t idx = 0; idx < count; idx++) writeU64(data[idx]);
+}
+
+void WireWriter::writeMatrix(const Matrix& mat) {
+    writeU64(mat.rows());
+    writeU64(mat.cols());
+    writeFloatBlock(mat.data(), mat.size());
+}
+
+/*
+############ Reader ###################
+*/
+
+void WireReader::align() {
+    size_t padding = (GODEC_WIRE_BLOCK_ALIGNMENT - mPos % GODEC_WIRE_BLOCK_ALIGNMENT) % GODEC_WIRE_BLOCK_ALIGNMENT;
+    if (padding > remaining()) GODEC_ERR << "WireReader: Message is truncated inside block padding";
+    mPos += padding;
+}
+
+std::string WireReader::readString() {
+    size_t size = readU64();
+    if (size > remaining()) GODEC_ERR << "WireReader: String of " << size << " bytes runs past the end of the message";
+    std::string out(mData + mPos, size);
+    mPos += size;
+    return out;
+}
+
+std::vector<unsigned char> WireReader::readBytes() {
+    size_t size = readU64();
+    if (size > remaining()) GODEC_ERR << "WireReader: Byte array of " << size << " bytes runs past the end of the message";
+    std::vector<unsigned char> out((const unsigned char*)mData + mPos, (const unsigned char*)mData + mPos + size);
+    mPos += size;
+    return out;
+}
+
+void WireReader::readFloatBlock(float* out, size_t count) {
+    align();
+    if (count > remaining() / sizeof(float)) GODEC_ERR << "WireReader: Block of " << count << " floats runs past the end of the message";
+    if (WireIsNativeOrder) {
+        readRaw(out, count * sizeof(float));
+        return;
+    }
+    for(size_t idx = 0; idx < count; idx++) out[idx] = readFloat();
+}
+
+void WireReader::readU64Block(uint64_t* out, size_t count) {
+    align();
+    if (count > remaining() / sizeof(uint64_t)) GODEC_ERR << "WireReader: Block of " << count << " integers runs past the end of the message";
+    if (WireIsNativeOrder) {
+        readRaw(out, count * sizeof(uint64_t));
+        return;
+    }
+    for(size_t idx = 0; idx < count; idx++) out[idx] = readU64();
+}
+
+std::vector<float> WireReader::readFloatVector() {
+    std::vector<float> out(readBlockSize());
+    readFloatBlock(out.data(), out.size());
+    return out;
+}
+
+std::vector<uint64_t> WireReader::readU64Vector() {
+    std::vector<uint64_t> out(readBlockSize());
+    readU64Block(out.data(), out.size());
+    return out;
+}
+
+Matrix WireReader::readMatrix() {
+    uint64_t rows = readU64();
+    uint64_t cols = readU64();
+    size_t count = readBlockSize();
+    // Checked first, a corrupt header could otherwise have the product wrap around to match the element count
+    if ((cols != 0 && rows > SIZE_MAX / cols) || rows > (uint64_t)PTRDIFF_MAX || cols > (uint64_t)PTRDIFF_MAX) GODEC_ERR << "WireReader: Matrix of " << rows << "x" << cols << " is too large";
+    if (count != rows * cols) GODEC_ERR << "WireReader: Matrix of " << rows << "x" << cols << " comes with " << count << " elements";
+    if (count > remaining() / sizeof(float)) GODEC_ERR << "WireReader: Matrix of " << rows << "x" << cols << " runs past the end of the message";
+    Matrix out = AcquireMatrix(rows, cols);
+    readFloatBlock(out.data(), count);
+    return out;
+}
+
+/*
+############ Messages ###################
+*/
+
+void WriteWireMessage(WireWriter& writer, const DecoderMessage& msg) {
+    writer.writeU32(GODEC_WIRE_MAGIC);
+    writer.writeU16(GODEC_WIRE_FORMAT_VERSION);
+    writer.writeU16(msg.getWireVersion());
+    uuid type = msg.getUUID();
+    writer.writeRaw(type.data, type.size());
+    size_t bodySizeOffset = writer.size();
+    writer.writeU64(0);
+    size_t bodyStart = writer.size();
+
+    writer.writeU64(msg.getTime());
+    writer.writeString(msg.getTag());
+    // Sorted, so that the same message always encodes to the same bytes
+    const std::unordered_map<std::string, std::string>& descriptors = msg.getDescriptors();
+    std::vector<std::pair<std::string, std::string>> sortedDescriptors(descriptors.begin(), descriptors.end());
+    std::sort(sortedDescriptors.begin(), sortedDescriptors.end());
+    writer.writeU64(sortedDescriptors.size());
+    for(auto it = sortedDescriptors.begin(); it != sortedDescriptors.end(); it++) {
+        writer.writeString(it->first);
+        writer.writeString(it->second);
+    }
+    msg.toWire(writer);
+
+    writer.patchU64(bodySizeOffset, writer.size() - bodyStart);
+}
+
+WireMessageHeader ReadWireMessageHeader(WireReader& reader) {
+    WireMessageHeader header;
+    uint32_t magic = reader.readU32();
+    if (magic != GODEC_WIRE_MAGIC) GODEC_ERR << "WireReader: Not a Godec wire message (bad magic number)";
+    uint16_t formatVersion = reader.readU16();
+    if (formatVersion > GODEC_WIRE_FORMAT_VERSION) GODEC_ERR << "WireReader: Message has wire format version " << formatVersion << ", this Godec only understands up to " << GODEC_WIRE_FORMAT_VERSION;
+    header.mTypeVersion = reader.readU16();
+    reader.readRaw(header.mType.data, header.mType.size());
+    header.mBodySize = reader.readU64();
+    if (header.mBodySize > reader.remaining()) GODEC_ERR << "WireReader: Message body of " << header.mBodySize << " bytes is truncated, only " << reader.remaining() << " bytes left";
+    return header;
+}
+
+DecoderMessage_ptr ReadWireMessageBody(WireReader& reader, const WireMessageHeader& header, GodecWireToMsgFunc decoder) {
+    size_t bodyEnd = reader.position() + header.mBodySize;
+    uint64_t time = reader.readU64();
+    std::string tag = reader.readString();
+    uint64_t numDescriptors = reader.readU64();
+    std::vector<std::pair<std::string, std::string>> descriptors;
+    for(uint64_t idx = 0; idx < numDescriptors; idx++) {
+        std::string key = reader.readString();
+        std::string val = reader.readString();
+        descriptors.push_back(std::make_pair(std::move(key), std::move(val)));
+    }
+    DecoderMessage_ptr msg = decoder(reader, header.mTypeVersion, time);
+    if (msg == nullptr) GODEC_ERR << "WireReader: Decoder for message type " << header.mType << " returned no message";
+    if (reader.position() > bodyEnd) GODEC_ERR << "WireReader: Decoder for message type " << header.mType << " read past the end of the message body";
+    reader.seek(bodyEnd);
+
+    DecoderMessage* writableMsg = boost::const_pointer_cast<DecoderMessage>(msg).get();
+    writableMsg->setTag(tag);
+    for(auto it = descriptors.begin(); it != descriptors.end(); it++) writableMsg->addDescriptor(it->first, it->second);
+    return msg;
+}
+
+} // namespace Godec
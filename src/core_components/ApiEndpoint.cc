@@ -1,12 +1,60 @@
 #include "ApiEndpoint.h"
 #include <boost/property_tree/ptree.hpp>
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 #include "GodecMessages.h"
 
 namespace Godec {
 
 std::string ApiEndpoint::SlotPassout = "passout";
 
+// Threads shared by all endpoints that deliver through a callback. Slow callbacks of one endpoint can hold up the others, so embedders should hand off anything expensive
+static const int ApiCallbackPoolThreads = 2;
+// How long Shutdown() waits for the callbacks to catch up before giving up
+static const float CallbackShutdownTimeoutSec = 60.0f;
+// How many slices can wait for the callbacks before the endpoint stops taking new ones (at least two callbacks' worth). This holds up the graph the same way a slow consumer of any other component does
+static const size_t MaxQueuedCallbackSlices = 256;
+// Only set on the pool threads, see ApiEndpoint::OnCallbackThread()
+static thread_local bool sOnCallbackThread = false;
+
+class ApiCallbackPool {
+  public:
+    static ApiCallbackPool& Get() {
+        // Deliberately never destroyed, the threads run until the process exits
+        static ApiCallbackPool* pool = new ApiCallbackPool();
+        return *pool;
+    }
+    void post(boost::function<void()> task) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(task);
+        mCv.notify_one();
+    }
+  private:
+    ApiCallbackPool() {
+        for (int threadIdx = 0; threadIdx < ApiCallbackPoolThreads; threadIdx++) {
+            boost::thread thread(boost::bind(&ApiCallbackPool::run, this));
+            thread.detach();
+        }
+    }
+    void run() {
+        sOnCallbackThread = true;
+        while (true) {
+            boost::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCv.wait(lock, [&]() { return !mTasks.empty(); });
+                task = mTasks.front();
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::deque<boost::function<void()>> mTasks;
+};
+
 LoopProcessor* ApiEndpoint::make(std::string id, ComponentGraphConfig* configPt) {
     return new ApiEndpoint(id, configPt);
 }
@@ -14,7 +62,7 @@ std::string ApiEndpoint::describeThyself() {
     return "An internal component for injecting or retrieving messages. Used heavily by the SubModule component and the Java API";
 }
 ApiEndpoint::ApiEndpoint(std::string id, ComponentGraphConfig* configPt) :
-    LoopProcessor(id, configPt) {
+    LoopProcessor(id, configPt), mMaxSlicesPerCallback(1), mCallbackScheduled(false), mInputClosed(false), mClosedDelivered(false) {
     mSliceKeeper.setIdVerbose(id + "-SliceKeeper", isVerbose());
     mSliceKeeper.checkIn(getLPId(false));
     bool isInputEndpoint = false;
@@ -34,14 +82,106 @@ ApiEndpoint::ApiEndpoint(std::string id, ComponentGraphConfig* configPt) :
 }
 
 void ApiEndpoint::ProcessMessage(const DecoderMessageBlock& msgBlock) {
+    {
+        std::unique_lock<std::mutex> lock(mCallbackMutex);
+        if (mSliceCallback) {
+            mCallbackRoomCv.wait(lock, [&]() { return mCallbackQueue.size() < std::max(MaxQueuedCallbackSlices, 2*(size_t)mMaxSlicesPerCallback); });
+            mCallbackQueue.push_back(msgBlock.getMap());
+            scheduleCallbackDelivery();
+            return;
+        }
+    }
+    // Not under mCallbackMutex, put() can block
     mSliceKeeper.put(msgBlock.getMap());
+    // SetCallback() might have come in between and already taken over what was in the keeper, the slice we just put there then goes the same way
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
+    if (mSliceCallback) takeOverSliceKeeper();
 }
 
 void ApiEndpoint::Shutdown() {
+    {
+        std::unique_lock<std::mutex> lock(mCallbackMutex);
+        mInputClosed = true;
+        if (mSliceCallback) {
+            // Don't report the endpoint as finished before the embedder has seen everything
+            scheduleCallbackDelivery();
+            if (!mCallbackDoneCv.wait_for(lock, std::chrono::duration<float>(CallbackShutdownTimeoutSec), [&]() { return mClosedDelivered; })) {
+                GODEC_ERR << getLPId(false) << ": The endpoint callbacks did not finish within " << CallbackShutdownTimeoutSec << "s of the input closing. Callbacks must not block on the graph, e.g. by waiting for it to shut down";
+            }
+        }
+    }
     mSliceKeeper.checkOut(getLPId(false));
     LoopProcessor::Shutdown();
 }
 
+bool ApiEndpoint::OnCallbackThread() {
+    return sOnCallbackThread;
+}
+
+void ApiEndpoint::SetCallback(ApiEndpointSliceCallback onSlices, ApiEndpointClosedCallback onClosed, int maxSlicesPerCall) {
+    if (!onSlices) GODEC_ERR << getLPId(false) << ": No slice callback specified";
+    if (maxSlicesPerCall < 1) GODEC_ERR << getLPId(false) << ": Callbacks need to get at least one slice per call";
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
+    if (mSliceCallback) GODEC_ERR << getLPId(false) << ": Endpoint already has a callback";
+    mSliceCallback = onSlices;
+    mClosedCallback = onClosed;
+    mMaxSlicesPerCallback = maxSlicesPerCall;
+    takeOverSliceKeeper();
+}
+
+// Hands whatever is in mSliceKeeper over to the callbacks. Needs mCallbackMutex to be held
+void ApiEndpoint::takeOverSliceKeeper() {
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> pending;
+    if (mSliceKeeper.getAll(pending, 0.0f) == ChannelNewItem) {
+        mCallbackQueue.insert(mCallbackQueue.end(), pending.begin(), pending.end());
+    }
+    scheduleCallbackDelivery();
+}
+
+// Needs mCallbackMutex to be held
+void ApiEndpoint::scheduleCallbackDelivery() {
+    if (mCallbackScheduled) return;
+    if (mCallbackQueue.empty() && !(mInputClosed && !mClosedDelivered)) return;
+    mCallbackScheduled = true;
+    ApiCallbackPool::Get().post(boost::bind(&ApiEndpoint::DeliverCallbacks, this));
+}
+
+void ApiEndpoint::DeliverCallbacks() {
+    while (true) {
+        std::vector<unordered_map<std::string, DecoderMessage_ptr>> slices;
+        {
+            std::lock_guard<std::mutex> lock(mCallbackMutex);
+            if (mCallbackQueue.empty() && !(mInputClosed && !mClosedDelivered)) {
+                mCallbackScheduled = false;
+                return;
+            }
+            while (!mCallbackQueue.empty() && (int)slices.size() < mMaxSlicesPerCallback) {
+                slices.push_back(std::move(mCallbackQueue.front()));
+                mCallbackQueue.pop_front();
+            }
+            mCallbackRoomCv.notify_all();
+        }
+        if (slices.empty()) {
+            try {
+                if (mClosedCallback) mClosedCallback();
+            } catch (const std::exception& e) {
+                GODEC_INFO << getLPId(false) << ": Endpoint close callback threw: " << e.what() << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(mCallbackMutex);
+            mClosedDelivered = true;
+            mCallbackScheduled = false;
+            mCallbackDoneCv.notify_all();
+            return;
+        }
+        if (isVerbose()) GODEC_INFO << getLPId(false) << ": Delivering " << slices.size() << " slices to callback" << std::endl;
+        try {
+            mSliceCallback(slices);
+        } catch (const std::exception& e) {
+            GODEC_INFO << getLPId(false) << ": Endpoint callback threw: " << e.what() << std::endl;
+        }
+    }
+}
+
 
 std::string ApiEndpoint::getOutputSlot() {
     if (mOutputSlots.size() != 1) GODEC_ERR << "Not exactly one output slot defined in Api endpoint " << getLPId(false, true) << std::endl;
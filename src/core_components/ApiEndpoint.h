@@ -1,7 +1,10 @@
 #pragma once
 #include <string>
 #include <mutex>
+#include <deque>
+#include <condition_variable>
 #include <godec/ChannelMessenger.h>
+#include <godec/ComponentGraph.h>
 
 namespace Godec {
 
@@ -10,15 +13,35 @@ class ApiEndpoint : public LoopProcessor {
     static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
     static std::string describeThyself();
     ApiEndpoint(std::string id, ComponentGraphConfig* configPt);
+    // With a callback set, waits until the callbacks have seen every slice and the close. Errors out if that takes more than a minute, which usually means a callback is blocked on the graph itself
     void Shutdown() override;
     void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
     ChannelReturnResult PullMessage(unordered_map<std::string, DecoderMessage_ptr>& slice, float maxTimeout);
     ChannelReturnResult PullAllMessages(std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slice, float maxTimeout);
+    // See ComponentGraph::SetApiEndpointCallback(). Once set, PullMessage()/PullAllMessages() no longer return anything
+    void SetCallback(ApiEndpointSliceCallback onSlices, ApiEndpointClosedCallback onClosed, int maxSlicesPerCall);
+    // Whether the calling thread is one of the callback delivery threads. Those must not wait for the graph to shut down, since the shutdown waits for them
+    static bool OnCallbackThread();
     std::string getOutputSlot();
     static std::string SlotPassout;
   private:
     channel<unordered_map<std::string, DecoderMessage_ptr>> mSliceKeeper;
     bool RequiresConvStateInput() override { return false; }
+
+    // Callback delivery. At most one delivery task per endpoint is queued or running in the pool at any time
+    void scheduleCallbackDelivery();
+    void takeOverSliceKeeper();
+    void DeliverCallbacks();
+    std::mutex mCallbackMutex;
+    std::condition_variable mCallbackDoneCv;
+    std::condition_variable mCallbackRoomCv; // ProcessMessage() waits on it while mCallbackQueue is full
+    ApiEndpointSliceCallback mSliceCallback;
+    ApiEndpointClosedCallback mClosedCallback;
+    int mMaxSlicesPerCallback;
+    std::deque<unordered_map<std::string, DecoderMessage_ptr>> mCallbackQueue;
+    bool mCallbackScheduled;
+    bool mInputClosed;
+    bool mClosedDelivered;
 };
 
 } // namespace Godec
@@ -4,13 +4,11 @@
 
 namespace Godec {
 
-Vector preemphasize(const Vector& audio, float preemphasisFactor) {
-    Vector outAudio = audio;
-    for (int32_t i = outAudio.size() - 1; i >= 1; --i) {
-        outAudio(i) -= preemphasisFactor * outAudio(i - 1);
+void preemphasize(VectorRef audio, float preemphasisFactor) {
+    for (int32_t i = audio.size() - 1; i >= 1; --i) {
+        audio(i) -= preemphasisFactor * audio(i - 1);
     }
-    outAudio(0) *= 1.0 - preemphasisFactor;
-    return outAudio;
+    audio(0) *= 1.0 - preemphasisFactor;
 }
 
 /*
@@ -70,6 +68,93 @@ int Alaw_Decode(unsigned char a_val) {
     return ((a_val & SIGN_BIT) ? t : -t);
 }
 
+// G.711 decoding is a lookup in these, filled once from the functions above
+struct G711Tables {
+    G711Tables() {
+        for (int idx = 0; idx < 256; idx++) {
+            mMulaw[idx] = (float)Mulaw_Decode((unsigned char)idx);
+            mAlaw[idx] = (float)Alaw_Decode((unsigned char)idx);
+        }
+    }
+    float mMulaw[256];
+    float mAlaw[256];
+};
+
+static const G711Tables& GetG711Tables() {
+    static G711Tables tables;
+    return tables;
+}
+
+// The decode kernels convert interleaved samples straight into one vector per channel. Like in FileFeeder's de-interleaving, the channel stride is a
+// template parameter for mono and stereo (0 means use the runtime value), so that the compiler can vectorize the strided conversion
+template<typename Sample, int Stride>
+static void DecodeLinearChannel(const Sample* in, int stride, float* out, int64_t numSamples) {
+    const int step = Stride > 0 ? Stride : stride;
+    for (int64_t sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) out[sampleIdx] = (float)in[sampleIdx*step];
+}
+
+template<typename Sample>
+static void DecodeLinear(const unsigned char* in, int numChannels, int64_t numSamples, std::vector<Vector>& out) {
+    for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
+        const Sample* inRunner = (const Sample*)in + channelIdx;
+        if (numChannels == 1) DecodeLinearChannel<Sample, 1>(inRunner, numChannels, out[channelIdx].data(), numSamples);
+        else if (numChannels == 2) DecodeLinearChannel<Sample, 2>(inRunner, numChannels, out[channelIdx].data(), numSamples);
+        else DecodeLinearChannel<Sample, 0>(inRunner, numChannels, out[channelIdx].data(), numSamples);
+    }
+}
+
+// 24-bit samples get assembled in the upper bytes of an int32, the arithmetic shift back down sign-extends them
+template<int Stride>
+static void DecodePcm24Channel(const unsigned char* in, int stride, float* out, int64_t numSamples) {
+    const int step = 3*(Stride > 0 ? Stride : stride);
+    for (int64_t sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) {
+        const unsigned char* sample = in + sampleIdx*step;
+        out[sampleIdx] = (float)((int32_t)(((uint32_t)sample[0] << 8) | ((uint32_t)sample[1] << 16) | ((uint32_t)sample[2] << 24)) >> 8);
+    }
+}
+
+static void DecodePcm24(const unsigned char* in, int numChannels, int64_t numSamples, std::vector<Vector>& out) {
+    for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
+        const unsigned char* inRunner = in + 3*channelIdx;
+        if (numChannels == 1) DecodePcm24Channel<1>(inRunner, numChannels, out[channelIdx].data(), numSamples);
+        else if (numChannels == 2) DecodePcm24Channel<2>(inRunner, numChannels, out[channelIdx].data(), numSamples);
+        else DecodePcm24Channel<0>(inRunner, numChannels, out[channelIdx].data(), numSamples);
+    }
+}
+
+template<int Stride>
+static void DecodeG711Channel(const unsigned char* in, int stride, const float* table, float* out, int64_t numSamples) {
+    const int step = Stride > 0 ? Stride : stride;
+    for (int64_t sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) out[sampleIdx] = table[in[sampleIdx*step]];
+}
+
+template<AudioType Law>
+static void DecodeG711(const unsigned char* in, int numChannels, int64_t numSamples, std::vector<Vector>& out) {
+    const float* table = Law == MuLaw ? GetG711Tables().mMulaw : GetG711Tables().mAlaw;
+    for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
+        if (numChannels == 1) DecodeG711Channel<1>(in + channelIdx, numChannels, table, out[channelIdx].data(), numSamples);
+        else if (numChannels == 2) DecodeG711Channel<2>(in + channelIdx, numChannels, table, out[channelIdx].data(), numSamples);
+        else DecodeG711Channel<0>(in + channelIdx, numChannels, table, out[channelIdx].data(), numSamples);
+    }
+}
+
+AudioDecodeKernel AudioFormatParser::getDecodeKernel() const {
+    if (baseFormat == PCM) {
+        if (sampleWidth == 8) return &DecodeLinear<int8_t>;
+        if (sampleWidth == 16) return &DecodeLinear<int16_t>;
+        if (sampleWidth == 24) return &DecodePcm24;
+        if (sampleWidth == 32) return &DecodeLinear<int32_t>;
+    } else if (baseFormat == PCMFloat) {
+        if (sampleWidth == 32) return &DecodeLinear<float>;
+    } else if (baseFormat == MuLaw) {
+        if (sampleWidth == 8) return &DecodeG711<MuLaw>;
+    } else if (baseFormat == Alaw) {
+        if (sampleWidth == 8) return &DecodeG711<Alaw>;
+    }
+    GODEC_ERR << "Unsupported sample width " << sampleWidth << " for audio format " << baseFormat;
+    return NULL;
+}
+
 AudioFormatParser AudioFormatParser::FromFormatString(std::string formatString) {
     AudioFormatParser out;
     out.vtlStretch = 1.0f;
@@ -85,6 +170,7 @@ AudioFormatParser AudioFormatParser::FromFormatString(std::string formatString)
             if (keyVal[1] == "PCM") out.baseFormat = PCM;
             else if (keyVal[1] == "ulaw") out.baseFormat = MuLaw;
             else if (keyVal[1] == "alaw") out.baseFormat = Alaw;
+            else if (keyVal[1] == "float") out.baseFormat = PCMFloat;
             else GODEC_ERR << "Unknown base format " << keyVal[1];
         } else if (keyVal[0] == "num_channels") {
             out.numChannels = std::atoi(keyVal[1].c_str());
@@ -111,7 +197,7 @@ std::string AudioPreProcessorComponent::describeThyself() {
 }
 
 /* AudioPreProcessorComponent::ExtendedDescription
-This component supports both BinaryDecoderMessage as well as AudioDecoderMessage input in its "stream_audio" slot. The output slots are enumerated in the form of "`streamed_audio_0`", "`streamed_audio_1`" etc, up to the number specified in "`max_out_channels`"
+This component supports both BinaryDecoderMessage as well as AudioDecoderMessage input in its "stream_audio" slot. Binary audio can be 8, 16, 24 or 32 bit integer PCM ("base_format=PCM"), 32 bit float ("base_format=float") or 8 bit mu-law/A-law ("ulaw", "alaw"), with the channels interleaved. The samples are taken at face value, i.e. integers in the range of their sample width and floats as they are; "output_scale" can bring them into the range the downstream components expect. The output slots are enumerated in the form of "`streamed_audio_0`", "`streamed_audio_1`" etc, up to the number specified in "`max_out_channels`". If the stream doesn't start at time 0, its audio needs to carry a "stream_start_time" descriptor with the time before its first sample (FileFeeder sets it when it has a "time_offset")
 */
 
 AudioPreProcessorComponent::AudioPreProcessorComponent(std::string id, ComponentGraphConfig* configPt) :
@@ -130,6 +216,7 @@ AudioPreProcessorComponent::AudioPreProcessorComponent(std::string id, Component
     mUttReceivedResampledAudio = 0;
     mUttProducedAudio = 0;
     mUttStartStreamOffset = -1;
+    mDecodeKernel = NULL;
 
     mUpdateStatsHop = 0.25*mTargetSamplingRate; // Update stats every quarter of a second
 
@@ -150,11 +237,16 @@ int64_t AudioPreProcessorComponent::getNextChunkSize() {
 void AudioPreProcessorComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
     auto convStateMsg = msgBlock.get<ConversationStateDecoderMessage>(SlotConversationState);
     auto audioBaseMsg = msgBlock.getBaseMsg(SlotStreamedAudio);
+    // A stream that doesn't start at time 0 (e.g. from a FileFeeder with "time_offset") says where it starts, the first utterance's timing is relative to that
+    if (mUttStartStreamOffset == -1 && audioBaseMsg->getDescriptor("stream_start_time") != "") {
+        mUttStartStreamOffset = boost::lexical_cast<int64_t>(audioBaseMsg->getDescriptor("stream_start_time"));
+    }
 
     float sampleRate = -1.0f;
     float vtlStretch = 1.0f;
     int numChannels = 1;
-    std::vector<Vector> audioVecs;
+    std::vector<Vector> decodedAudio;
+    std::vector<const Vector*> audioVecs;
 
     double inputTicksPerSample = 1.0;
     // If the message is in AudioDecoderMessage format, we already got the float values
@@ -162,41 +254,32 @@ void AudioPreProcessorComponent::ProcessMessage(const DecoderMessageBlock& msgBl
         auto audioMsg =msgBlock.get<AudioDecoderMessage>(SlotStreamedAudio);
         sampleRate = audioMsg->mSampleRate;
         inputTicksPerSample = audioMsg->mTicksPerSample;
-        audioVecs.push_back(audioMsg->mAudio);
+        audioVecs.push_back(&audioMsg->mAudio);
         vtlStretch = audioMsg->getDescriptor("vtl_stretch") == "" ? vtlStretch : boost::lexical_cast<float>(audioMsg->getDescriptor("vtl_stretch"));
         // message is in BinaryDecoderMessage format, need to decode first
     } else if (audioBaseMsg->getUUID() == UUID_BinaryDecoderMessage) {
         auto binaryMsg =msgBlock.get<BinaryDecoderMessage>(SlotStreamedAudio);
         auto& binaryData = binaryMsg->mData;
-        AudioFormatParser parser = AudioFormatParser::FromFormatString(binaryMsg->mFormat);
+        // The format (and with it the decode kernel) only gets looked at again when it changes, which it normally doesn't within a stream
+        if (mDecodeKernel == NULL || binaryMsg->mFormat != mBinaryFormat) {
+            mBinaryFormatParser = AudioFormatParser::FromFormatString(binaryMsg->mFormat);
+            mDecodeKernel = mBinaryFormatParser.getDecodeKernel();
+            mBinaryFormat = binaryMsg->mFormat;
+        }
+        const AudioFormatParser& parser = mBinaryFormatParser;
         sampleRate = parser.sampleRate;
         vtlStretch = parser.vtlStretch;
         numChannels = parser.numChannels;
+        if (numChannels < 1) GODEC_ERR << getLPId() << ": Bad number of channels in audio format '" << binaryMsg->mFormat << "'";
         int bytesPerSample = parser.sampleWidth / 8;
-        int32_t numSamples = binaryData.size() / (numChannels*bytesPerSample);
-        for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
-            audioVecs.push_back(Vector(numSamples));
-            for (int sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) {
-                const unsigned char* samplePtr = &binaryData[bytesPerSample*(sampleIdx*numChannels + channelIdx)];
-                if (parser.baseFormat == PCM) {
-                    if (bytesPerSample == 1) {
-                        audioVecs[channelIdx](sampleIdx) = *((int8_t*)samplePtr);
-                    } else if (bytesPerSample == 2) {
-                        audioVecs[channelIdx](sampleIdx) = *((int16_t*)samplePtr);
-                    } else if (bytesPerSample == 4) {
-                        audioVecs[channelIdx](sampleIdx) = *((int32_t*)samplePtr);
-                    }
-                } else if (parser.baseFormat == MuLaw) {
-                    audioVecs[channelIdx](sampleIdx) = Mulaw_Decode(*samplePtr);
-                } else if (parser.baseFormat == Alaw) {
-                    audioVecs[channelIdx](sampleIdx) = Alaw_Decode(*samplePtr);
-                }
-            }
-        }
-        inputTicksPerSample = (convStateMsg->getTime()-mUttStartStreamOffset)/(double)(mUttReceivedRawAudio+audioVecs[0].size());
+        int64_t numSamples = binaryData.size() / (numChannels*bytesPerSample);
+        for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) decodedAudio.push_back(AcquireVector(numSamples));
+        mDecodeKernel(binaryData.data(), numChannels, numSamples, decodedAudio);
+        for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) audioVecs.push_back(&decodedAudio[channelIdx]);
+        inputTicksPerSample = (convStateMsg->getTime()-mUttStartStreamOffset)/(double)(mUttReceivedRawAudio+audioVecs[0]->size());
     }
 
-    mUttReceivedRawAudio += audioVecs[0].size();
+    mUttReceivedRawAudio += audioVecs[0]->size();
     double outputTimePerSample = inputTicksPerSample*(sampleRate / mTargetSamplingRate);
     if (outputTimePerSample < 1.0)
         GODEC_ERR << "Due to upsampling from " << sampleRate << "Hz to " << mTargetSamplingRate << "Hz, each audio sample will no longer have a unique time stamp. To fix this, add the optional 'time_upsample_factor' to the FileFeeder or Soundcard component (whichever you are using) to a value of ceil(" << mTargetSamplingRate << "/" << sampleRate << ")=" << std::ceil(1.0 / outputTimePerSample) << " or higher. If the audio is fed via an API, it is the responsibility of them to increase the timestamps by that factor. Note that this factor was calculated based on this specific audio chunk's sampling rate. If you have audio with even lower sampling rate, you might have to increase the upsampling factor even more";
@@ -215,8 +298,9 @@ void AudioPreProcessorComponent::ProcessMessage(const DecoderMessageBlock& msgBl
     // Maybe at some point this will be supported? It's not clear though what the timestamps would be if you suddenly have a new output stream that didn't exist before
     if (numChannels != zeroMean.size()) GODEC_ERR << getLPId() << ": Number of incoming channels changed mid-stream (from " << zeroMean.size() << " to " << numChannels << "). This is currently not supported";
 
-    // Resample
-    std::vector<Vector> resampledAudio(numChannels);
+    // Resample. Without resampling we work straight off the incoming audio
+    std::vector<Vector> resampledStorage(numChannels);
+    std::vector<const Vector*> resampledAudio(numChannels);
     for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
         if (sampleRate != mTargetSamplingRate) {
             if ((resample[channelIdx] == nullptr) || (mPrevSampleRate != sampleRate)) {
@@ -227,51 +311,47 @@ void AudioPreProcessorComponent::ProcessMessage(const DecoderMessageBlock& msgBl
             }
             mPrevSampleRate = sampleRate;
 
-            Vector tmpResampled;
-            resample[channelIdx]->Resample(audioVecs[channelIdx], convStateMsg->mLastChunkInUtt, &tmpResampled);
-            resampledAudio[channelIdx] = tmpResampled;
+            resample[channelIdx]->Resample(*audioVecs[channelIdx], convStateMsg->mLastChunkInUtt, &resampledStorage[channelIdx]);
+            resampledAudio[channelIdx] = &resampledStorage[channelIdx];
         } else {
             resampledAudio[channelIdx] = audioVecs[channelIdx];
         }
     }
 
-    mUttReceivedResampledAudio += resampledAudio[0].size();
+    mUttReceivedResampledAudio += resampledAudio[0]->size();
 
     for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
-        mStatsAccumAudio[channelIdx].conservativeResize(mStatsAccumAudio[channelIdx].size() + resampledAudio[channelIdx].size());
-        mStatsAccumAudio[channelIdx].tail(resampledAudio[channelIdx].size()) = resampledAudio[channelIdx];
+        mStatsAccumAudio[channelIdx].conservativeResize(mStatsAccumAudio[channelIdx].size() + resampledAudio[channelIdx]->size());
+        mStatsAccumAudio[channelIdx].tail(resampledAudio[channelIdx]->size()) = *resampledAudio[channelIdx];
     }
 
+    // The chunks below consume all of the resampled audio, so the output buffers (which the output messages take over) can be sized up front
     uint64_t outTimestamp = 0;
     std::vector<Vector> outAudio(numChannels);
+    for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) outAudio[channelIdx] = AcquireVector(resampledAudio[channelIdx]->size());
+    int64_t chunkStart = 0;
     while(true) { // Iterate over audio chunks until there is none left. The point of doing it in this chunking way is to make the normalization independent of how much audio we received. If we just normalized over the entirety of what we got into the input channel, the output would be non-deterministic.
         int64_t nextAudioChunkSize = getNextChunkSize();
 
         if (nextAudioChunkSize == 0) break;
 
         for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
-            Vector audioChunk = resampledAudio[channelIdx].segment(0, nextAudioChunkSize);
-            resampledAudio[channelIdx] = (Vector)resampledAudio[channelIdx].tail(resampledAudio[channelIdx].size() - audioChunk.size());
+            Vector audioChunk = resampledAudio[channelIdx]->segment(chunkStart, nextAudioChunkSize);
+            auto outChunk = outAudio[channelIdx].segment(chunkStart, nextAudioChunkSize);
 
             // Zero-mean
-            Vector normAudioChunk = zeroMean[channelIdx]->normalize(audioChunk);
+            outChunk = zeroMean[channelIdx]->normalize(audioChunk);
             // Pre-emphasize
-            Vector preempAudio;
             if (mPreemphasisFactor != 0.0f) {
-                preempAudio = preemphasize(normAudioChunk, mPreemphasisFactor);
-            } else {
-                preempAudio = normAudioChunk;
+                preemphasize(outChunk, mPreemphasisFactor);
             }
 
-            if (channelIdx == 0) mUttProducedAudio += preempAudio.size();
+            if (channelIdx == 0) mUttProducedAudio += nextAudioChunkSize;
             outTimestamp = mUttStartStreamOffset + (int64_t)round(outputTimePerSample*mUttProducedAudio);
             if (convStateMsg->mLastChunkInUtt && getNextChunkSize() == 0) {
                 outTimestamp = convStateMsg->getTime();
             }
 
-            outAudio[channelIdx].conservativeResize(outAudio[channelIdx].size() + preempAudio.size());
-            outAudio[channelIdx].tail(preempAudio.size()) = preempAudio;
-
             // Update the statistics
             if (mUttProducedAudio % mUpdateStatsHop == 0) {
                 Vector newChunk = mStatsAccumAudio[channelIdx].segment(0, mUpdateStatsHop);
@@ -279,12 +359,12 @@ void AudioPreProcessorComponent::ProcessMessage(const DecoderMessageBlock& msgBl
                 zeroMean[channelIdx]->addData(newChunk);
             }
         }
+        chunkStart += nextAudioChunkSize;
     }
     // Rescale output
     for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
-        for(int sampleIdx = 0; sampleIdx < outAudio[channelIdx].size(); sampleIdx++) {
-            outAudio[channelIdx][sampleIdx] *= mOutputScale;
-        }
+        if (outAudio[channelIdx].size() != chunkStart) outAudio[channelIdx].conservativeResize(chunkStart);
+        outAudio[channelIdx] *= mOutputScale;
     }
     // Output each channel separately
     for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
@@ -293,10 +373,11 @@ void AudioPreProcessorComponent::ProcessMessage(const DecoderMessageBlock& msgBl
         ss << SlotStreamedAudio << "_" << channelIdx;
         auto outputSlots = getOutputSlots();
         if (outputSlots.find(ss.str()) == outputSlots.end()) GODEC_ERR << "Trying to output audio stream " << ss.str() << ", but the output has not been defined";
-        auto outMsg = AudioDecoderMessage::create(outTimestamp, outAudio[channelIdx].data(), outAudio[channelIdx].size(), mTargetSamplingRate, outputTimePerSample);
+        auto outMsg = AudioDecoderMessage::create(outTimestamp, std::move(outAudio[channelIdx]), mTargetSamplingRate, outputTimePerSample);
         (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(audioBaseMsg->getFullDescriptorString());
         pushToOutputs(ss.str(), outMsg);
     }
+    for (auto it = decodedAudio.begin(); it != decodedAudio.end(); it++) ReleasePayload(std::move(*it));
 
     DecoderMessage_ptr audioInfoMsg = AudioInfoDecoderMessage::create(outTimestamp, mTargetSamplingRate, outputTimePerSample);
     (boost::const_pointer_cast<DecoderMessage>(audioInfoMsg))->setFullDescriptorString(audioBaseMsg->getFullDescriptorString());
@@ -310,6 +391,7 @@ void AudioPreProcessorComponent::ProcessMessage(const DecoderMessageBlock& msgBl
         mUttProducedAudio = 0;
         for (int channelIdx = 0; channelIdx < numChannels; channelIdx++) {
             zeroMean[channelIdx]->reset();
+            mStatsAccumAudio[channelIdx].resize(0); // The audio that didn't make up a full stats hop, it must not end up in the next utterance's mean
             if (resample[channelIdx] != nullptr) resample[channelIdx]->Reset();
         }
     }
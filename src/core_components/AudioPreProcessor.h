@@ -11,6 +11,9 @@ namespace Godec {
 int Mulaw_Decode(unsigned char ulawbyte);
 int Alaw_Decode(unsigned char a_val);
 
+// Converts "numSamples" interleaved samples of "numChannels" channels into the per-channel vectors in "out", which need to have room for them
+typedef void (*AudioDecodeKernel)(const unsigned char* in, int numChannels, int64_t numSamples, std::vector<Vector>& out);
+
 class AudioFormatParser {
   public:
     AudioType baseFormat;
@@ -19,6 +22,7 @@ class AudioFormatParser {
     float sampleRate;
     float vtlStretch;
     static AudioFormatParser FromFormatString(std::string);
+    AudioDecodeKernel getDecodeKernel() const;
 };
 
 class AudioPreProcessorComponent : public LoopProcessor {
@@ -47,6 +51,10 @@ class AudioPreProcessorComponent : public LoopProcessor {
 
     bool mDoZeroMean;
     float mPreemphasisFactor;
+
+    std::string mBinaryFormat;
+    AudioFormatParser mBinaryFormatParser;
+    AudioDecodeKernel mDecodeKernel;
 };
 
 }
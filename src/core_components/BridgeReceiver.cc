@@ -0,0 +1,186 @@
+#include "BridgeReceiver.h"
+#include "BridgeSender.h"
+#include <godec/ComponentGraph.h>
+#include <boost/chrono.hpp>
+#if !defined(ANDROID) && !defined(_MSC_VER)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace Godec {
+
+LoopProcessor* BridgeReceiverComponent::make(std::string id, ComponentGraphConfig* configPt) {
+    return new BridgeReceiverComponent(id, configPt);
+}
+std::string BridgeReceiverComponent::describeThyself() {
+    return "Receives the streams a BridgeSender in another Godec process sends over a Unix domain socket";
+}
+
+/* BridgeReceiverComponent::ExtendedDescription
+The source counterpart of BridgeSender (Linux only). It creates the socket at "socket_path" (replacing a stale socket left behind by an earlier run) and waits up to "accept_timeout_sec" seconds for a single BridgeSender to connect (after that, Godec errors out). The output slots are the names of the streams on the sending side, e.g. if the sender had the "feats" stream connected, "outputs": { "feats": "remote_feats" } makes the messages available as "remote_feats". Streams that are not listed in "outputs" are skipped.
+
+Messages come out in the order and chunks they were sent in. For flow control, the sender can only have "window_kb" kilobytes of messages underway that this component has not given credit back for. Credit for a received batch goes back once the messages have been passed on and none of the downstream components has more than "max_queued_messages" messages waiting in its input queue. That way, a slow consumer slows down the sender instead of letting messages pile up in this process.
+
+If the sending process goes away before it has sent the end of its streams, this is an error.
+*/
+
+BridgeReceiverComponent::BridgeReceiverComponent(std::string id, ComponentGraphConfig* configPt) :
+    LoopProcessor(id, configPt) {
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    mSocketPath = configPt->get<std::string>("socket_path", "Path of the Unix domain socket to create and listen on");
+    int windowKb = configPt->get<int>("window_kb", "How many kilobytes of messages the sender can have underway before it has to wait for credit");
+    mMaxQueuedMessages = configPt->get<int>("max_queued_messages", "Credit is held back while a downstream component has more than this many messages waiting in its input queue");
+    mAcceptTimeoutSec = configPt->get<float>("accept_timeout_sec", "How long to wait for the BridgeSender to connect, in seconds");
+    if (windowKb < 1) GODEC_ERR << getLPId(false) << ": window_kb needs to be at least 1";
+    if (mMaxQueuedMessages < 0) GODEC_ERR << getLPId(false) << ": max_queued_messages can not be negative";
+    mWindowBytes = (uint64_t)windowKb * 1024;
+
+    std::list<std::string> requiredOutputSlots;
+    // requiredOutputSlots.push_back(Slot: name of a stream on the sending side);  // For godec doc
+    initOutputs(requiredOutputSlots);
+    if (mOutputSlots.empty()) GODEC_ERR << getLPId(false) << ": No outputs defined, specify the streams to receive";
+
+    // Listening starts right away, so that the sender can connect as soon as this graph is up
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (mSocketPath.size() >= sizeof(addr.sun_path)) GODEC_ERR << getLPId(false) << ": Socket path " << mSocketPath << " is too long";
+    strncpy(addr.sun_path, mSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+    struct stat pathStat;
+    if (lstat(mSocketPath.c_str(), &pathStat) == 0) {
+        if (!S_ISSOCK(pathStat.st_mode)) GODEC_ERR << getLPId(false) << ": " << mSocketPath << " exists and is not a socket";
+        unlink(mSocketPath.c_str());
+    }
+    mSocket = -1;
+    mListenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (mListenSocket < 0) GODEC_ERR << getLPId(false) << ": Could not create socket: " << strerror(errno);
+    if (bind(mListenSocket, (struct sockaddr*)&addr, sizeof(addr)) != 0) GODEC_ERR << getLPId(false) << ": Could not bind to " << mSocketPath << ": " << strerror(errno);
+    if (listen(mListenSocket, 1) != 0) GODEC_ERR << getLPId(false) << ": Could not listen on " << mSocketPath << ": " << strerror(errno);
+#else
+    GODEC_ERR << getLPId(false) << ": BridgeReceiver is only supported on Linux";
+#endif
+}
+
+BridgeReceiverComponent::~BridgeReceiverComponent() {
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    if (mSocket >= 0) close(mSocket);
+    if (mListenSocket >= 0) {
+        close(mListenSocket);
+        unlink(mSocketPath.c_str());
+    }
+#endif
+}
+
+void BridgeReceiverComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {}
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+
+void BridgeReceiverComponent::SendFrame(uint32_t frameType, const WireWriter& payload) {
+    WireWriter header;
+    header.writeU32(frameType);
+    header.writeU32(0);
+    header.writeU64(payload.size());
+    if (!WriteToSocket(mSocket, header.data(), header.size()) || !WriteToSocket(mSocket, payload.data(), payload.size())) {
+        GODEC_ERR << getLPId(false) << ": BridgeSender closed the connection before the end of its streams";
+    }
+}
+
+void BridgeReceiverComponent::AcceptSender() {
+    auto deadline = boost::chrono::steady_clock::now() + boost::chrono::duration<float>(mAcceptTimeoutSec);
+    while (true) {
+        boost::chrono::duration<float> remaining = deadline - boost::chrono::steady_clock::now();
+        if (remaining.count() <= 0.0f) GODEC_ERR << getLPId(false) << ": No BridgeSender connected to " << mSocketPath << " within " << mAcceptTimeoutSec << " seconds";
+        struct pollfd pfd;
+        pfd.fd = mListenSocket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, (int)std::min(remaining.count() * 1000.0f + 1.0f, (float)INT_MAX));
+        if (ret < 0 && errno != EINTR) GODEC_ERR << getLPId(false) << ": Could not wait for a connection on " << mSocketPath << ": " << strerror(errno);
+        if (ret <= 0) continue;
+        mSocket = accept4(mListenSocket, NULL, NULL, SOCK_CLOEXEC);
+        if (mSocket >= 0) return;
+        if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) GODEC_ERR << getLPId(false) << ": Could not accept connection on " << mSocketPath << ": " << strerror(errno);
+    }
+}
+
+// Only this component pushes into its output channels, so once one of them is down to "max_queued_messages" it stays there while we wait for the others
+void BridgeReceiverComponent::WaitForDownstream() {
+    for (auto slotIt = mOutputSlots.begin(); slotIt != mOutputSlots.end(); slotIt++) {
+        for (auto chanIt = slotIt->second.begin(); chanIt != slotIt->second.end(); chanIt++) {
+            while (!(*chanIt)->waitForNumItemsAtMost(mMaxQueuedMessages, FLT_MAX)) {}
+        }
+    }
+}
+
+void BridgeReceiverComponent::ProcessLoop() {
+    AcceptSender();
+    // Only one sender per receiver
+    close(mListenSocket);
+    mListenSocket = -1;
+    unlink(mSocketPath.c_str());
+
+    mFrameWriter.clear();
+    mFrameWriter.writeU32(GODEC_BRIDGE_MAGIC);
+    mFrameWriter.writeU16(GODEC_BRIDGE_VERSION);
+    mFrameWriter.writeU64(mWindowBytes);
+    SendFrame(BridgeFrameHello, mFrameWriter);
+
+    std::vector<char> payload;
+    uint64_t numReceived = 0;
+    std::set<std::string> skippedStreams;
+    while (true) {
+        char headerBytes[GODEC_BRIDGE_FRAME_HEADER_SIZE];
+        if (!ReadFromSocket(mSocket, headerBytes, sizeof(headerBytes))) GODEC_ERR << getLPId(false) << ": BridgeSender closed the connection before the end of its streams";
+        WireReader header(headerBytes, sizeof(headerBytes));
+        uint32_t frameType = header.readU32();
+        header.readU32();
+        uint64_t payloadSize = header.readU64();
+        if (frameType == BridgeFrameEnd) break;
+        if (frameType != BridgeFrameMessages) GODEC_ERR << getLPId(false) << ": Unexpected frame type " << frameType << " from BridgeSender";
+
+        payload.resize(payloadSize);
+        if (!ReadFromSocket(mSocket, payload.data(), payloadSize)) GODEC_ERR << getLPId(false) << ": BridgeSender closed the connection before the end of its streams";
+        WireReader frameReader(payload.data(), payload.size());
+        while (frameReader.remaining() > 0) {
+            uint64_t msgSize = frameReader.readU64();
+            frameReader.readU64();
+            if (msgSize > frameReader.remaining()) GODEC_ERR << getLPId(false) << ": Message of " << msgSize << " bytes runs past the end of its frame";
+            WireReader msgReader(payload.data() + frameReader.position(), msgSize);
+            DecoderMessage_ptr msg = GetComponentGraph()->WireToDecoderMsg(msgReader);
+            frameReader.seek(std::min(frameReader.position() + msgSize + BridgePadding(msgSize), payload.size()));
+
+            std::string stream = msg->getTag();
+            if (mOutputSlots.find(stream) == mOutputSlots.end()) {
+                skippedStreams.insert(stream);
+                continue;
+            }
+            pushToOutputs(stream, msg);
+            numReceived++;
+        }
+
+        WaitForDownstream();
+        mFrameWriter.clear();
+        mFrameWriter.writeU64(payloadSize);
+        SendFrame(BridgeFrameCredit, mFrameWriter);
+    }
+    close(mSocket);
+    mSocket = -1;
+
+    std::stringstream summary;
+    summary << getLPId() << ": Received " << numReceived << " messages";
+    for (auto it = skippedStreams.begin(); it != skippedStreams.end(); it++) {
+        summary << ", skipped stream '" << *it << "'";
+    }
+    GODEC_INFO << summary.str() << std::endl;
+    Shutdown();
+}
+
+#endif
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <godec/ChannelMessenger.h>
+#include <godec/WireFormat.h>
+#include "GodecMessages.h"
+#include "Ipc.h"
+
+namespace Godec {
+
+class BridgeReceiverComponent : public LoopProcessor {
+  public:
+    static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
+    static std::string describeThyself();
+    BridgeReceiverComponent(std::string id, ComponentGraphConfig* configPt);
+    virtual ~BridgeReceiverComponent();
+    void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
+
+  private:
+    bool RequiresConvStateInput() override { return false; }
+    bool EnforceInputsOutputs() override { return false; }
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    void ProcessLoop() override;
+    void SendFrame(uint32_t frameType, const WireWriter& payload);
+    void AcceptSender();
+    void WaitForDownstream();
+
+    std::string mSocketPath;
+    float mAcceptTimeoutSec;
+    uint64_t mWindowBytes;
+    int mMaxQueuedMessages;
+    int mListenSocket;
+    int mSocket;
+    WireWriter mFrameWriter;
+#endif
+};
+
+}
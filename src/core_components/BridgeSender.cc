@@ -0,0 +1,231 @@
+#include "BridgeSender.h"
+#include <boost/chrono.hpp>
+#if !defined(ANDROID) && !defined(_MSC_VER)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace Godec {
+
+LoopProcessor* BridgeSenderComponent::make(std::string id, ComponentGraphConfig* configPt) {
+    return new BridgeSenderComponent(id, configPt);
+}
+std::string BridgeSenderComponent::describeThyself() {
+    return "Sends its input streams over a Unix domain socket to a BridgeReceiver in another Godec process";
+}
+
+/* BridgeSenderComponent::ExtendedDescription
+Together with BridgeReceiver, this splits a graph across several Godec processes on the same machine (Linux only), e.g. to give the front end and a memory-hungry model their own processes that can be sized and restarted independently. Connect any number of streams as inputs, the slot names are free-form. On the receiving side, the streams come out under their names from this side.
+
+The BridgeReceiver creates the socket at "socket_path", and the sender connects to it, so start the receiving process first. The sender keeps retrying for "connect_timeout_sec" seconds, its input queues up in the meantime.
+
+Messages go over the socket in the binary wire format. Small messages that arrive in quick succession get batched into frames of up to "max_batch_kb" kilobytes, while a message that arrives on its own is sent right away. Big payloads (e.g. feature matrices) are not copied into the frame, they go to the socket straight from the message with scatter-gather I/O.
+
+The receiver hands out credit for a limited number of bytes (its "window_kb"), and only gives it back once it has passed the messages on and its downstream components have caught up. A slow consumer thus makes this component wait, and the backlog builds up in the input queue of this component rather than in an unbounded socket buffer on either side. The number of times the sender had to wait for credit is logged at shutdown.
+
+All message types need to support the binary wire format and be known by libraries loaded on both sides.
+*/
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+// Payload blocks at least this big go out directly from the message instead of being copied into the frame
+static const size_t BridgeScatterThresholdBytes = 32 * 1024;
+static const char BridgeZeroPadding[GODEC_WIRE_BLOCK_ALIGNMENT] = {0};
+#endif
+
+BridgeSenderComponent::BridgeSenderComponent(std::string id, ComponentGraphConfig* configPt) :
+    LoopProcessor(id, configPt) {
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    mSocketPath = configPt->get<std::string>("socket_path", "Path of the Unix domain socket the BridgeReceiver listens on");
+    mConnectTimeoutSec = configPt->get<float>("connect_timeout_sec", "How long to keep trying to connect to the BridgeReceiver, in seconds");
+    int maxBatchKb = configPt->get<int>("max_batch_kb", "Maximum size in kilobytes of a batch of messages sent in one frame");
+    if (maxBatchKb < 1) GODEC_ERR << getLPId(false) << ": max_batch_kb needs to be at least 1";
+    mMaxBatchBytes = (size_t)maxBatchKb * 1024;
+
+    // addInputSlotAndUUID(Slot: stream to send, UUID_AnyDecoderMessage);  // For godec doc
+
+    std::list<std::string> requiredOutputSlots;
+    initOutputs(requiredOutputSlots);
+
+    mSocket = -1;
+    mWindowBytes = 0;
+    mBytesInFlight = 0;
+    mBatchBytes = 0;
+    mNumSent = 0;
+    mNumFrames = 0;
+    mNumCreditWaits = 0;
+#else
+    GODEC_ERR << getLPId(false) << ": BridgeSender is only supported on Linux";
+#endif
+}
+
+BridgeSenderComponent::~BridgeSenderComponent() {
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    if (mSocket >= 0) close(mSocket);
+#endif
+}
+
+void BridgeSenderComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {}
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+
+void BridgeSenderComponent::Connect() {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (mSocketPath.size() >= sizeof(addr.sun_path)) GODEC_ERR << getLPId(false) << ": Socket path " << mSocketPath << " is too long";
+    strncpy(addr.sun_path, mSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    auto deadline = boost::chrono::steady_clock::now() + boost::chrono::duration<float>(mConnectTimeoutSec);
+    while (true) {
+        // Worker processes started later must not inherit the connection, or the receiver would not see it close when this process dies
+        mSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (mSocket < 0) GODEC_ERR << getLPId(false) << ": Could not create socket: " << strerror(errno);
+        if (connect(mSocket, (struct sockaddr*)&addr, sizeof(addr)) == 0) break;
+        int connectErrno = errno;
+        close(mSocket);
+        mSocket = -1;
+        // The receiving process might not be up yet
+        bool retry = connectErrno == ENOENT || connectErrno == ECONNREFUSED || connectErrno == EINTR;
+        if (!retry || boost::chrono::steady_clock::now() > deadline) {
+            GODEC_ERR << getLPId(false) << ": Could not connect to " << mSocketPath << ": " << strerror(connectErrno);
+        }
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+    }
+
+    uint32_t frameType;
+    if (!ReadFrame(frameType, mFramePayload) || frameType != BridgeFrameHello) GODEC_ERR << getLPId(false) << ": " << mSocketPath << " is not a BridgeReceiver";
+    WireReader reader(mFramePayload.data(), mFramePayload.size());
+    if (reader.readU32() != GODEC_BRIDGE_MAGIC) GODEC_ERR << getLPId(false) << ": " << mSocketPath << " is not a BridgeReceiver";
+    uint16_t version = reader.readU16();
+    if (version != GODEC_BRIDGE_VERSION) GODEC_ERR << getLPId(false) << ": BridgeReceiver at " << mSocketPath << " speaks protocol version " << version << ", this side " << GODEC_BRIDGE_VERSION;
+    mWindowBytes = reader.readU64();
+    // A batch never needs to wait for more credit than the receiver can ever hand out
+    mMaxBatchBytes = std::min(mMaxBatchBytes, (size_t)mWindowBytes);
+    GODEC_INFO << getLPId() << ": Connected to " << mSocketPath << ", window is " << mWindowBytes << " bytes" << std::endl;
+}
+
+bool BridgeSenderComponent::ReadFrame(uint32_t& frameType, std::vector<char>& payload) {
+    char headerBytes[GODEC_BRIDGE_FRAME_HEADER_SIZE];
+    if (!ReadFromSocket(mSocket, headerBytes, sizeof(headerBytes))) return false;
+    WireReader header(headerBytes, sizeof(headerBytes));
+    frameType = header.readU32();
+    header.readU32();
+    uint64_t payloadSize = header.readU64();
+    payload.resize(payloadSize);
+    return ReadFromSocket(mSocket, payload.data(), payloadSize);
+}
+
+// Reads credit frames, blocking for at least one if asked to, otherwise only as long as some are waiting in the socket
+void BridgeSenderComponent::ReadCredit(bool block) {
+    while (block || SocketReadable(mSocket)) {
+        uint32_t frameType;
+        if (!ReadFrame(frameType, mFramePayload)) GODEC_ERR << getLPId(false) << ": BridgeReceiver at " << mSocketPath << " closed the connection";
+        if (frameType != BridgeFrameCredit) GODEC_ERR << getLPId(false) << ": Unexpected frame type " << frameType << " from BridgeReceiver";
+        WireReader reader(mFramePayload.data(), mFramePayload.size());
+        uint64_t credit = reader.readU64();
+        if (credit > mBytesInFlight) GODEC_ERR << getLPId(false) << ": BridgeReceiver gave back more credit than was in use";
+        mBytesInFlight -= credit;
+        block = false;
+    }
+}
+
+void BridgeSenderComponent::AddToBatch(const DecoderMessage_ptr& msg) {
+    if (mBatchMsgs.size() == mWriters.size()) {
+        mWriters.emplace_back();
+        mWriters.back().setExternalBlockThreshold(BridgeScatterThresholdBytes);
+    }
+    WireWriter& writer = mWriters[mBatchMsgs.size()];
+    writer.clear();
+    WriteWireMessage(writer, *msg);
+    mBatchMsgs.push_back(msg);
+    mBatchBytes += GODEC_BRIDGE_MESSAGE_HEADER_SIZE + writer.size() + BridgePadding(writer.size());
+}
+
+void BridgeSenderComponent::SendBatch() {
+    if (mBatchMsgs.empty()) return;
+    ReadCredit(false);
+    if (mBytesInFlight > 0 && mBytesInFlight + mBatchBytes > mWindowBytes) {
+        mNumCreditWaits++;
+        while (mBytesInFlight > 0 && mBytesInFlight + mBatchBytes > mWindowBytes) ReadCredit(true);
+    }
+
+    // All headers go into one buffer first, so that pointers into it stay valid
+    mHeaderWriter.clear();
+    mHeaderWriter.writeU32(BridgeFrameMessages);
+    mHeaderWriter.writeU32(0);
+    mHeaderWriter.writeU64(mBatchBytes);
+    for (size_t msgIdx = 0; msgIdx < mBatchMsgs.size(); msgIdx++) {
+        mHeaderWriter.writeU64(mWriters[msgIdx].size());
+        mHeaderWriter.writeU64(0);
+    }
+    mSegments.clear();
+    mSegments.push_back(WireWriter::Segment{mHeaderWriter.data(), GODEC_BRIDGE_FRAME_HEADER_SIZE});
+    for (size_t msgIdx = 0; msgIdx < mBatchMsgs.size(); msgIdx++) {
+        mSegments.push_back(WireWriter::Segment{mHeaderWriter.data() + GODEC_BRIDGE_FRAME_HEADER_SIZE + msgIdx * GODEC_BRIDGE_MESSAGE_HEADER_SIZE, GODEC_BRIDGE_MESSAGE_HEADER_SIZE});
+        mWriters[msgIdx].appendSegments(mSegments);
+        size_t padding = BridgePadding(mWriters[msgIdx].size());
+        if (padding > 0) mSegments.push_back(WireWriter::Segment{BridgeZeroPadding, padding});
+    }
+    mIov.resize(mSegments.size());
+    for (size_t segIdx = 0; segIdx < mSegments.size(); segIdx++) {
+        mIov[segIdx].iov_base = (void*)mSegments[segIdx].mData;
+        mIov[segIdx].iov_len = mSegments[segIdx].mSize;
+    }
+    if (!WriteVectorToSocket(mSocket, mIov.data(), mIov.size())) GODEC_ERR << getLPId(false) << ": BridgeReceiver at " << mSocketPath << " closed the connection";
+
+    mBytesInFlight += mBatchBytes;
+    mNumSent += mBatchMsgs.size();
+    mNumFrames++;
+    mBatchMsgs.clear();
+    mBatchBytes = 0;
+}
+
+void BridgeSenderComponent::SendFrame(uint32_t frameType) {
+    mHeaderWriter.clear();
+    mHeaderWriter.writeU32(frameType);
+    mHeaderWriter.writeU32(0);
+    mHeaderWriter.writeU64(0);
+    if (!WriteToSocket(mSocket, mHeaderWriter.data(), mHeaderWriter.size())) GODEC_ERR << getLPId(false) << ": BridgeReceiver at " << mSocketPath << " closed the connection";
+}
+
+// Bypasses the time slicing of the usual loop, messages get sent as they arrive
+void BridgeSenderComponent::ProcessLoop() {
+    Connect();
+    while (true) {
+        DecoderMessage_ptr newMessage;
+        // Only waits when there is nothing to send, otherwise an empty input queue means it's time to send the batch
+        ChannelReturnResult res = mInputChannel.get(newMessage, mBatchMsgs.empty() ? FLT_MAX : 0.0f);
+        if (res == ChannelClosed) break;
+        if (res == ChannelTimeout) {
+            SendBatch();
+            continue;
+        }
+
+        if (isVerbose()) {
+            std::stringstream verboseStr;
+            verboseStr << "LP " << getLPId() << ": incoming " << newMessage->describeThyself() << std::endl;
+            GODEC_INFO << verboseStr.str();
+        }
+
+        AddToBatch(newMessage);
+        if (mBatchBytes >= mMaxBatchBytes) SendBatch();
+    }
+    SendBatch();
+    SendFrame(BridgeFrameEnd);
+
+    // The receiver closes the connection once it has everything, until then it might still send credit
+    uint32_t frameType;
+    while (ReadFrame(frameType, mFramePayload)) {}
+    close(mSocket);
+    mSocket = -1;
+
+    GODEC_INFO << getLPId() << ": Sent " << mNumSent << " messages in " << mNumFrames << " frames, waited for credit " << mNumCreditWaits << " times" << std::endl;
+    Shutdown();
+}
+
+#endif
+
+}
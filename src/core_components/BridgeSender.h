@@ -0,0 +1,87 @@
+#pragma once
+#include <godec/ChannelMessenger.h>
+#include <godec/WireFormat.h>
+#include "GodecMessages.h"
+#include "Ipc.h"
+#if !defined(ANDROID) && !defined(_MSC_VER)
+#include <sys/uio.h>
+#endif
+
+namespace Godec {
+
+/*
+ * Protocol between BridgeSender and BridgeReceiver, over a Unix domain stream socket. Every frame starts with
+ *
+ *   uint32  frame type (BridgeFrameType)
+ *   uint32  reserved, 0
+ *   uint64  payload size in bytes
+ *
+ * Receiver to sender:
+ *   BridgeFrameHello     First frame after the connection got accepted. uint32 magic ("GDBR"), uint16 protocol version, uint64 window size in bytes
+ *   BridgeFrameCredit    uint64 number of message payload bytes the receiver is done with
+ * Sender to receiver:
+ *   BridgeFrameMessages  One or more messages, each as uint64 size, uint64 reserved, the message in the wire format (see godec/WireFormat.h), zero padding to 16 bytes.
+ *                        The message tag is the name of the stream it was sent from
+ *   BridgeFrameEnd       No payload, all streams have ended
+ *
+ * Flow control: The sender may have at most "window" bytes of Messages payload that the receiver has not given credit back for. A single frame that is larger than the window can only go out when no credit is outstanding
+ */
+static const uint32_t GODEC_BRIDGE_MAGIC = 0x52424447; // "GDBR" when read as bytes
+static const uint16_t GODEC_BRIDGE_VERSION = 1;
+static const size_t GODEC_BRIDGE_FRAME_HEADER_SIZE = 16;
+static const size_t GODEC_BRIDGE_MESSAGE_HEADER_SIZE = 16;
+
+enum BridgeFrameType {
+    BridgeFrameHello = 0,
+    BridgeFrameCredit = 1,
+    BridgeFrameMessages = 2,
+    BridgeFrameEnd = 3
+};
+
+inline size_t BridgePadding(size_t size) {
+    return (GODEC_WIRE_BLOCK_ALIGNMENT - size % GODEC_WIRE_BLOCK_ALIGNMENT) % GODEC_WIRE_BLOCK_ALIGNMENT;
+}
+
+class BridgeSenderComponent : public LoopProcessor {
+  public:
+    static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
+    static std::string describeThyself();
+    BridgeSenderComponent(std::string id, ComponentGraphConfig* configPt);
+    virtual ~BridgeSenderComponent();
+    void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
+
+  private:
+    bool RequiresConvStateInput() override { return false; }
+    bool EnforceInputsOutputs() override { return false; }
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    void ProcessLoop() override;
+    void Connect();
+    bool ReadFrame(uint32_t& frameType, std::vector<char>& payload);
+    void ReadCredit(bool block);
+    void AddToBatch(const DecoderMessage_ptr& msg);
+    void SendBatch();
+    void SendFrame(uint32_t frameType);
+
+    std::string mSocketPath;
+    float mConnectTimeoutSec;
+    size_t mMaxBatchBytes;
+    int mSocket;
+    uint64_t mWindowBytes;
+    uint64_t mBytesInFlight;
+
+    // The current batch. The writers only reference big payloads, so the messages are kept alive until the batch has gone out
+    std::vector<WireWriter> mWriters;
+    std::vector<DecoderMessage_ptr> mBatchMsgs;
+    size_t mBatchBytes;
+    WireWriter mHeaderWriter;
+    std::vector<WireWriter::Segment> mSegments;
+    std::vector<struct iovec> mIov;
+    std::vector<char> mFramePayload;
+
+    uint64_t mNumSent;
+    uint64_t mNumFrames;
+    uint64_t mNumCreditWaits;
+#endif
+};
+
+}
@@ -29,19 +29,18 @@ void EnergyComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
 
     if (audioMsg->mFeatureNames.substr(0, strlen("WINAUDIO")) != "WINAUDIO") GODEC_ERR << getLPId() << ": Expected windowed audio, got " << audioMsg->mFeatureNames;
 
-    Matrix audioSnippets = audioMsg->mFeatures;
-    Matrix outMat(1, audioSnippets.cols());
+    const Matrix& audioSnippets = audioMsg->mFeatures;
+    Matrix outMat = AcquireMatrix(1, audioSnippets.cols());
 
     for (int frameIdx = 0; frameIdx < audioSnippets.cols(); frameIdx++) {
-        Vector audio = audioSnippets.col(frameIdx);
-        float energy = audio.squaredNorm();
+        float energy = audioSnippets.col(frameIdx).squaredNorm();
         energy = (energy < MINLARG) ? LZERO : 10.0*log10(energy);
         outMat(0, frameIdx) = energy;
     }
 
     pushToOutputs(SlotFeatures, FeaturesDecoderMessage::create(
                       convStateMsg->getTime(), convStateMsg->mUtteranceId,
-                      outMat, "R0%f", audioMsg->mFeatureTimestamps));
+                      std::move(outMat), "R0%f", audioMsg->mFeatureTimestamps));
 }
 
 }
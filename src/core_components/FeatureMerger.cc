@@ -31,7 +31,6 @@ FeatureMergerComponent::~FeatureMergerComponent() {}
 void FeatureMergerComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
     auto convStateMsg = msgBlock.get<ConversationStateDecoderMessage>(SlotConversationState);
 
-    Matrix mergedFeats(0, 0);
     std::string mergedPfname = "";
     std::vector<uint64_t> featureTimestamps;
 
@@ -39,43 +38,67 @@ void FeatureMergerComponent::ProcessMessage(const DecoderMessageBlock& msgBlock)
     float ticksPerSample;
     float sampleRate;
 
+    // Determine the merged size first, so the output can be filled in place
+    Eigen::Index mergedRows = 0;
+    Eigen::Index mergedCols = 0;
+    for(int streamIdx = 0; streamIdx < mNumStreams; streamIdx++) {
+        std::stringstream slotSs;
+        slotSs << "feature_stream_" << streamIdx;
+        std::string slot = slotSs.str();
+        auto baseMsg = msgBlock.getBaseMsg(slot);
+        Eigen::Index rows = 0;
+        Eigen::Index cols = 0;
+        if (baseMsg->getUUID() == UUID_FeaturesDecoderMessage) {
+            auto featMsg = msgBlock.get<FeaturesDecoderMessage>(slot);
+            rows = featMsg->mFeatures.rows();
+            cols = featMsg->mFeatures.cols();
+        } else if (baseMsg->getUUID() == UUID_AudioDecoderMessage) {
+            auto audioMsg = msgBlock.get<AudioDecoderMessage>(slot);
+            rows = 1;
+            cols = audioMsg->mAudio.size();
+        }
+        if (mergedCols != 0 && mergedCols != cols)
+            GODEC_ERR << getLPId() << ": Can't merge in stream " << slot << " because it has a different number of features than the previous streams" << std::endl << "Time " << convStateMsg->getTime() << " " << mergedCols << "vs" << cols << std::endl;
+        mergedRows += rows;
+        mergedCols = cols;
+    }
+
+    Matrix mergedFeats = AcquireMatrix(mergedRows, mergedCols);
+    Eigen::Index rowOffset = 0;
     for(int streamIdx = 0; streamIdx < mNumStreams; streamIdx++) {
         std::stringstream slotSs;
         slotSs << "feature_stream_" << streamIdx;
         std::string slot = slotSs.str();
         auto baseMsg = msgBlock.getBaseMsg(slot);
-        Matrix feats;
         msgType = baseMsg->getUUID();
         if (baseMsg->getUUID() == UUID_FeaturesDecoderMessage) {
             auto featMsg = msgBlock.get<FeaturesDecoderMessage>(slot);
-            feats = featMsg->mFeatures;
+            const Matrix& feats = featMsg->mFeatures;
+            mergedFeats.middleRows(rowOffset, feats.rows()) = feats;
+            rowOffset += feats.rows();
             mergedPfname += featMsg->mFeatureNames + ";";
             featureTimestamps = featMsg->mFeatureTimestamps;
         } else if (baseMsg->getUUID() == UUID_AudioDecoderMessage) {
             auto audioMsg = msgBlock.get<AudioDecoderMessage>(slot);
             ticksPerSample = audioMsg->mTicksPerSample;
             sampleRate = audioMsg->mSampleRate;
-            feats = audioMsg->mAudio.transpose();
+            mergedFeats.row(rowOffset) = audioMsg->mAudio.transpose();
+            rowOffset++;
             std::stringstream featNameSs;
             featNameSs << "AUDIO[0:" << (mNumStreams-1) << "]%f;";
             mergedPfname = featNameSs.str();
             int64_t msgLength = audioMsg->getTime()-msgBlock.getPrevCutoff();
-            std::vector<uint64_t> featTimeStamps;
-            for(int sampleIdx = 0; sampleIdx < feats.cols(); sampleIdx++) {
-                uint64_t t = msgBlock.getPrevCutoff()+msgLength*((sampleIdx+1)/(double)feats.cols());
-                featTimeStamps.push_back(t);
+            int64_t numSamples = audioMsg->mAudio.size();
+            featureTimestamps.resize(numSamples);
+            for(int sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) {
+                featureTimestamps[sampleIdx] = msgBlock.getPrevCutoff()+msgLength*((sampleIdx+1)/(double)numSamples);
             }
-            featureTimestamps = featTimeStamps;
         }
-        if (mergedFeats.cols() != 0 && mergedFeats.cols() != feats.cols())
-            GODEC_ERR << getLPId() << ": Can't merge in stream " << slot << " because it has a different number of features than the previous streams" << std::endl << "Time " << convStateMsg->getTime() << " " << mergedFeats.cols() << "vs" << feats.cols() << std::endl;
-        mergedFeats.conservativeResize(mergedFeats.rows() + feats.rows(), feats.cols());
-        mergedFeats.bottomRows(feats.rows()) = feats;
     }
     mergedPfname.pop_back(); // Erase the last ;
     DecoderMessage_ptr outMsg = FeaturesDecoderMessage::create(
                                     convStateMsg->getTime(), convStateMsg->mUtteranceId,
-                                    mergedFeats, mergedPfname, featureTimestamps);
+                                    std::move(mergedFeats), mergedPfname, std::move(featureTimestamps));
     if (msgType == UUID_AudioDecoderMessage) {
         (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("ticks_per_sample", boost::lexical_cast<std::string>(ticksPerSample));
         (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("sample_rate", boost::lexical_cast<std::string>(sampleRate));
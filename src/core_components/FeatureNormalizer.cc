@@ -198,33 +198,44 @@ void FeatureNormalizerComponent::ProcessMessage(const DecoderMessageBlock& msgBl
         mAccumFeats.conservativeResize(mAccumFeats.rows(), mAccumFeats.cols()+m.cols());
         mAccumFeats.rightCols(m.cols()) = m;
         std::vector<uint64_t> featureTimestamps;
-        Matrix normM = Matrix(mAccumFeats.rows(), 0);
-        while(mAccumFeats.cols() / mUpdateStatsHop > 0 || (mAccumFeats.cols() > 0 && convStateMsg->mLastChunkInUtt)) {
-            int pickupToCol = (std::min((int)mUpdateStatsHop, (int)mAccumFeats.cols()));
-            Matrix subMatrix = mAccumFeats.block(0, 0, mAccumFeats.rows(), pickupToCol);
+        std::vector<Matrix> normSubMatrices;
+        int normCols = 0;
+        int consumedCols = 0;
+        while((mAccumFeats.cols() - consumedCols) / mUpdateStatsHop > 0 || (mAccumFeats.cols() > consumedCols && convStateMsg->mLastChunkInUtt)) {
+            int pickupToCol = (std::min((int)mUpdateStatsHop, (int)mAccumFeats.cols() - consumedCols));
+            Matrix subMatrix = mAccumFeats.middleCols(consumedCols, pickupToCol);
 
             normalizer->previewData(subMatrix, convStateMsg->mLastChunkInUtt);
-            Matrix normSubMatrix = normalizer->transform(subMatrix, convStateMsg->mLastChunkInUtt);
-
-            normM.conservativeResize(normM.rows(), normM.cols()+normSubMatrix.cols());
-            normM.rightCols(normSubMatrix.cols()) = normSubMatrix;
+            normSubMatrices.push_back(normalizer->transform(subMatrix, convStateMsg->mLastChunkInUtt));
+            const Matrix& normSubMatrix = normSubMatrices.back();
+            normCols += normSubMatrix.cols();
 
             if (subMatrix.cols() % normSubMatrix.cols() != 0) GODEC_ERR << getLPId() << ": The features going into the normalizer are not an integer multiple of the number of features coming out. Impossible to choose the right timestamps";
             for(int timeIdx = 0; timeIdx < normSubMatrix.cols(); timeIdx++) {
-                featureTimestamps.push_back(mFeatureTimestampsBuffer[(timeIdx+1)*(subMatrix.cols()/normSubMatrix.cols())-1]);
+                featureTimestamps.push_back(mFeatureTimestampsBuffer[consumedCols + (timeIdx+1)*(subMatrix.cols()/normSubMatrix.cols())-1]);
             }
-
-            mAccumFeats = (Matrix)mAccumFeats.rightCols(mAccumFeats.cols()-pickupToCol);
+            consumedCols += pickupToCol;
+        }
+        if (consumedCols > 0) {
+            mAccumFeats = (Matrix)mAccumFeats.rightCols(mAccumFeats.cols()-consumedCols);
             mFeatureTimestampsBuffer.erase(mFeatureTimestampsBuffer.begin(),
-                                           mFeatureTimestampsBuffer.begin() + pickupToCol);
+                                           mFeatureTimestampsBuffer.begin() + consumedCols);
         }
 
-        if (normM.cols() > 0) {
+        if (normCols > 0) {
             uint64_t time = featureTimestamps.back();
 
+            // Assemble the output directly in the buffer that the message takes over
+            Matrix normM = AcquireMatrix(normSubMatrices[0].rows(), normCols);
+            int outCol = 0;
+            for (auto subIt = normSubMatrices.begin(); subIt != normSubMatrices.end(); subIt++) {
+                normM.middleCols(outCol, subIt->cols()) = *subIt;
+                outCol += subIt->cols();
+            }
+
             DecoderMessage_ptr outMsg = FeaturesDecoderMessage::create(
                                             time, convStateMsg->mUtteranceId,
-                                            normM, outFeatureNames, featureTimestamps);
+                                            std::move(normM), outFeatureNames, std::move(featureTimestamps));
 
             (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(featMsg->getFullDescriptorString());
 
@@ -258,7 +269,7 @@ void FeatureNormalizerComponent::ProcessMessage(const DecoderMessageBlock& msgBl
                 uint64_t time = featureTimestamps.back();
 
                 DecoderMessage_ptr outMsg = FeaturesDecoderMessage::create(
-                                                time, uttId, normM, outFeatureNames, featureTimestamps);
+                                                time, uttId, std::move(normM), outFeatureNames, std::move(featureTimestamps));
                 (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(featMsg->getFullDescriptorString());
                 pushToOutputs(SlotFeatures, outMsg);
             }
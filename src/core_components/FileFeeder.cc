@@ -13,6 +13,7 @@
 namespace Godec {
 
 const uint16_t WAVE_FORMAT_PCM = 0x0001;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
 const uint16_t WAVE_FORMAT_ALAW = 0x0006;
 const uint16_t WAVE_FORMAT_MULAW = 0x0007;
 const uint16_t WAVE_FORMAT_EXTENDED = 0xFFFE;
@@ -32,175 +33,246 @@ bool isEndOfFile(FILE* fp) {
     return (c == EOF);
 }
 
-bool isEndOfFile(std::ifstream& is) {
-    auto prePos = is.tellg();
-    int c = 0;
-    do {
-        c = is.get();
-    } while ((c == '\n' || c == '\r' || c == ' ') && (c != EOF));
-    is.seekg(prePos);
-    return (c == EOF);
-}
-
-int64_t AudioFileReader::getTotalNumSamples() {
-    return fileSize / (numChannels*bytesPerSample);
-}
-
-void AudioFileReader::readData(std::vector<unsigned char>& audioData, int64_t beginSample, int64_t& endSample, std::vector<int> channels) {
-    int64_t segmentBeginBytes = numChannels*bytesPerSample*beginSample;
-    // int64_t segmentEndBytes = numChannels*bytesPerSample*endSample;
-
-    int64_t numSamples = (endSample - beginSample);
-    int64_t allChannelsTmpAudioSize = numSamples*numChannels*bytesPerSample;
-    unsigned char* allChannelsTmpAudio = new unsigned char[allChannelsTmpAudioSize];
-
-    fseek(fPtr, (int64_t)(headerSize + segmentBeginBytes), SEEK_SET);
-    int64_t actuallyReadBytes = fread(allChannelsTmpAudio, 1, allChannelsTmpAudioSize, fPtr);
-
-    if (actuallyReadBytes != allChannelsTmpAudioSize) {
-        //printf("Sample request beyond end of file! Only read to position %li\n", ftell(fPtr));
-        numSamples = actuallyReadBytes / (numChannels*bytesPerSample);
-        endSample = beginSample+numSamples;
+AudioFileReader::AudioFileReader(const std::string& fileName, const std::string& typeString) {
+    mFileName = fileName;
+    try {
+        mMapping.open(fileName);
+    } catch (const std::exception& e) {
+        GODEC_ERR << "Failed to open audio file " << fileName << ": " << e.what();
     }
-
-    audioData.resize(numSamples*bytesPerSample*channels.size());
-
-    for (int64_t sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) {
-        for(int channelIdx = 0; channelIdx < channels.size(); channelIdx++) {
-            int channel = channels[channelIdx];
-            int64_t readPosition = bytesPerSample*(numChannels*sampleIdx + (channel - 1));
-            int64_t writePos = sampleIdx*bytesPerSample*channels.size()+channelIdx*bytesPerSample;
-            memcpy(&audioData[writePos], allChannelsTmpAudio + readPosition, bytesPerSample);
-        }
+    mData = (const unsigned char*)mMapping.data();
+    audioType = PCM;
+    numChannels = 1;
+    bytesPerSample = 2;
+    samplingFrequency = 0;
+    mUnsigned8Bit = false;
+    if (typeString == "WAV") {
+        parseWaveHeader();
+    } else if (typeString == "NIST_1A") {
+        parseNIST1AHeader();
+    } else if (typeString == "FLAC") {
+        parseFlacHeader();
+    } else {
+        GODEC_ERR << "Unknown type '" << typeString << "'";
     }
-
-    delete[](allChannelsTmpAudio);
-}
-
-void AudioFileReader::close() {
-    fclose(fPtr);
+    if (numChannels < 1 || bytesPerSample < 1) GODEC_ERR << "Audio file " << fileName << " has " << numChannels << " channels with " << bytesPerSample << " bytes per sample";
 }
 
-AudioFileReader *openWaveFile(std::string fileName) {
-    AudioFileReader* outFR = new AudioFileReader();
-    struct stat statBuf;
-    stat(fileName.c_str(), &statBuf);
-    outFR->headerSize = 44;
-
-    FILE *f = fopen(fileName.c_str(), "rb");
-    if (f == NULL) GODEC_ERR << "Failed to open audio file: " << fileName;
-
-    std::vector<char> buffer;
-    buffer.resize(12);
-
+void AudioFileReader::parseWaveHeader() {
     // WAVE format description: http://www-mmsp.ece.mcgill.ca/Documents/AudioFormats/WAVE/WAVE.html
-
-    fread(&buffer[0], 1, 12, f);
-    if (strncmp(&buffer[0], "RIFF", strlen("RIFF")) != 0 || strncmp(&buffer[0]+8, "WAVE", strlen("WAVE") != 0)) {
-        GODEC_ERR << "Not a MS RIFF WAV file: " << fileName;
+    int64_t fileSize = mMapping.size();
+    if (fileSize < 12 || memcmp(mData, "RIFF", 4) != 0 || memcmp(mData + 8, "WAVE", 4) != 0) {
+        GODEC_ERR << "Not a MS RIFF WAV file: " << mFileName;
     }
 
-    do {
-        fread(&buffer[0], 1, 8, f);
-        uint32_t chunkSize = *((uint32_t *)(&buffer[0] + 4));
-        buffer.resize(chunkSize);
-        //printf("Chunk type: %c%c%c%c, size %i\n", buffer[0],buffer[1],buffer[2], buffer[3],chunkSize);
-        if (strncmp(&buffer[0],"fmt ",strlen("fmt ")) == 0) {
-            fread(&buffer[0], 1, chunkSize, f);
-
-            uint16_t audioFormat = *((uint16_t*)(&buffer[0] + 0));
+    int64_t pos = 12;
+    while (true) {
+        if (pos + 8 > fileSize) GODEC_ERR << "No data chunk in audio file " << mFileName;
+        const unsigned char* chunk = mData + pos;
+        uint32_t chunkSize;
+        memcpy(&chunkSize, chunk + 4, sizeof(chunkSize));
+        pos += 8;
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || pos + chunkSize > fileSize) GODEC_ERR << "Truncated fmt chunk in audio file " << mFileName;
+            uint16_t audioFormat, channelCount, bitsPerSample;
+            uint32_t samplingRate;
+            memcpy(&audioFormat, chunk + 8, sizeof(audioFormat));
+            memcpy(&channelCount, chunk + 10, sizeof(channelCount));
+            memcpy(&samplingRate, chunk + 12, sizeof(samplingRate));
+            memcpy(&bitsPerSample, chunk + 22, sizeof(bitsPerSample));
+            // The extensible format has the actual format code at the start of its sub-format GUID
+            if (audioFormat == WAVE_FORMAT_EXTENDED && chunkSize >= 26) memcpy(&audioFormat, chunk + 32, sizeof(audioFormat));
             if (audioFormat == WAVE_FORMAT_PCM || audioFormat == WAVE_FORMAT_EXTENDED)
-                outFR->audioType = PCM;
+                audioType = PCM;
+            else if (audioFormat == WAVE_FORMAT_IEEE_FLOAT)
+                audioType = PCMFloat;
             else if (audioFormat == WAVE_FORMAT_ALAW)
-                outFR->audioType = Alaw;
+                audioType = Alaw;
             else if (audioFormat == WAVE_FORMAT_MULAW)
-                outFR->audioType = MuLaw;
+                audioType = MuLaw;
             else {
-                GODEC_ERR << "Unsupported audio format '" << audioFormat << "', only PCM, Alaw and MuLaw are supported in wav file.";
+                GODEC_ERR << "Unsupported audio format '" << audioFormat << "', only PCM, float, Alaw and MuLaw are supported in wav file.";
             }
-            outFR->numChannels = *((uint16_t*)(&buffer[0] + 2));
-
-            uint32_t samplingRate = *((uint32_t *)(&buffer[0] + 4));
-            outFR->samplingFrequency = samplingRate;
-            short bitsPerSample = *((short *)(&buffer[0] + 14));
-
-            //printf("Format: numchan=%i, sr: %f, bps: %i.\n", outFR->numChannels, outFR->samplingFrequency, bitsPerSample); fflush(stdout);
-            outFR->bytesPerSample = bitsPerSample / 8;
-        } else if (
-            (strncmp(&buffer[0],"fact",strlen("fact")) == 0) ||
-            (strncmp(&buffer[0],"list",strlen("list")) == 0) ||
-            (strncmp(&buffer[0],"LIST",strlen("LIST")) == 0)
-        ) {
-            fread(&buffer[0], 1, chunkSize, f);
-        } else if (strncmp(&buffer[0],"data",strlen("data")) == 0) {
-            outFR->headerSize = ftell(f);
-            outFR->fileSize = statBuf.st_size - outFR->headerSize;
-            outFR->fPtr = f;
-            return outFR;
+            numChannels = channelCount;
+            samplingFrequency = samplingRate;
+            bytesPerSample = bitsPerSample / 8;
+            // 8-bit WAV PCM is unsigned, with silence at 128
+            mUnsigned8Bit = audioType == PCM && bytesPerSample == 1;
+        } else if (memcmp(chunk, "fact", 4) == 0 || memcmp(chunk, "list", 4) == 0 || memcmp(chunk, "LIST", 4) == 0) {
+            // Skipped
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            headerSize = pos;
+            dataSize = fileSize - headerSize;
+            return;
         } else {
-            GODEC_ERR << "Unknown chunk type " << buffer[0] << buffer[1] << buffer[2] << buffer[3] << " in audio file";
+            GODEC_ERR << "Unknown chunk type " << chunk[0] << chunk[1] << chunk[2] << chunk[3] << " in audio file";
         }
-    } while(true);
-    return NULL;
+        // Chunks are padded to an even size
+        pos += chunkSize + (chunkSize & 1);
+    }
 }
 
-
-AudioFileReader *openNIST1AFile(std::string fileName) {
-    AudioFileReader* outFR = new AudioFileReader();
-
-    struct stat statBuf;
-    stat(fileName.c_str(), &statBuf);
-
-    FILE *f = fopen(fileName.c_str(), "rb");
-    if (f == NULL) GODEC_ERR << "Error opening file " << fileName << ": " << strerror(errno) << std::endl;
-
-    outFR->audioType = PCM; // Default
-    outFR->numChannels = 1;
-    char nistFileLine[1000];
-    fgets(nistFileLine, 1000, f);
-    trimLine(nistFileLine);
-    if (strcmp(nistFileLine, "NIST_1A") != 0) {
+void AudioFileReader::parseNIST1AHeader() {
+    int64_t fileSize = mMapping.size();
+    std::string headerStart((const char*)mData, std::min(fileSize, (int64_t)1024));
+    std::istringstream headerStream(headerStart);
+    std::string nistFileLine;
+    std::getline(headerStream, nistFileLine);
+    boost::algorithm::trim_right(nistFileLine);
+    if (nistFileLine != "NIST_1A") {
         GODEC_ERR << "Not a NIST file (" << nistFileLine << ")";
     }
-    long long headerSize;
-    fgets(nistFileLine, 1000, f);
-    trimLine(nistFileLine);
-    sscanf(nistFileLine, "%lld", &headerSize);
+    std::getline(headerStream, nistFileLine);
+    long long nistHeaderSize = 0;
+    sscanf(nistFileLine.c_str(), "%lld", &nistHeaderSize);
+    if (nistHeaderSize <= 0 || nistHeaderSize > fileSize) GODEC_ERR << "Bad header size in NIST file " << mFileName;
+
+    headerStream.str(std::string((const char*)mData, nistHeaderSize));
+    headerStream.clear();
+    std::getline(headerStream, nistFileLine);
+    std::getline(headerStream, nistFileLine);
     do {
-        fgets(nistFileLine, 1000, f);
-        trimLine(nistFileLine);
-        if (strncmp(nistFileLine, "sample_rate", strlen("sample_rate")) == 0) {
+        if (!std::getline(headerStream, nistFileLine)) GODEC_ERR << "No end_head in NIST file " << mFileName;
+        boost::algorithm::trim_right(nistFileLine);
+        if (strncmp(nistFileLine.c_str(), "sample_rate", strlen("sample_rate")) == 0) {
             long long sampleRate;
-            sscanf(nistFileLine, "sample_rate -i %lld", &sampleRate);
-            outFR->samplingFrequency = (float)sampleRate;
+            sscanf(nistFileLine.c_str(), "sample_rate -i %lld", &sampleRate);
+            samplingFrequency = (float)sampleRate;
         }
-        if (strncmp(nistFileLine, "channel_count", strlen("channel_count")) == 0) {
-            sscanf(nistFileLine, "channel_count -i %i", &outFR->numChannels);
-            if (outFR->numChannels != 1 && outFR->numChannels != 2) {
+        if (strncmp(nistFileLine.c_str(), "channel_count", strlen("channel_count")) == 0) {
+            sscanf(nistFileLine.c_str(), "channel_count -i %i", &numChannels);
+            if (numChannels != 1 && numChannels != 2) {
                 GODEC_ERR << "Only mono and stereo supported right now. Implement me!";
             }
         }
-        if (strncmp(nistFileLine, "sample_n_bytes", strlen("sample_n_bytes")) == 0) {
-            sscanf(nistFileLine, "sample_n_bytes -i %i", &outFR->bytesPerSample);
+        if (strncmp(nistFileLine.c_str(), "sample_n_bytes", strlen("sample_n_bytes")) == 0) {
+            sscanf(nistFileLine.c_str(), "sample_n_bytes -i %i", &bytesPerSample);
         }
-        if (strncmp(nistFileLine, "sample_coding", strlen("sample_coding")) == 0) {
+        if (strncmp(nistFileLine.c_str(), "sample_coding", strlen("sample_coding")) == 0) {
             char tmp[1024];
             int dummyInt;
-            sscanf(nistFileLine, "sample_coding -s%d %s", &dummyInt, tmp);
+            sscanf(nistFileLine.c_str(), "sample_coding -s%d %1023s", &dummyInt, tmp);
             if (strncmp(tmp, "mu-law", strlen("mu-law")) == 0 || strncmp(tmp, "ulaw", strlen("ulaw")) == 0) {
-                outFR->audioType = MuLaw;
+                audioType = MuLaw;
             } else if (strncmp(tmp, "alaw", strlen("alaw")) == 0) {
-                outFR->audioType = Alaw;
+                audioType = Alaw;
             }
         }
-    } while (strcmp(nistFileLine, "end_head") != 0);
+    } while (nistFileLine != "end_head");
 
-    outFR->fileSize = statBuf.st_size - headerSize;
-    outFR->fPtr = f;
-    outFR->headerSize = headerSize;
-    fseek(f, outFR->headerSize, SEEK_SET);
+    headerSize = nistHeaderSize;
+    dataSize = fileSize - headerSize;
+}
+
+void AudioFileReader::parseFlacHeader() {
+    mFlacDecoder = boost::shared_ptr<FlacDecoder>(new FlacDecoder(mData, mMapping.size(), mFileName));
+    samplingFrequency = (float)mFlacDecoder->getSampleRate();
+    numChannels = mFlacDecoder->getNumChannels();
+    // Samples get stored in whole bytes, e.g. 12 bit samples come out as 16 bit ones
+    bytesPerSample = (mFlacDecoder->getBitsPerSample() + 7) / 8;
+    headerSize = 0;
+    dataSize = 0;
+}
 
-    return outFR;
+int64_t AudioFileReader::getTotalNumSamples() const {
+    if (mFlacDecoder != nullptr) return mFlacDecoder->getTotalNumSamples();
+    return dataSize / (numChannels*bytesPerSample);
+}
+
+// 24-bit samples, moved around as a whole
+struct Sample24 {
+    unsigned char mBytes[3];
+};
+
+// The channel strides are template parameters for the common layouts (0 means use the runtime value), so that the compiler can turn the strided copy into vector shuffles
+template<typename Sample, int InStride, int OutStride>
+static void CopyChannel(const Sample* in, int inStride, Sample* out, int outStride, int64_t numSamples) {
+    const int inStep = InStride > 0 ? InStride : inStride;
+    const int outStep = OutStride > 0 ? OutStride : outStride;
+    for (int64_t sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) {
+        out[sampleIdx*outStep] = in[sampleIdx*inStep];
+    }
+}
+
+template<typename Sample>
+static void DeinterleaveChannels(const unsigned char* in, int numChannels, const std::vector<int>& channels, unsigned char* out, int64_t numSamples) {
+    int outStride = (int)channels.size();
+    for (int channelIdx = 0; channelIdx < outStride; channelIdx++) {
+        const Sample* inRunner = (const Sample*)in + (channels[channelIdx] - 1);
+        Sample* outRunner = (Sample*)out + channelIdx;
+        if (outStride == 1 && numChannels == 2) CopyChannel<Sample, 2, 1>(inRunner, numChannels, outRunner, outStride, numSamples);
+        else if (outStride == 1 && numChannels == 4) CopyChannel<Sample, 4, 1>(inRunner, numChannels, outRunner, outStride, numSamples);
+        else if (outStride == 2 && numChannels == 4) CopyChannel<Sample, 4, 2>(inRunner, numChannels, outRunner, outStride, numSamples);
+        else CopyChannel<Sample, 0, 0>(inRunner, numChannels, outRunner, outStride, numSamples);
+    }
+}
+
+void AudioFileReader::readData(unsigned char* out, int64_t beginSample, int64_t endSample, const std::vector<int>& channels) const {
+    int64_t numSamples = endSample - beginSample;
+    if (beginSample < 0 || numSamples < 0 || endSample > getTotalNumSamples()) GODEC_ERR << "Samples " << beginSample << "-" << endSample << " are outside of audio file " << mFileName;
+    for (int channelIdx = 0; channelIdx < channels.size(); channelIdx++) {
+        if (channels[channelIdx] < 1 || channels[channelIdx] > numChannels) GODEC_ERR << "Audio file " << mFileName << " has no channel " << channels[channelIdx];
+    }
+    if (mFlacDecoder != nullptr) {
+        mFlacDecoder->read(out, bytesPerSample, beginSample, endSample, channels);
+        return;
+    }
+    const unsigned char* in = mData + headerSize + numChannels*bytesPerSample*beginSample;
+
+    bool allChannelsInOrder = channels.size() == numChannels;
+    for (int channelIdx = 0; channelIdx < channels.size() && allChannelsInOrder; channelIdx++) allChannelsInOrder = channels[channelIdx] == channelIdx + 1;
+    // Sample-wise access needs aligned samples, a header with an odd size can get in the way
+    bool aligned = ((uintptr_t)in % bytesPerSample) == 0 && ((uintptr_t)out % bytesPerSample) == 0;
+    if (allChannelsInOrder) memcpy(out, in, numSamples*numChannels*bytesPerSample);
+    else if (bytesPerSample == 1) DeinterleaveChannels<uint8_t>(in, numChannels, channels, out, numSamples);
+    else if (bytesPerSample == 2 && aligned) DeinterleaveChannels<uint16_t>(in, numChannels, channels, out, numSamples);
+    else if (bytesPerSample == 3) DeinterleaveChannels<Sample24>(in, numChannels, channels, out, numSamples);
+    else if (bytesPerSample == 4 && aligned) DeinterleaveChannels<uint32_t>(in, numChannels, channels, out, numSamples);
+    else {
+        for (int64_t sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) {
+            for(int channelIdx = 0; channelIdx < channels.size(); channelIdx++) {
+                int64_t readPosition = bytesPerSample*(numChannels*sampleIdx + (channels[channelIdx] - 1));
+                int64_t writePos = bytesPerSample*(sampleIdx*channels.size() + channelIdx);
+                memcpy(out + writePos, in + readPosition, bytesPerSample);
+            }
+        }
+    }
+    // Flipping the top bit takes away the offset of 128, downstream 8-bit PCM is signed like all the other widths
+    if (mUnsigned8Bit) {
+        for (int64_t byteIdx = 0; byteIdx < numSamples*(int64_t)channels.size(); byteIdx++) out[byteIdx] ^= 0x80;
+    }
+}
+
+boost::shared_ptr<AudioFileReader> AudioFileCache::get(const std::string& fileName, const std::string& typeString) {
+    struct stat statBuf;
+    if (stat(fileName.c_str(), &statBuf) != 0) GODEC_ERR << "Failed to open audio file " << fileName << ": " << strerror(errno);
+
+    auto entryIt = mEntries.find(fileName);
+    if (entryIt != mEntries.end()) {
+        Entry& entry = entryIt->second;
+        // A file that changed since it was mapped gets mapped again
+        if (entry.mTypeString == typeString && entry.mFileSize == statBuf.st_size && entry.mModTime == statBuf.st_mtime) {
+            mLru.splice(mLru.begin(), mLru, entry.mLruPos);
+            return entry.mReader;
+        }
+        mLru.erase(entry.mLruPos);
+        mEntries.erase(entryIt);
+    }
+
+    Entry entry;
+    entry.mReader = boost::shared_ptr<AudioFileReader>(new AudioFileReader(fileName, typeString));
+    entry.mTypeString = typeString;
+    entry.mFileSize = statBuf.st_size;
+    entry.mModTime = statBuf.st_mtime;
+    mLru.push_front(fileName);
+    entry.mLruPos = mLru.begin();
+    mEntries[fileName] = entry;
+    // Readers still in use by the caller stay mapped until they are released
+    while (mLru.size() > mMaxFiles) {
+        mEntries.erase(mLru.back());
+        mLru.pop_back();
+    }
+    return entry.mReader;
 }
 
 void parseAnalistLine(std::string& analistFileLine, std::string& waveFile, std::vector<int>& channels, std::string& typeString, int64_t& beginSample, int64_t& endSample, double& stretch, std::string& utteranceId, std::string& episodeName) {
@@ -252,7 +324,7 @@ void parseAnalistLine(std::string& analistFileLine, std::string& waveFile, std::
 }
 
 
-AnalistFileFeeder::AnalistFileFeeder(std::string analistFile, std::string _waveFileDir, std::string _waveFileExtension) {
+AnalistFileFeeder::AnalistFileFeeder(std::string analistFile, std::string _waveFileDir, std::string _waveFileExtension, size_t audioFileCacheSize) : mAudioFiles(audioFileCacheSize) {
     mWaveFileDir = _waveFileDir;
     mWaveFileExtension = _waveFileExtension;
     fflush(stdout);
@@ -278,7 +350,7 @@ AnalistFileFeeder::AnalistFileFeeder(std::string analistFile, std::string _waveF
     utteranceCounter = 0;
 }
 
-bool AnalistFileFeeder::getNextUtterance(std::vector<unsigned char>& audioData, int& sampleWidth, std::string& utteranceId, std::string& episodeName, bool& episodeDone, bool& fileDone, std::string& waveFile, std::vector<int>& channels, std::string& formatString, float& audioChunkTimeInSeconds, int64_t& beginSample, float& uttOffsetInFileInSeconds) {
+bool AnalistFileFeeder::getNextUtterance(boost::shared_ptr<AudioFileReader>& reader, int64_t& numSamples, int& sampleWidth, std::string& utteranceId, std::string& episodeName, bool& episodeDone, bool& fileDone, std::string& waveFile, std::vector<int>& channels, std::string& formatString, float& audioChunkTimeInSeconds, int64_t& beginSample, float& uttOffsetInFileInSeconds) {
     utteranceCounter++;
     utteranceId = std::to_string(utteranceCounter);
     episodeDone = false;
@@ -295,33 +367,23 @@ bool AnalistFileFeeder::getNextUtterance(std::vector<unsigned char>& audioData,
         if (utteranceCounter == episodeList.size() || episodeName != episodeList[utteranceCounter]) episodeDone = true;
 
         std::string fullWavePath = mWaveFileDir+"/"+waveFile+"."+mWaveFileExtension;
+        reader = mAudioFiles.get(fullWavePath, typeString);
 
-        AudioFileReader* reader = NULL;
         std::string baseFormat = "";
-        if (typeString == "WAV") {
-            reader = openWaveFile(fullWavePath);
-        } else if (typeString == "NIST_1A") {
-            reader = openNIST1AFile(fullWavePath);
-        } else {
-            GODEC_ERR << "Unknown type '" << typeString << "'";
-        }
-        if (reader == NULL) {
-            GODEC_ERR << "Couldn't open file " << fullWavePath;
-        }
-
         if (reader->audioType == PCM) baseFormat = "PCM";
         else if (reader->audioType == MuLaw) baseFormat = "ulaw";
         else if (reader->audioType == Alaw) baseFormat = "alaw";
+        else if (reader->audioType == PCMFloat) baseFormat = "float";
 
         std::stringstream ss;
         sampleWidth = reader->bytesPerSample*8;
         ss << std::setprecision(50) << "base_format=" << baseFormat << ";sample_width=" << sampleWidth << ";sample_rate=" << reader->samplingFrequency << ";vtl_stretch=" << vtlStretch << ";num_channels=" << channels.size() << ";";
         formatString = ss.str();
-        reader->readData(audioData, beginSample, endSample, channels);
-        audioChunkTimeInSeconds = audioData.size() /((float)channels.size()*reader->samplingFrequency*reader->bytesPerSample);
+        // Segments reaching past the end of the file get cut short
+        endSample = std::min(endSample, reader->getTotalNumSamples());
+        numSamples = std::max(endSample - beginSample, (int64_t)0);
+        audioChunkTimeInSeconds = numSamples/reader->samplingFrequency;
         uttOffsetInFileInSeconds = beginSample/(float)reader->samplingFrequency;
-        reader->close();
-        delete reader;
 
         fileDone = isEndOfFile(mListFileFp);
     } else return false;
@@ -329,57 +391,139 @@ bool AnalistFileFeeder::getNextUtterance(std::vector<unsigned char>& audioData,
     return true;
 }
 
-TextFileFeeder::TextFileFeeder(const std::string& text_file) {
+MappedLineReader::MappedLineReader(const std::string& fileName) {
+    mData = nullptr;
+    mSize = 0;
+    mPos = 0;
+    if (!boost::filesystem::exists(fileName)) GODEC_ERR << "Fail to open file '" << fileName << "' for reading." << std::endl;
+    // Empty files can't be mapped
+    if (boost::filesystem::file_size(fileName) > 0) {
+        try {
+            mMapping.open(fileName);
+        } catch (const std::exception& e) {
+            GODEC_ERR << "Fail to open file '" << fileName << "' for reading. " << e.what() << std::endl;
+        }
+        mData = mMapping.data();
+        mSize = mMapping.size();
+    }
+    mContentEnd = mSize;
+    while (mContentEnd > 0 && (mData[mContentEnd - 1] == '\n' || mData[mContentEnd - 1] == '\r' || mData[mContentEnd - 1] == ' ')) mContentEnd--;
+}
+
+bool MappedLineReader::getLine(const char*& begin, const char*& end) {
+    if (mPos >= mSize) return false;
+    begin = mData + mPos;
+    const char* newline = (const char*)memchr(begin, '\n', mSize - mPos);
+    end = newline != nullptr ? newline : mData + mSize;
+    mPos = newline != nullptr ? newline + 1 - mData : mSize;
+    if (end > begin && *(end - 1) == '\r') end--;
+    return true;
+}
+
+TextFileFeeder::TextFileFeeder(const std::string& text_file) : text_reader(text_file) {
     lineCounter = 0;
-    text_reader.open(text_file, std::ifstream::in | std::ifstream::binary);
 }
 
 TextFileFeeder::~TextFileFeeder() {
 }
 
 bool TextFileFeeder::getNextUtterance(std::string& utteranceId, std::string& text, bool &fileDone) {
-    if (isEndOfFile(text_reader)) {
+    const char* lineBegin;
+    const char* lineEnd;
+    if (text_reader.atEnd() || !text_reader.getLine(lineBegin, lineEnd)) {
         return false;
     } else {
-        std::getline(text_reader, text);
+        text.assign(lineBegin, lineEnd);
         lineCounter++;
         utteranceId = (boost::format("text_line_%1%") % lineCounter).str();
-        fileDone = isEndOfFile(text_reader);
+        fileDone = text_reader.atEnd();
         return true;
     }
 }
 
-JsonFileFeeder::JsonFileFeeder(const std::string& jsonFile) {
-    itemCounter = 0;
-    std::ifstream is(jsonFile);
-    if (!is) {
-        GODEC_ERR << "Fail to open file '" << jsonFile << "' for reading." << std::endl;
+static const char* SkipJsonWhitespace(const char* pos, const char* end) {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) pos++;
+    return pos;
+}
 
+JsonFileFeeder::JsonFileFeeder(const std::string& jsonFile, bool jsonLines) : mFileName(jsonFile), mReader(jsonFile) {
+    itemCounter = 0;
+    mJsonLines = jsonLines;
+    mArrayDone = false;
+    if (!mJsonLines) {
+        const char* pos = SkipJsonWhitespace(mReader.position(), mReader.dataEnd());
+        if (pos == mReader.dataEnd() || *pos != '[') {
+            GODEC_ERR << "Toplevel JSON data must be an array." << std::endl;
+        }
+        mReader.skipTo(pos + 1);
     }
-    try {
-        is >> jsonData;
-    } catch(json::parse_error& e) {
-        GODEC_ERR << "Fail to load JSON data from '" << jsonFile << "'. " << e.what() << std::endl;
-    }
+}
 
-    if (!jsonData.is_array()) {
-        GODEC_ERR << "Toplevel JSON data must be an array." << std::endl;
+const char* JsonFileFeeder::findElementEnd(const char* begin) const {
+    // Only brackets outside of strings count, that is all it takes to find where the element ends
+    int depth = 0;
+    bool inString = false;
+    const char* end = mReader.dataEnd();
+    for (const char* pos = begin; pos < end; pos++) {
+        char c = *pos;
+        if (inString) {
+            if (c == '\\') pos++;
+            else if (c == '"') inString = false;
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) return pos;
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            return pos;
+        }
     }
+    return end;
 }
 
 bool JsonFileFeeder::getNextMessage(json &jsonMessage, json &jsonConvState) {
-    if (itemCounter < jsonData.size()) {
-        json jsonObj = jsonData[itemCounter++];
-
-        if (!jsonObj.is_object() || jsonObj.find("json_message") == jsonObj.end() || jsonObj.find("conversation_state") == jsonObj.end()) {
-            GODEC_ERR << "JsonFileFeeder: the " << itemCounter << "-th entry is not a JSON object with 'json_message' and 'conversation_state' fields." << std::endl;
-        }
-        jsonMessage = jsonObj["json_message"];
-        jsonConvState = jsonObj["conversation_state"];
-        return true;
+    const char* itemBegin;
+    const char* itemEnd;
+    if (mJsonLines) {
+        // Blank lines are skipped
+        do {
+            if (!mReader.getLine(itemBegin, itemEnd)) return false;
+        } while (SkipJsonWhitespace(itemBegin, itemEnd) == itemEnd);
     } else {
-        return false;
+        if (mArrayDone) return false;
+        const char* end = mReader.dataEnd();
+        const char* pos = SkipJsonWhitespace(mReader.position(), end);
+        if (pos == end) GODEC_ERR << "Fail to load JSON data from '" << mFileName << "'. The array is not terminated" << std::endl;
+        if (*pos == ']') {
+            mArrayDone = true;
+            if (SkipJsonWhitespace(pos + 1, end) != end) GODEC_ERR << "Fail to load JSON data from '" << mFileName << "'. Unexpected content after the array" << std::endl;
+            return false;
+        }
+        if (itemCounter > 0) {
+            if (*pos != ',') GODEC_ERR << "Fail to load JSON data from '" << mFileName << "'. Expected ',' after entry " << itemCounter << std::endl;
+            pos++;
+        }
+        itemBegin = pos;
+        itemEnd = findElementEnd(itemBegin);
+        mReader.skipTo(itemEnd);
+    }
+
+    json jsonObj;
+    try {
+        jsonObj = json::parse(itemBegin, itemEnd);
+    } catch(json::parse_error& e) {
+        GODEC_ERR << "Fail to load JSON data from '" << mFileName << "'. " << e.what() << std::endl;
+    }
+    itemCounter++;
+
+    if (!jsonObj.is_object() || jsonObj.find("json_message") == jsonObj.end() || jsonObj.find("conversation_state") == jsonObj.end()) {
+        GODEC_ERR << "JsonFileFeeder: the " << itemCounter << "-th entry is not a JSON object with 'json_message' and 'conversation_state' fields." << std::endl;
     }
+    jsonMessage = std::move(jsonObj["json_message"]);
+    jsonConvState = std::move(jsonObj["conversation_state"]);
+    return true;
 }
 
 JsonFileFeeder::~JsonFileFeeder() {
@@ -391,9 +535,10 @@ NumpyFileFeeder::NumpyFileFeeder(std::string npzKeysListFile) {
     mKeysListFile.open(npzKeysListFile);
     if (!mKeysListFile) GODEC_ERR << "Failed to open " << npzKeysListFile;
     mKeyListFileLineCount = 0;
+    mCurrentData = nullptr;
 }
 
-bool NumpyFileFeeder::getNextUtterance(float*& features, int64_t& numFrames, int& frameLength, std::string& utteranceId, std::string& episodeName, bool& episodeDone, bool& fileDone) {
+bool NumpyFileFeeder::getNextUtterance(int64_t& numFrames, int& frameLength, std::string& utteranceId, std::string& episodeName, bool& episodeDone, bool& fileDone) {
     std::string listLine;
     mKeysListFile >> listLine;
     mKeyListFileLineCount++;
@@ -404,15 +549,27 @@ bool NumpyFileFeeder::getNextUtterance(float*& features, int64_t& numFrames, int
     if (listLineEls.size() != 2) GODEC_ERR << "npz list file parsing error, line " << mKeyListFileLineCount << ". Format for each line is <npz file name>:<hash key insize npz for features>";
     std::string npzFile = listLineEls[0];
     std::string npzKey = listLineEls[1];
-    cnpy::NpyArray data = cnpy::npz_load(npzFile, npzKey);
+    try {
+        if (npzFile != mCurrentNpzFile) {
+            mCurrentNpz = boost::shared_ptr<cnpy::npz_index>(new cnpy::npz_index(npzFile));
+            mCurrentNpzFile = npzFile;
+        }
+        mCurrentInflated = cnpy::NpyArray();
+        mCurrentData = mCurrentNpz->view(npzKey, mCurrentInfo);
+        // Compressed (np.savez_compressed), or not aligned for reading the values in place
+        if (mCurrentData == nullptr || (mCurrentInfo.word_size != 0 && (uintptr_t)mCurrentData % mCurrentInfo.word_size != 0)) {
+            mCurrentInflated = mCurrentNpz->load(npzKey, mCurrentInfo);
+            mCurrentData = mCurrentInflated.num_bytes() != 0 ? mCurrentInflated.data<char>() : nullptr;
+        }
+    } catch (const std::runtime_error& e) {
+        GODEC_ERR << "Could not read key '" << npzKey << "' from " << npzFile << ": " << e.what();
+    }
 
-    if (data.shape.size() != 2) GODEC_ERR << "npz entry '" << npzKey << "' in file " << npzFile << " is not two-dimensional! Don't know how to feed";
-    numFrames = data.shape[1];
-    frameLength = data.shape[0];
-    Eigen::MatrixXd doubleMatrix = Eigen::Map<Eigen::MatrixXd>(data.data<double>(), numFrames, frameLength);
-    mCurrentFeatures = doubleMatrix.cast<float>().transpose();
+    if (mCurrentInfo.shape.size() != 2) GODEC_ERR << "npz entry '" << npzKey << "' in file " << npzFile << " is not two-dimensional! Don't know how to feed";
+    if (mCurrentInfo.type != 'f' || (mCurrentInfo.word_size != 4 && mCurrentInfo.word_size != 8)) GODEC_ERR << "npz entry '" << npzKey << "' in file " << npzFile << " has numpy type '" << mCurrentInfo.type << mCurrentInfo.word_size << "', only float32 and float64 are supported";
+    numFrames = mCurrentInfo.shape[1];
+    frameLength = mCurrentInfo.shape[0];
 
-    features = mCurrentFeatures.data();
     utteranceId = npzKey;
     episodeName = "dummy";
     episodeDone = mKeyListFileLineCount == mKeysListNumLines;
@@ -420,6 +577,27 @@ bool NumpyFileFeeder::getNextUtterance(float*& features, int64_t& numFrames, int
     return true;
 }
 
+// The arrays are feature dimension x frames. In Fortran order that is the layout of the features already, in C order (numpy's default) the block gets transposed on the way
+template<typename T>
+static void CopyNpyFrames(const char* data, int64_t rows, int64_t cols, bool fortranOrder, int64_t beginFrame, int64_t numFrames, Matrix& out) {
+    const T* values = (const T*)data;
+    if (fortranOrder) {
+        out = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>>(values + beginFrame*rows, rows, numFrames).template cast<float>();
+    } else {
+        out = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(values, rows, cols).middleCols(beginFrame, numFrames).template cast<float>();
+    }
+}
+
+void NumpyFileFeeder::readFrames(int64_t beginFrame, int64_t numFrames, Matrix& out) const {
+    int64_t rows = mCurrentInfo.shape[0];
+    int64_t cols = mCurrentInfo.shape[1];
+    if (mCurrentInfo.word_size == 4) {
+        CopyNpyFrames<float>(mCurrentData, rows, cols, mCurrentInfo.fortran_order, beginFrame, numFrames, out);
+    } else {
+        CopyNpyFrames<double>(mCurrentData, rows, cols, mCurrentInfo.fortran_order, beginFrame, numFrames, out);
+    }
+}
+
 LoopProcessor* FileFeederComponent::make(std::string id, ComponentGraphConfig* configPt) {
     return new FileFeederComponent(id, configPt);
 }
@@ -430,13 +608,19 @@ std::string FileFeederComponent::describeThyself() {
 /* FileFeederComponent::ExtendedDescription
 This is the component for providing your Godec graph with data for processing. The different feeding formats in details:
 
-"analist": A text file describing line-by-line segments in audio file (support formats: WAV and NIST_1A, i.e. SPHERE). The general format is "\<wave file base name without extension\> -c \<channel number, 1-based\> -t \<audio format\> -f \<sample start\>-\<sample end\> -o \<utterance ID\> -spkr \<speaker ID\>" . "wave_dir" parameter specifies the direction of where to find the wave files, "wave_extension" the file extension. The "feed_realtime_factor" specifies how much faster than realtime it should feed the audio (higher value = faster)
+"analist": A text file describing line-by-line segments in audio file (support formats: WAV, NIST_1A, i.e. SPHERE, and FLAC). The general format is "\<wave file base name without extension\> -c \<channel number, 1-based\> -t \<audio format\> -f \<sample start\>-\<sample end\> -o \<utterance ID\> -spkr \<speaker ID\>" . "wave_dir" parameter specifies the direction of where to find the wave files, "wave_extension" the file extension. The "feed_realtime_factor" specifies how much faster than realtime it should feed the audio (higher value = faster). The audio files are memory-mapped, and the most recently used ones stay mapped (32 of them, or as many as the optional "audio_file_cache_size" says), so analists with many segments from the same long recordings don't re-open them for every line. FLAC files ("-t FLAC") get decoded as the chunks are fed, straight into the outgoing messages, without any temporary WAV files. To get to a segment's start, decoding starts at the closest frame before it that is known from the file's seek table (or from an earlier segment), so files encoded with a seek table (the flac tool's default) can be read in any segment order. WAV files can be integer PCM, float, A-law or mu-law, also with the extensible header. 8-bit PCM WAV samples are unsigned, as the format requires, and get fed as signed 8-bit PCM like the other widths
+
+"text": A simple line-by-line file with text in it. The component will feed one line at a time, as a BinaryDecoderMessage with timestamps according to how many words were in the line. Lines can end in LF or CRLF. The file is memory-mapped and read as the lines get fed
+
+"json": A single file containing a JSON array of items. Each item is an object with the "json_message" to push as a JsonDecoderMessage, and the "conversation_state" ("time", "utterance_id", "conversation_id", "end_of_utterance", "end_of_conversation") to go with it. The items get parsed one at a time as they are fed, so even huge files start feeding right away and are never held in memory as a whole
 
-"text": A simple line-by-line file with text in it. The component will feed one line at a time, as a BinaryDecoderMessage with timestamps according to how many words were in the line
+"jsonl": Like "json", but with one item per line instead of an array
 
-"json": A single file containing a JSON array of items. Each item will be pushed as a JsonDecoderMessage
+"numpy_npz": A Python Numpy npz file. The parameter "keys_list_file" specifies a file which contains a line-by-line list of npz+key combo, e.g. "my_feats.npz:a", which would extract key "a" from my_feats.npz. "feature_chunk_size" sets the size of the feature chunks to be pushed. The arrays have to be float32 or float64, of shape (feature dimension, frames). The npz file is memory-mapped and indexed once, and arrays saved uncompressed (np.savez) are converted straight out of the mapping, so lists with many keys from the same npz stay fast. Consecutive lines for the same npz file reuse it
 
-"numpy_npz": A Python Numpy npz file. The parameter "keys_list_file" specifies a file which contains a line-by-line list of npz+key combo, e.g. "my_feats.npz:a", which would extract key "a" from my_feats.npz. "feature_chunk_size" sets the size of the feature chunks to be pushed
+Except for "json" and "jsonl", whose times come from the file, the optional "time_offset" starts the time stamps as if that much had already been fed: bytes of audio (samples times channels times bytes per sample, before the "time_upsample_factor") for analists, frames for numpy_npz and words for text. With an analist, the audio then carries a "stream_start_time" descriptor, so AudioPreProcessor times the first utterance from there and not from 0. "godec batch" uses it to give each conversation the times it has in a single run
+
+For all source types, the optional "read_ahead_chunks" moves the reading and decoding onto a separate thread that stays up to that many chunks ahead of the feeding, so that file opening and disk (or network storage) latency overlap with the downstream processing instead of stalling it. The default of 0 does everything on the feeding thread.
 
 The "control_type" parameter describes whether the FileFeeder will just work off one single configuration on startup, i.e. batch processing ("single_on_startup"), or whether it should receive these configurations via an external slot ("external") that pushes the exact same component JSON configuration from the outside via the Java API. The latter is essentially for "dynamic batch processing" where the FileFeeder gets pointed to new data dynamically.
 
@@ -444,12 +628,19 @@ The "control_type" parameter describes whether the FileFeeder will just work off
 
 boost::shared_ptr<FileFeederHolder> FileFeederComponent::GetFileFeederFromConfig( ComponentGraphConfig* configPt) {
     auto ffh = boost::shared_ptr<FileFeederHolder>(new FileFeederHolder());
-    std::string sourceType = configPt->get<std::string>("source_type", "File type of source file (analist, text, numpy_npz, json)");
+    std::string sourceType = configPt->get<std::string>("source_type", "File type of source file (analist, text, numpy_npz, json, jsonl)");
     std::string inputFile;
     if (sourceType != "numpy_npz") {
         inputFile = configPt->get<std::string>("input_file", "Input file");
     }
     ffh->inputFile = inputFile;
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<int>("read_ahead_chunks")) {
+        ffh->mReadAheadChunks = configPt->get<int>("read_ahead_chunks", "Number of chunks to read and decode ahead on a separate thread (0 = read on the feeding thread)");
+    }
+    if (sourceType != "json" && sourceType != "jsonl" && configPt->get_optional_READ_DECLARATION_BEFORE_USE<int64_t>("time_offset")) {
+        ffh->mTimeOffset = configPt->get<int64_t>("time_offset", "Start the time stamps as if this much had already been fed");
+        if (ffh->mTimeOffset < 0) GODEC_ERR << "time_offset can not be negative";
+    }
 
     if (sourceType == "analist") {
         ffh->mFeedRealtimeFactor = configPt->get<float>("feed_realtime_factor", "Controls how fast the audio is pushed. A value of 1.0 simulates soundcard reading of audio (i.e. pushing a 1-second chunk takes 1 second), a higher value pushes faster. Use 100000 for batch pushing");
@@ -465,19 +656,26 @@ boost::shared_ptr<FileFeederHolder> FileFeederComponent::GetFileFeederFromConfig
             GODEC_ERR << "Couldn't find wave_dir '" << waveFileDirPath << "'";
         }
         std::string waveFileExtension = configPt->get<std::string>("wave_extension", "Wave file extension");
-        ffh->analistFileFeeder = new AnalistFileFeeder((char*)inputFile.c_str(), (char*)waveFileDir.c_str(), (char*)waveFileExtension.c_str());
+        int audioFileCacheSize = AnalistFileFeeder::DefaultAudioFileCacheSize;
+        if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<int>("audio_file_cache_size")) {
+            audioFileCacheSize = configPt->get<int>("audio_file_cache_size", "How many of the most recently used audio files stay memory-mapped");
+        }
+        if (audioFileCacheSize < 1) GODEC_ERR << "audio_file_cache_size needs to be at least 1";
+        ffh->analistFileFeeder = new AnalistFileFeeder((char*)inputFile.c_str(), (char*)waveFileDir.c_str(), (char*)waveFileExtension.c_str(), audioFileCacheSize);
         ffh->chunkSizeInSamples = configPt->get<int>("audio_chunk_size", "Audio size in samples for each chunk");
         ffh->mTimeUpsampleFactor = configPt->get<int>("time_upsample_factor", "Factor by which the internal time stamps are increased. This is to prevent multiple subunits having the same time stamp.");
     } else if (sourceType == "text") {
         ffh->textFileFeeder = new TextFileFeeder(inputFile);
     } else if (sourceType == "json") {
-        ffh->jsonFileFeeder = new JsonFileFeeder(inputFile);
+        ffh->jsonFileFeeder = new JsonFileFeeder(inputFile, false);
+    } else if (sourceType == "jsonl") {
+        ffh->jsonFileFeeder = new JsonFileFeeder(inputFile, true);
     } else if (sourceType == "numpy_npz") {
         std::string npzKeysList = configPt->get<std::string>("keys_list_file", "File containing a list (line by line) of keys that are contained in the npz file and are then fed in that order");
         ffh->numpyFileFeeder = new NumpyFileFeeder(npzKeysList);
         ffh->chunkSizeInFrames = configPt->get<int>("feature_chunk_size", "Size in frames of each pushed chunk");
     } else {
-        GODEC_ERR << "Unknown source type '" << sourceType << "'. Valid options are: analist, text, numpy_mpz, and json." << std::endl;
+        GODEC_ERR << "Unknown source type '" << sourceType << "'. Valid options are: analist, text, numpy_npz, json, and jsonl." << std::endl;
     }
     return ffh;
 }
@@ -485,6 +683,7 @@ boost::shared_ptr<FileFeederHolder> FileFeederComponent::GetFileFeederFromConfig
 FileFeederComponent::FileFeederComponent(std::string id, ComponentGraphConfig* configPt) :
     LoopProcessor(id, configPt) {
 
+    mTotalTime = -1;
     mFFHChannel.checkIn(getLPId(false));
 
     mControlType = configPt->get<std::string>("control_type", "Where this FileFeeder gets its source data from: single-shot feeding on startup ('single_on_startup'), or as JSON input from an input stream ('external')");
@@ -507,8 +706,7 @@ FileFeederComponent::~FileFeederComponent() {
 }
 
 void FileFeederComponent::Start() {
-    mFeedThread = boost::thread(&FileFeederComponent::FeedLoop, this);
-    RegisterThreadForLogging(mFeedThread, mLogPtr, isVerbose());
+    mFeedThread = startPlacedThread(boost::bind(&FileFeederComponent::FeedLoop, this), "feeder");
     if (mControlType == "single_on_startup") {
         mFFHChannel.checkOut(getLPId(false));
     } else if (mControlType == "external") {
@@ -529,112 +727,155 @@ std::string FileFeederComponent::SlotOutput = "output_stream";
 
 void FileFeederComponent::FeedLoop() {
     ChannelReturnResult res;
-    int64_t totalTime = -1;
     while (true) {
         boost::shared_ptr<FileFeederHolder> ffh;
         res = mFFHChannel.get(ffh, FLT_MAX);
         if (res == ChannelClosed) break;
 
-        std::vector<unsigned char> audioData;
-        int sampleWidth;
-        float* features = NULL;
-        int64_t nFrames = 0;
-        int frameLength = 0;
-        std::string utteranceId;
-        std::string episodeName;
-        std::string waveFile;
-        std::vector<int> channels;
-        std::string ctm_channel;
-        bool episodeDone = false;
-        bool fileDone = false;
-        int64_t beginSamples = 0;
-        std::string text;
-        std::string formatString;
-        float audioChunkTimeInSeconds;
-        float uttOffsetInFileInSeconds;
-        std::vector<std::string> wordStrings;
-        std::vector<std::string> caseStrings;
-        std::vector<std::string> puncStrings;
-        std::vector<float> word_begin_times;
-        std::vector<float> word_dur_times;
-        json jsonMessage;
-        json jsonConvState;
-
-        while (
-            ((ffh->analistFileFeeder != NULL) && (ffh->analistFileFeeder->getNextUtterance(audioData, sampleWidth, utteranceId, episodeName, episodeDone, fileDone, waveFile, channels, formatString, audioChunkTimeInSeconds, beginSamples, uttOffsetInFileInSeconds))) ||
-            ((ffh->numpyFileFeeder != NULL) && (ffh->numpyFileFeeder->getNextUtterance(features, nFrames, frameLength, utteranceId, episodeName, episodeDone, fileDone))) ||
-            ((ffh->textFileFeeder != NULL) && (ffh->textFileFeeder->getNextUtterance(utteranceId, text, fileDone))) ||
-            ((ffh->jsonFileFeeder != NULL) && (ffh->jsonFileFeeder->getNextMessage(jsonMessage, jsonConvState)))
-        ) {
-            if (features != NULL) {
-                int64_t chunk_size = ffh->chunkSizeInFrames == 0 ? nFrames : ffh->chunkSizeInFrames;
-                float * feature_runner = features;
-                uint64_t remaining_frames = nFrames;
-                while (remaining_frames > 0) {
-                    uint64_t chunk_frames = remaining_frames >= chunk_size ? chunk_size : remaining_frames;
-                    remaining_frames -= chunk_frames;
-                    Matrix featsMatrix = Eigen::Map<Matrix>(feature_runner, frameLength, chunk_frames);
-                    std::vector<uint64_t> featureTimestamps;
-                    for (uint64_t i = 0; i < chunk_frames; ++i) {
-                        featureTimestamps.push_back(++totalTime);
-                    }
-                    bool utt_done = remaining_frames == 0;
-                    feature_runner += frameLength*chunk_frames;
-                    boost::format pfname("RAW[0:%1%]%%f");
-                    pfname % (frameLength - 1);
-                    pushToOutputs(SlotConversationState, ConversationStateDecoderMessage::create(totalTime, utteranceId, utt_done, episodeName, episodeDone&&utt_done));
-                    pushToOutputs(SlotOutput, FeaturesDecoderMessage::create(totalTime, utteranceId, featsMatrix, pfname.str(), featureTimestamps));
-                }
-            } else if (audioData.size() != 0) {
-                int64_t audioRunner = 0;
-                auto feedStartTime = std::chrono::system_clock::now();
-                while (audioRunner < audioData.size()) {
-                    int64_t actualIncrement = std::min((int64_t)(audioData.size() - audioRunner), (int64_t)channels.size()*ffh->chunkSizeInSamples*(sampleWidth/8));
-                    float secondsToAdd = audioChunkTimeInSeconds*((audioRunner+actualIncrement)/(float)audioData.size())/ffh->mFeedRealtimeFactor;
-
-                    auto timeToWaitUntil = feedStartTime+std::chrono::milliseconds((int)(1000*secondsToAdd));
-                    auto currTime = std::chrono::system_clock::now();
-                    std::chrono::duration<double> diff = timeToWaitUntil - currTime;
-                    if (diff.count() > 0) {
-                        std::this_thread::sleep_for(std::chrono::duration_cast<std::chrono::milliseconds>(diff));
-                    }
-
-                    bool isLastInUtt = (audioRunner + actualIncrement) == audioData.size();
-                    totalTime += actualIncrement;
-                    DecoderMessage_ptr convoMsg = ConversationStateDecoderMessage::create(ffh->mTimeUpsampleFactor*(totalTime+1)-1, utteranceId, isLastInUtt, episodeName, isLastInUtt && episodeDone);
-                    pushToOutputs(SlotConversationState, convoMsg);
-
-                    std::vector<unsigned char> pushData(audioData.begin() + audioRunner, audioData.begin() + audioRunner + actualIncrement);
-                    auto outMsg = BinaryDecoderMessage::create(ffh->mTimeUpsampleFactor*(totalTime + 1) - 1, pushData, formatString);
-                    (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("file_feeder_input_file", boost::lexical_cast<std::string>(ffh->inputFile));
-                    (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("wave_file_name", waveFile);
-                    std::string channelString = boost::algorithm::join( channels | boost::adaptors::transformed( static_cast<std::string(*)(int)>(std::to_string) ), ",");
-                    (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("channel", channelString);
-                    (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("speaker", episodeName);
-                    (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("utterance_offset_in_file", boost::lexical_cast<std::string>(uttOffsetInFileInSeconds));
-
-                    pushToOutputs(SlotOutput, outMsg);
-                    audioRunner += actualIncrement;
-                }
-            } else if (ffh->textFileFeeder != NULL) {
-                std::vector<std::string> wordVec;
-                boost::split(wordVec, text, boost::is_any_of(" "));
-                totalTime += wordVec.size();
-                pushToOutputs(SlotConversationState, ConversationStateDecoderMessage::create(totalTime, utteranceId, true, episodeName, episodeDone));
-                pushToOutputs(SlotOutput, BinaryDecoderMessage::create(totalTime, String2CharVec(text), "string"));
-            } else if (ffh->jsonFileFeeder != NULL) {
-                totalTime = jsonConvState["time"].get<int64_t>();
-                utteranceId = jsonConvState["utterance_id"].get<std::string>();
-                episodeName = jsonConvState["conversation_id"].get<std::string>();
-                bool endOfUtt = jsonConvState["end_of_utterance"].get<bool>();
-                episodeDone = jsonConvState["end_of_conversation"].get<bool>();
-                pushToOutputs(SlotConversationState, ConversationStateDecoderMessage::create(totalTime, utteranceId, endOfUtt, episodeName, episodeDone));
-                pushToOutputs(SlotOutput, JsonDecoderMessage::create(totalTime, jsonMessage));
+        std::chrono::system_clock::time_point feedStartTime;
+        if (ffh->mReadAheadChunks <= 0) {
+            ReadLoop(ffh, [&](const FeedItem& item) { PushFeedItem(item, feedStartTime); });
+        } else {
+            // Reading and decoding happens on its own thread, up to "read_ahead_chunks" chunks ahead of the feeding
+            channel<FeedItem> readAheadChannel;
+            readAheadChannel.setIdVerbose(getLPId(false) + " read-ahead", isVerbose());
+            readAheadChannel.setMaxItems(ffh->mReadAheadChunks);
+            readAheadChannel.checkIn(getLPId(false));
+            boost::thread readThread = startPlacedThread([&]() {
+                ReadLoop(ffh, [&](const FeedItem& item) { readAheadChannel.put(item); });
+                readAheadChannel.checkOut(getLPId(false));
+            }, "reader");
+            FeedItem item;
+            while (readAheadChannel.get(item, FLT_MAX) == ChannelNewItem) PushFeedItem(item, feedStartTime);
+            readThread.join();
+        }
+    }
+    Shutdown();
+}
+
+void FileFeederComponent::PushFeedItem(const FeedItem& item, std::chrono::system_clock::time_point& feedStartTime) {
+    if (item.mStartsUtterance) feedStartTime = std::chrono::system_clock::now();
+    if (item.mSecondsIntoUtterance > 0) {
+        auto timeToWaitUntil = feedStartTime+std::chrono::milliseconds((int)(1000*item.mSecondsIntoUtterance));
+        auto currTime = std::chrono::system_clock::now();
+        std::chrono::duration<double> diff = timeToWaitUntil - currTime;
+        if (diff.count() > 0) {
+            std::this_thread::sleep_for(std::chrono::duration_cast<std::chrono::milliseconds>(diff));
+        }
+    }
+    pushToOutputs(SlotConversationState, item.mConvState);
+    pushToOutputs(SlotOutput, item.mOutput);
+}
+
+void FileFeederComponent::ReadLoop(boost::shared_ptr<FileFeederHolder> ffh, boost::function<void(const FeedItem&)> emit) {
+    boost::shared_ptr<AudioFileReader> audioReader;
+    int64_t numSamples = 0;
+    int sampleWidth;
+    int64_t nFrames = 0;
+    int frameLength = 0;
+    std::string utteranceId;
+    std::string episodeName;
+    std::string waveFile;
+    std::vector<int> channels;
+    std::string ctm_channel;
+    bool episodeDone = false;
+    bool fileDone = false;
+    int64_t beginSamples = 0;
+    std::string text;
+    std::string formatString;
+    float audioChunkTimeInSeconds;
+    float uttOffsetInFileInSeconds;
+    std::vector<std::string> wordStrings;
+    std::vector<std::string> caseStrings;
+    std::vector<std::string> puncStrings;
+    std::vector<float> word_begin_times;
+    std::vector<float> word_dur_times;
+    json jsonMessage;
+    json jsonConvState;
+
+    if (ffh->mTimeOffset >= 0) {
+        if (ffh->mTimeOffset - 1 < mTotalTime) GODEC_ERR << getLPId() << "time_offset " << ffh->mTimeOffset << " is behind the " << (mTotalTime + 1) << " that have already been fed";
+        mTotalTime = ffh->mTimeOffset - 1;
+    }
 
+    while (
+        ((ffh->analistFileFeeder != NULL) && (ffh->analistFileFeeder->getNextUtterance(audioReader, numSamples, sampleWidth, utteranceId, episodeName, episodeDone, fileDone, waveFile, channels, formatString, audioChunkTimeInSeconds, beginSamples, uttOffsetInFileInSeconds))) ||
+        ((ffh->numpyFileFeeder != NULL) && (ffh->numpyFileFeeder->getNextUtterance(nFrames, frameLength, utteranceId, episodeName, episodeDone, fileDone))) ||
+        ((ffh->textFileFeeder != NULL) && (ffh->textFileFeeder->getNextUtterance(utteranceId, text, fileDone))) ||
+        ((ffh->jsonFileFeeder != NULL) && (ffh->jsonFileFeeder->getNextMessage(jsonMessage, jsonConvState)))
+    ) {
+        FeedItem item;
+        item.mStartsUtterance = false;
+        item.mSecondsIntoUtterance = 0;
+        if (ffh->numpyFileFeeder != NULL) {
+            // Chunks get converted straight out of the mapped npz into the message
+            int64_t chunk_size = ffh->chunkSizeInFrames == 0 ? nFrames : ffh->chunkSizeInFrames;
+            int64_t frame_runner = 0;
+            uint64_t remaining_frames = nFrames;
+            while (remaining_frames > 0) {
+                uint64_t chunk_frames = remaining_frames >= chunk_size ? chunk_size : remaining_frames;
+                remaining_frames -= chunk_frames;
+                Matrix featsMatrix = AcquireMatrix(frameLength, chunk_frames);
+                ffh->numpyFileFeeder->readFrames(frame_runner, chunk_frames, featsMatrix);
+                std::vector<uint64_t> featureTimestamps;
+                for (uint64_t i = 0; i < chunk_frames; ++i) {
+                    featureTimestamps.push_back(++mTotalTime);
+                }
+                bool utt_done = remaining_frames == 0;
+                frame_runner += chunk_frames;
+                boost::format pfname("RAW[0:%1%]%%f");
+                pfname % (frameLength - 1);
+                item.mConvState = ConversationStateDecoderMessage::create(mTotalTime, utteranceId, utt_done, episodeName, episodeDone&&utt_done);
+                item.mOutput = FeaturesDecoderMessage::create(mTotalTime, utteranceId, std::move(featsMatrix), pfname.str(), featureTimestamps);
+                emit(item);
             }
+        } else if (numSamples != 0) {
+            // Chunks get de-interleaved straight out of the mapped file into the message
+            int64_t bytesPerOutputSample = channels.size()*audioReader->bytesPerSample;
+            int64_t sampleRunner = 0;
+            item.mStartsUtterance = true;
+            while (sampleRunner < numSamples) {
+                int64_t actualIncrement = std::min(numSamples - sampleRunner, (int64_t)ffh->chunkSizeInSamples);
+                item.mSecondsIntoUtterance = audioChunkTimeInSeconds*((sampleRunner+actualIncrement)/(float)numSamples)/ffh->mFeedRealtimeFactor;
+
+                bool isLastInUtt = (sampleRunner + actualIncrement) == numSamples;
+                mTotalTime += actualIncrement*bytesPerOutputSample;
+                item.mConvState = ConversationStateDecoderMessage::create(ffh->mTimeUpsampleFactor*(mTotalTime+1)-1, utteranceId, isLastInUtt, episodeName, isLastInUtt && episodeDone);
+
+                std::vector<unsigned char> pushData(actualIncrement*bytesPerOutputSample);
+                audioReader->readData(pushData.data(), beginSamples + sampleRunner, beginSamples + sampleRunner + actualIncrement, channels);
+                auto outMsg = BinaryDecoderMessage::create(ffh->mTimeUpsampleFactor*(mTotalTime + 1) - 1, std::move(pushData), formatString);
+                (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("file_feeder_input_file", boost::lexical_cast<std::string>(ffh->inputFile));
+                (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("wave_file_name", waveFile);
+                std::string channelString = boost::algorithm::join( channels | boost::adaptors::transformed( static_cast<std::string(*)(int)>(std::to_string) ), ",");
+                (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("channel", channelString);
+                (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("speaker", episodeName);
+                (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("utterance_offset_in_file", boost::lexical_cast<std::string>(uttOffsetInFileInSeconds));
+                if (ffh->mTimeOffset >= 0) (boost::const_pointer_cast<DecoderMessage>(outMsg))->addDescriptor("stream_start_time", std::to_string(ffh->mTimeUpsampleFactor*ffh->mTimeOffset - 1));
+                item.mOutput = outMsg;
+
+                emit(item);
+                item.mStartsUtterance = false;
+                sampleRunner += actualIncrement;
+            }
+        } else if (ffh->textFileFeeder != NULL) {
+            std::vector<std::string> wordVec;
+            boost::split(wordVec, text, boost::is_any_of(" "));
+            mTotalTime += wordVec.size();
+            item.mConvState = ConversationStateDecoderMessage::create(mTotalTime, utteranceId, true, episodeName, episodeDone);
+            item.mOutput = BinaryDecoderMessage::create(mTotalTime, String2CharVec(text), "string");
+            emit(item);
+        } else if (ffh->jsonFileFeeder != NULL) {
+            mTotalTime = jsonConvState["time"].get<int64_t>();
+            utteranceId = jsonConvState["utterance_id"].get<std::string>();
+            episodeName = jsonConvState["conversation_id"].get<std::string>();
+            bool endOfUtt = jsonConvState["end_of_utterance"].get<bool>();
+            episodeDone = jsonConvState["end_of_conversation"].get<bool>();
+            item.mConvState = ConversationStateDecoderMessage::create(mTotalTime, utteranceId, endOfUtt, episodeName, episodeDone);
+            item.mOutput = JsonDecoderMessage::create(mTotalTime, jsonMessage);
+            emit(item);
         }
     }
-    Shutdown();
 }
 
 }
@@ -4,10 +4,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <fstream>
+#include <list>
+#include <chrono>
+#include <boost/function.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include "godec/ChannelMessenger.h"
 #include "GodecMessages.h"
 #include "godec/json.hpp"
 #include "cnpy.h"
+#include "FlacDecoder.h"
 
 namespace Godec {
 
@@ -15,26 +20,62 @@ enum AudioType {
     PCM,
     MuLaw,
     Alaw,
+    PCMFloat,
 };
 
+// An audio file (WAV, NIST_1A or FLAC) that is memory-mapped as a whole, with its header parsed once. FLAC gets decoded as it is read
 class AudioFileReader {
   public:
-    void readData(std::vector<unsigned char> &audioData, int64_t beginSample, int64_t &endSample, std::vector<int> channels);
-    void close();
-    int64_t getTotalNumSamples();
-    FILE* fPtr;
-    int64_t fileSize;
+    AudioFileReader(const std::string& fileName, const std::string& typeString);
+    // De-interleaves the given (1-based) channels of samples [beginSample, endSample) into "out", which needs room for (endSample-beginSample)*channels.size()*bytesPerSample bytes
+    void readData(unsigned char* out, int64_t beginSample, int64_t endSample, const std::vector<int>& channels) const;
+    int64_t getTotalNumSamples() const;
     float samplingFrequency;
     int numChannels;
     int bytesPerSample;
     AudioType audioType;
+  private:
+    void parseWaveHeader();
+    void parseNIST1AHeader();
+    void parseFlacHeader();
+    std::string mFileName;
+    boost::iostreams::mapped_file_source mMapping;
+    const unsigned char* mData;
     int64_t headerSize;
+    int64_t dataSize;
+    bool mUnsigned8Bit;
+    // Only for FLAC, keeps its own (locked) decoding state, so reading stays const
+    boost::shared_ptr<FlacDecoder> mFlacDecoder;
 };
 
+// Keeps the most recently used audio files mapped. Analists tend to have many segments from the same few files, which then only get opened and parsed once
+class AudioFileCache {
+  public:
+    AudioFileCache(size_t maxFiles) : mMaxFiles(maxFiles) {}
+    boost::shared_ptr<AudioFileReader> get(const std::string& fileName, const std::string& typeString);
+  private:
+    struct Entry {
+        boost::shared_ptr<AudioFileReader> mReader;
+        std::string mTypeString;
+        int64_t mFileSize;
+        time_t mModTime;
+        std::list<std::string>::iterator mLruPos;
+    };
+    std::unordered_map<std::string, Entry> mEntries;
+    std::list<std::string> mLru; // Most recently used first
+    size_t mMaxFiles;
+};
+
+// Splits an analist line into its fields. The episode name defaults to "<wave file>-<channels>" when there is no -spkr
+void parseAnalistLine(std::string& analistFileLine, std::string& waveFile, std::vector<int>& channels, std::string& typeString, int64_t& beginSample, int64_t& endSample, double& stretch, std::string& utteranceId, std::string& episodeName);
+
 class AnalistFileFeeder {
   public:
-    AnalistFileFeeder(std::string analistFile, std::string waveFileDir, std::string waveFileExtension);
-    bool getNextUtterance(std::vector<unsigned char> &audioData,
+    // How many audio files are kept mapped, unless "audio_file_cache_size" says otherwise
+    static const int DefaultAudioFileCacheSize = 32;
+    AnalistFileFeeder(std::string analistFile, std::string waveFileDir, std::string waveFileExtension, size_t audioFileCacheSize);
+    bool getNextUtterance(boost::shared_ptr<AudioFileReader> &reader,
+                          int64_t &numSamples,
                           int &sampleWidth,
                           std::string &utteranceId,
                           std::string &episodeName,
@@ -52,6 +93,26 @@ class AnalistFileFeeder {
     std::string mWaveFileExtension;
     long utteranceCounter;
     std::vector<std::string> episodeList;
+    AudioFileCache mAudioFiles;
+};
+
+// Memory-maps a text file and hands out its lines, so that feeding starts right away no matter how big the file is
+class MappedLineReader {
+  public:
+    MappedLineReader(const std::string& fileName);
+    // The next line, without its '\n' (or "\r\n")
+    bool getLine(const char*& begin, const char*& end);
+    // Only newlines and spaces left
+    bool atEnd() const { return mPos >= mContentEnd; }
+    const char* position() const { return mData + mPos; }
+    const char* dataEnd() const { return mData + mSize; }
+    void skipTo(const char* pos) { mPos = pos - mData; }
+  private:
+    boost::iostreams::mapped_file_source mMapping;
+    const char* mData;
+    size_t mSize;
+    size_t mPos;
+    size_t mContentEnd;
 };
 
 class TextFileFeeder {
@@ -60,34 +121,47 @@ class TextFileFeeder {
     ~TextFileFeeder();
     bool getNextUtterance(std::string &utteranceId, std::string &text, bool &fileDone);
   private:
-    std::ifstream text_reader;
+    MappedLineReader text_reader;
     int32_t lineCounter;
 };
 
 class NumpyFileFeeder {
   public:
     NumpyFileFeeder(std::string npzKeysListFile);
-    bool getNextUtterance(float*&features,
-                          int64_t &numFrames,
+    bool getNextUtterance(int64_t &numFrames,
                           int &frameLenth,
                           std::string &utteranceId,
                           std::string &episodeName,
                           bool &episodeDone,
                           bool &fileDone);
+    // Copies frames of the current utterance into out, which has to be sized already
+    void readFrames(int64_t beginFrame, int64_t numFrames, Matrix& out) const;
   private:
     std::ifstream mKeysListFile;
     int64_t mKeyListFileLineCount;
     int64_t mKeysListNumLines;
-    Matrix mCurrentFeatures;
+    // Key lists usually go through one npz after the other, so only the last one stays open
+    std::string mCurrentNpzFile;
+    boost::shared_ptr<cnpy::npz_index> mCurrentNpz;
+    cnpy::NpyInfo mCurrentInfo;
+    const char* mCurrentData;
+    cnpy::NpyArray mCurrentInflated; // Holds the current array when it can't be read out of the mapping
 };
 
+// Reads either a JSON array of items, or JSONL (one item per line). The items get parsed one at a time as they are fed, the array is never held in memory as a whole
 class JsonFileFeeder {
   public:
-    JsonFileFeeder(const std::string &jsonFile);
+    JsonFileFeeder(const std::string &jsonFile, bool jsonLines);
     ~JsonFileFeeder();
     bool getNextMessage(json &jsonMessage, json &jsonConvState);
   private:
-    json jsonData;
+    // Finds the end of the array element starting at "begin"
+    const char* findElementEnd(const char* begin) const;
+
+    std::string mFileName;
+    MappedLineReader mReader;
+    bool mJsonLines;
+    bool mArrayDone;
     size_t itemCounter;
 };
 
@@ -99,6 +173,8 @@ class FileFeederHolder {
         textFileFeeder = nullptr;
         jsonFileFeeder = nullptr;
         mTimeUpsampleFactor = 1;
+        mReadAheadChunks = 0;
+        mTimeOffset = -1;
     }
     ~FileFeederHolder() {
         delete numpyFileFeeder;
@@ -116,9 +192,19 @@ class FileFeederHolder {
     int chunkSizeInFrames;
     float mFeedRealtimeFactor;
     int mTimeUpsampleFactor;
+    int mReadAheadChunks;
+    int64_t mTimeOffset; // -1 when not set
     std::string inputFile;
 };
 
+// A conversation state and output message pair, ready to be pushed
+struct FeedItem {
+    DecoderMessage_ptr mConvState;
+    DecoderMessage_ptr mOutput;
+    bool mStartsUtterance; // Pacing is relative to the first chunk of an utterance
+    float mSecondsIntoUtterance; // When to push it, already scaled by the realtime factor. 0 for no pacing
+};
+
 class FileFeederComponent : public LoopProcessor {
   public:
     static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
@@ -137,7 +223,10 @@ class FileFeederComponent : public LoopProcessor {
     channel<boost::shared_ptr<FileFeederHolder> > mFFHChannel;
 
     boost::thread mFeedThread;
+    int64_t mTotalTime;
     void FeedLoop();
+    void ReadLoop(boost::shared_ptr<FileFeederHolder> ffh, boost::function<void(const FeedItem&)> emit);
+    void PushFeedItem(const FeedItem& item, std::chrono::system_clock::time_point& feedStartTime);
 };
 
 }
@@ -1,6 +1,5 @@
 #include "FileWriter.h"
 #include <iomanip>
-#include "cnpy.h"
 
 namespace Godec {
 
@@ -17,17 +16,96 @@ std::string FileWriterComponent::describeThyself() {
 /* FileWriterComponent::ExtendedDescription
 The writing equivalent to the FileFeeder component, for saving output. Available "input_type":
 
-"audio": For writing AudioDecoderMessage messages. "output_file_prefix" specifies the path prefix that each utterance gets written to. The incoming audio are float values expected to be normalied to -1.0/1.0 range
+"audio": For writing AudioDecoderMessage messages. "output_file_prefix" specifies the path prefix that each utterance gets written to. The incoming audio are float values expected to be normalied to -1.0/1.0 range, values outside of it are saturated when written as integers. "sample_depth" can be 8, 16, 24 or 32 bits; with the optional "sample_format" set to "float" (only with 32 bits), the samples are written as float32 without any scaling. By default the files are headerless PCM ("<prefix><utterance ID>.raw"); with the optional "file_format" set to "wav" they are mono WAV files ("<prefix><utterance ID>.wav"), whose header gets completed when the utterance has ended. 8-bit WAV samples are unsigned, as the format requires. BinaryDecoderMessage input is written as is, and only into raw files. The files are written through a large buffer, so the audio of an utterance only shows up in its entirety once the utterance has ended
 
 "raw_text": BinaryDecoderMessage expected that gets converted into text and written into "output_file"
 
-"json": Expects JsonDecoderMessage as input, concatenates the JSONs into the "output_file"
+"json": Expects JsonDecoderMessage as input, concatenates the JSONs into the "output_file". "json_output_format" "raw_json" pretty-prints each JSON, "jsonl" writes each as a single line; "ctm" and "fst_search" convert recognition results into CTM lines, "mt" writes the "translatedText" field
 
-"features": FeatureDecoderMessage as input, output file is a Numpy NPZ file, with the utterance IDs as keys
+"features": FeatureDecoderMessage as input, output file is a Numpy NPZ file, with the utterance IDs as keys. Each utterance is a float32 array of shape (feature dimension, frames). The archive is kept open while writing and is only a complete NPZ file once the FileWriter has shut down (or, in "external" mode, switched to the next file). By default an utterance is written once its last chunk has arrived; with the optional "stream_features" set to "true", every chunk is written as it arrives, so long utterances are not held in memory
+
+All files except the NPZ ones are written through a buffer on a separate thread (see OutputSink.h), so a slow disk does not hold up the graph. Optional parameters control when buffered output gets written: "sink_buffer_kb" (buffer size, default 1024), "sink_flush_ms" (longest time output stays buffered, default no limit), "sink_flush_on_utterance_end" (default false), and "sink_max_pending_kb" (how much output can wait for the disk before the component blocks, default 16384). With "verbose" on, the bytes written and the time spent blocked on I/O get reported at shutdown
 
 Like the FileFeeder, the "control_type" specifies whether this is a one-shot run that goes straight off the JSON parameters ("single_on_startup"), or whether it receives these JSON parameters through an external channel ("external"). When in the external mode, it also requires the ConversationState stream from the FileFeeder that produced the content
 */
 
+static void WriteLE(std::vector<char>& buf, uint32_t val, int numBytes) {
+    for (int i = 0; i < numBytes; i++) buf.push_back((char)((val >> (8 * i)) & 0xff));
+}
+
+void FileWriterHolder::OpenAudioFile(std::string fileName, float sampleRate) {
+    mSink->open(fileName);
+    mAudioFileOpen = true;
+    mAudioDataBytes = 0;
+    if (mAudioWav) {
+        // The sizes get filled in by CloseAudioFile()
+        uint32_t rate = (uint32_t)(sampleRate + 0.5f);
+        uint32_t bytesPerSample = mAudioSampleDepth / 8;
+        std::vector<char> header;
+        header.insert(header.end(), {'R', 'I', 'F', 'F'});
+        WriteLE(header, 0, 4);
+        header.insert(header.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+        WriteLE(header, 16, 4);
+        WriteLE(header, mAudioFloat ? 3 : 1, 2); // WAVE_FORMAT_IEEE_FLOAT or WAVE_FORMAT_PCM
+        WriteLE(header, 1, 2);
+        WriteLE(header, rate, 4);
+        WriteLE(header, rate * bytesPerSample, 4);
+        WriteLE(header, bytesPerSample, 2);
+        WriteLE(header, mAudioSampleDepth, 2);
+        header.insert(header.end(), {'d', 'a', 't', 'a'});
+        WriteLE(header, 0, 4);
+        mSink->write(header.data(), header.size());
+    }
+}
+
+void FileWriterHolder::WriteAudio(const Vector& audio) {
+    int64_t numSamples = audio.size();
+    size_t numBytes = numSamples * (mAudioSampleDepth / 8);
+    if (mAudioConvertBuffer.size() < numBytes) mAudioConvertBuffer.resize(numBytes);
+    char* out = mAudioConvertBuffer.data();
+    // Whole-vector conversions, so that Eigen can vectorize clamping, scaling and casting
+    if (mAudioFloat) {
+        Eigen::Map<Vector>((float*)out, numSamples) = audio;
+    } else if (mAudioSampleDepth == 8) {
+        if (mAudioWav) {
+            Eigen::Map<Eigen::Matrix<uint8_t, Eigen::Dynamic, 1>>((uint8_t*)out, numSamples) = ((audio.cwiseMin(1.0f).cwiseMax(-1.0f) * (float)INT8_MAX).cast<int16_t>().array() + 128).cast<uint8_t>();
+        } else {
+            Eigen::Map<Eigen::Matrix<int8_t, Eigen::Dynamic, 1>>((int8_t*)out, numSamples) = (audio.cwiseMin(1.0f).cwiseMax(-1.0f) * (float)INT8_MAX).cast<int8_t>();
+        }
+    } else if (mAudioSampleDepth == 16) {
+        Eigen::Map<Eigen::Matrix<int16_t, Eigen::Dynamic, 1>>((int16_t*)out, numSamples) = (audio.cwiseMin(1.0f).cwiseMax(-1.0f) * (float)INT16_MAX).cast<int16_t>();
+    } else if (mAudioSampleDepth == 24) {
+        const float maxVal = 8388607.0f;
+        Eigen::Matrix<int32_t, Eigen::Dynamic, 1> vals = (audio.cwiseMin(1.0f).cwiseMax(-1.0f) * maxVal).cast<int32_t>();
+        for (int64_t i = 0; i < numSamples; i++) {
+            out[3 * i] = (char)(vals(i) & 0xff);
+            out[3 * i + 1] = (char)((vals(i) >> 8) & 0xff);
+            out[3 * i + 2] = (char)((vals(i) >> 16) & 0xff);
+        }
+    } else if (mAudioSampleDepth == 32) {
+        // float does not have the precision for INT32_MAX
+        Eigen::Map<Eigen::Matrix<int32_t, Eigen::Dynamic, 1>>((int32_t*)out, numSamples) = (audio.cast<double>().cwiseMin(1.0).cwiseMax(-1.0) * (double)INT32_MAX).cast<int32_t>();
+    }
+    mSink->write(out, numBytes);
+    mAudioDataBytes += numBytes;
+}
+
+void FileWriterHolder::CloseAudioFile() {
+    if (mAudioWav) {
+        // Chunks have to have an even size
+        if (mAudioDataBytes % 2 == 1) mSink->write("", 1);
+        uint64_t riffBytes = 36 + mAudioDataBytes + mAudioDataBytes % 2;
+        std::vector<char> size;
+        WriteLE(size, (uint32_t)std::min(riffBytes, (uint64_t)UINT32_MAX), 4);
+        mSink->patch(4, size.data(), 4);
+        size.clear();
+        WriteLE(size, (uint32_t)std::min(mAudioDataBytes, (uint64_t)UINT32_MAX), 4);
+        mSink->patch(40, size.data(), 4);
+    }
+    mSink->closeFile();
+    mAudioFileOpen = false;
+}
+
 FileWriterInputType String2FWType(std::string ts) {
     if (ts == "audio") return Audio;
     else if (ts == "raw_text") return RawText;
@@ -40,28 +118,48 @@ FileWriterInputType String2FWType(std::string ts) {
 
 boost::shared_ptr<FileWriterHolder> FileWriterComponent::GetFileWriterFromConfig( ComponentGraphConfig* configPt) {
     auto fwh = boost::shared_ptr<FileWriterHolder>(new FileWriterHolder());
+    fwh->mSink = mSink;
 
     fwh->mInputType = String2FWType(configPt->get<std::string>("input_type", "Input stream type (audio, raw_text, features, json)"));
     if (fwh->mInputType == Audio) {
         fwh->mAudioPrefix = configPt->get<std::string>("output_file_prefix", "Output audio file path prefix");
-        int depth = configPt->get<int>("sample_depth", "wave file sample depth (8,16,32)");
-        if (depth != 8 && depth != 16 && depth != 32) GODEC_ERR << getLPId() << "Unsuported audio sample depth " << depth;
+        int depth = configPt->get<int>("sample_depth", "wave file sample depth (8,16,24,32)");
+        if (depth != 8 && depth != 16 && depth != 24 && depth != 32) GODEC_ERR << getLPId() << "Unsuported audio sample depth " << depth;
         fwh->mAudioSampleDepth = depth;
-        fwh->audioFp = NULL;
+        fwh->mAudioFloat = false;
+        if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<std::string>("sample_format")) {
+            std::string sampleFormat = configPt->get<std::string>("sample_format", "Sample format, 'int' or 'float' (float requires a sample_depth of 32)");
+            if (sampleFormat != "int" && sampleFormat != "float") GODEC_ERR << getLPId() << "Unknown sample format " << sampleFormat;
+            fwh->mAudioFloat = sampleFormat == "float";
+            if (fwh->mAudioFloat && depth != 32) GODEC_ERR << getLPId() << "Float samples require a sample_depth of 32";
+        }
+        fwh->mAudioWav = false;
+        if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<std::string>("file_format")) {
+            std::string fileFormat = configPt->get<std::string>("file_format", "Audio file format, headerless 'raw' or 'wav'");
+            if (fileFormat != "raw" && fileFormat != "wav") GODEC_ERR << getLPId() << "Unknown audio file format " << fileFormat;
+            fwh->mAudioWav = fileFormat == "wav";
+        }
     } else if (fwh->mInputType == RawText) {
         std::string output_file = configPt->get<std::string>("output_file", "Output text file path");
-        fwh->raw_text_writer.open(output_file);
+        fwh->mSink->open(output_file);
+        fwh->mTextFileOpen = true;
     } else if (fwh->mInputType == Json) {
         std::string output_file = configPt->get<std::string>("output_file", "Json output file path");
-        fwh->mJsonOutputFormat = configPt->get<std::string>("json_output_format", "Output format for json (raw_json, ctm, fst_search, mt)");
+        fwh->mJsonOutputFormat = configPt->get<std::string>("json_output_format", "Output format for json (raw_json, jsonl, ctm, fst_search, mt)");
 
-        if (fwh->mJsonOutputFormat != "raw_json" && fwh->mJsonOutputFormat != "ctm" && fwh->mJsonOutputFormat != "fst_search" && fwh->mJsonOutputFormat != "mt") {
+        if (fwh->mJsonOutputFormat != "raw_json" && fwh->mJsonOutputFormat != "jsonl" && fwh->mJsonOutputFormat != "ctm" && fwh->mJsonOutputFormat != "fst_search" && fwh->mJsonOutputFormat != "mt") {
             GODEC_ERR << ": Invalid json_output_format '" << fwh->mJsonOutputFormat << "'. Use 'raw_json' if you just want to dump json string." << std::endl;
         }
-        fwh->json_output_writer.open(output_file);
+        fwh->mSink->open(output_file);
+        fwh->mTextFileOpen = true;
     } else if (fwh->mInputType == Features) {
         fwh->mFeaturesNpz = configPt->get<std::string>("npz_file", "Output Numpy npz file name");
         boost::filesystem::remove(fwh->mFeaturesNpz);
+        fwh->mStreamFeatures = false;
+        if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<bool>("stream_features")) {
+            fwh->mStreamFeatures = configPt->get<bool>("stream_features", "Write each features chunk to the npz file as it arrives, instead of collecting the utterance first");
+        }
+        fwh->mFeaturesDim = -1;
     }
     return fwh;
 }
@@ -74,6 +172,8 @@ FileWriterComponent::FileWriterComponent(std::string id, ComponentGraphConfig *c
     mPrevConvoEndTimeInTicksStreamBased = -1;
     mPrevConvoEndTimeInSecondsStreamBased = 0.0;
 
+    mSink = boost::shared_ptr<OutputSink>(new OutputSink(OutputSinkOptions::FromConfig(configPt), this, getLPId(false)));
+
     mControlType = configPt->get<std::string>("control_type", "Where this FileWriter gets its output configuration from: single-shot on startup ('single_on_startup'), or as JSON input from an input stream ('external')");
     if (mControlType == "single_on_startup") {
         mCurrentFWH = GetFileWriterFromConfig(configPt);
@@ -89,6 +189,17 @@ FileWriterComponent::FileWriterComponent(std::string id, ComponentGraphConfig *c
 }
 
 void FileWriterComponent::Shutdown() {
+    if (mCurrentFWH != nullptr && mCurrentFWH->mFeaturesWriter != nullptr) {
+        try {
+            mCurrentFWH->mFeaturesWriter->close();
+        } catch (const std::exception& e) {
+            GODEC_ERR << getLPId() << e.what();
+        }
+    }
+    // Closes the files that are still open, then waits for the writer thread to write everything out
+    mCurrentFWH.reset();
+    mSink->close();
+    GODEC_INFO << getLPId() << ": Output sink " << mSink->describeStats() << std::endl;
     LoopProcessor::Shutdown();
 }
 
@@ -103,14 +214,18 @@ void FileWriterComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
         if (cleanJson.str() != mCurrentFWHJson) {
             json pt = json::parse(cleanJson);
             ComponentGraphConfig config("bla", pt, nullptr, nullptr);
+            // The old files have to be closed before the new ones get opened on the same sink
+            mCurrentFWH.reset();
             mCurrentFWH = GetFileWriterFromConfig(&config);
             mCurrentFWHJson = jsonMsg->getJsonObj().dump();
         }
     }
 
     if (mCurrentFWH->mInputType == Audio) {
-        if (mCurrentFWH->audioFp == NULL) {
-            std::string completeFilename = mCurrentFWH->mAudioPrefix + convStateMsg->mUtteranceId + ".raw";
+        bool isAudioMsg = baseInputMsg->getUUID() == UUID_AudioDecoderMessage;
+        if (!isAudioMsg && baseInputMsg->getUUID() != UUID_BinaryDecoderMessage) GODEC_ERR << "Unexpected message type ";
+        if (!mCurrentFWH->mAudioFileOpen) {
+            std::string completeFilename = mCurrentFWH->mAudioPrefix + convStateMsg->mUtteranceId + (mCurrentFWH->mAudioWav ? ".wav" : ".raw");
             for (int idx = 0; idx < completeFilename.length(); idx++) {
                 char c = completeFilename[idx];
                 if (!(
@@ -126,61 +241,77 @@ void FileWriterComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
                     completeFilename[idx] = '_';
                 }
             }
-            mCurrentFWH->audioFp = fopen(completeFilename.c_str(), "wb");
-            if (mCurrentFWH->audioFp == NULL) GODEC_ERR << "Couldn't open audio file '" << completeFilename << "' for writing";
+            if (mCurrentFWH->mAudioWav && !isAudioMsg) GODEC_ERR << getLPId() << "WAV output requires AudioDecoderMessage input";
+            mCurrentFWH->OpenAudioFile(completeFilename, isAudioMsg ? msgBlock.get<AudioDecoderMessage>(SlotInput)->mSampleRate : 0.0f);
         }
-        if (baseInputMsg->getUUID() == UUID_AudioDecoderMessage) {
+        if (isAudioMsg) {
             auto audioMsg = msgBlock.get<AudioDecoderMessage>(SlotInput);
-            const Vector audioData = audioMsg->mAudio.cwiseMin(1.0).cwiseMax(-1.0);
-            for (int i = 0; i < audioData.size(); i++) {
-                if (mCurrentFWH->mAudioSampleDepth == 8) {
-                    int8_t val = (char)(INT8_MAX*audioData(i));
-                    fwrite(&val, sizeof(int8_t), 1, mCurrentFWH->audioFp);
-                } else if (mCurrentFWH->mAudioSampleDepth == 16) {
-                    int16_t val = (int16_t)(INT16_MAX*audioData(i));
-                    fwrite(&val, sizeof(int16_t), 1, mCurrentFWH->audioFp);
-                } else if (mCurrentFWH->mAudioSampleDepth == 32) {
-                    int32_t val = (int32_t)(INT32_MAX*audioData(i));
-                    fwrite(&val, sizeof(int32_t), 1, mCurrentFWH->audioFp);
-                }
-            }
-        } else if (baseInputMsg->getUUID() == UUID_BinaryDecoderMessage) {
+            mCurrentFWH->WriteAudio(audioMsg->mAudio);
+        } else {
+            if (mCurrentFWH->mAudioWav) GODEC_ERR << getLPId() << "WAV output requires AudioDecoderMessage input";
             auto binaryMsg =msgBlock.get<BinaryDecoderMessage>(SlotInput);
             const std::vector<unsigned char> &data = binaryMsg->mData;
-            fwrite(&data[0], sizeof(unsigned char), data.size(), mCurrentFWH->audioFp);
-        } else
-            GODEC_ERR << "Unexpected message type ";
-        fflush(mCurrentFWH->audioFp);
+            mSink->write((const char*)data.data(), data.size());
+        }
         if (convStateMsg->mLastChunkInUtt) {
-            fclose(mCurrentFWH->audioFp);
-            mCurrentFWH->audioFp = NULL;
+            mCurrentFWH->CloseAudioFile();
+            mSink->endOfUtterance();
         }
     } else if (mCurrentFWH->mInputType == RawText) {
         auto binaryMsg = msgBlock.get<BinaryDecoderMessage>(SlotInput);
-        mCurrentFWH->raw_text_writer << CharVec2String(binaryMsg->mData) << std::endl;
-        mCurrentFWH->raw_text_writer.flush();
+        mSink->write((const char*)binaryMsg->mData.data(), binaryMsg->mData.size());
+        mSink->write("\n", 1);
+        if (convStateMsg->mLastChunkInUtt) mSink->endOfUtterance();
     } else if (mCurrentFWH->mInputType == Json) {
         auto jsonMsg = msgBlock.get<JsonDecoderMessage>(SlotInput);
-        WriteJsonOutput(jsonMsg, convStateMsg, msgBlock, mCurrentFWH->mJsonOutputFormat, mCurrentFWH->json_output_writer);
+        WriteJsonOutput(jsonMsg, convStateMsg, msgBlock, mCurrentFWH->mJsonOutputFormat, *mSink);
+        if (convStateMsg->mLastChunkInUtt) mSink->endOfUtterance();
     } else if (mCurrentFWH->mInputType == Features) {
         auto featsMsg = msgBlock.get<FeaturesDecoderMessage>(SlotInput);
-        if (mCurrentFWH->mFeaturesAccum.cols() == 0) {
-            mCurrentFWH->mFeaturesAccum = featsMsg->mFeatures;
+        WriteFeatures(featsMsg, convStateMsg->mLastChunkInUtt);
+    }
+}
+
+void FileWriterComponent::WriteFeatures(boost::shared_ptr<const FeaturesDecoderMessage> featsMsg, bool lastChunkInUtt) {
+    auto fwh = mCurrentFWH;
+    const Matrix& feats = featsMsg->mFeatures;
+    bool firstChunk = fwh->mFeaturesDim == -1;
+    if (firstChunk) fwh->mFeaturesDim = feats.rows();
+    if (feats.rows() != fwh->mFeaturesDim && feats.cols() != 0) GODEC_ERR << getLPId() << "Features dimension changed from " << fwh->mFeaturesDim << " to " << feats.rows() << " within utterance " << featsMsg->mUtteranceId;
+    try {
+        if (fwh->mFeaturesWriter == nullptr) fwh->mFeaturesWriter = boost::shared_ptr<cnpy::npz_writer>(new cnpy::npz_writer(fwh->mFeaturesNpz));
+        // Matrix is column-major, so the frames go out as they are, as a Fortran-order (dim, frames) array
+        if (fwh->mStreamFeatures) {
+            if (firstChunk) fwh->mFeaturesWriter->begin<float>(featsMsg->mUtteranceId, {(size_t)fwh->mFeaturesDim}, true);
+            fwh->mFeaturesWriter->write(feats.data(), feats.size());
+            if (lastChunkInUtt) fwh->mFeaturesWriter->end();
         } else {
-            mCurrentFWH->mFeaturesAccum.conservativeResize(mCurrentFWH->mFeaturesAccum.rows(), mCurrentFWH->mFeaturesAccum.cols()+featsMsg->mFeatures.cols());
-            mCurrentFWH->mFeaturesAccum.rightCols(featsMsg->mFeatures.cols()) = featsMsg->mFeatures;
-        }
-        if (convStateMsg->mLastChunkInUtt) {
-            std::vector<size_t> shape{(size_t)mCurrentFWH->mFeaturesAccum.rows(), (size_t)mCurrentFWH->mFeaturesAccum.cols()};
-            Matrix featsT = mCurrentFWH->mFeaturesAccum.transpose();
-            cnpy::npz_save(mCurrentFWH->mFeaturesNpz, featsMsg->mUtteranceId, featsT.data(), shape, "a");
-            mCurrentFWH->mFeaturesAccum = Matrix(0,0);
+            fwh->mFeaturesChunks.push_back(featsMsg);
+            if (lastChunkInUtt) {
+                fwh->mFeaturesWriter->begin<float>(featsMsg->mUtteranceId, {(size_t)fwh->mFeaturesDim}, true);
+                for (auto it = fwh->mFeaturesChunks.begin(); it != fwh->mFeaturesChunks.end(); it++) {
+                    fwh->mFeaturesWriter->write((*it)->mFeatures.data(), (*it)->mFeatures.size());
+                }
+                fwh->mFeaturesWriter->end();
+            }
         }
+    } catch (const std::exception& e) {
+        GODEC_ERR << getLPId() << e.what();
+    }
+    if (lastChunkInUtt) {
+        fwh->mFeaturesChunks.clear();
+        fwh->mFeaturesDim = -1;
     }
 }
-void FileWriterComponent::WriteJsonOutput(boost::shared_ptr<const JsonDecoderMessage> jsonMsg, boost::shared_ptr<const ConversationStateDecoderMessage> convMsg, const DecoderMessageBlock& msgBlock, std::string jsonOutputFormat, std::ofstream& json_output_writer) {
+
+void FileWriterComponent::WriteJsonOutput(boost::shared_ptr<const JsonDecoderMessage> jsonMsg, boost::shared_ptr<const ConversationStateDecoderMessage> convMsg, const DecoderMessageBlock& msgBlock, std::string jsonOutputFormat, OutputSink& sink) {
+    const json& j = jsonMsg->getJsonObj();
     if (jsonOutputFormat == "raw_json") {
-        json_output_writer << jsonMsg->getJsonObj().dump(4) << std::endl;
+        sink.write(j.dump(4));
+        sink.write("\n", 1);
+    } else if (jsonOutputFormat == "jsonl") {
+        sink.write(j.dump());
+        sink.write("\n", 1);
     } else if (jsonOutputFormat == "ctm" || jsonOutputFormat == "fst_search") {
         auto audioMsg =msgBlock.get<AudioDecoderMessage>(SlotStreamedAudio);
         float secondsPerTick = 1.0 / (audioMsg->mSampleRate*audioMsg->mTicksPerSample);
@@ -191,47 +322,51 @@ void FileWriterComponent::WriteJsonOutput(boost::shared_ptr<const JsonDecoderMes
         }
         std::string file = audioMsg->getDescriptor("wave_file_name") != "" ? audioMsg->getDescriptor("wave_file_name") : "dummy";
         std::string channel = audioMsg->getDescriptor("channel") == "1" ? "A" : "B";
-        json_output_writer << std::fixed << std::setprecision(2);
-        json j = jsonMsg->getJsonObj();
+        // All lines of the message get formatted into one buffer, which then goes to the sink in one piece
+        std::stringstream lines;
+        lines << std::fixed << std::setprecision(2);
         if (jsonOutputFormat == "ctm") {
-            for (size_t i = 0; i < j["words"].size(); ++i) {
-                json w = j["words"][i];
-
-                float wordBeginInSeconds = mPrevConvoEndTimeInSecondsStreamBased + (w["beginTime"].get<int64_t>() - mPrevConvoEndTimeInTicksStreamBased + 1) * secondsPerTick;
-                float wordDurationInSeconds = w["duration"].get<int64_t>() * secondsPerTick;
-
-                json_output_writer << file << " "
-                                   << channel << " "
-                                   << wordBeginInSeconds << " "
-                                   << wordDurationInSeconds << " "
-                                   << w["word"].get<std::string>() << " "
-                                   << TwoDigitsPrecisionRound(w["score"]);
-
-                if(!w["case"].is_null()) {
-                    std::string wcase = w["case"].get<std::string>();
-                    json_output_writer << " case:" << wcase;
+            auto words = j.find("words");
+            for (size_t i = 0; words != j.end() && i < words->size(); ++i) {
+                const json& w = (*words)[i];
+
+                float wordBeginInSeconds = mPrevConvoEndTimeInSecondsStreamBased + (w.at("beginTime").get<int64_t>() - mPrevConvoEndTimeInTicksStreamBased + 1) * secondsPerTick;
+                float wordDurationInSeconds = w.at("duration").get<int64_t>() * secondsPerTick;
+
+                lines << file << " "
+                      << channel << " "
+                      << wordBeginInSeconds << " "
+                      << wordDurationInSeconds << " "
+                      << w.at("word").get_ref<const std::string&>() << " "
+                      << TwoDigitsPrecisionRound(w.at("score"));
+
+                auto wcase = w.find("case");
+                if (wcase != w.end() && !wcase->is_null()) {
+                    lines << " case:" << wcase->get_ref<const std::string&>();
                 }
-                if(!w["punc"].is_null()) {
-                    std::string wpunc = w["punc"].get<std::string>();
-                    json_output_writer << " punc:" << wpunc;
+                auto wpunc = w.find("punc");
+                if (wpunc != w.end() && !wpunc->is_null()) {
+                    lines << " punc:" << wpunc->get_ref<const std::string&>();
                 }
-                json_output_writer << std::endl;
+                lines << "\n";
             }
         } else if (jsonOutputFormat == "fst_search") {
-            float beginTime = mPrevConvoEndTimeInSecondsStreamBased + (j["beginTime"].get<int64_t>() - mPrevConvoEndTimeInTicksStreamBased + 1) * secondsPerTick;
-            for (size_t i = 0; i < j["searchOutput"].size(); ++i) {
-                json& w = j["searchOutput"][i];
-                float wordBeginInSeconds = beginTime + w["relativeBeginTime"].get<int64_t>() * secondsPerTick;
-                float wordDurationInSeconds = w["duration"].get<int64_t>() * secondsPerTick;
-                json_output_writer << file << " "
-                                   << channel << " "
-                                   << wordBeginInSeconds << " "
-                                   << wordDurationInSeconds << " "
-                                   << w["outputString"].get<std::string>() << " "
-                                   << TwoDigitsPrecisionRound(w["score"]);
-                json_output_writer << std::endl;
+            float beginTime = mPrevConvoEndTimeInSecondsStreamBased + (j.at("beginTime").get<int64_t>() - mPrevConvoEndTimeInTicksStreamBased + 1) * secondsPerTick;
+            auto searchOutput = j.find("searchOutput");
+            for (size_t i = 0; searchOutput != j.end() && i < searchOutput->size(); ++i) {
+                const json& w = (*searchOutput)[i];
+                float wordBeginInSeconds = beginTime + w.at("relativeBeginTime").get<int64_t>() * secondsPerTick;
+                float wordDurationInSeconds = w.at("duration").get<int64_t>() * secondsPerTick;
+                lines << file << " "
+                      << channel << " "
+                      << wordBeginInSeconds << " "
+                      << wordDurationInSeconds << " "
+                      << w.at("outputString").get_ref<const std::string&>() << " "
+                      << TwoDigitsPrecisionRound(w.at("score"));
+                lines << "\n";
             }
         }
+        sink.write(lines.str());
 
         // This is an incredibly ugly allowance for the fact that CTMs are in reference to the analist's audio file. Pt II
         auto origConvMsg = msgBlock.get<ConversationStateDecoderMessage>(SlotFileFeederConvstate);
@@ -239,13 +374,9 @@ void FileWriterComponent::WriteJsonOutput(boost::shared_ptr<const JsonDecoderMes
             mPrevConvoEndTimeInTicksStreamBased = convMsg->getTime();
         }
     } else if (jsonOutputFormat == "mt") {
-        json j = jsonMsg->getJsonObj();
-        const std::string& translatedText = j["translatedText"].get<std::string>();
-        json_output_writer << translatedText << std::endl;
+        sink.write(j.at("translatedText").get_ref<const std::string&>());
+        sink.write("\n", 1);
     }
-
-    json_output_writer.flush();
 }
 
 }
-
@@ -1,9 +1,9 @@
 #pragma once
 
 #include "godec/ChannelMessenger.h"
+#include "godec/OutputSink.h"
 #include "GodecMessages.h"
-#include <stdio.h>
-#include <fstream>
+#include "cnpy.h"
 
 namespace Godec {
 
@@ -17,31 +17,43 @@ enum FileWriterInputType {
 class FileWriterHolder {
   public:
     FileWriterHolder() {
-        audioFp = nullptr;
+        mAudioFileOpen = false;
+        mTextFileOpen = false;
     }
     ~FileWriterHolder() {
-        if (audioFp != NULL) {
-            fclose(audioFp);
+        if (mAudioFileOpen) {
+            CloseAudioFile();
         }
-        if (raw_text_writer.is_open()) {
-            raw_text_writer.close();
-        }
-        if (json_output_writer.is_open()) {
-            json_output_writer.close();
+        if (mTextFileOpen) {
+            mSink->closeFile();
         }
     }
 
-    FILE* audioFp;
+    void OpenAudioFile(std::string fileName, float sampleRate);
+    void WriteAudio(const Vector& audio);
+    void CloseAudioFile();
+
+    // Shared with the component, all files (except the npz) go through it
+    boost::shared_ptr<OutputSink> mSink;
+
+    bool mAudioFileOpen;
     std::string mAudioPrefix;
     int mAudioSampleDepth;
+    bool mAudioFloat;
+    bool mAudioWav;
+    uint64_t mAudioDataBytes;
+    std::vector<char> mAudioConvertBuffer;
 
-    std::ofstream raw_text_writer;
-    std::ofstream json_output_writer;
+    bool mTextFileOpen;
     FileWriterInputType mInputType;
     std::string mFstPrefix;
     std::string mJsonOutputFormat;
     std::string mFeaturesNpz;
-    Matrix mFeaturesAccum;
+    bool mStreamFeatures;
+    boost::shared_ptr<cnpy::npz_writer> mFeaturesWriter;
+    // The chunks of the current utterance, when it is written in one go at its end
+    std::vector<boost::shared_ptr<const FeaturesDecoderMessage>> mFeaturesChunks;
+    int64_t mFeaturesDim;
 };
 
 
@@ -53,14 +65,16 @@ class FileWriterComponent : public LoopProcessor {
     void Shutdown();
   private:
     void ProcessMessage(const DecoderMessageBlock& msgBlock);
-    void WriteJsonOutput(boost::shared_ptr<const JsonDecoderMessage> jsonMsg, boost::shared_ptr<const ConversationStateDecoderMessage> convMsg, const DecoderMessageBlock& msgBlock, std::string jsonOutputFormat, std::ofstream& json_output_writer);
+    void WriteJsonOutput(boost::shared_ptr<const JsonDecoderMessage> jsonMsg, boost::shared_ptr<const ConversationStateDecoderMessage> convMsg, const DecoderMessageBlock& msgBlock, std::string jsonOutputFormat, OutputSink& sink);
     boost::shared_ptr<FileWriterHolder> GetFileWriterFromConfig( ComponentGraphConfig* configPt);
+    void WriteFeatures(boost::shared_ptr<const FeaturesDecoderMessage> featsMsg, bool lastChunkInUtt);
     static std::string SlotInput;
     static std::string SlotFileFeederConvstate;
     float mPrevConvoEndTimeInSecondsStreamBased;
     int64_t mPrevConvoEndTimeInTicksStreamBased;
 
     std::string mControlType;
+    boost::shared_ptr<OutputSink> mSink;
     boost::shared_ptr<FileWriterHolder> mCurrentFWH;
     std::string mCurrentFWHJson;
 };
@@ -0,0 +1,435 @@
+#include "FlacDecoder.h"
+#include <godec/HelperFuncs.h>
+#include <algorithm>
+#include <cstring>
+
+namespace Godec {
+
+// Both CRCs are MSB-first with a zero initial value. CRC-8 (polynomial x^8+x^2+x+1) covers the frame header, CRC-16 (x^16+x^15+x^2+1) the whole frame
+struct FlacCrcTables {
+    FlacCrcTables() {
+        for (int idx = 0; idx < 256; idx++) {
+            uint8_t crc8 = (uint8_t)idx;
+            uint16_t crc16 = (uint16_t)(idx << 8);
+            for (int bit = 0; bit < 8; bit++) {
+                crc8 = (crc8 & 0x80) ? (uint8_t)((crc8 << 1) ^ 0x07) : (uint8_t)(crc8 << 1);
+                crc16 = (crc16 & 0x8000) ? (uint16_t)((crc16 << 1) ^ 0x8005) : (uint16_t)(crc16 << 1);
+            }
+            mCrc8[idx] = crc8;
+            mCrc16[idx] = crc16;
+        }
+    }
+    uint8_t crc8(const unsigned char* data, int64_t size) const {
+        uint8_t crc = 0;
+        for (int64_t idx = 0; idx < size; idx++) crc = mCrc8[crc ^ data[idx]];
+        return crc;
+    }
+    uint16_t crc16(const unsigned char* data, int64_t size) const {
+        uint16_t crc = 0;
+        for (int64_t idx = 0; idx < size; idx++) crc = (uint16_t)((crc << 8) ^ mCrc16[(crc >> 8) ^ data[idx]]);
+        return crc;
+    }
+    uint8_t mCrc8[256];
+    uint16_t mCrc16[256];
+};
+
+static const FlacCrcTables& GetFlacCrcTables() {
+    static FlacCrcTables tables;
+    return tables;
+}
+
+static inline int CountLeadingZeros(uint64_t val) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(val);
+#else
+    int count = 0;
+    while (!(val & 0x8000000000000000ULL)) {
+        val <<= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// MSB-first bit reader. The bits that have been fetched sit left-aligned in a 64 bit cache, the bits below them are always zero
+class FlacBitReader {
+  public:
+    FlacBitReader(const unsigned char* data, int64_t size, int64_t pos, const std::string& fileName) :
+        mData(data), mSize(size), mPos(pos), mCache(0), mBits(0), mFileName(fileName) {}
+
+    inline uint32_t read(int numBits) {
+        if (numBits == 0) return 0;
+        if (mBits < numBits) {
+            refill();
+            if (mBits < numBits) truncated();
+        }
+        uint32_t val = (uint32_t)(mCache >> (64 - numBits));
+        mCache <<= numBits;
+        mBits -= numBits;
+        return val;
+    }
+
+    inline int32_t readSigned(int numBits) {
+        if (numBits == 0) return 0;
+        return (int32_t)(read(numBits) << (32 - numBits)) >> (32 - numBits);
+    }
+
+    // Number of 0 bits before the next 1 bit, which gets consumed as well
+    inline uint32_t readUnary() {
+        uint32_t count = 0;
+        while (true) {
+            if (mCache == 0) {
+                count += mBits;
+                mBits = 0;
+                refill();
+                if (mBits == 0) truncated();
+                continue;
+            }
+            int zeros = CountLeadingZeros(mCache);
+            mCache <<= zeros;
+            mCache <<= 1;
+            mBits -= zeros + 1;
+            return count + zeros;
+        }
+    }
+
+    void alignToByte() {
+        int skip = mBits & 7;
+        mCache <<= skip;
+        mBits -= skip;
+    }
+
+    // Only meaningful when aligned to a byte
+    int64_t bytePosition() const {
+        return mPos - mBits / 8;
+    }
+
+  private:
+    inline void refill() {
+        while (mBits <= 56 && mPos < mSize) {
+            mCache |= (uint64_t)mData[mPos++] << (56 - mBits);
+            mBits += 8;
+        }
+    }
+    void truncated() {
+        GODEC_ERR << "Truncated FLAC data in " << mFileName;
+    }
+
+    const unsigned char* mData;
+    int64_t mSize;
+    int64_t mPos;
+    uint64_t mCache;
+    int mBits;
+    const std::string& mFileName;
+};
+
+static void DecodeResidual(FlacBitReader& reader, int blockSize, int predictorOrder, int32_t* out, const std::string& fileName) {
+    uint32_t codingMethod = reader.read(2);
+    if (codingMethod > 1) GODEC_ERR << "Reserved residual coding method in FLAC file " << fileName;
+    int paramBits = codingMethod == 0 ? 4 : 5;
+    uint32_t escapeParam = codingMethod == 0 ? 15 : 31;
+    int partitionOrder = reader.read(4);
+    int partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < predictorOrder) GODEC_ERR << "Bad residual partitioning in FLAC file " << fileName;
+
+    for (int partitionIdx = 0; partitionIdx < (1 << partitionOrder); partitionIdx++) {
+        int numSamples = partitionIdx == 0 ? partitionSize - predictorOrder : partitionSize;
+        uint32_t riceParam = reader.read(paramBits);
+        if (riceParam == escapeParam) {
+            int numBits = reader.read(5);
+            for (int sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) out[sampleIdx] = reader.readSigned(numBits);
+        } else {
+            for (int sampleIdx = 0; sampleIdx < numSamples; sampleIdx++) {
+                uint32_t val = (reader.readUnary() << riceParam) | reader.read(riceParam);
+                out[sampleIdx] = (int32_t)(val >> 1) ^ -(int32_t)(val & 1);
+            }
+        }
+        out += numSamples;
+    }
+}
+
+// Turns the residual in "samples" (after the warm-up samples) into samples, in place
+template<typename Accumulator>
+static void RestoreLpc(int32_t* samples, int blockSize, const int32_t* coefs, int order, int shift) {
+    for (int sampleIdx = order; sampleIdx < blockSize; sampleIdx++) {
+        Accumulator sum = 0;
+        for (int coefIdx = 0; coefIdx < order; coefIdx++) sum += (Accumulator)coefs[coefIdx] * samples[sampleIdx - 1 - coefIdx];
+        samples[sampleIdx] += (int32_t)(sum >> shift);
+    }
+}
+
+static void RestoreFixed(int32_t* samples, int blockSize, int order) {
+    switch (order) {
+    case 0:
+        break;
+    case 1:
+        for (int idx = 1; idx < blockSize; idx++) samples[idx] += samples[idx - 1];
+        break;
+    case 2:
+        for (int idx = 2; idx < blockSize; idx++) samples[idx] += 2 * samples[idx - 1] - samples[idx - 2];
+        break;
+    case 3:
+        for (int idx = 3; idx < blockSize; idx++) samples[idx] += 3 * samples[idx - 1] - 3 * samples[idx - 2] + samples[idx - 3];
+        break;
+    case 4:
+        for (int idx = 4; idx < blockSize; idx++) samples[idx] += 4 * samples[idx - 1] - 6 * samples[idx - 2] + 4 * samples[idx - 3] - samples[idx - 4];
+        break;
+    }
+}
+
+static void DecodeSubframe(FlacBitReader& reader, int bitsPerSample, int blockSize, int32_t* out, const std::string& fileName) {
+    if (reader.read(1) != 0) GODEC_ERR << "Bad subframe header in FLAC file " << fileName;
+    uint32_t type = reader.read(6);
+    int wastedBits = 0;
+    if (reader.read(1)) {
+        wastedBits = reader.readUnary() + 1;
+        bitsPerSample -= wastedBits;
+        if (bitsPerSample < 1) GODEC_ERR << "Bad number of wasted bits in FLAC file " << fileName;
+    }
+
+    if (type == 0) {
+        int32_t val = reader.readSigned(bitsPerSample);
+        std::fill(out, out + blockSize, val);
+    } else if (type == 1) {
+        for (int idx = 0; idx < blockSize; idx++) out[idx] = reader.readSigned(bitsPerSample);
+    } else if (type >= 8 && type <= 12) {
+        int order = type - 8;
+        if (order > blockSize) GODEC_ERR << "Predictor order larger than block size in FLAC file " << fileName;
+        for (int idx = 0; idx < order; idx++) out[idx] = reader.readSigned(bitsPerSample);
+        DecodeResidual(reader, blockSize, order, out + order, fileName);
+        RestoreFixed(out, blockSize, order);
+    } else if (type >= 32) {
+        int order = type - 31;
+        if (order > blockSize) GODEC_ERR << "Predictor order larger than block size in FLAC file " << fileName;
+        for (int idx = 0; idx < order; idx++) out[idx] = reader.readSigned(bitsPerSample);
+        int precision = reader.read(4) + 1;
+        if (precision == 16) GODEC_ERR << "Bad LPC coefficient precision in FLAC file " << fileName;
+        int shift = reader.readSigned(5);
+        if (shift < 0) GODEC_ERR << "Negative LPC shift in FLAC file " << fileName;
+        int32_t coefs[32];
+        for (int idx = 0; idx < order; idx++) coefs[idx] = reader.readSigned(precision);
+        DecodeResidual(reader, blockSize, order, out + order, fileName);
+        // Same criterion as libFLAC for when the prediction can't overflow 32 bits
+        int orderBits = 0;
+        while ((1 << orderBits) < order) orderBits++;
+        if (bitsPerSample + precision + orderBits <= 32) RestoreLpc<int32_t>(out, blockSize, coefs, order, shift);
+        else RestoreLpc<int64_t>(out, blockSize, coefs, order, shift);
+    } else {
+        GODEC_ERR << "Reserved subframe type " << type << " in FLAC file " << fileName;
+    }
+
+    if (wastedBits > 0) {
+        for (int idx = 0; idx < blockSize; idx++) out[idx] = (int32_t)((uint32_t)out[idx] << wastedBits);
+    }
+}
+
+static uint64_t ReadBigEndian(const unsigned char* data, int numBytes) {
+    uint64_t val = 0;
+    for (int idx = 0; idx < numBytes; idx++) val = (val << 8) | data[idx];
+    return val;
+}
+
+FlacDecoder::FlacDecoder(const unsigned char* data, int64_t size, const std::string& fileName) :
+    mFileName(fileName), mData(data), mSize(size), mBlockFirstSample(0), mBlockSize(0), mNextFrameOffset(0) {
+    parseMetadata();
+    mBlock.resize(mNumChannels, std::vector<int32_t>(mMaxBlockSize));
+}
+
+void FlacDecoder::parseMetadata() {
+    int64_t pos = 0;
+    // Some taggers put an ID3v2 tag in front
+    if (mSize >= 10 && memcmp(mData, "ID3", 3) == 0) {
+        int64_t tagSize = ((mData[6] & 0x7F) << 21) | ((mData[7] & 0x7F) << 14) | ((mData[8] & 0x7F) << 7) | (mData[9] & 0x7F);
+        pos = 10 + tagSize + ((mData[5] & 0x10) ? 10 : 0);
+    }
+    if (pos + 4 > mSize || memcmp(mData + pos, "fLaC", 4) != 0) GODEC_ERR << "Not a FLAC file: " << mFileName;
+    pos += 4;
+
+    bool haveStreamInfo = false;
+    std::vector<std::pair<uint64_t, uint64_t>> seekPoints;
+    bool lastBlock = false;
+    while (!lastBlock) {
+        if (pos + 4 > mSize) GODEC_ERR << "Truncated metadata in FLAC file " << mFileName;
+        lastBlock = (mData[pos] & 0x80) != 0;
+        int blockType = mData[pos] & 0x7F;
+        int64_t blockLength = (int64_t)ReadBigEndian(mData + pos + 1, 3);
+        pos += 4;
+        if (pos + blockLength > mSize) GODEC_ERR << "Truncated metadata in FLAC file " << mFileName;
+
+        if (blockType == 0) {
+            if (blockLength < 34) GODEC_ERR << "Bad STREAMINFO in FLAC file " << mFileName;
+            FlacBitReader reader(mData, pos + blockLength, pos, mFileName);
+            mMinBlockSize = reader.read(16);
+            mMaxBlockSize = reader.read(16);
+            reader.read(24); // Minimum frame size
+            reader.read(24); // Maximum frame size
+            mSampleRate = reader.read(20);
+            mNumChannels = reader.read(3) + 1;
+            mBitsPerSample = reader.read(5) + 1;
+            mTotalNumSamples = ((int64_t)reader.read(4) << 32) | reader.read(32);
+            haveStreamInfo = true;
+        } else if (blockType == 3) {
+            for (int64_t pointPos = pos; pointPos + 18 <= pos + blockLength; pointPos += 18) {
+                uint64_t sample = ReadBigEndian(mData + pointPos, 8);
+                uint64_t offset = ReadBigEndian(mData + pointPos + 8, 8);
+                // Placeholder points have all bits set
+                if (sample != 0xFFFFFFFFFFFFFFFFULL) seekPoints.push_back(std::make_pair(sample, offset));
+            }
+        } else if (blockType == 127) {
+            GODEC_ERR << "Invalid metadata block in FLAC file " << mFileName;
+        }
+        pos += blockLength;
+    }
+    mFirstFrameOffset = pos;
+
+    if (!haveStreamInfo) GODEC_ERR << "No STREAMINFO in FLAC file " << mFileName;
+    if (mBitsPerSample < 4 || mBitsPerSample > 24) GODEC_ERR << "FLAC file " << mFileName << " has " << mBitsPerSample << " bits per sample, only 4 to 24 are supported";
+    if (mMaxBlockSize < 16 || mMinBlockSize > mMaxBlockSize) GODEC_ERR << "Bad block sizes in FLAC file " << mFileName;
+    if (mSampleRate == 0) GODEC_ERR << "No sample rate in FLAC file " << mFileName;
+    if (mTotalNumSamples == 0) GODEC_ERR << "FLAC file " << mFileName << " does not say how many samples it has";
+
+    mFrames[0] = mFirstFrameOffset;
+    for (auto it = seekPoints.begin(); it != seekPoints.end(); it++) {
+        if (it->first < (uint64_t)mTotalNumSamples && it->second < (uint64_t)(mSize - mFirstFrameOffset)) mFrames[it->first] = mFirstFrameOffset + it->second;
+    }
+}
+
+int64_t FlacDecoder::decodeFrame(int64_t offset, int64_t firstSample) {
+    const FlacCrcTables& crcTables = GetFlacCrcTables();
+    FlacBitReader reader(mData, mSize, offset, mFileName);
+    // 14 sync bits and a reserved 0
+    if (reader.read(15) != 0x7FFC) GODEC_ERR << "No FLAC frame at offset " << offset << " in " << mFileName;
+    bool variableBlockSize = reader.read(1) != 0;
+    int blockSizeCode = reader.read(4);
+    int sampleRateCode = reader.read(4);
+    int channelAssignment = reader.read(4);
+    int sampleSizeCode = reader.read(3);
+    if (reader.read(1) != 0) GODEC_ERR << "Bad frame header at offset " << offset << " in FLAC file " << mFileName;
+
+    // Frame or sample number, UTF-8 style coded
+    uint32_t firstByte = reader.read(8);
+    int extraBytes = 0;
+    while (extraBytes < 8 && (firstByte & (0x80 >> extraBytes))) extraBytes++;
+    if (extraBytes == 1 || extraBytes == 8) GODEC_ERR << "Bad frame number at offset " << offset << " in FLAC file " << mFileName;
+    if (extraBytes > 0) extraBytes--;
+    uint64_t number = firstByte & (0x7F >> (extraBytes == 0 ? 0 : extraBytes + 1));
+    for (int idx = 0; idx < extraBytes; idx++) {
+        uint32_t nextByte = reader.read(8);
+        if ((nextByte & 0xC0) != 0x80) GODEC_ERR << "Bad frame number at offset " << offset << " in FLAC file " << mFileName;
+        number = (number << 6) | (nextByte & 0x3F);
+    }
+
+    int blockSize = 0;
+    if (blockSizeCode == 1) blockSize = 192;
+    else if (blockSizeCode >= 2 && blockSizeCode <= 5) blockSize = 576 << (blockSizeCode - 2);
+    else if (blockSizeCode == 6) blockSize = reader.read(8) + 1;
+    else if (blockSizeCode == 7) blockSize = reader.read(16) + 1;
+    else if (blockSizeCode >= 8) blockSize = 256 << (blockSizeCode - 8);
+    else GODEC_ERR << "Reserved block size at offset " << offset << " in FLAC file " << mFileName;
+
+    // The sample rate comes from STREAMINFO, the one in the frame header only needs skipping
+    if (sampleRateCode == 12) reader.read(8);
+    else if (sampleRateCode == 13 || sampleRateCode == 14) reader.read(16);
+    else if (sampleRateCode == 15) GODEC_ERR << "Bad sample rate at offset " << offset << " in FLAC file " << mFileName;
+
+    static const int sampleSizes[8] = { 0, 8, 12, -1, 16, 20, 24, 32 };
+    int bitsPerSample = sampleSizeCode == 0 ? mBitsPerSample : sampleSizes[sampleSizeCode];
+    if (bitsPerSample != mBitsPerSample) GODEC_ERR << "Frame at offset " << offset << " in FLAC file " << mFileName << " has " << bitsPerSample << " bits per sample instead of " << mBitsPerSample;
+    int numChannels = channelAssignment < 8 ? channelAssignment + 1 : 2;
+    if (channelAssignment > 10 || numChannels != mNumChannels) GODEC_ERR << "Bad channel assignment at offset " << offset << " in FLAC file " << mFileName;
+
+    int64_t headerEnd = reader.bytePosition();
+    if (reader.read(8) != crcTables.crc8(mData + offset, headerEnd - offset)) GODEC_ERR << "Frame header CRC mismatch at offset " << offset << " in FLAC file " << mFileName;
+
+    int64_t headerFirstSample = variableBlockSize ? number : number * (mMinBlockSize == mMaxBlockSize ? mMinBlockSize : blockSize);
+    if (headerFirstSample != firstSample) GODEC_ERR << "Frame at offset " << offset << " in FLAC file " << mFileName << " starts at sample " << headerFirstSample << " instead of " << firstSample << " (bad seek table?)";
+    if (blockSize > (int)mBlock[0].size()) {
+        for (int channelIdx = 0; channelIdx < mNumChannels; channelIdx++) mBlock[channelIdx].resize(blockSize);
+    }
+
+    for (int channelIdx = 0; channelIdx < mNumChannels; channelIdx++) {
+        // The side channel has one bit more
+        bool isSide = (channelAssignment == 8 && channelIdx == 1) || (channelAssignment == 9 && channelIdx == 0) || (channelAssignment == 10 && channelIdx == 1);
+        DecodeSubframe(reader, bitsPerSample + (isSide ? 1 : 0), blockSize, mBlock[channelIdx].data(), mFileName);
+    }
+    reader.alignToByte();
+    int64_t frameEnd = reader.bytePosition();
+    if (reader.read(16) != crcTables.crc16(mData + offset, frameEnd - offset)) GODEC_ERR << "Frame CRC mismatch at offset " << offset << " in FLAC file " << mFileName;
+
+    int32_t* left = mBlock[0].data();
+    int32_t* right = mNumChannels > 1 ? mBlock[1].data() : NULL;
+    if (channelAssignment == 8) {
+        for (int idx = 0; idx < blockSize; idx++) right[idx] = left[idx] - right[idx];
+    } else if (channelAssignment == 9) {
+        for (int idx = 0; idx < blockSize; idx++) left[idx] += right[idx];
+    } else if (channelAssignment == 10) {
+        for (int idx = 0; idx < blockSize; idx++) {
+            int32_t side = right[idx];
+            int32_t mid = (int32_t)((uint32_t)left[idx] << 1) | (side & 1);
+            left[idx] = (mid + side) >> 1;
+            right[idx] = (mid - side) >> 1;
+        }
+    }
+
+    mBlockFirstSample = firstSample;
+    mBlockSize = blockSize;
+    mNextFrameOffset = frameEnd + 2;
+    mFrames[firstSample] = offset;
+    return mNextFrameOffset;
+}
+
+void FlacDecoder::seek(int64_t sample) {
+    if (mBlockSize > 0 && sample >= mBlockFirstSample && sample < mBlockFirstSample + mBlockSize) return;
+    auto frameIt = mFrames.upper_bound(sample);
+    frameIt--;
+    int64_t firstSample = frameIt->first;
+    int64_t offset = frameIt->second;
+    // Carrying on after the current block beats going back to an earlier known frame
+    int64_t nextSample = mBlockFirstSample + mBlockSize;
+    if (mBlockSize > 0 && nextSample <= sample && nextSample > firstSample) {
+        firstSample = nextSample;
+        offset = mNextFrameOffset;
+    }
+    while (true) {
+        if (firstSample >= mTotalNumSamples || offset >= mSize) GODEC_ERR << "FLAC file " << mFileName << " ends before sample " << sample;
+        decodeFrame(offset, firstSample);
+        if (sample < mBlockFirstSample + mBlockSize) return;
+        firstSample = mBlockFirstSample + mBlockSize;
+        offset = mNextFrameOffset;
+    }
+}
+
+template<int Bytes>
+void FlacDecoder::copyOut(unsigned char* out, int64_t blockBegin, int64_t blockEnd, const std::vector<int>& channels, int shift) {
+    int numOutChannels = (int)channels.size();
+    for (int channelIdx = 0; channelIdx < numOutChannels; channelIdx++) {
+        const int32_t* in = mBlock[channels[channelIdx] - 1].data();
+        unsigned char* outRunner = out + channelIdx * Bytes;
+        for (int64_t sampleIdx = blockBegin; sampleIdx < blockEnd; sampleIdx++) {
+            uint32_t val = (uint32_t)in[sampleIdx] << shift;
+            for (int byteIdx = 0; byteIdx < Bytes; byteIdx++) outRunner[byteIdx] = (unsigned char)(val >> (8 * byteIdx));
+            outRunner += numOutChannels * Bytes;
+        }
+    }
+}
+
+void FlacDecoder::read(unsigned char* out, int bytesPerSample, int64_t beginSample, int64_t endSample, const std::vector<int>& channels) {
+    boost::mutex::scoped_lock lock(mMutex);
+    int shift = bytesPerSample * 8 - mBitsPerSample;
+    if (shift < 0) GODEC_ERR << "FLAC file " << mFileName << " has " << mBitsPerSample << " bits per sample, which don't fit into " << bytesPerSample << " bytes";
+    int64_t sample = beginSample;
+    while (sample < endSample) {
+        seek(sample);
+        int64_t blockBegin = sample - mBlockFirstSample;
+        int64_t blockEnd = std::min(endSample - mBlockFirstSample, mBlockSize);
+        if (bytesPerSample == 1) copyOut<1>(out, blockBegin, blockEnd, channels, shift);
+        else if (bytesPerSample == 2) copyOut<2>(out, blockBegin, blockEnd, channels, shift);
+        else if (bytesPerSample == 3) copyOut<3>(out, blockBegin, blockEnd, channels, shift);
+        else if (bytesPerSample == 4) copyOut<4>(out, blockBegin, blockEnd, channels, shift);
+        else GODEC_ERR << "Unsupported sample width of " << bytesPerSample << " bytes";
+        out += (blockEnd - blockBegin) * channels.size() * bytesPerSample;
+        sample += blockEnd - blockBegin;
+    }
+}
+
+}
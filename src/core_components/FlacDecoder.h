@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+namespace Godec {
+
+/*
+ * Self-contained FLAC decoder for a file that is in memory as a whole (FileFeeder memory-maps it), so there is no dependency on libFLAC.
+ * Format specification: https://xiph.org/flac/format.html
+ *
+ * Decoding is frame by frame, straight into the caller's buffer. To get to a sample, decoding starts at the closest preceding frame that is known,
+ * either from the file's seek table or from having decoded it before, so reading a file's segments in order never decodes a frame twice.
+ * Frame CRCs are checked, a corrupt frame is an error.
+ *
+ * Supported: everything the reference encoder writes, i.e. fixed and variable block sizes, 4 to 24 bits per sample, up to 8 channels and all channel
+ * decorrelation modes. Files need to have the total number of samples in their STREAMINFO.
+ */
+class FlacDecoder {
+  public:
+    FlacDecoder(const unsigned char* data, int64_t size, const std::string& fileName);
+    // Writes samples [beginSample, endSample) of the given (1-based) channels interleaved into "out", as little-endian integers that are
+    // "bytesPerSample" wide. Samples with fewer bits than that are shifted up, like they would be in a WAV file
+    void read(unsigned char* out, int bytesPerSample, int64_t beginSample, int64_t endSample, const std::vector<int>& channels);
+
+    int64_t getTotalNumSamples() const { return mTotalNumSamples; }
+    int getSampleRate() const { return mSampleRate; }
+    int getNumChannels() const { return mNumChannels; }
+    int getBitsPerSample() const { return mBitsPerSample; }
+
+  private:
+    void parseMetadata();
+    // Makes the decoded block contain "sample"
+    void seek(int64_t sample);
+    // Decodes the frame at "offset" into mBlock, returns the offset of the next frame
+    int64_t decodeFrame(int64_t offset, int64_t firstSample);
+    template<int Bytes>
+    void copyOut(unsigned char* out, int64_t blockBegin, int64_t blockEnd, const std::vector<int>& channels, int shift);
+
+    std::string mFileName;
+    const unsigned char* mData;
+    int64_t mSize;
+
+    int mSampleRate;
+    int mNumChannels;
+    int mBitsPerSample;
+    int mMinBlockSize;
+    int mMaxBlockSize;
+    int64_t mTotalNumSamples;
+    int64_t mFirstFrameOffset;
+
+    // First sample -> file offset of every frame that is known so far
+    std::map<int64_t, int64_t> mFrames;
+
+    // The decoded block, one vector per channel
+    boost::mutex mMutex;
+    std::vector<std::vector<int32_t>> mBlock;
+    int64_t mBlockFirstSample;
+    int64_t mBlockSize;
+    int64_t mNextFrameOffset;
+};
+
+}
@@ -1,5 +1,6 @@
 #include "GodecMessages.h"
 #include <godec/HelperFuncs.h>
+#include <godec/MessagePool.h>
 #include <boost/format.hpp>
 #ifndef ANDROID
 #define PY_ARRAY_UNIQUE_SYMBOL GODEC_MESSAGES_ARRAY_API
@@ -30,7 +31,90 @@ ProcessingMode StringToProcessMode(std::string s) {
 
 #ifndef ANDROID
 int GodecMessages_init_numpy() {
-    import_array();
+    // The conversions call this for every message, the import only needs to happen once
+    if (PyArray_API != NULL) return 0;
+    import_array1(-1);
+    return 0;
+}
+
+// PyDict_SetItemString() does not steal the reference to the value, this does
+static void SetPythonDictItem(PyObject* dict, const char* key, PyObject* value) {
+    if (value == NULL) { PyErr_Print(); GODEC_ERR << "Could not create Python value for message field '" << key << "'"; }
+    PyDict_SetItemString(dict, key, value);
+    Py_DECREF(value);
+}
+
+// Numbers can come in as either Python numbers or strings
+static float PythonGetFloat(PyObject* pVal, const std::string& fieldName) {
+    if (PyUnicode_Check(pVal)) return boost::lexical_cast<float>(PyUnicode_AsUTF8(pVal));
+    double val = PyFloat_AsDouble(pVal);
+    if (val == -1.0 && PyErr_Occurred()) { PyErr_Print(); GODEC_ERR << "Incoming Python message field '" << fieldName << "' is not a number!"; }
+    return (float)val;
+}
+
+static void ReleaseMessageCapsule(PyObject* pCapsule) {
+    delete (DecoderMessage_ptr*)PyCapsule_GetPointer(pCapsule, "godec.DecoderMessage");
+}
+
+// Read-only numpy array that points straight at a message payload. Eigen storage is column-major, so 2D views come out in Fortran order. The array's base is a capsule holding a reference to the message, which keeps the payload alive for as long as Python holds on to the array
+static PyObject* NumpyViewOfPayload(const DecoderMessage* msg, int numDims, npy_intp* dims, int typeNum, const void* data) {
+    PyObject* pArray = PyArray_New(&PyArray_Type, numDims, dims, typeNum, NULL, (void*)data, 0, NPY_ARRAY_F_CONTIGUOUS | NPY_ARRAY_ALIGNED, NULL);
+    if (pArray == NULL) { PyErr_Print(); GODEC_ERR << "Could not create numpy view of message payload"; }
+    PyArray_CLEARFLAGS((PyArrayObject*)pArray, NPY_ARRAY_WRITEABLE);
+    PyObject* pCapsule = PyCapsule_New(new DecoderMessage_ptr(msg->shared_from_this()), "godec.DecoderMessage", ReleaseMessageCapsule);
+    if (pCapsule == NULL || PyArray_SetBaseObject((PyArrayObject*)pArray, pCapsule) != 0) { PyErr_Print(); GODEC_ERR << "Could not attach message to numpy view"; }
+    return pArray;
+}
+
+// Incoming arrays get copied into a pooled payload in one go, straight out of the numpy buffer if it is float32 in C or Fortran order. Only other dtypes and non-contiguous arrays get converted by numpy first
+static PyArrayObject* PythonGetContiguousArray(PyObject* pObj, int typeNum, int numDims, const std::string& fieldName) {
+    if (pObj == NULL) GODEC_ERR << "Incoming Python message dict does not contain field '" << fieldName << "'!";
+    PyArrayObject* pArray = (PyArrayObject*)PyArray_FROM_OTF(pObj, typeNum, NPY_ARRAY_ALIGNED);
+    if (pArray == NULL) { PyErr_Print(); GODEC_ERR << "Incoming Python message field '" << fieldName << "' can not be converted into a numpy array of the right type!"; }
+    if (PyArray_NDIM(pArray) != numDims) {
+        int actualDims = PyArray_NDIM(pArray);
+        Py_DECREF(pArray);
+        GODEC_ERR << "Incoming Python message field '" << fieldName << "' is not " << numDims << "-dimensional! Dimension is " << actualDims;
+    }
+    if (!PyArray_IS_C_CONTIGUOUS(pArray) && !PyArray_IS_F_CONTIGUOUS(pArray)) {
+        PyArrayObject* pContiguous = (PyArrayObject*)PyArray_FROM_OTF((PyObject*)pArray, typeNum, NPY_ARRAY_IN_FARRAY);
+        Py_DECREF(pArray);
+        if (pContiguous == NULL) { PyErr_Print(); GODEC_ERR << "Could not make incoming Python message field '" << fieldName << "' contiguous"; }
+        pArray = pContiguous;
+    }
+    return pArray;
+}
+
+static Matrix PythonGetMatrix(PyObject* pMsg, const std::string& fieldName) {
+    PyArrayObject* pArray = PythonGetContiguousArray(PyDict_GetItemString(pMsg, fieldName.c_str()), NPY_FLOAT32, 2, fieldName);
+    Eigen::Index rows = PyArray_DIM(pArray, 0);
+    Eigen::Index cols = PyArray_DIM(pArray, 1);
+    const float* data = (const float*)PyArray_DATA(pArray);
+    Matrix out = AcquireMatrix(rows, cols);
+    if (PyArray_IS_F_CONTIGUOUS(pArray)) {
+        out = Eigen::Map<const Matrix>(data, rows, cols);
+    } else {
+        out = Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(data, rows, cols);
+    }
+    Py_DECREF(pArray);
+    return out;
+}
+
+static Vector PythonGetVector(PyObject* pArrayObj, const std::string& fieldName) {
+    PyArrayObject* pArray = PythonGetContiguousArray(pArrayObj, NPY_FLOAT32, 1, fieldName);
+    Vector out = AcquireVector(PyArray_DIM(pArray, 0));
+    out = Eigen::Map<const Vector>((const float*)PyArray_DATA(pArray), out.size());
+    Py_DECREF(pArray);
+    return out;
+}
+
+template<class T>
+static std::vector<T> PythonGetStdVector(PyObject* pArrayObj, int typeNum, const std::string& fieldName) {
+    PyArrayObject* pArray = PythonGetContiguousArray(pArrayObj, typeNum, 1, fieldName);
+    const T* data = (const T*)PyArray_DATA(pArray);
+    std::vector<T> out(data, data + PyArray_DIM(pArray, 0));
+    Py_DECREF(pArray);
+    return out;
 }
 #endif
 
@@ -50,17 +134,38 @@ DecoderMessage_ptr AudioDecoderMessage::create(uint64_t _time, const float* _aud
     if (_numSamples == 0) {
         GODEC_ERR << "Can not create AudioDecoderMessage from empty data (numSamples=0).";
     }
-    AudioDecoderMessage* msg = new AudioDecoderMessage();
+    auto msg = NewPooledMessage<AudioDecoderMessage>();
     msg->setTime(_time);
     msg->mSampleRate = _sampleRate;
     msg->mTicksPerSample = _ticksPerSample;
+    msg->mAudio = AcquireVector(_numSamples);
     msg->mAudio = Eigen::Map<Vector>((float*)_audioData, _numSamples);
-    return DecoderMessage_ptr(msg);
+    return msg;
 }
 
+DecoderMessage_ptr AudioDecoderMessage::create(uint64_t _time, Vector&& _audio, float _sampleRate, float _ticksPerSample) {
+    if (_audio.size() == 0) {
+        GODEC_ERR << "Can not create AudioDecoderMessage from empty data (numSamples=0).";
+    }
+    auto msg = NewPooledMessage<AudioDecoderMessage>();
+    msg->setTime(_time);
+    msg->mSampleRate = _sampleRate;
+    msg->mTicksPerSample = _ticksPerSample;
+    msg->mAudio = std::move(_audio);
+    return msg;
+}
+
+AudioDecoderMessage::~AudioDecoderMessage() {
+    ReleasePayload(std::move(mAudio));
+}
 
 
-DecoderMessage_ptr AudioDecoderMessage::clone() const { return  DecoderMessage_ptr(new AudioDecoderMessage(*this)); }
+DecoderMessage_ptr AudioDecoderMessage::clone() const {
+    auto msg = NewPooledMessage<AudioDecoderMessage>();
+    msg->mAudio = AcquireVector(mAudio.size());
+    *msg = *this;
+    return msg;
+}
 
 bool AudioDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose) {
     auto newAudioMsg = boost::static_pointer_cast<const AudioDecoderMessage>(msg);
@@ -75,8 +180,11 @@ bool AudioDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &
         return true;
     }
     const Vector& newAudio = newAudioMsg->mAudio;
-    mAudio.conservativeResize(mAudio.size() + newAudio.size());
-    mAudio.tail(newAudio.size()) = newAudio;
+    Vector mergedAudio = AcquireVector(mAudio.size() + newAudio.size());
+    mergedAudio.head(mAudio.size()) = mAudio;
+    mergedAudio.tail(newAudio.size()) = newAudio;
+    ReleasePayload(std::move(mAudio));
+    mAudio = std::move(mergedAudio);
     setTime(msg->getTime());
     return false;
 }
@@ -115,8 +223,10 @@ bool AudioDecoderMessage::sliceOut(uint64_t sliceTime, DecoderMessage_ptr& slice
     if (remainingAudioSize == 0) {
         msgList.erase(msgList.begin());
     } else {
-        Matrix tmp = firstMsg->mAudio.tail(remainingAudioSize);
-        boost::static_pointer_cast<AudioDecoderMessage>(firstMsg)->mAudio = tmp;
+        Vector remainingAudio = AcquireVector(remainingAudioSize);
+        remainingAudio = firstMsg->mAudio.tail(remainingAudioSize);
+        ReleasePayload(std::move(firstMsg->mAudio));
+        firstMsg->mAudio = std::move(remainingAudio);
     }
     return true;
 }
@@ -125,45 +235,59 @@ void AudioDecoderMessage::shiftInTime(int64_t deltaT) {
     setTime((int64_t)getTime()+deltaT);
 }
 
+void AudioDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeFloat(mSampleRate);
+    writer.writeFloat(mTicksPerSample);
+    writer.writeFloatBlock(mAudio.data(), mAudio.size());
+}
+
+DecoderMessage_ptr AudioDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    float sampleRate = reader.readFloat();
+    float ticksPerSample = reader.readFloat();
+    Vector audio = AcquireVector(reader.readBlockSize());
+    reader.readFloatBlock(audio.data(), audio.size());
+    return AudioDecoderMessage::create(time, std::move(audio), sampleRate, ticksPerSample);
+}
+
+static std::string JNIGetStringField(JNIEnv* env, jobject jObj, jfieldID fieldId) {
+    jstring jString = (jstring)env->GetObjectField(jObj, fieldId);
+    const char* chars = env->GetStringUTFChars(jString, 0);
+    std::string out = chars;
+    env->ReleaseStringUTFChars(jString, chars);
+    env->DeleteLocalRef(jString);
+    return out;
+}
+
 jobject AudioDecoderMessage::toJNI(JNIEnv* env) {
-    jclass AudioDecoderMessageClass = env->FindClass("com/bbn/godec/AudioDecoderMessage");
-    jclass DecoderMessageClass = env->FindClass("com/bbn/godec/DecoderMessage");
-    jmethodID jAudioMsgInit = env->GetMethodID(AudioDecoderMessageClass, "<init>", "(Ljava/lang/String;JLcom/bbn/godec/Vector;FF)V");
-    std::string tag = getTag();
-    jstring jTag = env->NewStringUTF(tag.c_str());
-    jlong jTime = getTime();
-    jobject jAudioVectorObj = CreateJNIVector(env, mAudio);
-    jobject jAudioMsg = env->NewObject(AudioDecoderMessageClass, jAudioMsgInit, jTag, jTime, jAudioVectorObj, mSampleRate, mTicksPerSample);
+    return toJNIWithBuffer(env, nullptr);
+}
 
+jobject AudioDecoderMessage::toJNIWithBuffer(JNIEnv* env, jobject directBuffer) {
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 4); // jTag, jAudioVectorObj, jAudioMsg, jDescriptor
+    jstring jTag = env->NewStringUTF(getTag().c_str());
+    jobject jAudioVectorObj = CreateJNIVector(env, mAudio, directBuffer);
+    jobject jAudioMsg = env->NewObject(ids.mAudioMsg, ids.mAudioMsgInit, jTag, (jlong)getTime(), jAudioVectorObj, mSampleRate, mTicksPerSample);
     jstring jDescriptor = env->NewStringUTF(getFullDescriptorString().c_str());
-    jmethodID jSetFullDescriptor = env->GetMethodID(DecoderMessageClass, "setFullDescriptorString", "(Ljava/lang/String;)V");
-    env->CallVoidMethod(jAudioMsg, jSetFullDescriptor, jDescriptor);
-    return jAudioMsg;
-};
+    env->CallVoidMethod(jAudioMsg, ids.mDecoderMessageSetFullDescriptor, jDescriptor);
+    return frame.release(jAudioMsg);
+}
 
 DecoderMessage_ptr AudioDecoderMessage::fromJNI(JNIEnv* env, jobject jMsg) {
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 4); // jAudioVectorObj, plus what JNIVectorToEigen() needs
     std::string tag;
     uint64_t time;
     std::string descriptorString;
     JNIGetDecoderMessageVals(env, jMsg, tag, time, descriptorString);
 
-    jclass AudioDecoderMessageClass = env->FindClass("com/bbn/godec/AudioDecoderMessage");
-    jclass VectorClass = env->FindClass("com/bbn/godec/Vector");
-    jfieldID jVectorId = env->GetFieldID(AudioDecoderMessageClass, "mAudio", "Lcom/bbn/godec/Vector;");
-    jfieldID jAudioVectorDataId = env->GetFieldID(VectorClass, "mData", "[F");
-    jobject jAudioVectorObj = env->GetObjectField(jMsg, jVectorId);
-    jobject jAudioFloatObject = env->GetObjectField(jAudioVectorObj, jAudioVectorDataId);
-    jfloatArray* jAudioFloatArray = reinterpret_cast<jfloatArray*>(&jAudioFloatObject);
-    jfloat* audioData = env->GetFloatArrayElements(*jAudioFloatArray, 0);
-    jint audioDataSize = env->GetArrayLength(*jAudioFloatArray);
-    jfieldID jSampleRateFieldId = env->GetFieldID(AudioDecoderMessageClass, "mSampleRate", "F");
-    jfloat jSampleRate = env->GetFloatField(jMsg, jSampleRateFieldId);
-    jfieldID jTicksPerSampleFieldId = env->GetFieldID(AudioDecoderMessageClass, "mTicksPerSample", "F");
-    jfloat jTicksPerSample = env->GetFloatField(jMsg, jTicksPerSampleFieldId);
-
-    DecoderMessage_ptr outMsg = AudioDecoderMessage::create(time, audioData, audioDataSize, jSampleRate, jTicksPerSample);
+    jobject jAudioVectorObj = env->GetObjectField(jMsg, ids.mAudioMsgAudio);
+    Vector audio = JNIVectorToEigen(env, jAudioVectorObj);
+    jfloat jSampleRate = env->GetFloatField(jMsg, ids.mAudioMsgSampleRate);
+    jfloat jTicksPerSample = env->GetFloatField(jMsg, ids.mAudioMsgTicksPerSample);
+
+    DecoderMessage_ptr outMsg = AudioDecoderMessage::create(time, std::move(audio), jSampleRate, jTicksPerSample);
     (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
-    env->ReleaseFloatArrayElements(*jAudioFloatArray, audioData, 0);
     return outMsg;
 }
 
@@ -172,20 +296,15 @@ PyObject* AudioDecoderMessage::toPython() {
     GodecMessages_init_numpy();
     PyObject* dict = PyDict_New();
 
-    PyDict_SetItemString(dict, "type", PyUnicode_FromString("AudioDecoderMessage"));
-    PyDict_SetItemString(dict, "tag", PyUnicode_FromString(getTag().c_str()));
-    PyDict_SetItemString(dict, "sample_rate", PyFloat_FromDouble(mSampleRate));
-    PyDict_SetItemString(dict, "ticks_per_sample", PyFloat_FromDouble(mTicksPerSample));
-    PyDict_SetItemString(dict, "time", PyLong_FromLong(getTime()));
-    PyDict_SetItemString(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
-
-    npy_intp featDims[1] {mAudio.size()};
-    PyObject* pAudio = PyArray_SimpleNew(1, featDims, NPY_FLOAT32);
-    if (pAudio == NULL) GODEC_ERR << "Could not allocate feature memory";
-    for(int idx = 0; idx < mAudio.size(); idx++) {
-        *((float*)PyArray_GETPTR1(pAudio, idx)) = mAudio(idx);
-    }
-    PyDict_SetItemString(dict, "audio", pAudio);
+    SetPythonDictItem(dict, "type", PyUnicode_FromString("AudioDecoderMessage"));
+    SetPythonDictItem(dict, "tag", PyUnicode_FromString(getTag().c_str()));
+    SetPythonDictItem(dict, "sample_rate", PyFloat_FromDouble(mSampleRate));
+    SetPythonDictItem(dict, "ticks_per_sample", PyFloat_FromDouble(mTicksPerSample));
+    SetPythonDictItem(dict, "time", PyLong_FromLong(getTime()));
+    SetPythonDictItem(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
+
+    npy_intp audioDims[1] {mAudio.size()};
+    SetPythonDictItem(dict, "audio", NumpyViewOfPayload(this, 1, audioDims, NPY_FLOAT32, mAudio.data()));
     return dict;
 }
 
@@ -198,23 +317,15 @@ DecoderMessage_ptr AudioDecoderMessage::fromPython(PyObject* pMsg) {
 
     PyObject* pSampleRate = PyDict_GetItemString(pMsg,"sample_rate");
     if (pSampleRate == nullptr) GODEC_ERR << "Incoming Python message dict does not contain field 'sample_rate'!";
-    float sampleRate = boost::lexical_cast<float>(PyUnicode_AsUTF8(pSampleRate));
+    float sampleRate = PythonGetFloat(pSampleRate, "sample_rate");
 
     PyObject* pTicksPerSample = PyDict_GetItemString(pMsg,"ticks_per_sample");
     if (pTicksPerSample == nullptr) GODEC_ERR << "Incoming Python message dict does not contain field 'ticks_per_sample'!";
-    float ticksPerSample = boost::lexical_cast<float>(PyUnicode_AsUTF8(pTicksPerSample));
-
-    // matrix
-    PyArrayObject* pAudio = (PyArrayObject*)PyDict_GetItemString(pMsg,"audio");
-    if (pAudio == NULL) GODEC_ERR << "AudioDecoderMessage::fromPython : Dict does not contain field 'audio'!";
-    if (PyArray_NDIM(pAudio) != 1) GODEC_ERR << "AudioDecoderMessage::fromPython : audio element is not one-dimensional! Dimension is " << PyArray_NDIM(pAudio);
-    npy_intp* pAudioDims = PyArray_SHAPE(pAudio);
-    Vector audioVector(pAudioDims[0]);
-    for(int idx = 0; idx < pAudioDims[0]; idx++) {
-        audioVector(idx) = *((float*)PyArray_GETPTR1(pAudio, idx));
-    }
+    float ticksPerSample = PythonGetFloat(pTicksPerSample, "ticks_per_sample");
 
-    DecoderMessage_ptr outMsg = AudioDecoderMessage::create(time, audioVector.data(), audioVector.size(), sampleRate, ticksPerSample);
+    Vector audioVector = PythonGetVector(PyDict_GetItemString(pMsg,"audio"), "audio");
+
+    DecoderMessage_ptr outMsg = AudioDecoderMessage::create(time, std::move(audioVector), sampleRate, ticksPerSample);
     (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
     return outMsg;
 }
@@ -247,29 +358,48 @@ std::string FeaturesDecoderMessage::describeThyself() const {
 
 DecoderMessage_ptr FeaturesDecoderMessage::create(
     uint64_t _time, std::string _utteranceId,
-    Matrix _feats, std::string _featureNames, std::vector<uint64_t> _featureTimestamps) {
+    const Matrix& _feats, std::string _featureNames, std::vector<uint64_t> _featureTimestamps) {
+    Matrix feats = AcquireMatrix(_feats.rows(), _feats.cols());
+    feats = _feats;
+    return create(_time, std::move(_utteranceId), std::move(feats), std::move(_featureNames), std::move(_featureTimestamps));
+}
+
+DecoderMessage_ptr FeaturesDecoderMessage::create(
+    uint64_t _time, std::string _utteranceId,
+    Matrix&& _feats, std::string _featureNames, std::vector<uint64_t> _featureTimestamps) {
     if (_feats.cols() != _featureTimestamps.size()) GODEC_ERR << "FeaturesDecoderMessage::create: feature #columns != timestamps size!";
     if (_time != _featureTimestamps.back()) GODEC_ERR << "FeaturesDecoderMessage::create: time != last timestamp entry!";
     if (_feats.cols() == 0) GODEC_ERR << "FeaturesDecoderMessage::create: No empty payload allowed!";
-    FeaturesDecoderMessage* msg = new FeaturesDecoderMessage();
+    auto msg = NewPooledMessage<FeaturesDecoderMessage>();
     msg->setTime(_time);
-    msg->mUtteranceId = _utteranceId;
-    msg->mFeatures = _feats;
-    msg->mFeatureNames = _featureNames;
-    msg->mFeatureTimestamps = _featureTimestamps;
-    return DecoderMessage_ptr(msg);
+    msg->mUtteranceId = std::move(_utteranceId);
+    msg->mFeatures = std::move(_feats);
+    msg->mFeatureNames = std::move(_featureNames);
+    msg->mFeatureTimestamps = std::move(_featureTimestamps);
+    return msg;
 }
 
+FeaturesDecoderMessage::~FeaturesDecoderMessage() {
+    ReleasePayload(std::move(mFeatures));
+}
 
 
-DecoderMessage_ptr FeaturesDecoderMessage::clone()  const { return  DecoderMessage_ptr(new FeaturesDecoderMessage(*this)); }
+DecoderMessage_ptr FeaturesDecoderMessage::clone()  const {
+    auto msg = NewPooledMessage<FeaturesDecoderMessage>();
+    msg->mFeatures = AcquireMatrix(mFeatures.rows(), mFeatures.cols());
+    *msg = *this;
+    return msg;
+}
 bool FeaturesDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose) {
     auto newFeatsMsg = boost::static_pointer_cast<const FeaturesDecoderMessage>(msg);
     if (mUtteranceId == newFeatsMsg->mUtteranceId) { // Convo is assumed to be the same in this case
         const Matrix& newFeats = newFeatsMsg->mFeatures;
         if (mFeatures.rows() != newFeats.rows()) GODEC_ERR << "Trying to merge incompatible features";
-        mFeatures.conservativeResize(mFeatures.rows(), mFeatures.cols() + newFeats.cols());
-        mFeatures.rightCols(newFeats.cols()) = newFeats;
+        Matrix mergedFeats = AcquireMatrix(mFeatures.rows(), mFeatures.cols() + newFeats.cols());
+        mergedFeats.leftCols(mFeatures.cols()) = mFeatures;
+        mergedFeats.rightCols(newFeats.cols()) = newFeats;
+        ReleasePayload(std::move(mFeatures));
+        mFeatures = std::move(mergedFeats);
         mFeatureTimestamps.insert(mFeatureTimestamps.end(),
                                   newFeatsMsg->mFeatureTimestamps.begin(), newFeatsMsg->mFeatureTimestamps.end());
         setTime(msg->getTime());
@@ -321,7 +451,8 @@ bool FeaturesDecoderMessage::sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sl
     int nRemovedFrames = (int)std::distance(
                              firstMsg->mFeatureTimestamps.begin(), sliceAtFrameTimestampIt) + 1;
 
-    Matrix slicedFeats = (Matrix)firstMsg->mFeatures.leftCols(nRemovedFrames);
+    Matrix slicedFeats = AcquireMatrix(firstMsg->mFeatures.rows(), nRemovedFrames);
+    slicedFeats = firstMsg->mFeatures.leftCols(nRemovedFrames);
     std::vector<uint64_t> featureTimestamps;
     featureTimestamps.insert(featureTimestamps.end(),
                              firstMsg->mFeatureTimestamps.begin(),
@@ -334,7 +465,10 @@ bool FeaturesDecoderMessage::sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sl
     if (remainingFeatureSize == 0) {
         msgList.erase(msgList.begin());
     } else {
-        firstMsg->mFeatures = (Matrix)firstMsg->mFeatures.rightCols(remainingFeatureSize);
+        Matrix remainingFeats = AcquireMatrix(firstMsg->mFeatures.rows(), remainingFeatureSize);
+        remainingFeats = firstMsg->mFeatures.rightCols(remainingFeatureSize);
+        ReleasePayload(std::move(firstMsg->mFeatures));
+        firstMsg->mFeatures = std::move(remainingFeats);
     }
 
 #if 0
@@ -351,7 +485,7 @@ bool FeaturesDecoderMessage::sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sl
 
     sliceMsg = FeaturesDecoderMessage::create(
                    sliceTime, firstMsg->mUtteranceId,
-                   slicedFeats, firstMsg->mFeatureNames, featureTimestamps);
+                   std::move(slicedFeats), firstMsg->mFeatureNames, std::move(featureTimestamps));
     (boost::const_pointer_cast<DecoderMessage>(sliceMsg))->setFullDescriptorString(firstMsg->getFullDescriptorString());
     auto featSliceMsg = boost::static_pointer_cast<FeaturesDecoderMessage>(boost::const_pointer_cast<DecoderMessage>(sliceMsg));
 
@@ -365,90 +499,62 @@ void FeaturesDecoderMessage::shiftInTime(int64_t deltaT) {
     }
 }
 
+void FeaturesDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeString(mUtteranceId);
+    writer.writeString(mFeatureNames);
+    writer.writeU64Block(mFeatureTimestamps.data(), mFeatureTimestamps.size());
+    writer.writeMatrix(mFeatures);
+}
+
+DecoderMessage_ptr FeaturesDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    std::string uttId = reader.readString();
+    std::string featureNames = reader.readString();
+    std::vector<uint64_t> featureTimestamps = reader.readU64Vector();
+    Matrix features = reader.readMatrix();
+    return FeaturesDecoderMessage::create(time, std::move(uttId), std::move(features), std::move(featureNames), std::move(featureTimestamps));
+}
+
 
 jobject FeaturesDecoderMessage::toJNI(JNIEnv* env) {
-    jclass FeaturesDecoderMessageClass = env->FindClass("com/bbn/godec/FeaturesDecoderMessage");
-    jclass DecoderMessageClass = env->FindClass("com/bbn/godec/DecoderMessage");
-    jmethodID jFeatMsgInit = env->GetMethodID(FeaturesDecoderMessageClass, "<init>", "(Ljava/lang/String;JLjava/lang/String;Lcom/bbn/godec/Matrix;[JLjava/lang/String;)V");
-    std::string tag = getTag();
-    jstring jTag = env->NewStringUTF(tag.c_str());
+    return toJNIWithBuffer(env, nullptr);
+}
+
+jobject FeaturesDecoderMessage::toJNIWithBuffer(JNIEnv* env, jobject directBuffer) {
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 7); // jTag, jUtteranceId, jFeatNames, jFeatMatrixObj, jTimestampsArray, jFeatMsg, jDescriptor
+    jstring jTag = env->NewStringUTF(getTag().c_str());
     jstring jUtteranceId = env->NewStringUTF(mUtteranceId.c_str());
     jstring jFeatNames = env->NewStringUTF(mFeatureNames.c_str());
-    jlong jTime = getTime();
-    jobject jFeatMatrixObj = CreateJNIMatrix(env, mFeatures);
+    jobject jFeatMatrixObj = CreateJNIMatrix(env, mFeatures, directBuffer);
     jlongArray jTimestampsArray = env->NewLongArray((jsize)mFeatureTimestamps.size());
-    jlong* tmpArray = new jlong[mFeatureTimestamps.size()];
-    for (int idx = 0; idx < mFeatureTimestamps.size(); idx++) {
-        tmpArray[idx] = mFeatureTimestamps[idx];
-    }
-    env->SetLongArrayRegion(jTimestampsArray, 0, (jsize)mFeatureTimestamps.size(), tmpArray);
-    delete[] tmpArray;
-    jobject jFeatMsg = env->NewObject(FeaturesDecoderMessageClass, jFeatMsgInit, jTag, jTime, jUtteranceId, jFeatMatrixObj, jTimestampsArray, jFeatNames);
-
+    static_assert(sizeof(jlong) == sizeof(uint64_t), "Feature timestamps can't be copied as-is");
+    env->SetLongArrayRegion(jTimestampsArray, 0, (jsize)mFeatureTimestamps.size(), (const jlong*)mFeatureTimestamps.data());
+    jobject jFeatMsg = env->NewObject(ids.mFeaturesMsg, ids.mFeaturesMsgInit, jTag, (jlong)getTime(), jUtteranceId, jFeatMatrixObj, jTimestampsArray, jFeatNames);
     jstring jDescriptor = env->NewStringUTF(getFullDescriptorString().c_str());
-    jmethodID jSetFullDescriptor = env->GetMethodID(DecoderMessageClass, "setFullDescriptorString", "(Ljava/lang/String;)V");
-    env->CallVoidMethod(jFeatMsg, jSetFullDescriptor, jDescriptor);
-    return jFeatMsg;
-};
+    env->CallVoidMethod(jFeatMsg, ids.mDecoderMessageSetFullDescriptor, jDescriptor);
+    return frame.release(jFeatMsg);
+}
 
 DecoderMessage_ptr FeaturesDecoderMessage::fromJNI(JNIEnv* env, jobject jMsg) {
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 2); // jTimestampsArray, jFeaturesObj
     std::string tag;
     uint64_t time;
     std::string descriptorString;
     JNIGetDecoderMessageVals(env, jMsg, tag, time, descriptorString);
 
-    // utterance ID
-    jclass FeaturesDecoderMessageClass = env->FindClass("com/bbn/godec/FeaturesDecoderMessage");
-    jfieldID jUttFieldId = env->GetFieldID(FeaturesDecoderMessageClass, "mUtteranceId", "Ljava/lang/String;");
-    jstring jUttIdObj = (jstring)env->GetObjectField(jMsg, jUttFieldId);
-    const char* uttIdChars = env->GetStringUTFChars(jUttIdObj, 0);
-    std::string uttId = uttIdChars;
-    env->ReleaseStringUTFChars(jUttIdObj, uttIdChars);
-
-    // pfnames
-    jfieldID jNamesFieldId = env->GetFieldID(FeaturesDecoderMessageClass, "mFeatureNames", "Ljava/lang/String;");
-    jstring jNamesObj = (jstring)env->GetObjectField(jMsg, jNamesFieldId);
-    const char* namesChars = env->GetStringUTFChars(jNamesObj, 0);
-    std::string pfnames = namesChars;
-    env->ReleaseStringUTFChars(jNamesObj, namesChars);
-
-    // timestamps
-    jfieldID jTimestampsFieldId = env->GetFieldID(FeaturesDecoderMessageClass, "mFeatureTimestamps", "[J");
-    jobject jTimestampsObj = env->GetObjectField(jMsg, jTimestampsFieldId);
-    jlongArray* jTimestampsArray = reinterpret_cast<jlongArray*>(&jTimestampsObj);
-    jlong* jTimestamps = env->GetLongArrayElements(*jTimestampsArray, 0);
-    jint timestampsSize = env->GetArrayLength(*jTimestampsArray);
-    std::vector<uint64_t> featureTimestamps(timestampsSize);
-    for (int iTimestamp=0; iTimestamp < timestampsSize; iTimestamp++) {
-        featureTimestamps[iTimestamp] = (uint64_t) jTimestamps[iTimestamp];
-    }
-
-    env->ReleaseLongArrayElements(*jTimestampsArray, jTimestamps, 0);
-
-    // matrix
-    jfieldID jFeaturesFieldId = env->GetFieldID(FeaturesDecoderMessageClass, "mFeatures", "Lcom/bbn/godec/Matrix;");
-    jclass MatrixClass = env->FindClass("com/bbn/godec/Matrix");
+    std::string uttId = JNIGetStringField(env, jMsg, ids.mFeaturesMsgUtteranceId);
+    std::string pfnames = JNIGetStringField(env, jMsg, ids.mFeaturesMsgFeatureNames);
 
-    jobject jFeaturesObj = env->GetObjectField(jMsg, jFeaturesFieldId);
-    jmethodID jColsMethodId = env->GetMethodID(MatrixClass, "cols", "()I");
-    jmethodID jRowsMethodId = env->GetMethodID(MatrixClass, "rows", "()I");
-    jmethodID jGetMethodId  = env->GetMethodID(MatrixClass, "get", "(II)F");
-
-    jint numCols = env->CallIntMethod(jFeaturesObj, jColsMethodId);
-    jint numRows = env->CallIntMethod(jFeaturesObj, jRowsMethodId);
-
-    Matrix featureMatrix;
-    featureMatrix.conservativeResize(numRows, numCols);
+    jlongArray jTimestampsArray = (jlongArray)env->GetObjectField(jMsg, ids.mFeaturesMsgTimestamps);
+    jint timestampsSize = env->GetArrayLength(jTimestampsArray);
+    std::vector<uint64_t> featureTimestamps(timestampsSize);
+    env->GetLongArrayRegion(jTimestampsArray, 0, timestampsSize, (jlong*)featureTimestamps.data());
 
-    // "First make it work, then make it efficient"
-    for (int i=0; i < numCols; i++) {
-        for (int j=0; j < numRows; j++) {
-            jfloat val = env->CallFloatMethod(jFeaturesObj, jGetMethodId, j, i);
-            featureMatrix(j, i) = val;
-        }
-    }
+    jobject jFeaturesObj = env->GetObjectField(jMsg, ids.mFeaturesMsgFeatures);
+    Matrix featureMatrix = JNIMatrixToEigen(env, jFeaturesObj);
 
-    DecoderMessage_ptr outMsg = FeaturesDecoderMessage::create(time, uttId, featureMatrix, pfnames, featureTimestamps);
+    DecoderMessage_ptr outMsg = FeaturesDecoderMessage::create(time, uttId, std::move(featureMatrix), pfnames, featureTimestamps);
     (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
     return outMsg;
 }
@@ -459,27 +565,18 @@ PyObject* FeaturesDecoderMessage::toPython() {
     GodecMessages_init_numpy();
     PyObject* dict = PyDict_New();
 
-    PyDict_SetItemString(dict, "type", PyUnicode_FromString("FeaturesDecoderMessage"));
-    PyDict_SetItemString(dict, "tag", PyUnicode_FromString(getTag().c_str()));
-    PyDict_SetItemString(dict, "utterance_id", PyUnicode_FromString(mUtteranceId.c_str()));
-    PyDict_SetItemString(dict, "feature_names", PyUnicode_FromString(mFeatureNames.c_str()));
-    PyDict_SetItemString(dict, "time", PyLong_FromLong(getTime()));
-    PyDict_SetItemString(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
+    SetPythonDictItem(dict, "type", PyUnicode_FromString("FeaturesDecoderMessage"));
+    SetPythonDictItem(dict, "tag", PyUnicode_FromString(getTag().c_str()));
+    SetPythonDictItem(dict, "utterance_id", PyUnicode_FromString(mUtteranceId.c_str()));
+    SetPythonDictItem(dict, "feature_names", PyUnicode_FromString(mFeatureNames.c_str()));
+    SetPythonDictItem(dict, "time", PyLong_FromLong(getTime()));
+    SetPythonDictItem(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
 
     npy_intp timeDims[1] {(npy_intp)mFeatureTimestamps.size()};
-    PyObject* pTimestamps = PyArray_SimpleNewFromData(1, timeDims, NPY_UINT64, &mFeatureTimestamps[0]);
-    if (pTimestamps == NULL) GODEC_ERR << "Could not allocate feature timestamps memory";
-    PyDict_SetItemString(dict, "feature_timestamps", pTimestamps);
+    SetPythonDictItem(dict, "feature_timestamps", NumpyViewOfPayload(this, 1, timeDims, NPY_UINT64, mFeatureTimestamps.data()));
 
     npy_intp featDims[2] {(npy_intp)mFeatures.rows(), (npy_intp)mFeatures.cols()};
-    PyObject* pFeats = PyArray_SimpleNew(2, featDims, NPY_FLOAT32);
-    if (pFeats == NULL) GODEC_ERR << "Could not allocate feature memory";
-    for(int row = 0; row < mFeatures.rows(); row++) {
-        for(int col = 0; col < mFeatures.cols(); col++) {
-            *((float*)PyArray_GETPTR2(pFeats, row, col)) = mFeatures(row,col);
-        }
-    }
-    PyDict_SetItemString(dict, "features", pFeats);
+    SetPythonDictItem(dict, "features", NumpyViewOfPayload(this, 2, featDims, NPY_FLOAT32, mFeatures.data()));
     return dict;
 }
 DecoderMessage_ptr FeaturesDecoderMessage::fromPython(PyObject* pMsg) {
@@ -496,29 +593,10 @@ DecoderMessage_ptr FeaturesDecoderMessage::fromPython(PyObject* pMsg) {
     if (pFeatureNames == nullptr) GODEC_ERR << "Incoming Python message dict does not contain field 'feature_names'!";
     std::string featureNames = PyUnicode_AsUTF8(pFeatureNames);
 
-    // timestamps
-    PyArrayObject* pTimestamps = (PyArrayObject*)PyDict_GetItemString(pMsg,"feature_timestamps");
-    if (pTimestamps == NULL) GODEC_ERR << "Incoming Python message dict does not contain field 'feature_timestamps'!";
-    if (PyArray_NDIM(pTimestamps) != 1) GODEC_ERR << "Incoming Python message, 'feature_timestamps' element is not a one-dimensional numpy array!";
-    std::vector<uint64_t> featureTimestamps(PyArray_DIM(pTimestamps,0));
-    for(int idx = 0; idx < featureTimestamps.size(); idx++) {
-        featureTimestamps[idx] = *((uint64_t*)PyArray_GETPTR1(pTimestamps, idx));
-    }
-
-    // matrix
-    PyArrayObject* pFeatures = (PyArrayObject*)PyDict_GetItemString(pMsg,"features");
-    if (pFeatures == NULL) GODEC_ERR << "FeaturesDecoderMessage::fromPython : Dict does not contain field 'features'!";
-    if (PyArray_NDIM(pFeatures) != 2) GODEC_ERR << "FeaturesDecoderMessage::fromPython : features element is not two-dimensional! Dimension is " << PyArray_NDIM(pFeatures);
-    npy_intp* pFeaturesDims = PyArray_SHAPE(pFeatures);
-    Matrix featureMatrix;
-    featureMatrix.conservativeResize(pFeaturesDims[0], pFeaturesDims[1]);
-    for(int row = 0; row < pFeaturesDims[0]; row++) {
-        for(int col = 0; col < pFeaturesDims[1]; col++) {
-            featureMatrix(row,col) = *((float*)PyArray_GETPTR2(pFeatures, row, col));
-        }
-    }
+    std::vector<uint64_t> featureTimestamps = PythonGetStdVector<uint64_t>(PyDict_GetItemString(pMsg,"feature_timestamps"), NPY_UINT64, "feature_timestamps");
+    Matrix featureMatrix = PythonGetMatrix(pMsg, "features");
 
-    DecoderMessage_ptr outMsg = FeaturesDecoderMessage::create(time, uttId, featureMatrix, featureNames, featureTimestamps);
+    DecoderMessage_ptr outMsg = FeaturesDecoderMessage::create(time, std::move(uttId), std::move(featureMatrix), std::move(featureNames), std::move(featureTimestamps));
     (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
     return outMsg;
 }
@@ -535,15 +613,30 @@ std::string MatrixDecoderMessage::describeThyself() const {
     return ss.str();
 }
 
-DecoderMessage_ptr MatrixDecoderMessage::create(uint64_t _time, Matrix _mat) {
-    MatrixDecoderMessage* msg = new MatrixDecoderMessage();
+DecoderMessage_ptr MatrixDecoderMessage::create(uint64_t _time, const Matrix& _mat) {
+    Matrix mat = AcquireMatrix(_mat.rows(), _mat.cols());
+    mat = _mat;
+    return create(_time, std::move(mat));
+}
+
+DecoderMessage_ptr MatrixDecoderMessage::create(uint64_t _time, Matrix&& _mat) {
+    auto msg = NewPooledMessage<MatrixDecoderMessage>();
     msg->setTime(_time);
-    msg->mMat = _mat;
-    return DecoderMessage_ptr(msg);
+    msg->mMat = std::move(_mat);
+    return msg;
+}
+
+MatrixDecoderMessage::~MatrixDecoderMessage() {
+    ReleasePayload(std::move(mMat));
 }
 
 
-DecoderMessage_ptr MatrixDecoderMessage::clone()  const { return  DecoderMessage_ptr(new MatrixDecoderMessage(*this)); }
+DecoderMessage_ptr MatrixDecoderMessage::clone()  const {
+    auto msg = NewPooledMessage<MatrixDecoderMessage>();
+    msg->mMat = AcquireMatrix(mMat.rows(), mMat.cols());
+    *msg = *this;
+    return msg;
+}
 bool MatrixDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose) {
     remainingMsg = msg;
     return true;
@@ -569,6 +662,14 @@ void MatrixDecoderMessage::shiftInTime(int64_t deltaT) {
     setTime((int64_t)getTime()+deltaT);
 }
 
+void MatrixDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeMatrix(mMat);
+}
+
+DecoderMessage_ptr MatrixDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    return MatrixDecoderMessage::create(time, reader.readMatrix());
+}
+
 jobject MatrixDecoderMessage::toJNI(JNIEnv* env) {
     GODEC_ERR << "MatrixDecoderMessage::toJNI not implemented yet!";
     return NULL;
@@ -576,12 +677,28 @@ jobject MatrixDecoderMessage::toJNI(JNIEnv* env) {
 
 #ifndef ANDROID
 PyObject* MatrixDecoderMessage::toPython() {
-    GODEC_ERR << "MatrixDecoderMessage::toPython not implemented yet";
-    return nullptr;
+    GodecMessages_init_numpy();
+    PyObject* dict = PyDict_New();
+
+    SetPythonDictItem(dict, "type", PyUnicode_FromString("MatrixDecoderMessage"));
+    SetPythonDictItem(dict, "tag", PyUnicode_FromString(getTag().c_str()));
+    SetPythonDictItem(dict, "time", PyLong_FromLong(getTime()));
+    SetPythonDictItem(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
+
+    npy_intp matDims[2] {(npy_intp)mMat.rows(), (npy_intp)mMat.cols()};
+    SetPythonDictItem(dict, "matrix", NumpyViewOfPayload(this, 2, matDims, NPY_FLOAT32, mMat.data()));
+    return dict;
 }
 DecoderMessage_ptr MatrixDecoderMessage::fromPython(PyObject* pMsg) {
-    GODEC_ERR << "MatrixDecoderMessage::fromPython not implemented yet";
-    return DecoderMessage_ptr();
+    GodecMessages_init_numpy();
+    std::string tag;
+    uint64_t time;
+    std::string descriptorString;
+    PythonGetDecoderMessageVals(pMsg, tag, time, descriptorString);
+
+    DecoderMessage_ptr outMsg = MatrixDecoderMessage::create(time, PythonGetMatrix(pMsg, "matrix"));
+    (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
+    return outMsg;
 }
 #endif
 
@@ -598,18 +715,18 @@ std::string NbestDecoderMessage::describeThyself() const {
 }
 
 DecoderMessage_ptr NbestDecoderMessage::create(uint64_t _time, std::vector<std::vector<std::string>> _text, std::vector<std::vector<uint64_t>> _words, std::vector<std::vector<uint64_t>> _alignment, std::vector<std::vector<float>> _confidences) {
-    NbestDecoderMessage* msg = new NbestDecoderMessage();
+    auto msg = NewPooledMessage<NbestDecoderMessage>();
     msg->setTime(_time);
-    msg->mWords = _words;
-    msg->mAlignment = _alignment;
-    msg->mText = _text;
-    msg->mConfidences = _confidences;
-    return DecoderMessage_ptr(msg);
+    msg->mWords = std::move(_words);
+    msg->mAlignment = std::move(_alignment);
+    msg->mText = std::move(_text);
+    msg->mConfidences = std::move(_confidences);
+    return msg;
 }
 
 
 
-DecoderMessage_ptr NbestDecoderMessage::clone()  const { return  DecoderMessage_ptr(new NbestDecoderMessage(*this)); }
+DecoderMessage_ptr NbestDecoderMessage::clone()  const { return NewPooledMessage<NbestDecoderMessage>(*this); }
 bool NbestDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose) {
     remainingMsg = msg;
     return true;
@@ -635,146 +752,225 @@ void NbestDecoderMessage::shiftInTime(int64_t deltaT) {
     }
 }
 
-jobject NbestToJniHelper(JNIEnv* env, const NbestDecoderMessage& msg) {
-    jclass NbestDecoderMessageClass = env->FindClass("com/bbn/godec/NbestDecoderMessage");
-    jclass NbestEntryClass = env->FindClass("com/bbn/godec/NbestEntry");
-    jclass StringClass = env->FindClass("java/lang/String");
-    jclass ArrayListClass = env->FindClass("java/util/ArrayList");
-
-    jmethodID nbestInit = env->GetMethodID(NbestDecoderMessageClass, "<init>", "(Ljava/lang/String;JLjava/util/ArrayList;)V");
-    jmethodID nbestEntryInit = env->GetMethodID(NbestEntryClass, "<init>", "([I[J[Ljava/lang/String;[F)V");
-    jmethodID arrayListInit = env->GetMethodID(ArrayListClass, "<init>", "()V");
-    jmethodID arrayListAdd = env->GetMethodID(ArrayListClass, "add", "(Ljava/lang/Object;)Z");
+void NbestDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeU64(mText.size());
+    for(size_t nbestIdx = 0; nbestIdx < mText.size(); nbestIdx++) {
+        writer.writeU64(mText[nbestIdx].size());
+        for(auto it = mText[nbestIdx].begin(); it != mText[nbestIdx].end(); it++) writer.writeString(*it);
+        writer.writeU64Block(mWords[nbestIdx].data(), mWords[nbestIdx].size());
+        writer.writeU64Block(mAlignment[nbestIdx].data(), mAlignment[nbestIdx].size());
+        writer.writeFloatBlock(mConfidences[nbestIdx].data(), mConfidences[nbestIdx].size());
+    }
+}
 
-    std::string tag = msg.getTag();
-    jlong time = msg.getTime();
+DecoderMessage_ptr NbestDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    uint64_t numEntries = reader.readU64();
+    std::vector<std::vector<std::string>> text;
+    std::vector<std::vector<uint64_t>> words;
+    std::vector<std::vector<uint64_t>> alignment;
+    std::vector<std::vector<float>> confidences;
+    for(uint64_t nbestIdx = 0; nbestIdx < numEntries; nbestIdx++) {
+        uint64_t numWords = reader.readU64();
+        std::vector<std::string> entryText;
+        for(uint64_t wordIdx = 0; wordIdx < numWords; wordIdx++) entryText.push_back(reader.readString());
+        text.push_back(std::move(entryText));
+        words.push_back(reader.readU64Vector());
+        alignment.push_back(reader.readU64Vector());
+        confidences.push_back(reader.readFloatVector());
+    }
+    return NbestDecoderMessage::create(time, std::move(text), std::move(words), std::move(alignment), std::move(confidences));
+}
 
-    env->PushLocalFrame(3); // jTag, jArrayListObject, retObj
-    jstring jTag = env->NewStringUTF(tag.c_str());
-    jobject jArrayListObject = env->NewObject(ArrayListClass, arrayListInit);
+jobject NbestToJniHelper(JNIEnv* env, const NbestDecoderMessage& msg) {
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 3); // jTag, jArrayListObject, retObj
+    jstring jTag = env->NewStringUTF(msg.getTag().c_str());
+    jobject jArrayListObject = env->NewObject(ids.mArrayList, ids.mArrayListInit, (jint)msg.mWords.size());
 
+    std::vector<jint> jWords;
+    std::vector<jlong> jAlignment;
     for (int entryIdx = 0; entryIdx < msg.mWords.size(); entryIdx++) {
         const std::vector<std::string>& text = msg.mText[entryIdx];
         const std::vector<uint64_t>& words = msg.mWords[entryIdx];
         const std::vector<uint64_t>& alignment = msg.mAlignment[entryIdx];
         const std::vector<float>& confidences = msg.mConfidences[entryIdx];
 
-        env->PushLocalFrame(4); // jWordsArray, jAlignmentArray, jConfidencesArray, jTextArray
+        JNILocalFrame entryFrame(env, 6); // jWordsArray, jAlignmentArray, jConfidencesArray, jTextArray, jWordString, jNbestEntryObject
 
         jintArray jWordsArray = env->NewIntArray((jsize)words.size());
         jlongArray jAlignmentArray = env->NewLongArray((jsize)alignment.size());
         jfloatArray jConfidencesArray = env->NewFloatArray((jsize)confidences.size());
-        jobjectArray jTextArray = env->NewObjectArray((jsize)text.size(), StringClass, NULL);
+        jobjectArray jTextArray = env->NewObjectArray((jsize)text.size(), ids.mString, NULL);
         if (words.size() > 0) {
-            env->SetIntArrayRegion(jWordsArray, 0, (jsize)words.size(), &(std::vector<jint>(words.begin(), words.end())[0]));
-            env->SetLongArrayRegion(jAlignmentArray, 0, (jsize)alignment.size(), &(std::vector<jlong>(alignment.begin(), alignment.end())[0]));
-            env->SetFloatArrayRegion(jConfidencesArray, 0, (jsize)confidences.size(), &confidences[0]);
-            for (int wordIdx = 0; wordIdx < words.size(); wordIdx++) {
-                env->SetObjectArrayElement(jTextArray, wordIdx, env->NewStringUTF(text[wordIdx].c_str()));
+            jWords.assign(words.begin(), words.end());
+            jAlignment.assign(alignment.begin(), alignment.end());
+            env->SetIntArrayRegion(jWordsArray, 0, (jsize)jWords.size(), jWords.data());
+            env->SetLongArrayRegion(jAlignmentArray, 0, (jsize)jAlignment.size(), jAlignment.data());
+            env->SetFloatArrayRegion(jConfidencesArray, 0, (jsize)confidences.size(), confidences.data());
+            for (int wordIdx = 0; wordIdx < text.size(); wordIdx++) {
+                jstring jWordString = env->NewStringUTF(text[wordIdx].c_str());
+                env->SetObjectArrayElement(jTextArray, wordIdx, jWordString);
+                env->DeleteLocalRef(jWordString);
             }
         }
 
-        jobject jNbestEntryObject = env->NewObject(NbestEntryClass, nbestEntryInit, jWordsArray, jAlignmentArray, jTextArray, jConfidencesArray);
-        env->CallBooleanMethod(jArrayListObject, arrayListAdd, jNbestEntryObject);
-
-        env->PopLocalFrame(NULL);
+        jobject jNbestEntryObject = env->NewObject(ids.mNbestEntry, ids.mNbestEntryInit, jWordsArray, jAlignmentArray, jTextArray, jConfidencesArray);
+        env->CallBooleanMethod(jArrayListObject, ids.mArrayListAdd, jNbestEntryObject);
     }
 
-    jobject retObj = env->NewObject(NbestDecoderMessageClass, nbestInit, jTag, time, jArrayListObject);
-    return env->PopLocalFrame(retObj);
+    jobject retObj = env->NewObject(ids.mNbestMsg, ids.mNbestMsgInit, jTag, (jlong)msg.getTime(), jArrayListObject);
+    return frame.release(retObj);
 }
 
 jobject NbestDecoderMessage::toJNI(JNIEnv* env) {
-    env->PushLocalFrame(2); // mainObject, tentativeObject
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 2); // mainObject, jDescriptor
     jobject mainObject = NbestToJniHelper(env, *this);
-    jclass DecoderMessageClass = env->FindClass("com/bbn/godec/DecoderMessage");
     jstring jDescriptor = env->NewStringUTF(getFullDescriptorString().c_str());
-    jmethodID jSetFullDescriptor = env->GetMethodID(DecoderMessageClass, "setFullDescriptorString", "(Ljava/lang/String;)V");
-    env->CallVoidMethod(mainObject, jSetFullDescriptor, jDescriptor);
-
-    return env->PopLocalFrame(mainObject);
-};
+    env->CallVoidMethod(mainObject, ids.mDecoderMessageSetFullDescriptor, jDescriptor);
+    return frame.release(mainObject);
+}
 
 void GetNbestEntryVals(JNIEnv* env, jobject jEntryObj, std::vector<std::string>& text, std::vector<uint64_t>& words, std::vector<uint64_t>& alignment, std::vector<float>& confidences) {
-    jclass NbestEntryClass = env->FindClass("com/bbn/godec/NbestEntry");
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 5); // The four arrays, plus one word string at a time
 
     // Words
-    jfieldID jWordsFieldId = env->GetFieldID(NbestEntryClass, "words", "[I");
-    jintArray jWordsArray = (jintArray)env->GetObjectField(jEntryObj, jWordsFieldId);
+    jintArray jWordsArray = (jintArray)env->GetObjectField(jEntryObj, ids.mNbestEntryWords);
     int jWordsArraySize = env->GetArrayLength(jWordsArray);
-    jint* jWordsArrayInts = env->GetIntArrayElements(jWordsArray, 0);
-    for (int idx = 0; idx < jWordsArraySize; idx++) words.push_back(jWordsArrayInts[idx]);
-    env->ReleaseIntArrayElements(jWordsArray, jWordsArrayInts, 0);
+    std::vector<jint> jWords(jWordsArraySize);
+    env->GetIntArrayRegion(jWordsArray, 0, jWordsArraySize, jWords.data());
+    words.assign(jWords.begin(), jWords.end());
 
     // Alignment
-    jfieldID jAlignmentFieldId = env->GetFieldID(NbestEntryClass, "alignment", "[J");
-    jlongArray jAlignmentArray = (jlongArray)env->GetObjectField(jEntryObj, jAlignmentFieldId);
-    jlong* jAlignmentArrayInts = env->GetLongArrayElements(jAlignmentArray, 0);
-    for (int idx = 0; idx < jWordsArraySize; idx++) alignment.push_back(jAlignmentArrayInts[idx]);
-    env->ReleaseLongArrayElements(jAlignmentArray, jAlignmentArrayInts, 0);
+    jlongArray jAlignmentArray = (jlongArray)env->GetObjectField(jEntryObj, ids.mNbestEntryAlignment);
+    alignment.resize(jWordsArraySize);
+    env->GetLongArrayRegion(jAlignmentArray, 0, jWordsArraySize, (jlong*)alignment.data());
 
     // Text
-    jfieldID jTextFieldId = env->GetFieldID(NbestEntryClass, "text", "[Ljava/lang/String;");
-    jobjectArray jTextArray = (jobjectArray)env->GetObjectField(jEntryObj, jTextFieldId);
+    jobjectArray jTextArray = (jobjectArray)env->GetObjectField(jEntryObj, ids.mNbestEntryText);
     for (int idx = 0; idx < jWordsArraySize; idx++) {
         jstring jTextArrayString = (jstring)env->GetObjectArrayElement(jTextArray, idx);
         const char* textChars = env->GetStringUTFChars(jTextArrayString, 0);
         text.push_back(textChars);
         env->ReleaseStringUTFChars(jTextArrayString, textChars);
+        env->DeleteLocalRef(jTextArrayString);
     }
 
     // Confidences
-    jfieldID jConfidencesFieldId = env->GetFieldID(NbestEntryClass, "wordConfidences", "[F");
-    jfloatArray jConfidencesArray = (jfloatArray)env->GetObjectField(jEntryObj, jConfidencesFieldId);
-    jfloat* jConfidencesArrayFloats = env->GetFloatArrayElements(jConfidencesArray, 0);
-    for (int idx = 0; idx < jWordsArraySize; idx++) confidences.push_back(jConfidencesArrayFloats[idx]);
-    env->ReleaseFloatArrayElements(jConfidencesArray, jConfidencesArrayFloats, 0);
+    jfloatArray jConfidencesArray = (jfloatArray)env->GetObjectField(jEntryObj, ids.mNbestEntryConfidences);
+    confidences.resize(jWordsArraySize);
+    env->GetFloatArrayRegion(jConfidencesArray, 0, jWordsArraySize, confidences.data());
 }
 
 DecoderMessage_ptr NbestDecoderMessage::fromJNI(JNIEnv* env, jobject jMsg) {
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 2); // jEntriesObj, one jEntryObj at a time
     std::string tag;
     uint64_t time;
     std::string descriptorString;
     JNIGetDecoderMessageVals(env, jMsg, tag, time, descriptorString);
 
-    jclass NbestDecoderMessageClass = env->FindClass("com/bbn/godec/NbestDecoderMessage");
-    jclass ArrayListClass = env->FindClass("java/util/ArrayList");
-
     std::vector<std::vector<std::string>> textV;
     std::vector<std::vector<uint64_t>> wordsV;
     std::vector<std::vector<uint64_t>> alignmentV;
     std::vector<std::vector<float>> confidencesV;
 
-    jfieldID jEntriesFieldId = env->GetFieldID(NbestDecoderMessageClass, "mEntries", "Ljava/util/ArrayList;");
-    jobject jEntriesObj = (jobject)env->GetObjectField(jMsg, jEntriesFieldId);
-    jmethodID jArraySizeMethodId = env->GetMethodID(ArrayListClass, "size", "()I");
-    jmethodID jArrayGetMethodId = env->GetMethodID(ArrayListClass, "get", "(I)Ljava/lang/Object;");
-    jint numEntries = env->CallIntMethod(jEntriesObj, jArraySizeMethodId);
+    jobject jEntriesObj = env->GetObjectField(jMsg, ids.mNbestMsgEntries);
+    jint numEntries = env->CallIntMethod(jEntriesObj, ids.mArrayListSize);
+    textV.resize(numEntries);
+    wordsV.resize(numEntries);
+    alignmentV.resize(numEntries);
+    confidencesV.resize(numEntries);
     for (int entryIdx = 0; entryIdx < numEntries; entryIdx++) {
-        jobject jEntryObj = env->CallObjectMethod(jEntriesObj, jArrayGetMethodId, entryIdx);
-        std::vector<std::string> text;
-        std::vector<uint64_t> words;
-        std::vector<uint64_t> alignment;
-        std::vector<float> confidences;
-        GetNbestEntryVals(env, jEntryObj, text, words, alignment, confidences);
-        textV.push_back(text);
-        wordsV.push_back(words);
-        alignmentV.push_back(alignment);
-        confidencesV.push_back(confidences);
+        jobject jEntryObj = env->CallObjectMethod(jEntriesObj, ids.mArrayListGet, entryIdx);
+        GetNbestEntryVals(env, jEntryObj, textV[entryIdx], wordsV[entryIdx], alignmentV[entryIdx], confidencesV[entryIdx]);
+        env->DeleteLocalRef(jEntryObj);
     }
-    DecoderMessage_ptr outMsg = NbestDecoderMessage::create(time, textV, wordsV, alignmentV, confidencesV);
+    DecoderMessage_ptr outMsg = NbestDecoderMessage::create(time, std::move(textV), std::move(wordsV), std::move(alignmentV), std::move(confidencesV));
     (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
     return outMsg;
 }
 
 #ifndef ANDROID
 PyObject* NbestDecoderMessage::toPython() {
-    GODEC_ERR << "NbestDecoderMessage::toPython not implemented yet";
-    return nullptr;
+    GodecMessages_init_numpy();
+    PyObject* dict = PyDict_New();
+
+    SetPythonDictItem(dict, "type", PyUnicode_FromString("NbestDecoderMessage"));
+    SetPythonDictItem(dict, "tag", PyUnicode_FromString(getTag().c_str()));
+    SetPythonDictItem(dict, "time", PyLong_FromLong(getTime()));
+    SetPythonDictItem(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
+
+    // One list element per Nbest entry, "text" as lists of strings, the rest as numpy views
+    PyObject* pText = PyList_New(mText.size());
+    for(int entryIdx = 0; entryIdx < mText.size(); entryIdx++) {
+        PyObject* pEntryText = PyList_New(mText[entryIdx].size());
+        for(int wordIdx = 0; wordIdx < mText[entryIdx].size(); wordIdx++) {
+            PyList_SetItem(pEntryText, wordIdx, PyUnicode_FromString(mText[entryIdx][wordIdx].c_str()));
+        }
+        PyList_SetItem(pText, entryIdx, pEntryText);
+    }
+    SetPythonDictItem(dict, "text", pText);
+
+    PyObject* pWords = PyList_New(mWords.size());
+    for(int entryIdx = 0; entryIdx < mWords.size(); entryIdx++) {
+        npy_intp dims[1] {(npy_intp)mWords[entryIdx].size()};
+        PyList_SetItem(pWords, entryIdx, NumpyViewOfPayload(this, 1, dims, NPY_UINT64, mWords[entryIdx].data()));
+    }
+    SetPythonDictItem(dict, "words", pWords);
+
+    PyObject* pAlignment = PyList_New(mAlignment.size());
+    for(int entryIdx = 0; entryIdx < mAlignment.size(); entryIdx++) {
+        npy_intp dims[1] {(npy_intp)mAlignment[entryIdx].size()};
+        PyList_SetItem(pAlignment, entryIdx, NumpyViewOfPayload(this, 1, dims, NPY_UINT64, mAlignment[entryIdx].data()));
+    }
+    SetPythonDictItem(dict, "alignment", pAlignment);
+
+    PyObject* pConfidences = PyList_New(mConfidences.size());
+    for(int entryIdx = 0; entryIdx < mConfidences.size(); entryIdx++) {
+        npy_intp dims[1] {(npy_intp)mConfidences[entryIdx].size()};
+        PyList_SetItem(pConfidences, entryIdx, NumpyViewOfPayload(this, 1, dims, NPY_FLOAT32, mConfidences[entryIdx].data()));
+    }
+    SetPythonDictItem(dict, "confidences", pConfidences);
+    return dict;
 }
 DecoderMessage_ptr NbestDecoderMessage::fromPython(PyObject* pMsg) {
-    GODEC_ERR << "NbestDecoderMessage::fromPython not implemented yet";
-    return DecoderMessage_ptr();
+    GodecMessages_init_numpy();
+    std::string tag;
+    uint64_t time;
+    std::string descriptorString;
+    PythonGetDecoderMessageVals(pMsg, tag, time, descriptorString);
+
+    PyObject* pText = PyDict_GetItemString(pMsg,"text");
+    PyObject* pWords = PyDict_GetItemString(pMsg,"words");
+    PyObject* pAlignment = PyDict_GetItemString(pMsg,"alignment");
+    PyObject* pConfidences = PyDict_GetItemString(pMsg,"confidences");
+    if (pText == nullptr || pWords == nullptr || pAlignment == nullptr || pConfidences == nullptr) GODEC_ERR << "Incoming Python message dict needs to contain fields 'text', 'words', 'alignment' and 'confidences'!";
+    if (!PyList_Check(pText) || !PyList_Check(pWords) || !PyList_Check(pAlignment) || !PyList_Check(pConfidences)) GODEC_ERR << "Incoming Python message fields 'text', 'words', 'alignment' and 'confidences' need to be lists with one element per Nbest entry!";
+    Py_ssize_t numEntries = PyList_Size(pText);
+    if (PyList_Size(pWords) != numEntries || PyList_Size(pAlignment) != numEntries || PyList_Size(pConfidences) != numEntries) GODEC_ERR << "Incoming Python message fields 'text', 'words', 'alignment' and 'confidences' have different numbers of Nbest entries!";
+
+    std::vector<std::vector<std::string>> textV(numEntries);
+    std::vector<std::vector<uint64_t>> wordsV(numEntries);
+    std::vector<std::vector<uint64_t>> alignmentV(numEntries);
+    std::vector<std::vector<float>> confidencesV(numEntries);
+    for(Py_ssize_t entryIdx = 0; entryIdx < numEntries; entryIdx++) {
+        PyObject* pEntryText = PyList_GetItem(pText, entryIdx);
+        if (!PyList_Check(pEntryText)) GODEC_ERR << "Incoming Python message, 'text' entry " << entryIdx << " is not a list of strings!";
+        for(Py_ssize_t wordIdx = 0; wordIdx < PyList_Size(pEntryText); wordIdx++) {
+            const char* word = PyUnicode_AsUTF8(PyList_GetItem(pEntryText, wordIdx));
+            if (word == NULL) { PyErr_Print(); GODEC_ERR << "Incoming Python message, 'text' entry " << entryIdx << " is not a list of strings!"; }
+            textV[entryIdx].push_back(word);
+        }
+        wordsV[entryIdx] = PythonGetStdVector<uint64_t>(PyList_GetItem(pWords, entryIdx), NPY_UINT64, "words");
+        alignmentV[entryIdx] = PythonGetStdVector<uint64_t>(PyList_GetItem(pAlignment, entryIdx), NPY_UINT64, "alignment");
+        confidencesV[entryIdx] = PythonGetStdVector<float>(PyList_GetItem(pConfidences, entryIdx), NPY_FLOAT32, "confidences");
+    }
+
+    DecoderMessage_ptr outMsg = NbestDecoderMessage::create(time, std::move(textV), std::move(wordsV), std::move(alignmentV), std::move(confidencesV));
+    (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
+    return outMsg;
 }
 #endif
 
@@ -790,14 +986,14 @@ std::string AudioInfoDecoderMessage::describeThyself() const {
 }
 
 DecoderMessage_ptr AudioInfoDecoderMessage::create(uint64_t time, float sampleRate, float ticksPerSample) {
-    AudioInfoDecoderMessage* msg = new AudioInfoDecoderMessage();
+    auto msg = NewPooledMessage<AudioInfoDecoderMessage>();
     msg->setTime(time);
     msg->mSampleRate = sampleRate;
     msg->mTicksPerSample = ticksPerSample;
-    return DecoderMessage_ptr(msg);
+    return msg;
 }
 
-DecoderMessage_ptr AudioInfoDecoderMessage::clone()  const { return  DecoderMessage_ptr(new AudioInfoDecoderMessage(*this)); }
+DecoderMessage_ptr AudioInfoDecoderMessage::clone()  const { return NewPooledMessage<AudioInfoDecoderMessage>(*this); }
 
 bool AudioInfoDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose) {
     auto mergeMsg = boost::static_pointer_cast<const AudioInfoDecoderMessage>(msg); 
@@ -829,6 +1025,17 @@ void AudioInfoDecoderMessage::shiftInTime(int64_t deltaT) {
     setTime((int64_t)getTime()+deltaT);
 }
 
+void AudioInfoDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeFloat(mSampleRate);
+    writer.writeFloat(mTicksPerSample);
+}
+
+DecoderMessage_ptr AudioInfoDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    float sampleRate = reader.readFloat();
+    float ticksPerSample = reader.readFloat();
+    return AudioInfoDecoderMessage::create(time, sampleRate, ticksPerSample);
+}
+
 jobject AudioInfoDecoderMessage::toJNI(JNIEnv* env) {
     GODEC_ERR << "AudioInfoDecoderMessage::toJNI not implemented yet!";
     return NULL;
@@ -841,13 +1048,30 @@ DecoderMessage_ptr AudioInfoDecoderMessage::fromJNI(JNIEnv* env, jobject jMsg) {
 
 #ifndef ANDROID
 PyObject* AudioInfoDecoderMessage::toPython() {
-    GODEC_ERR << "AudioInfoDecoderMessage::toPython not implemented yet!";
-    return NULL;
+    PyObject* dict = PyDict_New();
+
+    SetPythonDictItem(dict, "type", PyUnicode_FromString("AudioInfoDecoderMessage"));
+    SetPythonDictItem(dict, "tag", PyUnicode_FromString(getTag().c_str()));
+    SetPythonDictItem(dict, "sample_rate", PyFloat_FromDouble(mSampleRate));
+    SetPythonDictItem(dict, "ticks_per_sample", PyFloat_FromDouble(mTicksPerSample));
+    SetPythonDictItem(dict, "time", PyLong_FromLong(getTime()));
+    SetPythonDictItem(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
+    return dict;
 }
 DecoderMessage_ptr AudioInfoDecoderMessage::fromPython(PyObject* pMsg) {
-    GODEC_ERR << "AudioInfoDecoderMessage::fromPython not implemented yet!";
-    return NULL;
+    std::string tag;
+    uint64_t time;
+    std::string descriptorString;
+    PythonGetDecoderMessageVals(pMsg, tag, time, descriptorString);
+
+    PyObject* pSampleRate = PyDict_GetItemString(pMsg,"sample_rate");
+    if (pSampleRate == nullptr) GODEC_ERR << "Incoming Python message dict does not contain field 'sample_rate'!";
+    PyObject* pTicksPerSample = PyDict_GetItemString(pMsg,"ticks_per_sample");
+    if (pTicksPerSample == nullptr) GODEC_ERR << "Incoming Python message dict does not contain field 'ticks_per_sample'!";
 
+    DecoderMessage_ptr outMsg = AudioInfoDecoderMessage::create(time, PythonGetFloat(pSampleRate, "sample_rate"), PythonGetFloat(pTicksPerSample, "ticks_per_sample"));
+    (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
+    return outMsg;
 }
 #endif
 
@@ -864,19 +1088,19 @@ std::string ConversationStateDecoderMessage::describeThyself() const {
 }
 
 DecoderMessage_ptr ConversationStateDecoderMessage::create(uint64_t _time, std::string _utteranceId, bool _isLastChunkInUtt, std::string _convoId, bool _isLastChunkInConvo) {
-    ConversationStateDecoderMessage* msg = new ConversationStateDecoderMessage();
+    auto msg = NewPooledMessage<ConversationStateDecoderMessage>();
     msg->setTime(_time);
-    msg->mUtteranceId = _utteranceId;
+    msg->mUtteranceId = std::move(_utteranceId);
     msg->mLastChunkInUtt = _isLastChunkInUtt;
-    msg->mConvoId = _convoId;
+    msg->mConvoId = std::move(_convoId);
     msg->mLastChunkInConvo = _isLastChunkInConvo;
     if (_isLastChunkInConvo && !_isLastChunkInUtt) GODEC_ERR << "Trying to construct nonsensical ConversationStateDecoderMessage: isLastChunkInConvo=true but isLastChunkInUtt=false. Utterances can't carry over past conversations!";
-    return DecoderMessage_ptr(msg);
+    return msg;
 }
 
 
 
-DecoderMessage_ptr ConversationStateDecoderMessage::clone()  const { return  DecoderMessage_ptr(new ConversationStateDecoderMessage(*this)); }
+DecoderMessage_ptr ConversationStateDecoderMessage::clone()  const { return NewPooledMessage<ConversationStateDecoderMessage>(*this); }
 
 bool ConversationStateDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose) {
     auto mergeMsg = boost::static_pointer_cast<const ConversationStateDecoderMessage>(msg);
@@ -925,49 +1149,44 @@ void ConversationStateDecoderMessage::shiftInTime(int64_t deltaT) {
     setTime((int64_t)getTime()+deltaT);
 }
 
+void ConversationStateDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeString(mUtteranceId);
+    writer.writeBool(mLastChunkInUtt);
+    writer.writeString(mConvoId);
+    writer.writeBool(mLastChunkInConvo);
+}
+
+DecoderMessage_ptr ConversationStateDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    std::string uttId = reader.readString();
+    bool lastChunkInUtt = reader.readBool();
+    std::string convoId = reader.readString();
+    bool lastChunkInConvo = reader.readBool();
+    return ConversationStateDecoderMessage::create(time, uttId, lastChunkInUtt, convoId, lastChunkInConvo);
+}
+
 jobject ConversationStateDecoderMessage::toJNI(JNIEnv* env) {
-    env->PushLocalFrame(4); // jTag, jUttId, jConvoId, jConvoMsg
-    jclass ConvoDecoderMessageClass = env->FindClass("com/bbn/godec/ConversationStateDecoderMessage");
-    jclass DecoderMessageClass = env->FindClass("com/bbn/godec/DecoderMessage");
-    jmethodID jConvoMsgInit = env->GetMethodID(ConvoDecoderMessageClass, "<init>", "(Ljava/lang/String;JLjava/lang/String;ZLjava/lang/String;Z)V");
-    std::string tag = getTag();
-    jstring jTag = env->NewStringUTF(tag.c_str());
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 5); // jTag, jUttId, jConvoId, jConvoMsg, jDescriptor
+    jstring jTag = env->NewStringUTF(getTag().c_str());
     jstring jUttId = env->NewStringUTF(mUtteranceId.c_str());
     jstring jConvoId = env->NewStringUTF(mConvoId.c_str());
-    jlong jTime = getTime();
-    jobject jConvoMsg = env->NewObject(ConvoDecoderMessageClass, jConvoMsgInit, jTag, jTime, jUttId, mLastChunkInUtt, jConvoId, mLastChunkInConvo);
-
+    jobject jConvoMsg = env->NewObject(ids.mConvStateMsg, ids.mConvStateMsgInit, jTag, (jlong)getTime(), jUttId, (jboolean)mLastChunkInUtt, jConvoId, (jboolean)mLastChunkInConvo);
     jstring jDescriptor = env->NewStringUTF(getFullDescriptorString().c_str());
-    jmethodID jSetFullDescriptor = env->GetMethodID(DecoderMessageClass, "setFullDescriptorString", "(Ljava/lang/String;)V");
-    env->CallVoidMethod(jConvoMsg, jSetFullDescriptor, jDescriptor);
-    return env->PopLocalFrame(jConvoMsg);
-};
+    env->CallVoidMethod(jConvoMsg, ids.mDecoderMessageSetFullDescriptor, jDescriptor);
+    return frame.release(jConvoMsg);
+}
 
 DecoderMessage_ptr ConversationStateDecoderMessage::fromJNI(JNIEnv* env, jobject jMsg) {
+    const JNIIds& ids = GetJNIIds(env);
     std::string tag;
     uint64_t time;
     std::string descriptorString;
     JNIGetDecoderMessageVals(env, jMsg, tag, time, descriptorString);
 
-    jclass ConversationStateDecoderMessageClass = env->FindClass("com/bbn/godec/ConversationStateDecoderMessage");
-    jfieldID jUttFieldId = env->GetFieldID(ConversationStateDecoderMessageClass, "mUtteranceId", "Ljava/lang/String;");
-    jstring jUttIdObj = (jstring)env->GetObjectField(jMsg, jUttFieldId);
-    const char* uttIdChars = env->GetStringUTFChars(jUttIdObj, 0);
-    std::string uttId = uttIdChars;
-    env->ReleaseStringUTFChars(jUttIdObj, uttIdChars);
-
-    // utterance ID
-    jfieldID jConvoFieldId = env->GetFieldID(ConversationStateDecoderMessageClass, "mConvoId", "Ljava/lang/String;");
-    jstring jConvoObj = (jstring)env->GetObjectField(jMsg, jConvoFieldId);
-    const char* convoChars = env->GetStringUTFChars(jConvoObj, 0);
-    std::string convoId = convoChars;
-    env->ReleaseStringUTFChars(jConvoObj, convoChars);
-
-    // booleans
-    jfieldID jLastChunkInUttFieldId = env->GetFieldID(ConversationStateDecoderMessageClass, "mLastChunkInUtt", "Z");
-    jboolean isLastChunkInUtt = env->GetBooleanField(jMsg, jLastChunkInUttFieldId);
-    jfieldID jLastChunkInConvoFieldId = env->GetFieldID(ConversationStateDecoderMessageClass, "mLastChunkInConvo", "Z");
-    jboolean isLastChunkInConvo = env->GetBooleanField(jMsg, jLastChunkInConvoFieldId);
+    std::string uttId = JNIGetStringField(env, jMsg, ids.mConvStateMsgUtteranceId);
+    std::string convoId = JNIGetStringField(env, jMsg, ids.mConvStateMsgConvoId);
+    jboolean isLastChunkInUtt = env->GetBooleanField(jMsg, ids.mConvStateMsgLastChunkInUtt);
+    jboolean isLastChunkInConvo = env->GetBooleanField(jMsg, ids.mConvStateMsgLastChunkInConvo);
 
     DecoderMessage_ptr outMsg = ConversationStateDecoderMessage::create(time, uttId, isLastChunkInUtt, convoId, isLastChunkInConvo);
     (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
@@ -979,14 +1198,14 @@ PyObject* ConversationStateDecoderMessage::toPython() {
     GodecMessages_init_numpy();
     PyObject* dict = PyDict_New();
 
-    PyDict_SetItemString(dict, "type", PyUnicode_FromString("ConversationStateDecoderMessage"));
-    PyDict_SetItemString(dict, "tag", PyUnicode_FromString(getTag().c_str()));
-    PyDict_SetItemString(dict, "utterance_id", PyUnicode_FromString(mUtteranceId.c_str()));
-    PyDict_SetItemString(dict, "convo_id", PyUnicode_FromString(mConvoId.c_str()));
+    SetPythonDictItem(dict, "type", PyUnicode_FromString("ConversationStateDecoderMessage"));
+    SetPythonDictItem(dict, "tag", PyUnicode_FromString(getTag().c_str()));
+    SetPythonDictItem(dict, "utterance_id", PyUnicode_FromString(mUtteranceId.c_str()));
+    SetPythonDictItem(dict, "convo_id", PyUnicode_FromString(mConvoId.c_str()));
     PyDict_SetItemString(dict, "last_chunk_in_utt", mLastChunkInUtt ? Py_True : Py_False);
     PyDict_SetItemString(dict, "last_chunk_in_convo", mLastChunkInConvo ? Py_True : Py_False);
-    PyDict_SetItemString(dict, "time", PyLong_FromLong(getTime()));
-    PyDict_SetItemString(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
+    SetPythonDictItem(dict, "time", PyLong_FromLong(getTime()));
+    SetPythonDictItem(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
     return dict;
 }
 DecoderMessage_ptr ConversationStateDecoderMessage::fromPython(PyObject* pMsg) {
@@ -1028,16 +1247,16 @@ std::string BinaryDecoderMessage::describeThyself() const {
 }
 
 DecoderMessage_ptr BinaryDecoderMessage::create(uint64_t _time, std::vector<unsigned char> data, std::string format) {
-    BinaryDecoderMessage* msg = new BinaryDecoderMessage();
+    auto msg = NewPooledMessage<BinaryDecoderMessage>();
     msg->setTime(_time);
-    msg->mData = data;
-    msg->mFormat = format;
-    return DecoderMessage_ptr(msg);
+    msg->mData = std::move(data);
+    msg->mFormat = std::move(format);
+    return msg;
 }
 
 
 
-DecoderMessage_ptr BinaryDecoderMessage::clone()  const { return  DecoderMessage_ptr(new BinaryDecoderMessage(*this)); }
+DecoderMessage_ptr BinaryDecoderMessage::clone()  const { return NewPooledMessage<BinaryDecoderMessage>(*this); }
 bool BinaryDecoderMessage::mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose) {
     remainingMsg = msg;
     return true;
@@ -1058,47 +1277,44 @@ void BinaryDecoderMessage::shiftInTime(int64_t deltaT) {
     setTime((int64_t)getTime()+deltaT);
 }
 
+void BinaryDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeString(mFormat);
+    writer.writeBytes(mData.data(), mData.size());
+}
+
+DecoderMessage_ptr BinaryDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    std::string format = reader.readString();
+    return BinaryDecoderMessage::create(time, reader.readBytes(), std::move(format));
+}
+
 jobject BinaryDecoderMessage::toJNI(JNIEnv* env) {
-    jclass BinaryDecoderMessageClass = env->FindClass("com/bbn/godec/BinaryDecoderMessage");
-    jclass DecoderMessageClass = env->FindClass("com/bbn/godec/DecoderMessage");
-    jmethodID jBinaryMsgInit = env->GetMethodID(BinaryDecoderMessageClass, "<init>", "(Ljava/lang/String;J[BLjava/lang/String;)V");
-    std::string tag = getTag();
-    jstring jTag = env->NewStringUTF(tag.c_str());
-    jlong jTime = getTime();
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 5); // jTag, jDataArrayObj, jFormatString, jBinaryMsg, jDescriptor
+    jstring jTag = env->NewStringUTF(getTag().c_str());
     jbyteArray jDataArrayObj = env->NewByteArray((jsize)mData.size());
     env->SetByteArrayRegion(jDataArrayObj, 0, (jsize)mData.size(), (const jbyte*)mData.data());
     jstring jFormatString = env->NewStringUTF(mFormat.c_str());
-    jobject jAudioMsg = env->NewObject(BinaryDecoderMessageClass, jBinaryMsgInit, jTag, jTime, jDataArrayObj, jFormatString);
-
+    jobject jBinaryMsg = env->NewObject(ids.mBinaryMsg, ids.mBinaryMsgInit, jTag, (jlong)getTime(), jDataArrayObj, jFormatString);
     jstring jDescriptor = env->NewStringUTF(getFullDescriptorString().c_str());
-    jmethodID jSetFullDescriptor = env->GetMethodID(DecoderMessageClass, "setFullDescriptorString", "(Ljava/lang/String;)V");
-    env->CallVoidMethod(jAudioMsg, jSetFullDescriptor, jDescriptor);
-    return jAudioMsg;
-};
+    env->CallVoidMethod(jBinaryMsg, ids.mDecoderMessageSetFullDescriptor, jDescriptor);
+    return frame.release(jBinaryMsg);
+}
 
 DecoderMessage_ptr BinaryDecoderMessage::fromJNI(JNIEnv* env, jobject jMsg) {
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 1); // jDataArray
     std::string tag;
     uint64_t time;
     std::string descriptorString;
     JNIGetDecoderMessageVals(env, jMsg, tag, time, descriptorString);
 
-    jclass BinaryDecoderMessageClass = env->FindClass("com/bbn/godec/BinaryDecoderMessage");
-    jfieldID jDataFieldId = env->GetFieldID(BinaryDecoderMessageClass, "mData", "[B");
-    jobject jDataObj = env->GetObjectField(jMsg, jDataFieldId);
-    jbyteArray* jDataArray = reinterpret_cast<jbyteArray*>(&jDataObj);
-    jbyte* jData = env->GetByteArrayElements(*jDataArray, 0);
-    jint dataSize = env->GetArrayLength(*jDataArray);
+    jbyteArray jDataArray = (jbyteArray)env->GetObjectField(jMsg, ids.mBinaryMsgData);
+    jint dataSize = env->GetArrayLength(jDataArray);
     std::vector<unsigned char> dataVec(dataSize);
-    memcpy(&dataVec[0], jData, dataSize);
-    env->ReleaseByteArrayElements(*jDataArray, jData, 0);
-
-    jfieldID jFormatFieldId = env->GetFieldID(BinaryDecoderMessageClass, "mFormat", "Ljava/lang/String;");
-    jstring jFormatObj = (jstring)env->GetObjectField(jMsg, jFormatFieldId);
-    const char* formatChars = env->GetStringUTFChars(jFormatObj, 0);
-    std::string format = formatChars;
-    env->ReleaseStringUTFChars(jFormatObj, formatChars);
+    env->GetByteArrayRegion(jDataArray, 0, dataSize, (jbyte*)dataVec.data());
+    std::string format = JNIGetStringField(env, jMsg, ids.mBinaryMsgFormat);
 
-    DecoderMessage_ptr outMsg = BinaryDecoderMessage::create(time, dataVec, format);
+    DecoderMessage_ptr outMsg = BinaryDecoderMessage::create(time, std::move(dataVec), format);
     (boost::const_pointer_cast<DecoderMessage>(outMsg))->setFullDescriptorString(descriptorString);
     return outMsg;
 }
@@ -1122,35 +1338,32 @@ std::string JsonDecoderMessage::describeThyself() const {
 }
 
 DecoderMessage_ptr JsonDecoderMessage::clone() const {
-    return DecoderMessage_ptr(new JsonDecoderMessage(*this));
+    return NewPooledMessage<JsonDecoderMessage>(*this);
 }
 
 jobject JsonDecoderMessage::toJNI(JNIEnv *env) {
-    jclass JsonDecoderMessageClass = env->FindClass("com/bbn/godec/JsonDecoderMessage");
-    jmethodID msgInit = env->GetMethodID(JsonDecoderMessageClass, "<init>", "(Ljava/lang/String;JLjava/lang/String;)V");
-    std::string tag = getTag();
-    jlong time = getTime();
-    env->PushLocalFrame(3); // jTag, JJsonStr, retObj
-    jstring jTag = env->NewStringUTF(tag.c_str());
+    const JNIIds& ids = GetJNIIds(env);
+    JNILocalFrame frame(env, 3); // jTag, jJsonString, retObj
+    jstring jTag = env->NewStringUTF(getTag().c_str());
     jstring jJsonString = env->NewStringUTF(mJson.dump().c_str());
-    jobject retObj = env->NewObject(JsonDecoderMessageClass, msgInit, jTag, time, jJsonString);
-    return env->PopLocalFrame(retObj);
+    jobject retObj = env->NewObject(ids.mJsonMsg, ids.mJsonMsgInit, jTag, (jlong)getTime(), jJsonString);
+    return frame.release(retObj);
 }
 
 DecoderMessage_ptr JsonDecoderMessage::fromJNI(JNIEnv* env, jobject jMsg) {
-    jclass JsonDecoderMessageClass = env->FindClass("com/bbn/godec/JsonDecoderMessage");
-    jmethodID jtoStringId = env->GetMethodID(JsonDecoderMessageClass, "toString", "()Ljava/lang/String;");
-    jstring jJsonString = (jstring)env->CallObjectMethod(jMsg, jtoStringId);
+    const JNIIds& ids = GetJNIIds(env);
+    jstring jJsonString = (jstring)env->CallObjectMethod(jMsg, ids.mJsonMsgToString);
     const char* jsonChars = env->GetStringUTFChars(jJsonString, 0);
     std::string jsonString = jsonChars;
     env->ReleaseStringUTFChars(jJsonString, jsonChars);
+    env->DeleteLocalRef(jJsonString);
 
     std::string tag;
     uint64_t time;
     std::string descriptorString;
     JNIGetDecoderMessageVals(env, jMsg, tag, time, descriptorString);
     json j = json::parse(jsonString);
-    return JsonDecoderMessage::create(time, j);
+    return JsonDecoderMessage::create(time, std::move(j));
 }
 
 #ifndef ANDROID
@@ -1158,11 +1371,11 @@ PyObject* JsonDecoderMessage::toPython() {
     GodecMessages_init_numpy();
     PyObject* dict = PyDict_New();
 
-    PyDict_SetItemString(dict, "type", PyUnicode_FromString("JsonDecoderMessage"));
-    PyDict_SetItemString(dict, "tag", PyUnicode_FromString(getTag().c_str()));
-    PyDict_SetItemString(dict, "time", PyLong_FromLong(getTime()));
-    PyDict_SetItemString(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
-    PyDict_SetItemString(dict, "json", PyUnicode_FromString(mJson.dump().c_str()));
+    SetPythonDictItem(dict, "type", PyUnicode_FromString("JsonDecoderMessage"));
+    SetPythonDictItem(dict, "tag", PyUnicode_FromString(getTag().c_str()));
+    SetPythonDictItem(dict, "time", PyLong_FromLong(getTime()));
+    SetPythonDictItem(dict, "descriptor", PyUnicode_FromString(getFullDescriptorString().c_str()));
+    SetPythonDictItem(dict, "json", PyUnicode_FromString(mJson.dump().c_str()));
     return dict;
 }
 
@@ -1205,6 +1418,14 @@ void JsonDecoderMessage::shiftInTime(int64_t deltaT) {
     setTime((int64_t)getTime()+deltaT);
 }
 
+void JsonDecoderMessage::toWire(WireWriter& writer) const {
+    writer.writeString(mJson.dump());
+}
+
+DecoderMessage_ptr JsonDecoderMessage::fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    return JsonDecoderMessage::create(time, json::parse(reader.readString()));
+}
+
 bool JsonDecoderMessage::canSliceAt(uint64_t sliceTime,
                                     std::vector<DecoderMessage_ptr> &streamList,
                                     uint64_t streamStartOffset,
@@ -1212,13 +1433,67 @@ bool JsonDecoderMessage::canSliceAt(uint64_t sliceTime,
     return streamList[0]->getTime() == sliceTime;
 }
 
-DecoderMessage_ptr JsonDecoderMessage::create(uint64_t time, json &jsonObj) {
-    JsonDecoderMessage* msg = new JsonDecoderMessage();
+DecoderMessage_ptr JsonDecoderMessage::create(uint64_t time, const json &jsonObj) {
+    auto msg = NewPooledMessage<JsonDecoderMessage>();
     msg->setTime(time);
     msg->mJson = jsonObj;
 
-    return DecoderMessage_ptr(msg);
+    return msg;
 }
 
+DecoderMessage_ptr JsonDecoderMessage::create(uint64_t time, json &&jsonObj) {
+    auto msg = NewPooledMessage<JsonDecoderMessage>();
+    msg->setTime(time);
+    msg->mJson = std::move(jsonObj);
+
+    return msg;
+}
+
+std::vector<GodecMessageConverter> GetCoreMessageConverters() {
+    std::vector<GodecMessageConverter> converters;
+    auto addJava = [&](std::string javaClass, GodecJNIToMsgFunc fromJNI) {
+        GodecMessageConverter converter;
+        converter.mJavaClass = javaClass;
+        converter.mFromJNI = fromJNI;
+        converters.push_back(converter);
+    };
+    addJava("com.bbn.godec.AudioDecoderMessage", &AudioDecoderMessage::fromJNI);
+    addJava("com.bbn.godec.ConversationStateDecoderMessage", &ConversationStateDecoderMessage::fromJNI);
+    addJava("com.bbn.godec.NbestDecoderMessage", &NbestDecoderMessage::fromJNI);
+    addJava("com.bbn.godec.BinaryDecoderMessage", &BinaryDecoderMessage::fromJNI);
+    addJava("com.bbn.godec.FeaturesDecoderMessage", &FeaturesDecoderMessage::fromJNI);
+    addJava("com.bbn.godec.JsonDecoderMessage", &JsonDecoderMessage::fromJNI);
+#ifndef ANDROID
+    auto addPython = [&](std::string pythonType, GodecPythonToMsgFunc fromPython) {
+        GodecMessageConverter converter;
+        converter.mPythonType = pythonType;
+        converter.mFromPython = fromPython;
+        converters.push_back(converter);
+    };
+    addPython("AudioDecoderMessage", &AudioDecoderMessage::fromPython);
+    addPython("ConversationStateDecoderMessage", &ConversationStateDecoderMessage::fromPython);
+    addPython("NbestDecoderMessage", &NbestDecoderMessage::fromPython);
+    addPython("BinaryDecoderMessage", &BinaryDecoderMessage::fromPython);
+    addPython("FeaturesDecoderMessage", &FeaturesDecoderMessage::fromPython);
+    addPython("JsonDecoderMessage", &JsonDecoderMessage::fromPython);
+    addPython("MatrixDecoderMessage", &MatrixDecoderMessage::fromPython);
+    addPython("AudioInfoDecoderMessage", &AudioInfoDecoderMessage::fromPython);
+#endif
+    auto addWire = [&](uuid wireType, GodecWireToMsgFunc fromWire) {
+        GodecMessageConverter converter;
+        converter.mWireType = wireType;
+        converter.mFromWire = fromWire;
+        converters.push_back(converter);
+    };
+    addWire(UUID_AudioDecoderMessage, &AudioDecoderMessage::fromWire);
+    addWire(UUID_AudioInfoDecoderMessage, &AudioInfoDecoderMessage::fromWire);
+    addWire(UUID_ConversationStateDecoderMessage, &ConversationStateDecoderMessage::fromWire);
+    addWire(UUID_NbestDecoderMessage, &NbestDecoderMessage::fromWire);
+    addWire(UUID_BinaryDecoderMessage, &BinaryDecoderMessage::fromWire);
+    addWire(UUID_FeaturesDecoderMessage, &FeaturesDecoderMessage::fromWire);
+    addWire(UUID_MatrixDecoderMessage, &MatrixDecoderMessage::fromWire);
+    addWire(UUID_JsonDecoderMessage, &JsonDecoderMessage::fromWire);
+    return converters;
 }
 
+}
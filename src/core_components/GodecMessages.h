@@ -11,6 +11,8 @@
 #include <boost/uuid/string_generator.hpp>
 #include <godec/TimeStream.h>
 #include <godec/ChannelMessenger.h>
+#include <godec/WireFormat.h>
+#include <godec/ComponentGraph.h>
 #include <jni.h>
 #undef PAGE_SIZE
 #undef PAGE_MASK
@@ -38,20 +40,28 @@ enum ProcessingMode {
 
 ProcessingMode StringToProcessMode(std::string s);
 
+// Java, Python and wire format converters for the message types below, what libgodec_core hands out through GodecGetMessageConverters()
+std::vector<GodecMessageConverter> GetCoreMessageConverters();
+
 class AudioDecoderMessage : public DecoderMessage {
   public:
     Vector mAudio;
     float mSampleRate;
     float mTicksPerSample;
 
+    ~AudioDecoderMessage();
     std::string describeThyself() const;
     DecoderMessage_ptr clone() const;
     static DecoderMessage_ptr create(uint64_t time, const float* audioData, unsigned int numSamples, float sampleRate, float ticksPerSample);
+    static DecoderMessage_ptr create(uint64_t time, Vector&& audio, float sampleRate, float ticksPerSample);
     bool mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose);
     bool canSliceAt(uint64_t sliceTime, std::vector<DecoderMessage_ptr>& msgList, uint64_t streamStartOffset, bool verbose);
     bool sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sliceMsg, std::vector<DecoderMessage_ptr>& msgList, int64_t streamStartOffset, bool verbose);
     void shiftInTime(int64_t deltaT);
+    void toWire(WireWriter& writer) const;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
     jobject toJNI(JNIEnv* env);
+    jobject toJNIWithBuffer(JNIEnv* env, jobject directBuffer);
     static DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg);
 #ifndef ANDROID
     PyObject* toPython();
@@ -85,6 +95,8 @@ class AudioInfoDecoderMessage : public DecoderMessage {
     bool canSliceAt(uint64_t sliceTime, std::vector<DecoderMessage_ptr>& msgList, uint64_t streamStartOffset, bool verbose);
     bool sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sliceMsg, std::vector<DecoderMessage_ptr>& msgList, int64_t streamStartOffset, bool verbose);
     void shiftInTime(int64_t deltaT);
+    void toWire(WireWriter& writer) const;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
     jobject toJNI(JNIEnv* env);
     static DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg);
 #ifndef ANDROID
@@ -112,15 +124,21 @@ class FeaturesDecoderMessage : public DecoderMessage {
     std::string mFeatureNames;
     std::string mUtteranceId; // This is only here so that don't merge on utterance boundaries in the stream
 
+    ~FeaturesDecoderMessage();
     std::string describeThyself() const;
     DecoderMessage_ptr clone() const;
 
-    static DecoderMessage_ptr create(uint64_t time, std::string utteranceId, Matrix feats, std::string featureNames, std::vector<uint64_t> _featureTimestamps);
+    // The rvalue versions take over the passed-in buffers, use them (with std::move) when the payload was built for the message anyway
+    static DecoderMessage_ptr create(uint64_t time, std::string utteranceId, const Matrix& feats, std::string featureNames, std::vector<uint64_t> _featureTimestamps);
+    static DecoderMessage_ptr create(uint64_t time, std::string utteranceId, Matrix&& feats, std::string featureNames, std::vector<uint64_t> _featureTimestamps);
     bool mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose);
     bool canSliceAt(uint64_t sliceTime, std::vector<DecoderMessage_ptr>& msgList, uint64_t streamStartOffset, bool verbose);
     bool sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sliceMsg, std::vector<DecoderMessage_ptr>& msgList, int64_t streamStartOffset, bool verbose);
     void shiftInTime(int64_t deltaT);
+    void toWire(WireWriter& writer) const;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
     jobject toJNI(JNIEnv* env);
+    jobject toJNIWithBuffer(JNIEnv* env, jobject directBuffer);
     static DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg);
 #ifndef ANDROID
     PyObject* toPython();
@@ -146,14 +164,18 @@ class MatrixDecoderMessage : public DecoderMessage {
   public:
     Matrix mMat;
 
+    ~MatrixDecoderMessage();
     std::string describeThyself() const;
     DecoderMessage_ptr clone() const;
 
-    static DecoderMessage_ptr create(uint64_t time, Matrix mat);
+    static DecoderMessage_ptr create(uint64_t time, const Matrix& mat);
+    static DecoderMessage_ptr create(uint64_t time, Matrix&& mat);
     bool mergeWith(DecoderMessage_ptr msg, DecoderMessage_ptr &remainingMsg, bool verbose);
     bool canSliceAt(uint64_t sliceTime, std::vector<DecoderMessage_ptr>& msgList, uint64_t streamStartOffset, bool verbose);
     bool sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sliceMsg, std::vector<DecoderMessage_ptr>& msgList, int64_t streamStartOffset, bool verbose);
     void shiftInTime(int64_t deltaT);
+    void toWire(WireWriter& writer) const;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
     jobject toJNI(JNIEnv* env);
 #ifndef ANDROID
     PyObject* toPython();
@@ -187,6 +209,8 @@ class NbestDecoderMessage : public DecoderMessage {
     bool canSliceAt(uint64_t sliceTime, std::vector<DecoderMessage_ptr>& msgList, uint64_t streamStartOffset, bool verbose);
     bool sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sliceMsg, std::vector<DecoderMessage_ptr>& msgList, int64_t streamStartOffset, bool verbose);
     void shiftInTime(int64_t deltaT);
+    void toWire(WireWriter& writer) const;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
     jobject toJNI(JNIEnv* env);
     static DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg);
 #ifndef ANDROID
@@ -224,6 +248,8 @@ class ConversationStateDecoderMessage : public DecoderMessage {
     bool canSliceAt(uint64_t sliceTime, std::vector<DecoderMessage_ptr>& msgList, uint64_t streamStartOffset, bool verbose);
     bool sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sliceMsg, std::vector<DecoderMessage_ptr>& msgList, int64_t streamStartOffset, bool verbose);
     void shiftInTime(int64_t deltaT);
+    void toWire(WireWriter& writer) const;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
     jobject toJNI(JNIEnv* env);
     static DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg);
 #ifndef ANDROID
@@ -259,6 +285,8 @@ class BinaryDecoderMessage : public DecoderMessage {
     bool canSliceAt(uint64_t sliceTime, std::vector<DecoderMessage_ptr>& msgList, uint64_t streamStartOffset, bool verbose);
     bool sliceOut(uint64_t sliceTime, DecoderMessage_ptr& sliceMsg, std::vector<DecoderMessage_ptr>& msgList, int64_t streamStartOffset, bool verbose);
     void shiftInTime(int64_t deltaT);
+    void toWire(WireWriter& writer) const;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
     jobject toJNI(JNIEnv* env);
     static DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg);
 #ifndef ANDROID
@@ -295,6 +323,8 @@ class JsonDecoderMessage : public DecoderMessage {
 
     jobject toJNI(JNIEnv *env) override;
     static DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg);
+    void toWire(WireWriter& writer) const override;
+    static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time);
 #ifndef ANDROID
     PyObject* toPython();
     static DecoderMessage_ptr fromPython(PyObject* pMsg);
@@ -313,9 +343,10 @@ class JsonDecoderMessage : public DecoderMessage {
     void shiftInTime(int64_t deltaT);
     uuid getUUID() const override { return UUID_JsonDecoderMessage; };
     static uuid getUUIDStatic() { return UUID_JsonDecoderMessage; };
-    json getJsonObj() const { return mJson; }
+    const json& getJsonObj() const { return mJson; }
     void setJsonObj(const json& rhs) { mJson = rhs; }
-    static DecoderMessage_ptr create(uint64_t time, json& jsonObj);
+    static DecoderMessage_ptr create(uint64_t time, const json& jsonObj);
+    static DecoderMessage_ptr create(uint64_t time, json&& jsonObj);
 
   private:
     json mJson;
@@ -0,0 +1,319 @@
+#include "Ipc.h"
+#include <boost/chrono.hpp>
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+#include <unistd.h>
+#include <poll.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <boost/filesystem.hpp>
+
+extern char** environ;
+
+namespace Godec {
+
+bool WriteToSocket(int fd, const void* data, size_t size) {
+    const char* ptr = (const char*)data;
+    while (size > 0) {
+        ssize_t written = send(fd, ptr, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        ptr += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool ReadFromSocket(int fd, void* data, size_t size) {
+    char* ptr = (char*)data;
+    while (size > 0) {
+        ssize_t numRead = read(fd, ptr, size);
+        if (numRead < 0 && errno == EINTR) continue;
+        if (numRead <= 0) return false;
+        ptr += numRead;
+        size -= numRead;
+    }
+    return true;
+}
+
+bool WriteVectorToSocket(int fd, struct iovec* iov, size_t iovCount) {
+    while (iovCount > 0) {
+        struct msghdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = iov;
+        hdr.msg_iovlen = std::min(iovCount, (size_t)IOV_MAX);
+        ssize_t written = sendmsg(fd, &hdr, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        // Skip what went out, the last piece might only be partially sent
+        while (iovCount > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovCount--;
+        }
+        if (written > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+bool SocketReadable(int fd) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) > 0;
+}
+
+/*
+############ Worker processes ###################
+*/
+
+static std::string FindGodecExecutable() {
+    Dl_info info;
+    if (dladdr((void*)&SpawnWorkerProcess, &info) != 0 && info.dli_fname != NULL) {
+        // The libraries get installed into bin/<platform>, the executable into bin
+        boost::filesystem::path libDir = boost::filesystem::absolute(info.dli_fname).parent_path();
+        if (boost::filesystem::exists(libDir / "godec")) return (libDir / "godec").string();
+        if (boost::filesystem::exists(libDir.parent_path() / "godec")) return (libDir.parent_path() / "godec").string();
+    }
+    const char* installDir = getenv("GODEC_INSTALL_DIR");
+    if (installDir != NULL) {
+        boost::filesystem::path candidate = boost::filesystem::path(installDir) / "bin" / "godec";
+        if (boost::filesystem::exists(candidate)) return candidate.string();
+    }
+    return "godec";
+}
+
+pid_t SpawnWorkerProcess(const std::string& kind, const std::string& config, const std::vector<int>& fds) {
+    static const std::string godecExecutable = FindGodecExecutable();
+    // dup2() in the file actions runs in order, so first move the descriptors out of the way of the target numbers
+    std::vector<int> highFds;
+    for(auto it = fds.begin(); it != fds.end(); it++) {
+        int highFd = fcntl(*it, F_DUPFD_CLOEXEC, WorkerFd((int)fds.size()));
+        if (highFd < 0) GODEC_ERR << "Could not duplicate file descriptor for worker process: " << strerror(errno);
+        highFds.push_back(highFd);
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for(size_t idx = 0; idx < highFds.size(); idx++) posix_spawn_file_actions_adddup2(&actions, highFds[idx], WorkerFd((int)idx));
+    std::vector<char*> argv;
+    argv.push_back((char*)godecExecutable.c_str());
+    argv.push_back((char*)"_worker");
+    argv.push_back((char*)kind.c_str());
+    argv.push_back((char*)config.c_str());
+    argv.push_back(NULL);
+    pid_t pid;
+    int res = posix_spawnp(&pid, godecExecutable.c_str(), &actions, NULL, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    for(auto it = highFds.begin(); it != highFds.end(); it++) close(*it);
+    if (res != 0) GODEC_ERR << "Could not start worker process '" << godecExecutable << "': " << strerror(res);
+    return pid;
+}
+
+int ReapWorkerProcess(pid_t pid, float timeoutSec) {
+    auto deadline = boost::chrono::steady_clock::now() + boost::chrono::duration<float>(timeoutSec);
+    int status = 0;
+    while (true) {
+        pid_t res = waitpid(pid, &status, WNOHANG);
+        if (res == pid || (res < 0 && errno != EINTR)) return status;
+        if (boost::chrono::steady_clock::now() >= deadline) break;
+        usleep(10000);
+    }
+    GODEC_INFO << "Worker process " << pid << " did not exit within " << timeoutSec << "s, killing it" << std::endl;
+    kill(pid, SIGKILL);
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return status;
+}
+
+/*
+############ Shared memory ring ###################
+*/
+
+// Positions only ever grow, the offset into the ring is the position modulo the capacity. Each side's fields sit on their own cache line
+struct SharedMemoryRing::Header {
+    alignas(64) std::atomic<uint64_t> mWritePos;
+    alignas(64) std::atomic<uint64_t> mReadPos;
+    alignas(64) std::atomic<uint32_t> mDataSeq; // Bumped for every pushed record, the reader sleeps on it
+    std::atomic<uint32_t> mReaderWaiting;
+    alignas(64) std::atomic<uint32_t> mSpaceSeq; // Bumped for every released record, the writer sleeps on it
+    std::atomic<uint32_t> mWriterWaiting;
+    alignas(64) std::atomic<uint32_t> mInterrupted;
+};
+
+static const uint64_t RingWrapMarker = UINT64_MAX;
+static const int RingSpinIterations = 2000;
+
+static size_t RingAlign(size_t size) {
+    return (size + 15) & ~(size_t)15;
+}
+
+static void FutexWait(std::atomic<uint32_t>& word, uint32_t expected, float timeoutSec) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)timeoutSec;
+    ts.tv_nsec = (long)((timeoutSec - ts.tv_sec) * 1e9);
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, expected, &ts, NULL, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+SharedMemoryRing::SharedMemoryRing() : mHeader(nullptr), mData(nullptr), mCapacity(0), mMappedSize(0), mFd(-1), mPendingRelease(0) {}
+
+SharedMemoryRing::~SharedMemoryRing() {
+    if (mHeader != nullptr) munmap(mHeader, mMappedSize);
+    if (mFd >= 0) close(mFd);
+}
+
+void SharedMemoryRing::create(const std::string& name, size_t capacity) {
+    mCapacity = RingAlign(capacity);
+    size_t headerSize = RingAlign(sizeof(Header));
+    mMappedSize = headerSize + mCapacity;
+    mFd = memfd_create(name.c_str(), MFD_CLOEXEC);
+    if (mFd < 0) GODEC_ERR << "Could not create shared memory for " << name << ": " << strerror(errno);
+    if (ftruncate(mFd, mMappedSize) != 0) GODEC_ERR << "Could not size shared memory for " << name << " to " << mMappedSize << " bytes: " << strerror(errno);
+    void* mem = mmap(NULL, mMappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (mem == MAP_FAILED) GODEC_ERR << "Could not map " << mMappedSize << " bytes of shared memory for " << name << ": " << strerror(errno);
+    mHeader = new (mem) Header();
+    mData = (char*)mem + headerSize;
+    reset();
+}
+
+void SharedMemoryRing::attach(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) GODEC_ERR << "Could not query shared memory ring: " << strerror(errno);
+    size_t headerSize = RingAlign(sizeof(Header));
+    if ((size_t)st.st_size <= headerSize) GODEC_ERR << "Shared memory ring of " << st.st_size << " bytes is too small";
+    mFd = fd;
+    mMappedSize = st.st_size;
+    mCapacity = mMappedSize - headerSize;
+    void* mem = mmap(NULL, mMappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (mem == MAP_FAILED) GODEC_ERR << "Could not map " << mMappedSize << " bytes of shared memory ring: " << strerror(errno);
+    mHeader = (Header*)mem;
+    mData = (char*)mem + headerSize;
+}
+
+void SharedMemoryRing::reset() {
+    mHeader->mWritePos = 0;
+    mHeader->mReadPos = 0;
+    mHeader->mReaderWaiting = 0;
+    mHeader->mWriterWaiting = 0;
+    mHeader->mInterrupted = 0;
+    mPendingRelease = 0;
+}
+
+void SharedMemoryRing::interrupt() {
+    mHeader->mInterrupted = 1;
+    mHeader->mDataSeq++;
+    mHeader->mSpaceSeq++;
+    FutexWake(mHeader->mDataSeq);
+    FutexWake(mHeader->mSpaceSeq);
+}
+
+bool SharedMemoryRing::isInterrupted() {
+    return mHeader->mInterrupted != 0;
+}
+
+// The "waiting" flag and the positions are all sequentially consistent, so either the waiter sees the new position, or the other side sees the flag and wakes it.
+// The futex itself only goes to sleep if the sequence number hasn't moved since it was read
+template<typename Cond>
+bool SharedMemoryRing::waitFor(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting, Cond cond, float timeoutSec) {
+    for (int spin = 0; spin < RingSpinIterations; spin++) {
+        if (isInterrupted()) return false;
+        if (cond()) return true;
+    }
+    auto deadline = boost::chrono::steady_clock::now() + boost::chrono::duration<float>(std::min(timeoutSec, 60.0f * 60 * 24 * 365));
+    while (true) {
+        uint32_t seqVal = seq;
+        waiting = 1;
+        if (cond()) {
+            waiting = 0;
+            return true;
+        }
+        boost::chrono::duration<float> remaining = deadline - boost::chrono::steady_clock::now();
+        if (isInterrupted() || remaining.count() <= 0.0f) {
+            waiting = 0;
+            return false;
+        }
+        FutexWait(seq, seqVal, std::min(remaining.count(), 1.0f));
+        waiting = 0;
+    }
+}
+
+bool SharedMemoryRing::push(const char* data, size_t size, float timeoutSec) {
+    struct iovec piece;
+    piece.iov_base = (void*)data;
+    piece.iov_len = size;
+    return push(&piece, 1, timeoutSec);
+}
+
+bool SharedMemoryRing::push(const struct iovec* pieces, size_t pieceCount, float timeoutSec) {
+    size_t size = 0;
+    for (size_t idx = 0; idx < pieceCount; idx++) size += pieces[idx].iov_len;
+    if (size > maxRecordSize()) GODEC_ERR << "Record of " << size << " bytes does not fit into a shared memory ring of " << mCapacity << " bytes";
+    size_t recordSize = RecordHeaderSize + RingAlign(size);
+    uint64_t writePos = mHeader->mWritePos;
+    size_t offset = writePos % mCapacity;
+    size_t skip = (mCapacity - offset < recordSize) ? mCapacity - offset : 0;
+    if (!waitFor(mHeader->mSpaceSeq, mHeader->mWriterWaiting, [&]() { return mCapacity - (writePos - mHeader->mReadPos) >= skip + recordSize; }, timeoutSec)) return false;
+
+    if (skip > 0) {
+        memcpy(mData + offset, &RingWrapMarker, sizeof(uint64_t));
+        offset = 0;
+    }
+    uint64_t size64 = size;
+    memcpy(mData + offset, &size64, sizeof(uint64_t));
+    // A record never wraps around, so the pieces go in back to back
+    char* dest = mData + offset + RecordHeaderSize;
+    for (size_t idx = 0; idx < pieceCount; idx++) {
+        memcpy(dest, pieces[idx].iov_base, pieces[idx].iov_len);
+        dest += pieces[idx].iov_len;
+    }
+    mHeader->mWritePos = writePos + skip + recordSize;
+    mHeader->mDataSeq++;
+    if (mHeader->mReaderWaiting) FutexWake(mHeader->mDataSeq);
+    return true;
+}
+
+bool SharedMemoryRing::peek(const char*& data, size_t& size, float timeoutSec) {
+    while (true) {
+        uint64_t readPos = mHeader->mReadPos;
+        if (!waitFor(mHeader->mDataSeq, mHeader->mReaderWaiting, [&]() { return mHeader->mWritePos != readPos; }, timeoutSec)) return false;
+        size_t offset = readPos % mCapacity;
+        uint64_t size64;
+        memcpy(&size64, mData + offset, sizeof(uint64_t));
+        if (size64 == RingWrapMarker) {
+            mHeader->mReadPos = readPos + (mCapacity - offset);
+            continue;
+        }
+        data = mData + offset + RecordHeaderSize;
+        size = size64;
+        mPendingRelease = RecordHeaderSize + RingAlign(size);
+        return true;
+    }
+}
+
+void SharedMemoryRing::release() {
+    mHeader->mReadPos = mHeader->mReadPos + mPendingRelease;
+    mPendingRelease = 0;
+    mHeader->mSpaceSeq++;
+    if (mHeader->mWriterWaiting) FutexWake(mHeader->mSpaceSeq);
+}
+
+}
+#endif
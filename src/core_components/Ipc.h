@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <float.h>
+#include <godec/HelperFuncs.h>
+
+struct iovec;
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+namespace Godec {
+
+// Write/read exactly "size" bytes, false if the other side went away
+bool WriteToSocket(int fd, const void* data, size_t size);
+bool ReadFromSocket(int fd, void* data, size_t size);
+// Writes all pieces with as few sendmsg() calls as possible, false if the other side went away. Modifies the iovec array
+bool WriteVectorToSocket(int fd, struct iovec* iov, size_t iovCount);
+// Whether a read on the socket would not block (data or EOF pending)
+bool SocketReadable(int fd);
+
+// Starts "godec _worker <kind> <config>" as a new process, with the given file descriptors showing up in it as WorkerFd(0), WorkerFd(1), ... (everything else created by Godec is close-on-exec).
+// The worker is a fresh exec of the godec executable (the one next to the Godec libraries, then $GODEC_INSTALL_DIR/bin, then the PATH), not a fork() of this process, so it doesn't inherit locks held by other threads at the time
+pid_t SpawnWorkerProcess(const std::string& kind, const std::string& config, const std::vector<int>& fds);
+inline int WorkerFd(int idx) { return 3 + idx; }
+// Waits for the process to exit, and kills it with SIGKILL if it hasn't after timeoutSec. Returns the wait status
+int ReapWorkerProcess(pid_t pid, float timeoutSec);
+
+// Single-producer single-consumer ring of variable-sized records, in memory that is shared between processes (a memfd, handed to the other process through SpawnWorkerProcess()).
+// Records start on 16-byte boundaries, so messages in the wire format can be decoded right where they are. Both sides spin briefly before they sleep on a futex
+class SharedMemoryRing {
+  public:
+    SharedMemoryRing();
+    ~SharedMemoryRing();
+    void create(const std::string& name, size_t capacity);
+    // Worker side, maps a ring that the other process created
+    void attach(int fd);
+    int fd() const { return mFd; }
+    size_t maxRecordSize() const { return mCapacity / 2 - RecordHeaderSize; }
+
+    // Writer side. Copies the record in, waits while the ring is full. Returns false on timeout or when the ring got interrupted
+    bool push(const char* data, size_t size, float timeoutSec = FLT_MAX);
+    // Same, with the record gathered from several pieces (e.g. WireWriter segments), so payload blocks go straight from the message into the ring
+    bool push(const struct iovec* pieces, size_t pieceCount, float timeoutSec = FLT_MAX);
+    // Reader side. Points at the next record inside the ring, valid until release(). Returns false on timeout or when the ring got interrupted
+    bool peek(const char*& data, size_t& size, float timeoutSec = FLT_MAX);
+    void release();
+
+    // Makes current and future push()/peek() calls return false, in all processes that have the ring mapped
+    void interrupt();
+    bool isInterrupted();
+    // Empties the ring and clears the interrupt. Only call when neither side is using it
+    void reset();
+
+  private:
+    struct Header;
+    static const size_t RecordHeaderSize = 16;
+    template<typename Cond> bool waitFor(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting, Cond cond, float timeoutSec);
+    Header* mHeader;
+    char* mData;
+    size_t mCapacity;
+    size_t mMappedSize;
+    int mFd;
+    uint64_t mPendingRelease; // Reader side, ring bytes taken up by the record handed out by peek()
+};
+
+}
+#endif
@@ -20,11 +20,18 @@ The signature of ProcessMessage is
 
 The input HashMap's keys correspond to the input streams, the output is expected to contain the necessary output streams of the component.
 
+With the optional "batch_slices" parameter, up to that many consecutive slices get handed over in a single call, if the class defines
+
+`ArrayList<HashMap<String,DecoderMessage>> ProcessMessageBatch(ArrayList<HashMap<String,DecoderMessage>>, long[])`
+
+The second parameter contains the time of each slice, the return value has to contain one output HashMap per slice. If the class doesn't have it, ProcessMessage() gets called for each slice. "batch_latency_ms" limits how long the first slice of a batch waits for the batch to fill up.
+
 See `java/com/bbn/godec/regression/TextTransform.java` and `test/jni_test.json` for an example.
 */
 
 JavaComponent::JavaComponent(std::string id, ComponentGraphConfig* configPt) :
     LoopProcessor(id, configPt) {
+    enableSliceBatching(configPt);
     mClassName = configPt->get<std::string>("class_name", "Full-qualified class name, e.g. java/util/ArrayList");
     mClassParam = configPt->get<std::string>("class_constructor_param", "string parameter passed into constructor");
     std::string expectedInputs = configPt->get<std::string>("expected_inputs", "comma-separated list of expected input slots");
@@ -48,75 +55,124 @@ JavaComponent::JavaComponent(std::string id, ComponentGraphConfig* configPt) :
 
 JavaComponent::~JavaComponent() {
 #ifndef ANDROID
-    mJVM->DetachCurrentThread();
+    if (mJNIEnv != nullptr) mJVM->DetachCurrentThread();
 #endif
 }
 
 #ifndef ANDROID
 jobject JavaComponent::DecoderMsgHashToJNI(JNIEnv* jniEnv, const unordered_map<std::string, DecoderMessage_ptr>& map) {
-    jclass HashClass = jniEnv->FindClass("java/util/HashMap");
-    jmethodID HashConstructor = jniEnv->GetMethodID(HashClass, "<init>", "(I)V");
-    jobject jMsgHash = jniEnv->NewObject(HashClass, HashConstructor, 10, nullptr);
-    jmethodID PutMethod = jniEnv->GetMethodID(HashClass, "put", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+    const JNIIds& ids = GetJNIIds(jniEnv);
+    jobject jMsgHash = jniEnv->NewObject(ids.mHashMap, ids.mHashMapInit, (jint)map.size());
     for(auto it = map.begin(); it != map.end(); it++) {
         auto nonConstMsg = boost::const_pointer_cast<DecoderMessage>(it->second);
         jobject jMsg = nonConstMsg->toJNI(jniEnv);
         jstring jSlot = jniEnv->NewStringUTF(it->first.c_str());
-        jniEnv->CallObjectMethod(jMsgHash, PutMethod, jSlot, jMsg);
+        jobject jPrevious = jniEnv->CallObjectMethod(jMsgHash, ids.mHashMapPut, jSlot, jMsg);
+        jniEnv->DeleteLocalRef(jPrevious);
+        jniEnv->DeleteLocalRef(jSlot);
+        jniEnv->DeleteLocalRef(jMsg);
     }
     return jMsgHash;
 }
 
 unordered_map<std::string, DecoderMessage_ptr> JavaComponent::JNIHashToDecoderMsg(JNIEnv* jniEnv, jobject jHash) {
+    const JNIIds& ids = GetJNIIds(jniEnv);
     unordered_map<std::string, DecoderMessage_ptr> out;
-    jclass HashClass = jniEnv->FindClass("java/util/HashMap");
-    jclass SetClass = jniEnv->FindClass("java/util/Set");
-    jmethodID KeySetMethod = jniEnv->GetMethodID(HashClass, "keySet", "()Ljava/util/Set;");
-    jobject jKeySet = jniEnv->CallObjectMethod(jHash, KeySetMethod);
-    jmethodID ToArrayMethod = jniEnv->GetMethodID(SetClass, "toArray", "()[Ljava/lang/Object;");
-    jobjectArray jKeyArray = (jobjectArray)jniEnv->CallObjectMethod(jKeySet, ToArrayMethod);
+    jobject jKeySet = jniEnv->CallObjectMethod(jHash, ids.mHashMapKeySet);
+    jobjectArray jKeyArray = (jobjectArray)jniEnv->CallObjectMethod(jKeySet, ids.mSetToArray);
     int jKeyArrayCount = jniEnv->GetArrayLength(jKeyArray);
-    jmethodID GetMethod = jniEnv->GetMethodID(HashClass, "get", "(Ljava/lang/Object;)Ljava/lang/Object;");
     for(int keyIdx = 0; keyIdx < jKeyArrayCount; keyIdx++) {
         jstring jKey = (jstring)jniEnv->GetObjectArrayElement(jKeyArray, keyIdx);
         const char* jKeyChars = jniEnv->GetStringUTFChars(jKey, NULL);
-        jobject jVal = jniEnv->CallObjectMethod(jHash, GetMethod, jKey);
+        jobject jVal = jniEnv->CallObjectMethod(jHash, ids.mHashMapGet, jKey);
         DecoderMessage_ptr msg = GetComponentGraph()->JNIToDecoderMsg(jniEnv, jVal);
 
         out[jKeyChars] = msg;
         jniEnv->ReleaseStringUTFChars(jKey, jKeyChars);
+        jniEnv->DeleteLocalRef(jVal);
+        jniEnv->DeleteLocalRef(jKey);
     }
+    jniEnv->DeleteLocalRef(jKeyArray);
+    jniEnv->DeleteLocalRef(jKeySet);
 
     return out;
 }
+
+void JavaComponent::AttachToJVM() {
+    JavaVM* jvms[10];
+    jsize numVMs;
+    JNI_GetCreatedJavaVMs(jvms, 10, &numVMs);
+    if (numVMs == 0) GODEC_ERR << getLPId(false) << ": No Java VM could be retrieved; if running Godec from command line, specify java class path with -java_class_path argument";
+    mJVM = jvms[0];
+    if (mJVM->AttachCurrentThreadAsDaemon((void**)&mJNIEnv, NULL) != JNI_OK) GODEC_ERR << getLPId(false) << ": Couldn't attach thread to JVM";
+
+    if (mJNIEnv == nullptr) GODEC_ERR << getLPId(false) << ": JNI environment is NULL; make sure you set the Java class path in the Godec command line";
+    jclass Class = mJNIEnv->FindClass(mClassName.c_str());
+    jmethodID constructor = mJNIEnv->GetMethodID(Class, "<init>", "(Ljava/lang/String;)V");
+    if (constructor == nullptr) GODEC_ERR << getLPId(false) << ": Could not find constructor of Java class "+mClassName;
+    jstring jParam = mJNIEnv->NewStringUTF(mClassParam.c_str());
+    jobject classObject = mJNIEnv->NewObject(Class, constructor, jParam);
+    if (classObject == nullptr) GODEC_ERR << getLPId(false) << ": Couldn't instatiate Java class "+mClassName;
+    // The per-call local references get released after each call, this one has to stick around
+    mClassObject = mJNIEnv->NewGlobalRef(classObject);
+    mProcessMessage = mJNIEnv->GetMethodID(Class, "ProcessMessage", "(Ljava/util/HashMap;J)Ljava/util/HashMap;");
+    if (mProcessMessage == nullptr) GODEC_ERR << getLPId(false) << ": Could not find ProcessMessage in Java class "+mClassName;
+    mProcessMessageBatch = mJNIEnv->GetMethodID(Class, "ProcessMessageBatch", "(Ljava/util/ArrayList;[J)Ljava/util/ArrayList;");
+    if (mProcessMessageBatch == nullptr) mJNIEnv->ExceptionClear(); // It's optional
+    mJNIEnv->DeleteLocalRef(jParam);
+    mJNIEnv->DeleteLocalRef(classObject);
+    mJNIEnv->DeleteLocalRef(Class);
+}
 #endif
 
 void JavaComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
+    ProcessMessageBatch(std::vector<DecoderMessageBlock>(1, msgBlock));
+}
+
+void JavaComponent::ProcessMessageBatch(const std::vector<DecoderMessageBlock>& msgBlocks) {
 #ifndef ANDROID
-    uint64_t time = msgBlock.getMap().begin()->second->getTime();
-    if (mJNIEnv == nullptr) {
-        JavaVM* jvms[10];
-        jsize numVMs;
-        JNI_GetCreatedJavaVMs(jvms, 10, &numVMs);
-        if (numVMs == 0) GODEC_ERR << getLPId(false) << ": No Java VM could be retrieved; if running Godec from command line, specify java class path with -java_class_path argument";
-        mJVM = jvms[0];
-        if (mJVM->AttachCurrentThreadAsDaemon((void**)&mJNIEnv, NULL) != JNI_OK) GODEC_ERR << getLPId(false) << ": Couldn't attach thread to JVM";
-
-        if (mJNIEnv == nullptr) GODEC_ERR << getLPId(false) << ": JNI environment is NULL; make sure you set the Java class path in the Godec command line";
-        jclass Class = mJNIEnv->FindClass(mClassName.c_str());
-        jmethodID constructor = mJNIEnv->GetMethodID(Class, "<init>", "(Ljava/lang/String;)V");
-        if (constructor == nullptr) GODEC_ERR << getLPId(false) << ": Could not find constructor of Java class "+mClassName;
-        jstring jParam = mJNIEnv->NewStringUTF(mClassParam.c_str());
-        mClassObject = mJNIEnv->NewObject(Class, constructor, jParam);
-        if (mClassObject == nullptr) GODEC_ERR << getLPId(false) << ": Couldn't instatiate Java class "+mClassName;
-        mProcessMessage = mJNIEnv->GetMethodID(Class, "ProcessMessage", "(Ljava/util/HashMap;J)Ljava/util/HashMap;");
-        if (mProcessMessage == nullptr) GODEC_ERR << getLPId(false) << ": Could not find ProcessMessage in Java class "+mClassName;
+    if (mJNIEnv == nullptr) AttachToJVM();
+    const JNIIds& ids = GetJNIIds(mJNIEnv);
+    // The thread stays attached for the lifetime of the component, so without a local frame all references created for the call would pile up
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> retHashes;
+    {
+        JNILocalFrame frame(mJNIEnv, 16);
+        if (mProcessMessageBatch != nullptr && msgBlocks.size() > 1) {
+            jobject jMsgHashes = mJNIEnv->NewObject(ids.mArrayList, ids.mArrayListInit, (jint)msgBlocks.size());
+            std::vector<jlong> times;
+            for(auto blockIt = msgBlocks.begin(); blockIt != msgBlocks.end(); blockIt++) {
+                jobject jMsgHash = DecoderMsgHashToJNI(mJNIEnv, blockIt->getMap());
+                mJNIEnv->CallBooleanMethod(jMsgHashes, ids.mArrayListAdd, jMsgHash);
+                mJNIEnv->DeleteLocalRef(jMsgHash);
+                times.push_back((jlong)blockIt->getMap().begin()->second->getTime());
+            }
+            jlongArray jTimes = mJNIEnv->NewLongArray(times.size());
+            mJNIEnv->SetLongArrayRegion(jTimes, 0, times.size(), times.data());
+            jobject jRetHashes = mJNIEnv->CallObjectMethod(mClassObject, mProcessMessageBatch, jMsgHashes, jTimes);
+            if (mJNIEnv->ExceptionCheck()) { mJNIEnv->ExceptionDescribe(); GODEC_ERR << getLPId(false) << ": Java ProcessMessageBatch threw an exception"; }
+            if (jRetHashes == nullptr || mJNIEnv->CallIntMethod(jRetHashes, ids.mArrayListSize) != (jint)msgBlocks.size()) GODEC_ERR << getLPId(false) << ": Java ProcessMessageBatch needs to return one HashMap per slice";
+            for(jint blockIdx = 0; blockIdx < (jint)msgBlocks.size(); blockIdx++) {
+                jobject jRetHash = mJNIEnv->CallObjectMethod(jRetHashes, ids.mArrayListGet, blockIdx);
+                retHashes.push_back(JNIHashToDecoderMsg(mJNIEnv, jRetHash));
+                mJNIEnv->DeleteLocalRef(jRetHash);
+            }
+        } else {
+            for(auto blockIt = msgBlocks.begin(); blockIt != msgBlocks.end(); blockIt++) {
+                uint64_t time = blockIt->getMap().begin()->second->getTime();
+                jobject jMsgHash = DecoderMsgHashToJNI(mJNIEnv, blockIt->getMap());
+                jobject jRetHash = mJNIEnv->CallObjectMethod(mClassObject, mProcessMessage, jMsgHash, (jlong)time);
+                if (mJNIEnv->ExceptionCheck()) { mJNIEnv->ExceptionDescribe(); GODEC_ERR << getLPId(false) << ": Java ProcessMessage threw an exception"; }
+                retHashes.push_back(JNIHashToDecoderMsg(mJNIEnv, jRetHash));
+                mJNIEnv->DeleteLocalRef(jMsgHash);
+                mJNIEnv->DeleteLocalRef(jRetHash);
+            }
+        }
     }
 
-    jobject jRetHash = mJNIEnv->CallObjectMethod(mClassObject, mProcessMessage, DecoderMsgHashToJNI(mJNIEnv, msgBlock.getMap()), (jlong)time);
-    auto retHash = JNIHashToDecoderMsg(mJNIEnv, jRetHash);
-    for(auto it = retHash.begin(); it != retHash.end(); it++) {
-        pushToOutputs(it->first, it->second);
+    for(auto hashIt = retHashes.begin(); hashIt != retHashes.end(); hashIt++) {
+        for(auto it = hashIt->begin(); it != hashIt->end(); it++) {
+            pushToOutputs(it->first, it->second);
+        }
     }
 #endif
 }
@@ -16,11 +16,14 @@ class JavaComponent : public LoopProcessor {
 
   private:
     void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
+    void ProcessMessageBatch(const std::vector<DecoderMessageBlock>& msgBlocks) override;
 #ifndef ANDROID
+    void AttachToJVM();
     jobject DecoderMsgHashToJNI(JNIEnv* jniEnv, const unordered_map<std::string, DecoderMessage_ptr>& map);
     unordered_map<std::string, DecoderMessage_ptr> JNIHashToDecoderMsg(JNIEnv* jniEnv, jobject jHash);
     jobject mClassObject;
     jmethodID mProcessMessage;
+    jmethodID mProcessMessageBatch;
     JavaVM* mJVM;
     JNIEnv* mJNIEnv;
 #endif
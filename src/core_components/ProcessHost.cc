@@ -0,0 +1,490 @@
+#include "ProcessHost.h"
+#include "ApiEndpoint.h"
+#include <godec/ComponentGraph.h>
+#if !defined(ANDROID) && !defined(_MSC_VER)
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <boost/filesystem.hpp>
+#endif
+
+namespace Godec {
+
+LoopProcessor* ProcessHostComponent::make(std::string id, ComponentGraphConfig* configPt) {
+    return new ProcessHostComponent(id, configPt);
+}
+std::string ProcessHostComponent::describeThyself() {
+    return "Runs a subgraph in a separate, supervised process";
+}
+
+/* ProcessHostComponent::ExtendedDescription
+Like SubModule, but the subgraph from "file" runs in a child process (Linux only, a fresh `godec` executable from the Godec installation), so that a component that leaks memory or crashes (e.g. one wrapping a third-party library, or Python code) can't take down the whole graph. To host a single component, put it into a JSON of its own. "inputs", "outputs" and the optional "override" work exactly like in SubModule.
+
+The messages go back and forth in the binary wire format, through two shared memory ring buffers of "ring_buffer_mb" megabytes each. A single message has to fit into half a ring. With the optional "worker_memory_limit_mb", the child process can't grow beyond that size (allocations beyond it fail, which usually ends the process).
+
+When the child process dies, it gets restarted, up to "max_restarts" times over the lifetime of the component (after that, Godec errors out). The new process gets re-fed the input from the start of the first utterance that the old one had not yet turned into output on all output streams, and output that was already passed on before the crash is suppressed. For deterministic subgraphs that carry no state from one utterance to the next, this makes the restart invisible downstream, otherwise output around the restart point can differ from an uninterrupted run. Note that this keeps the input of the current utterance around for a potential restart. If none of the inputs is a conversation state stream, there are no utterances to go by, and the new process only gets re-fed the input messages that are not yet covered by output on all output streams.
+
+Message types that cross the process boundary have to be known by libraries loaded on both sides.
+*/
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+enum HostRecordType {
+    HostRecordMessage = 0, // Slot name and message
+    HostRecordShutdown = 1, // All input has been sent
+    HostRecordReady = 2, // Worker has set up the subgraph
+    HostRecordDone = 3, // Worker has sent all output
+    HostRecordError = 4 // Worker failed to set up the subgraph, with the error text
+};
+
+// The worker exits with this when it could report the failure itself, so no restart
+static const int WorkerReportedError = 2;
+// Payload blocks at least this big go into the ring directly from the message instead of through the writer's buffer
+static const size_t HostScatterThresholdBytes = 32 * 1024;
+
+static void EncodeHostRecord(WireWriter& writer, uint8_t recordType, const std::string& str, const DecoderMessage* msg) {
+    writer.clear();
+    writer.writeU8(recordType);
+    writer.writeString(str);
+    if (msg != nullptr) WriteWireMessage(writer, *msg);
+}
+
+static bool PushHostRecord(SharedMemoryRing& ring, const WireWriter& writer, std::vector<WireWriter::Segment>& segments, std::vector<struct iovec>& iov, float timeoutSec = FLT_MAX) {
+    segments.clear();
+    writer.appendSegments(segments);
+    iov.resize(segments.size());
+    for (size_t segIdx = 0; segIdx < segments.size(); segIdx++) {
+        iov[segIdx].iov_base = (void*)segments[segIdx].mData;
+        iov[segIdx].iov_len = segments[segIdx].mSize;
+    }
+    return ring.push(iov.data(), iov.size(), timeoutSec);
+}
+
+static std::string DescribeWaitStatus(int status) {
+    std::stringstream ss;
+    if (WIFSIGNALED(status)) ss << "was killed by signal " << WTERMSIG(status) << " (" << strsignal(WTERMSIG(status)) << ")";
+    else if (WIFEXITED(status)) ss << "exited with status " << WEXITSTATUS(status);
+    else ss << "ended with wait status " << status;
+    return ss.str();
+}
+#endif
+
+ProcessHostComponent::ProcessHostComponent(std::string id, ComponentGraphConfig* configPt) :
+    LoopProcessor(id, configPt) {
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    std::string subgraphFile = configPt->get<std::string>("file", "The json for the subgraph to run in the child process");
+    int ringBufferMb = configPt->get<int>("ring_buffer_mb", "Size in MB of each of the two shared memory ring buffers to and from the child process");
+    mMaxRestarts = configPt->get<int>("max_restarts", "How often the child process gets restarted after it died, before giving up");
+    int64_t workerMemoryLimitMb = -1;
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<int64_t>("worker_memory_limit_mb")) {
+        workerMemoryLimitMb = configPt->get<int64_t>("worker_memory_limit_mb", "Address space limit in MB for the child process");
+    }
+    if (ringBufferMb < 1) GODEC_ERR << getLPId(false) << ": ring_buffer_mb needs to be at least 1";
+
+    if (!configPt->get_optional_READ_DECLARATION_BEFORE_USE<std::string>("inputs") || !configPt->get_optional_READ_DECLARATION_BEFORE_USE<std::string>("outputs"))
+        GODEC_ERR << id << ": Either no inputs or outputs defined. This make no sense for a ProcessHost.";
+    auto inputsChild = configPt->get_json_child("inputs");
+    for(auto v = inputsChild.begin(); v != inputsChild.end(); v++) mSubInputs.push_back(v.key());
+    auto outputsChild = configPt->get_json_child("outputs");
+    for(auto v = outputsChild.begin(); v != outputsChild.end(); v++) mSubOutputs.push_back(v.key());
+
+    // addInputSlotAndUUID(name of slot inside sub-network that will be injected, UUID_AnyDecoderMessage);  // Replacement for above godec doc ignore
+
+    std::list<std::string> requiredOutputSlots;
+    // .push_back(Slot: name of stream inside sub-network to be pulled out);  // For godec doc
+    initOutputs(requiredOutputSlots);
+
+    // Everything the worker process needs for setting up the subgraph
+    mWorkerConfig["id"] = mId;
+    mWorkerConfig["lp_id"] = getLPId(false);
+    mWorkerConfig["verbose"] = isVerbose();
+    mWorkerConfig["file"] = subgraphFile;
+    mWorkerConfig["working_directory"] = boost::filesystem::current_path().string();
+    mWorkerConfig["override"] = json();
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<std::string>("override")) {
+        mWorkerConfig["override"] = configPt->get_json_child("override");
+    }
+    mWorkerConfig["globals"] = json::object();
+    for (auto it = configPt->globalVals.keyVals.begin(); it != configPt->globalVals.keyVals.end(); it++) mWorkerConfig["globals"][it->first] = it->second;
+    mWorkerConfig["inputs"] = mSubInputs;
+    mWorkerConfig["outputs"] = mSubOutputs;
+    mWorkerConfig["memory_limit_mb"] = workerMemoryLimitMb;
+
+    mNumRestarts = 0;
+    mWorkerPid = -1;
+    mWorkerRunning = false;
+    mWorkerExitStatus = 0;
+    mSawConversationState = false;
+    mInputDone = false;
+    mCoveredTime = -1;
+    mGeneration = 0;
+    mReceiverParked = false;
+    mReceivedDone = false;
+    mToWorkerWriter.setExternalBlockThreshold(HostScatterThresholdBytes);
+
+    mToWorker.create(getLPId(false) + "_to_worker", (size_t)ringBufferMb * 1024 * 1024);
+    mFromWorker.create(getLPId(false) + "_from_worker", (size_t)ringBufferMb * 1024 * 1024);
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, mLifelineSockets) != 0) GODEC_ERR << getLPId(false) << ": Could not create lifeline socket: " << strerror(errno);
+#else
+    GODEC_ERR << getLPId(false) << ": ProcessHost is only supported on Linux";
+#endif
+}
+
+ProcessHostComponent::~ProcessHostComponent() {
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    if (mReceiveThread.joinable()) mReceiveThread.join();
+    if (mSuperviseThread.joinable()) mSuperviseThread.join();
+    if (mWorkerRunning) {
+        // Only still around if we never got to a regular shutdown
+        kill(mWorkerPid, SIGKILL);
+        waitpid(mWorkerPid, NULL, 0);
+    }
+    close(mLifelineSockets[0]);
+    close(mLifelineSockets[1]);
+#endif
+}
+
+void ProcessHostComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {}
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+void ProcessHostComponent::Start() {
+    // The worker process gets started only now, once the graph has loaded all libraries whose messages it might have to convert.
+    // Wait until the subgraph is up, so that configuration errors show up at startup like with a SubModule
+    SpawnWorker();
+    while (true) {
+        const char* data;
+        size_t size;
+        if (mFromWorker.peek(data, size, 0.1f)) {
+            WireReader reader(data, size);
+            uint8_t recordType = reader.readU8();
+            std::string text = reader.readString();
+            mFromWorker.release();
+            if (recordType == HostRecordError) GODEC_ERR << getLPId(false) << ": " << text;
+            if (recordType != HostRecordReady) GODEC_ERR << getLPId(false) << ": Unexpected record from the child process during startup";
+            break;
+        }
+        if (WorkerExited(false)) GODEC_ERR << getLPId(false) << ": Child process " << DescribeWaitStatus(mWorkerExitStatus) << " during startup";
+    }
+    GODEC_INFO << getLPId(false) << ": Started child process " << mWorkerPid << std::endl;
+
+    mReceiveThread = startPlacedThread(boost::bind(&ProcessHostComponent::ReceiveLoop, this), "receive");
+    mSuperviseThread = startPlacedThread(boost::bind(&ProcessHostComponent::SuperviseLoop, this), "supervise");
+    LoopProcessor::Start();
+}
+
+/*
+############ Godec side ###################
+*/
+
+void ProcessHostComponent::SpawnWorker() {
+    json workerConfig = mWorkerConfig;
+    workerConfig["libraries"] = GetComponentGraph()->GetLoadedLibraries();
+    std::vector<int> workerFds = { mToWorker.fd(), mFromWorker.fd(), mLifelineSockets[1] };
+    mWorkerPid = SpawnWorkerProcess("process_host", workerConfig.dump(), workerFds);
+    mWorkerRunning = true;
+}
+
+// Only the supervisor thread (or Start(), before it exists) reaps the worker
+bool ProcessHostComponent::WorkerExited(bool block) {
+    if (!mWorkerRunning) return true;
+    int status = 0;
+    pid_t ret;
+    do {
+        ret = waitpid(mWorkerPid, &status, block ? 0 : WNOHANG);
+    } while (ret < 0 && errno == EINTR);
+    if (ret == 0) return false;
+    if (ret < 0) GODEC_ERR << getLPId(false) << ": Could not wait for child process " << mWorkerPid << ": " << strerror(errno);
+    mWorkerRunning = false;
+    mWorkerExitStatus = status;
+    return true;
+}
+
+// A false return means the message did not make it to the worker because it died, it is in the replay buffer though (or the caller is the supervisor doing the replay)
+bool ProcessHostComponent::SendToWorker(uint8_t recordType, const std::string& slot, const DecoderMessage* msg, bool fromSupervisor) {
+    EncodeHostRecord(mToWorkerWriter, recordType, slot, msg);
+    if (!fromSupervisor) return PushHostRecord(mToWorker, mToWorkerWriter, mToWorkerSegments, mToWorkerIov);
+    // The supervisor is the one who would notice the worker dying, so it can't just sit in push()
+    while (!PushHostRecord(mToWorker, mToWorkerWriter, mToWorkerSegments, mToWorkerIov, 0.1f)) {
+        if (mToWorker.isInterrupted() || WorkerExited(false)) return false;
+    }
+    return true;
+}
+
+void ProcessHostComponent::ProcessLoop() {
+    while (true) {
+        DecoderMessage_ptr newMessage;
+        ChannelReturnResult res = mInputChannel.get(newMessage, FLT_MAX);
+        if (res == ChannelClosed) break;
+
+        if (isVerbose()) {
+            std::stringstream verboseStr;
+            verboseStr << "LP " << getLPId() << ": incoming " << newMessage->describeThyself() << std::endl;
+            GODEC_INFO << verboseStr.str();
+        }
+
+        if (mInputTag2Slot.find(newMessage->getTag()) == mInputTag2Slot.end()) {
+            GODEC_ERR << getLPId() << ": Can't find slot for tag '" << newMessage->getTag() << "'" << std::endl;
+        }
+        auto convStateMsg = dynamic_cast<const ConversationStateDecoderMessage*>(newMessage.get());
+        for (auto slotIt = mInputTag2Slot[newMessage->getTag()].begin(); slotIt != mInputTag2Slot[newMessage->getTag()].end(); slotIt++) {
+            std::lock_guard<std::mutex> lock(mToWorkerMutex);
+            // With conversation states coming in, only whole utterances get dropped, so that a new worker starts where an uninterrupted one would have been in the same state
+            int64_t coveredTime = mCoveredTime;
+            int64_t trimTime = mSawConversationState ? -1 : coveredTime;
+            while (!mUttEndTimes.empty() && mUttEndTimes.front() <= coveredTime) {
+                trimTime = mUttEndTimes.front();
+                mUttEndTimes.pop_front();
+            }
+            while (!mReplayBuffer.empty() && (int64_t)mReplayBuffer.front().second->getTime() <= trimTime) mReplayBuffer.pop_front();
+            if (convStateMsg != nullptr) {
+                mSawConversationState = true;
+                if (convStateMsg->mLastChunkInUtt && (mUttEndTimes.empty() || mUttEndTimes.back() != (int64_t)newMessage->getTime())) mUttEndTimes.push_back(newMessage->getTime());
+            }
+            mReplayBuffer.push_back(std::make_pair(*slotIt, newMessage));
+            SendToWorker(HostRecordMessage, *slotIt, newMessage.get(), false);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mToWorkerMutex);
+        mInputDone = true;
+        SendToWorker(HostRecordShutdown, "", nullptr, false);
+    }
+    mReceiveThread.join();
+    mSuperviseThread.join();
+    Shutdown();
+}
+
+void ProcessHostComponent::ReceiveLoop() {
+    unordered_map<std::string, int64_t> lastEmitted;
+    for (auto it = mSubOutputs.begin(); it != mSubOutputs.end(); it++) lastEmitted[*it] = -1;
+    uint64_t generation = 0;
+    while (true) {
+        const char* data;
+        size_t size;
+        if (!mFromWorker.peek(data, size)) {
+            // The worker died, wait for the supervisor to bring up the next one
+            std::unique_lock<std::mutex> lock(mStateMutex);
+            mReceiverParked = true;
+            mStateCv.notify_all();
+            mStateCv.wait(lock, [&]() { return mGeneration != generation; });
+            generation = mGeneration;
+            mReceiverParked = false;
+            continue;
+        }
+        WireReader reader(data, size);
+        uint8_t recordType = reader.readU8();
+        std::string slot = reader.readString();
+        if (recordType == HostRecordMessage) {
+            DecoderMessage_ptr msg = GetComponentGraph()->WireToDecoderMsg(reader);
+            mFromWorker.release();
+            // After a restart, the new worker repeats output that already went out
+            auto lastIt = lastEmitted.find(slot);
+            if (lastIt == lastEmitted.end()) GODEC_ERR << getLPId(false) << ": Child process sent unknown output '" << slot << "'";
+            if ((int64_t)msg->getTime() <= lastIt->second) continue;
+            lastIt->second = msg->getTime();
+            pushToOutputs(slot, msg);
+            int64_t coveredTime = INT64_MAX;
+            for (auto it = lastEmitted.begin(); it != lastEmitted.end(); it++) coveredTime = std::min(coveredTime, it->second);
+            mCoveredTime = coveredTime;
+        } else if (recordType == HostRecordReady) {
+            mFromWorker.release();
+        } else if (recordType == HostRecordDone) {
+            mFromWorker.release();
+            std::lock_guard<std::mutex> lock(mStateMutex);
+            mReceivedDone = true;
+            mStateCv.notify_all();
+            break;
+        } else if (recordType == HostRecordError) {
+            GODEC_ERR << getLPId(false) << ": " << slot;
+        } else {
+            GODEC_ERR << getLPId(false) << ": Unknown record type " << (int)recordType << " from child process";
+        }
+    }
+}
+
+void ProcessHostComponent::SuperviseLoop() {
+    while (true) {
+        WorkerExited(true);
+        int status = mWorkerExitStatus;
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == 0 || WEXITSTATUS(status) == WorkerReportedError)) break;
+        {
+            std::lock_guard<std::mutex> lock(mStateMutex);
+            if (mReceivedDone) break;
+        }
+        RestartWorker(status);
+    }
+}
+
+void ProcessHostComponent::RestartWorker(int status) {
+    while (true) {
+        mNumRestarts++;
+        if (mNumRestarts > mMaxRestarts) GODEC_ERR << getLPId(false) << ": Child process " << mWorkerPid << " " << DescribeWaitStatus(status) << ", giving up after " << mMaxRestarts << " restarts";
+        // Unconditionally on stderr, like the message of a crashing component would be
+        std::cerr << getLPId(false) << ": Child process " << mWorkerPid << " " << DescribeWaitStatus(status) << ", restarting it (" << mNumRestarts << " of " << mMaxRestarts << ")" << std::endl;
+
+        mToWorker.interrupt();
+        mFromWorker.interrupt();
+        std::lock_guard<std::mutex> writeLock(mToWorkerMutex);
+        {
+            std::unique_lock<std::mutex> lock(mStateMutex);
+            mStateCv.wait(lock, [&]() { return mReceiverParked || mReceivedDone; });
+            if (mReceivedDone) return;
+        }
+        mToWorker.reset();
+        mFromWorker.reset();
+        SpawnWorker();
+        {
+            std::lock_guard<std::mutex> lock(mStateMutex);
+            mGeneration++;
+            mStateCv.notify_all();
+        }
+
+        bool replayed = true;
+        for (auto it = mReplayBuffer.begin(); replayed && it != mReplayBuffer.end(); it++) {
+            replayed = SendToWorker(HostRecordMessage, it->first, it->second.get(), true);
+        }
+        if (replayed && mInputDone) replayed = SendToWorker(HostRecordShutdown, "", nullptr, true);
+        if (replayed) return;
+        // The new worker died as well while being re-fed
+        WorkerExited(true);
+        status = mWorkerExitStatus;
+    }
+}
+
+/*
+############ Worker process ###################
+*/
+
+int ProcessHostComponent::RunWorkerProcess(const json& config) {
+    SharedMemoryRing toWorker;
+    SharedMemoryRing fromWorker;
+    toWorker.attach(WorkerFd(0));
+    fromWorker.attach(WorkerFd(1));
+    int lifelineSocket = WorkerFd(2);
+    std::string id = config["id"].get<std::string>();
+    std::string lpId = config["lp_id"].get<std::string>();
+    std::vector<std::string> subInputs = config["inputs"].get<std::vector<std::string>>();
+    std::vector<std::string> subOutputs = config["outputs"].get<std::vector<std::string>>();
+
+    // Godec going away closes the other end of the lifeline
+    boost::thread lifelineThread([lifelineSocket]() {
+        char c;
+        ssize_t ret;
+        do {
+            ret = read(lifelineSocket, &c, 1);
+        } while (ret < 0 && errno == EINTR);
+        _exit(1);
+    });
+    lifelineThread.detach();
+
+    int64_t memoryLimitMb = config["memory_limit_mb"].get<int64_t>();
+    if (memoryLimitMb > 0) {
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = (rlim_t)memoryLimitMb * 1024 * 1024;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+
+    WireWriter writer;
+    writer.setExternalBlockThreshold(HostScatterThresholdBytes);
+    std::vector<WireWriter::Segment> segments;
+    std::vector<struct iovec> iov;
+    std::mutex writeMutex;
+    ComponentGraph* graph = nullptr;
+    MessageConverterRegistry converters;
+    try {
+        boost::filesystem::current_path(config["working_directory"].get<std::string>());
+        GlobalComponentGraphVals* subGlobals = new GlobalComponentGraphVals();
+        for (auto it = config["globals"].begin(); it != config["globals"].end(); it++) subGlobals->put(it.key(), it.value().get<std::string>());
+        json endpoints;
+        for (auto it = subInputs.begin(); it != subInputs.end(); it++) {
+            std::vector<std::string> inputs;
+            endpoints["!" + *it + ComponentGraph::API_ENDPOINT_SUFFIX] = ComponentGraph::CreateApiEndpoint(config["verbose"].get<bool>(), inputs, *it);
+        }
+        for (auto it = subOutputs.begin(); it != subOutputs.end(); it++) {
+            std::vector<std::string> inputs;
+            inputs.push_back(*it);
+            endpoints["!" + *it + ComponentGraph::API_ENDPOINT_SUFFIX] = ComponentGraph::CreateApiEndpoint(config["verbose"].get<bool>(), inputs, "");
+        }
+        ComponentGraphConfig subCgc(id, config["override"], NULL, nullptr);
+        graph = new ComponentGraph(id, config["file"].get<std::string>(), &subCgc, endpoints, subGlobals);
+
+        // Godec may have loaded libraries (and with them message types) that the subgraph itself doesn't use
+        std::vector<std::string> graphLibraries = graph->GetLoadedLibraries();
+        for (auto it = config["libraries"].begin(); it != config["libraries"].end(); it++) {
+            std::string dllName = it->get<std::string>();
+            if (std::find(graphLibraries.begin(), graphLibraries.end(), dllName) == graphLibraries.end()) converters.addLibrary(dllName, ComponentGraph::LoadGodecLibrary(dllName));
+        }
+        converters.merge(graph->GetMessageConverters());
+    } catch (const std::exception& e) {
+        EncodeHostRecord(writer, HostRecordError, std::string("Child process failed to set up the subgraph. ") + e.what(), nullptr);
+        PushHostRecord(fromWorker, writer, segments, iov);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(WorkerReportedError);
+    }
+    EncodeHostRecord(writer, HostRecordReady, "", nullptr);
+    PushHostRecord(fromWorker, writer, segments, iov);
+
+    std::vector<boost::thread> pullThreads;
+    for (auto it = subOutputs.begin(); it != subOutputs.end(); it++) {
+        std::string slot = *it;
+        auto ep = graph->GetApiEndpoint(id + ComponentGraph::TREE_LEVEL_SEPARATOR + slot);
+        // The worker process has no component around it to place its threads, they inherit the CPU affinity of the process
+        pullThreads.push_back(boost::thread([&, ep, slot]() {
+            while (true) {
+                unordered_map<std::string, DecoderMessage_ptr> newSlice;
+                ChannelReturnResult res = ep->PullMessage(newSlice, FLT_MAX);
+                if (res == ChannelClosed) break;
+                for (auto msgIt = newSlice.begin(); msgIt != newSlice.end(); msgIt++) {
+                    std::lock_guard<std::mutex> lock(writeMutex);
+                    EncodeHostRecord(writer, HostRecordMessage, slot, msgIt->second.get());
+                    PushHostRecord(fromWorker, writer, segments, iov);
+                }
+            }
+        }));
+    }
+
+    unordered_map<std::string, boost::shared_ptr<ApiEndpoint>> inputEndpoints;
+    for (auto it = subInputs.begin(); it != subInputs.end(); it++) {
+        inputEndpoints[*it] = graph->GetApiEndpoint(id + ComponentGraph::TREE_LEVEL_SEPARATOR + *it);
+    }
+    while (true) {
+        const char* data;
+        size_t size;
+        if (!toWorker.peek(data, size)) break;
+        WireReader reader(data, size);
+        uint8_t recordType = reader.readU8();
+        std::string slot = reader.readString();
+        if (recordType != HostRecordMessage) {
+            toWorker.release();
+            break;
+        }
+        // Decoded right out of the ring, the message ends up with its own copy of the payload
+        DecoderMessage_ptr msg = converters.fromWire(reader);
+        toWorker.release();
+        auto epIt = inputEndpoints.find(slot);
+        if (epIt == inputEndpoints.end()) GODEC_ERR << lpId << ": Got message for unknown input '" << slot << "'";
+        epIt->second->pushToOutputs(epIt->second->getOutputSlot(), msg);
+    }
+
+    // Deleting the endpoints closes the subgraph's inputs, as long as nobody else holds on to them
+    inputEndpoints.clear();
+    for (auto it = subInputs.begin(); it != subInputs.end(); it++) {
+        graph->DeleteApiEndpoint(id + ComponentGraph::TREE_LEVEL_SEPARATOR + *it);
+    }
+    for (auto it = pullThreads.begin(); it != pullThreads.end(); it++) it->join();
+    EncodeHostRecord(writer, HostRecordDone, "", nullptr);
+    PushHostRecord(fromWorker, writer, segments, iov);
+    // Let components like FileWriter inside the subgraph finish up
+    graph->WaitTilShutdown();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+#endif
+
+}
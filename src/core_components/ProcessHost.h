@@ -0,0 +1,79 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <godec/ChannelMessenger.h>
+#include <godec/WireFormat.h>
+#include "GodecMessages.h"
+#include "Ipc.h"
+#if !defined(ANDROID) && !defined(_MSC_VER)
+#include <sys/uio.h>
+#endif
+
+namespace Godec {
+
+class ProcessHostComponent : public LoopProcessor {
+  public:
+    static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
+    static std::string describeThyself();
+    ProcessHostComponent(std::string id, ComponentGraphConfig* configPt);
+    virtual ~ProcessHostComponent();
+    void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    // Body of "godec _worker process_host", the config is the one built by the constructor plus the libraries for converting messages
+    static int RunWorkerProcess(const json& config);
+#endif
+
+  private:
+    bool RequiresConvStateInput() override { return false; }
+    bool EnforceInputsOutputs() override { return false; }
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    void Start() override;
+    void ProcessLoop() override;
+    // Godec side
+    void ReceiveLoop();
+    void SuperviseLoop();
+    void SpawnWorker();
+    // Reaps the worker if it has exited (waits for that with "block"), the wait status then is in mWorkerExitStatus. False if it is still running
+    bool WorkerExited(bool block);
+    void RestartWorker(int status);
+    bool SendToWorker(uint8_t recordType, const std::string& slot, const DecoderMessage* msg, bool fromSupervisor);
+
+    json mWorkerConfig;
+    std::vector<std::string> mSubInputs;
+    std::vector<std::string> mSubOutputs;
+    int mMaxRestarts;
+    int mNumRestarts;
+
+    SharedMemoryRing mToWorker;
+    SharedMemoryRing mFromWorker;
+    // The worker watches its end of this, so it goes away together with Godec
+    int mLifelineSockets[2];
+    pid_t mWorkerPid;
+    bool mWorkerRunning;
+    int mWorkerExitStatus;
+
+    // Everything written to the worker goes through here, the replay buffer keeps the utterances the worker has not fully turned into output yet, for re-feeding them after a restart
+    std::mutex mToWorkerMutex;
+    WireWriter mToWorkerWriter;
+    std::vector<WireWriter::Segment> mToWorkerSegments;
+    std::vector<struct iovec> mToWorkerIov;
+    std::deque<std::pair<std::string, DecoderMessage_ptr>> mReplayBuffer;
+    std::deque<int64_t> mUttEndTimes; // Of the utterances in the replay buffer that have ended
+    bool mSawConversationState;
+    bool mInputDone;
+    std::atomic<int64_t> mCoveredTime;
+
+    // Handshake between supervisor and receiver during a restart
+    std::mutex mStateMutex;
+    std::condition_variable mStateCv;
+    uint64_t mGeneration;
+    bool mReceiverParked;
+    bool mReceivedDone;
+
+    boost::thread mReceiveThread;
+    boost::thread mSuperviseThread;
+#endif
+};
+
+}
@@ -1,5 +1,6 @@
 #include "PythonComponent.h"
 #include "godec/ComponentGraph.h"
+#include "Ipc.h"
 #ifndef ANDROID
 #define PY_ARRAY_UNIQUE_SYMBOL PYTHON_COMPONENT_ARRAY_API
 #include <numpy/arrayobject.h>
@@ -7,6 +8,13 @@
 #include <codecvt>
 #ifndef _MSC_VER
 #include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <cstring>
 #else
 #define STDIN_FILENO 0
 #define STDOUT_FILENO 1
@@ -25,33 +33,226 @@ std::string PythonComponent::describeThyself() {
 /* PythonComponent::ExtendedDescription
 Just like the Java component, this allows for calling an arbitrary Python script specified in "script_file_name" (omit the .py ending and any preceding path, those go into "python_path")  and doing some processing inside it. The Python script needs to define a class with the "class_name" name, and the component will instantiate an instance with the "class_constructor_param" string as the only parameter. "python_executable" points to the Python executable to use, "python_path" to the "PYTHONPATH" values to set so Python finds all dependent libraries.
 
-The input is a dict with the specified input streams as key, and the value whatever the message is (currently only FeatureDecoderMessage type is implemented, which is are Numpy matrices), the output (i.e. the return value) should be in the same format.
+The input is a dict with the specified input streams as key, and the value a dict describing the message (its "type" field names the message type), the output (i.e. the return value) should be in the same format. Audio, features, matrices and the numeric parts of Nbests are passed in as writable numpy arrays. With the optional parameter "zero_copy_inputs": "true", the arrays instead directly view the message memory, which saves a copy of every payload. These views are read-only since the message is shared with other components, so the script has to compute into new arrays instead of modifying them in place (e.g. `feats = feats * 2` rather than `feats *= 2`). Returned arrays are best float32 (and C- or Fortran-ordered), those get copied into the outgoing message without any conversion.
+
+By default all Python components of a graph share one embedded interpreter, which means only one of them can execute Python code at any given time (the GIL). With the optional parameter "execution_mode": "worker_process" (Linux only) the component instead starts a worker process (a fresh `godec` executable from the Godec installation) that hosts its own interpreter, so independent Python components run in parallel on separate cores. The messages get passed back and forth through shared memory. If the worker does not exit within 10 seconds of Godec shutting down, it gets killed. The default is "shared_interpreter".
+
+Each call into Python has a fixed overhead. With the optional parameter "batch_slices" set, the component collects up to that many consecutive slices and, if the Python class defines a `ProcessMessageBatch` function, calls it with a list of the input dicts. It has to return a list with one output dict per slice (see `test/python_test.py`). Without that function, `ProcessMessage` gets called for each slice, but the GIL is only acquired once per batch. The optional "batch_latency_ms" limits how long the first slice of a batch waits for the batch to fill up, without it a batch only goes out once it is full (or at the end of the input).
 
 Look at `test/python_test.json` for an example.
 */
 
 #ifndef ANDROID
 int PythonComponent_init_numpy() {
-    import_array();
+    // The conversions call this for every message, the import only needs to happen once
+    if (PyArray_API != NULL) return 0;
+    import_array1(-1);
+    return 0;
+}
+
+// Number of components using the interpreter inside the Godec process, the last one shuts it down
+static int sNumSharedInterpreterUsers = 0;
+#endif
+
+#if !defined(ANDROID) && !defined(_MSC_VER)
+// How long the destructor waits for a worker process to exit before killing it
+static const float WorkerExitTimeoutSec = 10.0f;
+
+WorkerSharedBuffer::WorkerSharedBuffer() : mFd(-1), mData(nullptr), mMappedSize(0) {}
+
+WorkerSharedBuffer::~WorkerSharedBuffer() {
+    if (mData != nullptr) munmap(mData, mMappedSize);
+    if (mFd >= 0) close(mFd);
+}
+
+void WorkerSharedBuffer::create(const std::string& name) {
+    mFd = memfd_create(name.c_str(), MFD_CLOEXEC);
+    if (mFd < 0) GODEC_ERR << "Could not create shared memory for " << name << ": " << strerror(errno);
+}
+
+void WorkerSharedBuffer::attach(int fd) {
+    mFd = fd;
+}
+
+void WorkerSharedBuffer::remap(size_t size) {
+    if (mData != nullptr) munmap(mData, mMappedSize);
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (data == MAP_FAILED) GODEC_ERR << "Could not map " << size << " bytes of shared memory: " << strerror(errno);
+    mData = (char*)data;
+    mMappedSize = size;
+}
+
+char* WorkerSharedBuffer::reserve(size_t size) {
+    if (size > mMappedSize) {
+        size_t newSize = std::max(std::max(size, 2 * mMappedSize), (size_t)1024 * 1024);
+        if (ftruncate(mFd, newSize) != 0) GODEC_ERR << "Could not grow shared memory to " << newSize << " bytes: " << strerror(errno);
+        remap(newSize);
+    }
+    return mData;
+}
+
+const char* WorkerSharedBuffer::view(size_t size) {
+    if (size > mMappedSize) {
+        struct stat st;
+        if (fstat(mFd, &st) != 0 || (size_t)st.st_size < size) GODEC_ERR << "Shared memory is smaller than announced message size " << size;
+        remap(st.st_size);
+    }
+    return mData;
+}
+
+// A frame is an error string (empty if all went well) and a slot->message map for each slice, messages are in the wire format (see WireFormat.h).
+// A message that sits in several slots is only written once, later slots refer back to it by its index within the frame
+static void SendWorkerFrame(int socket, WorkerSharedBuffer& buffer, WireWriter& writer, const std::string& error, const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices) {
+    writer.clear();
+    writer.writeString(error);
+    writer.writeU64(slices.size());
+    unordered_map<const DecoderMessage*, uint64_t> msgIndices;
+    for(auto sliceIt = slices.begin(); sliceIt != slices.end(); sliceIt++) {
+        writer.writeU64(sliceIt->size());
+        for(auto it = sliceIt->begin(); it != sliceIt->end(); it++) {
+            writer.writeString(it->first);
+            auto indexIt = msgIndices.find(it->second.get());
+            if (indexIt != msgIndices.end()) {
+                writer.writeU64(indexIt->second);
+                continue;
+            }
+            uint64_t newIndex = msgIndices.size();
+            msgIndices[it->second.get()] = newIndex;
+            writer.writeU64(newIndex);
+            WriteWireMessage(writer, *it->second);
+        }
+    }
+    memcpy(buffer.reserve(writer.size()), writer.data(), writer.size());
+    uint64_t frameSize = writer.size();
+    if (!WriteToSocket(socket, &frameSize, sizeof(frameSize))) GODEC_ERR << "Python worker connection closed unexpectedly";
+}
+
+// Returns false if the other side has gone away
+static bool ReceiveWorkerFrame(int socket, WorkerSharedBuffer& buffer, const MessageConverterRegistry& converters, std::string& error, std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices) {
+    uint64_t frameSize;
+    if (!ReadFromSocket(socket, &frameSize, sizeof(frameSize)) || frameSize == 0) return false;
+    WireReader reader(buffer.view(frameSize), frameSize);
+    error = reader.readString();
+    uint64_t numSlices = reader.readU64();
+    slices.resize(numSlices);
+    std::vector<DecoderMessage_ptr> msgs;
+    for(uint64_t sliceIdx = 0; sliceIdx < numSlices; sliceIdx++) {
+        uint64_t numMsgs = reader.readU64();
+        for(uint64_t msgIdx = 0; msgIdx < numMsgs; msgIdx++) {
+            std::string slot = reader.readString();
+            uint64_t frameMsgIdx = reader.readU64();
+            if (frameMsgIdx == msgs.size()) msgs.push_back(converters.fromWire(reader));
+            else if (frameMsgIdx > msgs.size()) GODEC_ERR << "Python worker frame refers to message " << frameMsgIdx << " before it was sent";
+            slices[sliceIdx][slot] = msgs[frameMsgIdx];
+        }
+    }
+    return true;
 }
 #endif
 
 PythonComponent::PythonComponent(std::string id, ComponentGraphConfig* configPt) :
     LoopProcessor(id, configPt) {
+    enableSliceBatching(configPt);
 
 #ifndef ANDROID
-    // Initialize the Python interpreter.
+    mScriptHost = nullptr;
+    mScriptConfig["id"] = getLPId(false);
+    mScriptConfig["verbose"] = isVerbose();
+    mScriptConfig["python_executable"] = configPt->get<std::string>("python_executable", "Python executable to use");
+    mScriptConfig["script_file_name"] = configPt->get<std::string>("script_file_name", "Python script file name");
+    mScriptConfig["python_path"] = configPt->get<std::string>("python_path", "PYTHONPATH to set (cwd and script folder get added automatically)");
+    mScriptConfig["class_name"] = configPt->get<std::string>("class_name", "The name of the class that contains the ProcessMessage function");
+    mScriptConfig["class_constructor_param"] = configPt->get<std::string>("class_constructor_param", "string parameter passed into class constructor");
+    // Relative script and python paths are relative to the JSON file, so the worker process starts out in the same directory
+    mScriptConfig["working_directory"] = boost::filesystem::current_path().string();
+
+    std::string executionMode = "shared_interpreter";
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<std::string>("execution_mode")) {
+        executionMode = configPt->get<std::string>("execution_mode", "Where the Python code runs: 'shared_interpreter' (default, one interpreter for all Python components in the process) or 'worker_process' (a separate process with its own interpreter, runs in parallel to other Python components)");
+    }
+    if (executionMode == "shared_interpreter") mUseWorkerProcess = false;
+    else if (executionMode == "worker_process") mUseWorkerProcess = true;
+    else GODEC_ERR << getLPId(false) << ": Unknown execution_mode '" << executionMode << "'";
+#ifdef _MSC_VER
+    if (mUseWorkerProcess) GODEC_ERR << getLPId(false) << ": execution_mode 'worker_process' is not supported on Windows";
+#endif
+
+    bool zeroCopyInputs = false;
+    if (configPt->get_optional_READ_DECLARATION_BEFORE_USE<bool>("zero_copy_inputs")) {
+        zeroCopyInputs = configPt->get<bool>("zero_copy_inputs", "Pass payloads to Python as read-only views of the message memory instead of writable copies");
+    }
+    mScriptConfig["zero_copy_inputs"] = zeroCopyInputs;
+
+    std::string expectedInputs = configPt->get<std::string>("expected_inputs", "comma-separated list of expected input slots");
+    std::string expectedOutputs = configPt->get<std::string>("expected_outputs", "comma-separated list of expected output slots");
+
+    std::list<std::string> requiredInputSlots;
+    boost::split(requiredInputSlots, expectedInputs,boost::is_any_of(","));
+    for(auto it = requiredInputSlots.begin(); it != requiredInputSlots.end(); it++) {
+        addInputSlotAndUUID(*it, UUID_AnyDecoderMessage); // GodecDocIgnore
+        // addInputSlotAndUUID(<slots from 'expected_inputs'>, UUID_AnyDecoderMessage);  // Replacement for above godec doc ignore
+    }
+
+    std::list<std::string> requiredOutputSlots;
+    boost::split(requiredOutputSlots, expectedOutputs,boost::is_any_of(","));
+    requiredOutputSlots.erase(std::remove_if(requiredOutputSlots.begin(), requiredOutputSlots.end(), [&](auto const& elem) {return elem == "";}), requiredOutputSlots.end());
+    // .push_back(Slots From 'expected_outputs');  // godec doc won't catch the above construct
+    initOutputs(requiredOutputSlots);
+
+#ifndef _MSC_VER
+    mWorkerSocket = -1;
+#endif
+    // The worker process gets started in Start(), once the graph has loaded all libraries whose messages it might have to convert
+    if (mUseWorkerProcess) return;
+
+    // The first component brings up the interpreter and then releases the GIL, the others just grab it while setting up
+    bool firstUser = !Py_IsInitialized();
+    PyGILState_STATE gstate;
+    if (!firstUser) gstate = PyGILState_Ensure();
+    mScriptHost = new PythonScriptHost(mScriptConfig, &GetComponentGraph()->GetMessageConverters());
+    mScriptHost->StartInterpreter();
+    mScriptHost->LoadPythonClass();
+    sNumSharedInterpreterUsers++;
+    if (firstUser) PyEval_SaveThread();
+    else PyGILState_Release(gstate);
+#else
+    GODEC_ERR << "The Python component can not be used under Android";
+#endif
+}
+
+#ifndef ANDROID
+PythonScriptHost::PythonScriptHost(const json& config, const MessageConverterRegistry* converters) :
+    mConverters(converters), mPModule(NULL), mPModuleDict(NULL), mPClass(NULL), mHasBatchMethod(false) {
     std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-    std::string tmpPythonExec = configPt->get<std::string>("python_executable", "Python executable to use");
-    mPythonExec = converter.from_bytes(tmpPythonExec);
-    Py_SetProgramName((wchar_t*)mPythonExec.c_str());
-    Py_Initialize();
-    PythonComponent_init_numpy();
+    mId = config["id"].get<std::string>();
+    mVerbose = config["verbose"].get<bool>();
+    mPythonExec = converter.from_bytes(config["python_executable"].get<std::string>());
+    mScriptName = config["script_file_name"].get<std::string>();
+    mPythonPath = config["python_path"].get<std::string>();
+    mClassName = config["class_name"].get<std::string>();
+    mConstructorParam = config["class_constructor_param"].get<std::string>();
+    mZeroCopyInputs = config["zero_copy_inputs"].get<bool>();
+}
+
+// Needs the GIL
+PythonScriptHost::~PythonScriptHost() {
+    Py_XDECREF(mPClass);
+    /* These are leaked references, but I'm assuming it's a tiny amount
+        Py_DECREF(pClass);
+        Py_DECREF(pConstructorArgs);
+        Py_DECREF(pClassParam);
+        Py_DECREF(pStdoutParam);
+        Py_DECREF(pStderrParam); */
+}
+
+void PythonScriptHost::StartInterpreter() {
+    if (!Py_IsInitialized()) {
+        Py_SetProgramName((wchar_t*)mPythonExec.c_str());
+        Py_Initialize();
+    }
 
-    std::string scriptName = configPt->get<std::string>("script_file_name", "Python script file name");
-    boost::filesystem::path scriptPath(scriptName);
-    std::string pythonPath = configPt->get<std::string>("python_path", "PYTHONPATH to set (cwd and script folder get added automatically)");
-    boost::filesystem::path pythonPathPath(pythonPath);
+    boost::filesystem::path scriptPath(mScriptName);
+    boost::filesystem::path pythonPathPath(mPythonPath);
     std::wstring cwd = boost::filesystem::current_path().wstring();
 #ifdef _MSC_VER
     std::wstring completePythonPath = cwd+L";"+scriptPath.parent_path().wstring()+L";"+pythonPathPath.wstring();
@@ -62,109 +263,258 @@ PythonComponent::PythonComponent(std::string id, ComponentGraphConfig* configPt)
 
     if (PyImport_ImportModule("numpy") == NULL) { PyErr_Print(); GODEC_ERR << "Unable to import numpy"; }
     if (PyImport_ImportModule("numpy.core.multiarray") == NULL) {PyErr_Print(); GODEC_ERR << "Unable to import numpy.core.multiarray";}
+    PythonComponent_init_numpy();
+}
 
+void PythonScriptHost::LoadPythonClass() {
+    boost::filesystem::path scriptPath(mScriptName);
     mPModule = PyImport_ImportModule((char*)(scriptPath.stem().string().c_str()));
 
-    if (mPModule == NULL) { PyErr_Print(); GODEC_ERR << getLPId(false) << "Could not load Python script '" << scriptName << "'. Make sure to omit the '.py' ending, and set the 'python_path' parameter if necessary (keep in mind to use the correct separator: ':' for Linux, ';' for Windows)";}
+    if (mPModule == NULL) { PyErr_Print(); GODEC_ERR << mId << "Could not load Python script '" << mScriptName << "'. Make sure to omit the '.py' ending, and set the 'python_path' parameter if necessary (keep in mind to use the correct separator: ':' for Linux, ';' for Windows)";}
 
     mPModuleDict = PyModule_GetDict(mPModule);
-    if (mPModuleDict == NULL) GODEC_ERR << getLPId(false) << "Could not extract Python module dict";
+    if (mPModuleDict == NULL) GODEC_ERR << mId << "Could not extract Python module dict";
 
-    std::string className = configPt->get<std::string>("class_name", "The name of the class that contains the ProcessMessage function");
-    std::string constructorParam = configPt->get<std::string>("class_constructor_param", "string parameter passed into class constructor");
-    PyObject* pClass = PyDict_GetItemString(mPModuleDict, className.c_str());
-    if (pClass == NULL) GODEC_ERR << getLPId(false) <<  "Could not find class '" << className << "' in Python module";
+    PyObject* pClass = PyDict_GetItemString(mPModuleDict, mClassName.c_str());
+    if (pClass == NULL) GODEC_ERR << mId <<  "Could not find class '" << mClassName << "' in Python module";
     PyObject* pConstructorArgs = PyTuple_New(4);
-    PyObject* pClassParam = PyUnicode_FromString(constructorParam.c_str());
+    PyObject* pClassParam = PyUnicode_FromString(mConstructorParam.c_str());
     PyObject* pStdoutParam = PyFile_FromFd(STDOUT_FILENO, "<stdout>", "w", -1, NULL, NULL, "\n", 0);
     PyObject* pStderrParam = PyFile_FromFd(STDERR_FILENO, "<stderr>", "w", -1, NULL, NULL, "\n", 0);
     PyTuple_SetItem(pConstructorArgs, 0, pClassParam);
     PyTuple_SetItem(pConstructorArgs, 1, pStdoutParam);
     PyTuple_SetItem(pConstructorArgs, 2, pStderrParam);
-    PyTuple_SetItem(pConstructorArgs, 3, isVerbose() ? Py_True : Py_False);
+    PyTuple_SetItem(pConstructorArgs, 3, mVerbose ? Py_True : Py_False);
     mPClass = PyObject_CallObject(pClass, pConstructorArgs);
-    if(mPClass == NULL) GODEC_ERR << getLPId(false) << ": Could not instantiate class!";
+    if(mPClass == NULL) GODEC_ERR << mId << ": Could not instantiate class!";
+    mHasBatchMethod = PyObject_HasAttrString(mPClass, "ProcessMessageBatch");
+}
+#endif
 
-    std::string expectedInputs = configPt->get<std::string>("expected_inputs", "comma-separated list of expected input slots");
-    std::string expectedOutputs = configPt->get<std::string>("expected_outputs", "comma-separated list of expected output slots");
+#if !defined(ANDROID) && !defined(_MSC_VER)
+void PythonComponent::Start() {
+    if (mUseWorkerProcess) StartWorkerProcess();
+    LoopProcessor::Start();
+}
 
-    std::list<std::string> requiredInputSlots;
-    boost::split(requiredInputSlots, expectedInputs,boost::is_any_of(","));
-    for(auto it = requiredInputSlots.begin(); it != requiredInputSlots.end(); it++) {
-        addInputSlotAndUUID(*it, UUID_AnyDecoderMessage); // GodecDocIgnore
-        // addInputSlotAndUUID(<slots from 'expected_inputs'>, UUID_AnyDecoderMessage);  // Replacement for above godec doc ignore
+void PythonComponent::StartWorkerProcess() {
+    mToWorker.create(getLPId(false) + "_to_worker");
+    mFromWorker.create(getLPId(false) + "_from_worker");
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) GODEC_ERR << getLPId(false) << ": Could not create worker socket: " << strerror(errno);
+
+    json workerConfig = mScriptConfig;
+    workerConfig["libraries"] = GetComponentGraph()->GetLoadedLibraries();
+    std::vector<int> workerFds = { sockets[1], mToWorker.fd(), mFromWorker.fd() };
+    try {
+        mWorkerPid = SpawnWorkerProcess("python", workerConfig.dump(), workerFds);
+    } catch (const std::exception& e) {
+        close(sockets[0]);
+        close(sockets[1]);
+        throw;
     }
+    close(sockets[1]);
+    mWorkerSocket = sockets[0];
 
-    std::list<std::string> requiredOutputSlots;
-    boost::split(requiredOutputSlots, expectedOutputs,boost::is_any_of(","));
-    requiredOutputSlots.erase(std::remove_if(requiredOutputSlots.begin(), requiredOutputSlots.end(), [&](auto const& elem) {return elem == "";}), requiredOutputSlots.end());
-    // .push_back(Slots From 'expected_outputs');  // godec doc won't catch the above construct
-    initOutputs(requiredOutputSlots);
-    mPMainThread = PyEval_SaveThread();
-#else
-    GODEC_ERR << "The Python component can not be used under Android";
-#endif
+    // Wait until the worker is up, so that script errors show up at startup just like with the shared interpreter
+    std::string error;
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> noSlices;
+    if (!ReceiveWorkerFrame(mWorkerSocket, mFromWorker, GetComponentGraph()->GetMessageConverters(), error, noSlices)) GODEC_ERR << getLPId(false) << ": Python worker process died during startup";
+    if (error != "") GODEC_ERR << getLPId(false) << ": " << error;
+    GODEC_INFO << getLPId(false) << ": Started Python worker process " << mWorkerPid << std::endl;
 }
 
+int PythonComponent::RunWorkerProcess(const json& config) {
+    int socket = WorkerFd(0);
+    WorkerSharedBuffer toWorker;
+    WorkerSharedBuffer fromWorker;
+    toWorker.attach(WorkerFd(1));
+    fromWorker.attach(WorkerFd(2));
+    WireWriter frameWriter;
+    MessageConverterRegistry converters;
+    PythonScriptHost* scriptHost = nullptr;
+    std::string error;
+    try {
+        boost::filesystem::current_path(config["working_directory"].get<std::string>());
+        for(auto it = config["libraries"].begin(); it != config["libraries"].end(); it++) {
+            std::string dllName = it->get<std::string>();
+            converters.addLibrary(dllName, ComponentGraph::LoadGodecLibrary(dllName));
+        }
+        scriptHost = new PythonScriptHost(config, &converters);
+        scriptHost->StartInterpreter();
+        scriptHost->LoadPythonClass();
+    } catch (const std::exception& e) {
+        error = std::string("Python worker failed to start up. ") + e.what();
+    }
+    try {
+        SendWorkerFrame(socket, fromWorker, frameWriter, error, std::vector<unordered_map<std::string, DecoderMessage_ptr>>());
+        // Godec going away shows up as the socket closing, same as the zero-sized frame the destructor sends
+        while (error == "") {
+            std::vector<unordered_map<std::string, DecoderMessage_ptr>> slices;
+            if (!ReceiveWorkerFrame(socket, toWorker, converters, error, slices)) break;
+            std::vector<unordered_map<std::string, DecoderMessage_ptr>> retSlices;
+            try {
+                retSlices = scriptHost->CallPythonProcessMessage(slices);
+            } catch (const std::exception& e) {
+                error = std::string("Python worker failed processing a message. ") + e.what();
+            }
+            SendWorkerFrame(socket, fromWorker, frameWriter, error, retSlices);
+        }
+    } catch (const std::exception& e) {}
+    return error == "" ? 0 : 1;
+}
+
+std::vector<unordered_map<std::string, DecoderMessage_ptr>> PythonComponent::CallWorker(const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices) {
+    SendWorkerFrame(mWorkerSocket, mToWorker, mWorkerFrameWriter, "", slices);
+    std::string error;
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> retSlices;
+    if (!ReceiveWorkerFrame(mWorkerSocket, mFromWorker, GetComponentGraph()->GetMessageConverters(), error, retSlices)) GODEC_ERR << getLPId(false) << ": Python worker process " << mWorkerPid << " died";
+    if (error != "") GODEC_ERR << getLPId(false) << ": " << error;
+    return retSlices;
+}
+#endif
+
 PythonComponent::~PythonComponent() {
 #ifndef ANDROID
-    PyEval_RestoreThread(mPMainThread);
-    Py_DECREF(mPClass);
-    /* These are leaked references, but I'm assuming it's a tiny amount
-        Py_DECREF(pClass);
-        Py_DECREF(pConstructorArgs);
-        Py_DECREF(pClassParam);
-        Py_DECREF(pStdoutParam);
-        Py_DECREF(pStderrParam); */
-    Py_Finalize();
+#ifndef _MSC_VER
+    if (mUseWorkerProcess) {
+        if (mWorkerSocket < 0) return;
+        // A zero-sized frame tells the worker to exit. One that is stuck inside the Python code gets killed after a while
+        uint64_t frameSize = 0;
+        WriteToSocket(mWorkerSocket, &frameSize, sizeof(frameSize));
+        close(mWorkerSocket);
+        ReapWorkerProcess(mWorkerPid, WorkerExitTimeoutSec);
+        return;
+    }
+#endif
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    delete mScriptHost;
+    if (--sNumSharedInterpreterUsers == 0) Py_Finalize();
+    else PyGILState_Release(gstate);
 #endif
 }
 
 #ifndef ANDROID
-PyObject* PythonComponent::DecoderMsgHashToPython(const DecoderMessageBlock& msgBlock) {
-    const auto& map = msgBlock.getMap();
+// toPython() hands out read-only views of the message payloads. Unless the component runs with zero_copy_inputs, those get replaced by writable copies, so scripts can keep modifying their inputs in place
+static PyObject* WritableArrayCopy(PyObject* pObj) {
+    if (PyArray_Check(pObj) && !PyArray_ISWRITEABLE((PyArrayObject*)pObj)) {
+        PyObject* pCopy = PyArray_NewCopy((PyArrayObject*)pObj, NPY_ANYORDER);
+        if (pCopy == NULL) { PyErr_Print(); GODEC_ERR << "Could not copy numpy view of message payload"; }
+        return pCopy;
+    }
+    return NULL;
+}
+
+static void MakePayloadsWritable(PyObject* pContainer) {
+    if (PyDict_Check(pContainer)) {
+        PyObject *pKey, *pVal;
+        Py_ssize_t pos = 0;
+        // Replacing the value of an existing key is fine while iterating
+        while (PyDict_Next(pContainer, &pos, &pKey, &pVal)) {
+            PyObject* pCopy = WritableArrayCopy(pVal);
+            if (pCopy != NULL) {
+                PyDict_SetItem(pContainer, pKey, pCopy);
+                Py_DECREF(pCopy);
+            } else {
+                MakePayloadsWritable(pVal);
+            }
+        }
+    } else if (PyList_Check(pContainer)) {
+        for(Py_ssize_t idx = 0; idx < PyList_Size(pContainer); idx++) {
+            PyObject* pCopy = WritableArrayCopy(PyList_GET_ITEM(pContainer, idx));
+            if (pCopy != NULL) PyList_SetItem(pContainer, idx, pCopy);
+            else MakePayloadsWritable(PyList_GET_ITEM(pContainer, idx));
+        }
+    }
+}
+
+PyObject* PythonScriptHost::DecoderMsgHashToPython(const unordered_map<std::string, DecoderMessage_ptr>& msgs) {
     PyObject* pMsgHash = PyDict_New();
-    for(auto it = map.begin(); it != map.end(); it++) {
+    for(auto it = msgs.begin(); it != msgs.end(); it++) {
         auto nonConstMsg = boost::const_pointer_cast<DecoderMessage>(it->second);
         PyObject* pMsg = nonConstMsg->toPython();
+        if (!mZeroCopyInputs) MakePayloadsWritable(pMsg);
         PyDict_SetItemString(pMsgHash, it->first.c_str(), pMsg);
         Py_DECREF(pMsg);
     }
     return pMsgHash;
 }
 
-unordered_map<std::string, DecoderMessage_ptr> PythonComponent::PythonDictToDecoderMsg(PyObject* pDict) {
+unordered_map<std::string, DecoderMessage_ptr> PythonScriptHost::PythonDictToDecoderMsg(PyObject* pDict) {
     unordered_map<std::string, DecoderMessage_ptr> out;
     PyObject *pSlot, *pMsg;
     Py_ssize_t pos = 0;
     while (PyDict_Next(pDict, &pos, &pSlot, &pMsg)) {
         std::string slot = PyUnicode_AsUTF8(pSlot);
-        DecoderMessage_ptr msg = GetComponentGraph()->PythonToDecoderMsg(pMsg);
+        DecoderMessage_ptr msg = mConverters->fromPython(pMsg);
         out[slot] = msg;
     }
 
     return out;
 }
+
+std::vector<unordered_map<std::string, DecoderMessage_ptr>> PythonScriptHost::CallPythonProcessMessage(const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices) {
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> retSlices;
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    if (mHasBatchMethod && slices.size() > 1) {
+        PyObject* pMsgBlocks = PyList_New(slices.size());
+        for(size_t sliceIdx = 0; sliceIdx < slices.size(); sliceIdx++) {
+            PyList_SET_ITEM(pMsgBlocks, sliceIdx, DecoderMsgHashToPython(slices[sliceIdx]));
+        }
+        PyObject* pProcessMessageBatch = PyUnicode_FromString("ProcessMessageBatch");
+        PyObject* pResult = PyObject_CallMethodObjArgs(mPClass, pProcessMessageBatch, pMsgBlocks, NULL);
+        if(pResult == NULL) {
+            PyErr_Print();
+            GODEC_ERR << mId << ": Could not call Python ProcessMessageBatch function!";
+        }
+        if (!PyList_Check(pResult) || PyList_Size(pResult) != (Py_ssize_t)slices.size()) GODEC_ERR << mId << ": Python ProcessMessageBatch needs to return a list with one dict per slice";
+        for(size_t sliceIdx = 0; sliceIdx < slices.size(); sliceIdx++) {
+            retSlices.push_back(PythonDictToDecoderMsg(PyList_GET_ITEM(pResult, sliceIdx)));
+        }
+        Py_DECREF(pMsgBlocks);
+        Py_DECREF(pProcessMessageBatch);
+        Py_DECREF(pResult);
+    } else {
+        PyObject* pProcessMessage = PyUnicode_FromString("ProcessMessage");
+        for(auto sliceIt = slices.begin(); sliceIt != slices.end(); sliceIt++) {
+            PyObject* pMsgBlock = DecoderMsgHashToPython(*sliceIt);
+            PyObject* pResult = PyObject_CallMethodObjArgs(mPClass, pProcessMessage, pMsgBlock, NULL);
+            if(pResult == NULL) {
+                PyErr_Print();
+                GODEC_ERR << mId << ": Could not call Python ProcessMessage function!";
+            }
+            retSlices.push_back(PythonDictToDecoderMsg(pResult));
+            Py_DECREF(pMsgBlock);
+            Py_DECREF(pResult);
+        }
+        Py_DECREF(pProcessMessage);
+    }
+    PyGILState_Release(gstate);
+    return retSlices;
+}
 #endif
 
 void PythonComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
+    ProcessMessageBatch(std::vector<DecoderMessageBlock>(1, msgBlock));
+}
+
+void PythonComponent::ProcessMessageBatch(const std::vector<DecoderMessageBlock>& msgBlocks) {
 #ifndef ANDROID
-    PyGILState_STATE gstate = PyGILState_Ensure();
-    PyObject* pMsgBlock = DecoderMsgHashToPython(msgBlock);
-    PyObject* pProcessMessage = PyUnicode_FromString("ProcessMessage");
-    PyObject* pResult = PyObject_CallMethodObjArgs(mPClass, pProcessMessage, pMsgBlock, NULL);
-    if(pResult == NULL) {
-        PyErr_Print();
-        GODEC_ERR << getLPId(false) << ": Could not call Python ProcessMessage function!";
-    }
-    auto retMsg = PythonDictToDecoderMsg(pResult);
-    for(auto it = retMsg.begin(); it != retMsg.end(); it++) {
-        pushToOutputs(it->first, it->second);
-    }
-    Py_DECREF(pMsgBlock);
-    Py_DECREF(pProcessMessage);
-    Py_DECREF(pResult);
-    PyGILState_Release(gstate);
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> slices;
+    for(auto blockIt = msgBlocks.begin(); blockIt != msgBlocks.end(); blockIt++) {
+        slices.push_back(blockIt->getMap());
+    }
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> retSlices;
+#ifndef _MSC_VER
+    if (mUseWorkerProcess) retSlices = CallWorker(slices);
+    else
+#endif
+        retSlices = mScriptHost->CallPythonProcessMessage(slices);
+    for(auto sliceIt = retSlices.begin(); sliceIt != retSlices.end(); sliceIt++) {
+        for(auto it = sliceIt->begin(); it != sliceIt->end(); it++) {
+            pushToOutputs(it->first, it->second);
+        }
+    }
 #endif
 }
 
@@ -1,31 +1,98 @@
 #pragma once
 
 #include <godec/ChannelMessenger.h>
+#include <godec/ComponentGraph.h>
 #include "GodecMessages.h"
+#if !defined(ANDROID) && !defined(_MSC_VER)
+#include <sys/types.h>
+#endif
 
 namespace Godec {
 
+#if !defined(ANDROID) && !defined(_MSC_VER)
+// One direction of the channel to a Python worker process. The payload goes through a memfd that both processes have mapped, the socket only carries the payload size
+class WorkerSharedBuffer {
+  public:
+    WorkerSharedBuffer();
+    ~WorkerSharedBuffer();
+    void create(const std::string& name);
+    // Worker side, the memfd was handed over by SpawnWorkerProcess()
+    void attach(int fd);
+    int fd() const { return mFd; }
+    // Writer side, grows the shared file if necessary
+    char* reserve(size_t size);
+    // Reader side, remaps if the writer has grown the shared file
+    const char* view(size_t size);
+  private:
+    void remap(size_t size);
+    int mFd;
+    char* mData;
+    size_t mMappedSize;
+};
+#endif
+
+#ifndef ANDROID
+// The Python class instance and the conversions to and from it. Lives inside the component with the shared interpreter, or inside the worker process.
+// Everything it needs is in a JSON object (see PythonComponent::mScriptConfig), which is how it gets handed to the worker process
+class PythonScriptHost {
+  public:
+    PythonScriptHost(const json& config, const MessageConverterRegistry* converters);
+    ~PythonScriptHost();
+    void StartInterpreter();
+    void LoadPythonClass();
+    // One entry per slice. Goes through ProcessMessageBatch() if the Python class has it and there is more than one slice, otherwise ProcessMessage() gets called for each
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> CallPythonProcessMessage(const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices);
+  private:
+    PyObject* DecoderMsgHashToPython(const unordered_map<std::string, DecoderMessage_ptr>& msgs);
+    unordered_map<std::string, DecoderMessage_ptr> PythonDictToDecoderMsg(PyObject* pDict);
+    const MessageConverterRegistry* mConverters;
+    PyObject* mPModule;
+    PyObject* mPModuleDict;
+    PyObject* mPClass;
+    bool mHasBatchMethod;
+    std::string mId;
+    bool mVerbose;
+    std::wstring mPythonExec;
+    std::string mScriptName;
+    std::string mPythonPath;
+    std::string mClassName;
+    std::string mConstructorParam;
+    bool mZeroCopyInputs;
+};
+#endif
+
 class PythonComponent : public LoopProcessor {
   public:
     static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
     static std::string describeThyself();
     PythonComponent(std::string id, ComponentGraphConfig* configPt);
     ~PythonComponent();
+#if !defined(ANDROID) && !defined(_MSC_VER)
+    // Body of "godec _worker python", the config is mScriptConfig plus the libraries for converting messages
+    static int RunWorkerProcess(const json& config);
+#endif
 
     //virtual bool RequiresConvStateInput() override { return false; }
 
   private:
     void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
+    void ProcessMessageBatch(const std::vector<DecoderMessageBlock>& msgBlocks) override;
 #ifndef ANDROID
-    PyObject* DecoderMsgHashToPython(const DecoderMessageBlock& msgBlock);
-    unordered_map<std::string, DecoderMessage_ptr> PythonDictToDecoderMsg(PyObject* pDict);
-    PyObject* mPModule;
-    PyObject* mPModuleDict;
-    PyObject* mPClass;
-    PyThreadState* mPMainThread;
-    std::wstring mPythonExec;
+    json mScriptConfig;
+    PythonScriptHost* mScriptHost; // Only with the shared interpreter
+
+    bool mUseWorkerProcess;
+#ifndef _MSC_VER
+    void Start() override;
+    void StartWorkerProcess();
+    std::vector<unordered_map<std::string, DecoderMessage_ptr>> CallWorker(const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices);
+    pid_t mWorkerPid;
+    int mWorkerSocket;
+    WorkerSharedBuffer mToWorker;
+    WorkerSharedBuffer mFromWorker;
+    WireWriter mWorkerFrameWriter; // Kept around so the frame buffer doesn't get reallocated for every call
+#endif
 #endif
 };
 
 }
-
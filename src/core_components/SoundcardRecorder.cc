@@ -211,8 +211,7 @@ void WindowsSoundcardRecorder::ProcessLoop() {
 
 void WindowsSoundcardRecorder::startCapture() {
     mKeepRunning = true;
-    mProcThread = boost::thread(&WindowsSoundcardRecorder::ProcessLoop, this);
-    RegisterThreadForLogging(mProcThread, mGodecComp->getLogPtr(), mGodecComp->isVerbose());
+    mProcThread = mGodecComp->startPlacedThread(boost::bind(&WindowsSoundcardRecorder::ProcessLoop, this), "capture");
 }
 
 void WindowsSoundcardRecorder::stopCapture() {
@@ -387,8 +386,7 @@ void LinuxAudioRecorder::startCapture() {
     if (snd_pcm_start(capture_handle) < 0) GODEC_ERR << "Couldn't start audio capture";
     //if (snd_pcm_pause(capture_handle, 0) < 0) GODEC_ERR << "Couldn't unpause audio capture";
     mKeepRunning = true;
-    mProcThread = boost::thread(&LinuxAudioRecorder::ProcessLoop, this);
-    RegisterThreadForLogging(mProcThread, mGodecComp->getLogPtr(), mGodecComp->isVerbose());
+    mProcThread = mGodecComp->startPlacedThread(boost::bind(&LinuxAudioRecorder::ProcessLoop, this), "capture");
 }
 
 void LinuxAudioRecorder::stopCapture() {
@@ -0,0 +1,133 @@
+#include "StreamRecorder.h"
+#include <boost/chrono.hpp>
+
+namespace Godec {
+
+LoopProcessor* StreamRecorderComponent::make(std::string id, ComponentGraphConfig* configPt) {
+    return new StreamRecorderComponent(id, configPt);
+}
+std::string StreamRecorderComponent::describeThyself() {
+    return "Records every message of its input streams, with arrival times, into a binary file that StreamReplay can play back";
+}
+
+/* StreamRecorderComponent::ExtendedDescription
+A "tap" for capturing exactly what a component sees, for benchmarking or debugging that component in isolation later. Connect any number of streams as inputs (the slot names are free-form, the recording stores the name of the stream itself). Messages are recorded as they arrive, with their original chunking and order across streams, and with the time they arrived at.
+
+The file writing happens on its own thread. If it falls behind by more than "max_backlog_messages" messages, new messages are dropped rather than held, so the tap never slows down the graph. The number of dropped messages per stream is printed at shutdown; a recording with drops is not a faithful copy of the stream.
+
+All message types need to support the binary wire format (all core messages do).
+*/
+
+StreamRecorderComponent::StreamRecorderComponent(std::string id, ComponentGraphConfig* configPt) :
+    LoopProcessor(id, configPt), mNumRecorded(0) {
+    std::string outputFile = configPt->get<std::string>("output_file", "File to write the recording to");
+    int maxBacklog = configPt->get<int>("max_backlog_messages", "Maximum number of messages waiting to be written before new ones get dropped");
+    if (maxBacklog < 1) GODEC_ERR << getLPId(false) << ": max_backlog_messages needs to be at least 1";
+
+    mOutFile.open(outputFile, std::ios::binary);
+    if (!mOutFile.is_open()) GODEC_ERR << getLPId(false) << ": Could not open output file " << outputFile;
+    WireWriter header;
+    header.writeU32(GODEC_RECORDING_MAGIC);
+    header.writeU16(GODEC_RECORDING_VERSION);
+    mOutFile.write(header.data(), header.size());
+
+    // addInputSlotAndUUID(Slot: stream to record, UUID_AnyDecoderMessage);  // For godec doc
+
+    std::list<std::string> requiredOutputSlots;
+    initOutputs(requiredOutputSlots);
+
+    mWriteChannel.setIdVerbose(getLPId(false) + " write queue", isVerbose());
+    mWriteChannel.setMaxItems(maxBacklog);
+}
+
+StreamRecorderComponent::~StreamRecorderComponent() {
+    if (mWriteThread.joinable()) mWriteThread.join();
+}
+
+void StreamRecorderComponent::Start() {
+    mWriteChannel.checkIn(getLPId(false));
+    mWriteThread = startPlacedThread(boost::bind(&StreamRecorderComponent::WriteLoop, this), "writer");
+    LoopProcessor::Start();
+}
+
+void StreamRecorderComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {}
+
+// Bypasses the time slicing of the usual loop, so that messages get recorded the way they arrived
+void StreamRecorderComponent::ProcessLoop() {
+    boost::chrono::steady_clock::time_point startTime;
+    bool gotFirst = false;
+    while (true) {
+        DecoderMessage_ptr newMessage;
+        ChannelReturnResult res = mInputChannel.get(newMessage, FLT_MAX);
+        if (res == ChannelClosed) break;
+        auto now = boost::chrono::steady_clock::now();
+        if (!gotFirst) {
+            startTime = now;
+            gotFirst = true;
+        }
+
+        if (isVerbose()) {
+            std::stringstream verboseStr;
+            verboseStr << "LP " << getLPId() << ": incoming " << newMessage->describeThyself() << std::endl;
+            GODEC_INFO << verboseStr.str();
+        }
+
+        RecordedMessage recMsg;
+        recMsg.mMsg = newMessage;
+        recMsg.mArrivalNs = boost::chrono::duration_cast<boost::chrono::nanoseconds>(now - startTime).count();
+        if (!mWriteChannel.tryPut(recMsg)) mNumDropped[newMessage->getTag()]++;
+        CheckWriteError();
+    }
+    mWriteChannel.checkOut(getLPId(false));
+    mWriteThread.join();
+    CheckWriteError();
+    mOutFile.close();
+
+    std::stringstream summary;
+    summary << getLPId() << ": Recorded " << mNumRecorded << " messages";
+    for (auto it = mNumDropped.begin(); it != mNumDropped.end(); it++) {
+        summary << ", dropped " << it->second << " on stream '" << it->first << "'";
+    }
+    // Drops make the recording incomplete, so they get reported even when not verbose
+    if (mNumDropped.empty()) GODEC_INFO << summary.str() << std::endl;
+    else std::cerr << summary.str() << std::endl;
+    Shutdown();
+}
+
+void StreamRecorderComponent::CheckWriteError() {
+    std::lock_guard<std::mutex> lock(mWriteErrorMutex);
+    if (!mWriteError.empty()) GODEC_ERR << getLPId(false) << ": " << mWriteError;
+}
+
+// Errors can't be thrown from this thread, nothing would catch them. They get stored for ProcessLoop() to throw instead
+void StreamRecorderComponent::WriteLoop() {
+    WireWriter recordWriter;
+    WireWriter msgWriter;
+    std::string error;
+    try {
+        while (error.empty()) {
+            RecordedMessage recMsg;
+            ChannelReturnResult res = mWriteChannel.get(recMsg, FLT_MAX);
+            if (res == ChannelClosed) break;
+            msgWriter.clear();
+            WriteWireMessage(msgWriter, *recMsg.mMsg);
+            recordWriter.clear();
+            recordWriter.writeU64(recMsg.mArrivalNs);
+            recordWriter.writeU64(msgWriter.size());
+            mOutFile.write(recordWriter.data(), recordWriter.size());
+            mOutFile.write(msgWriter.data(), msgWriter.size());
+            if (!mOutFile.good()) error = "Error while writing the recording";
+            else mNumRecorded++;
+        }
+        mOutFile.flush();
+        if (error.empty() && !mOutFile.good()) error = "Error while writing the recording";
+    } catch (const std::exception& e) {
+        error = std::string("Could not serialize a message for the recording. ") + e.what();
+    }
+    if (!error.empty()) {
+        std::lock_guard<std::mutex> lock(mWriteErrorMutex);
+        mWriteError = error;
+    }
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <fstream>
+#include <mutex>
+#include <godec/ChannelMessenger.h>
+#include <godec/WireFormat.h>
+#include "GodecMessages.h"
+
+namespace Godec {
+
+/*
+ * Recording file as written by StreamRecorder and read by StreamReplay:
+ *
+ *   uint32  magic ("GDRC")
+ *   uint16  recording format version
+ *   then per message:
+ *     uint64  arrival time in nanoseconds since the first recorded message
+ *     uint64  size of the encoded message
+ *     the message in the wire format (see godec/WireFormat.h), its tag is the name of the stream it was recorded from
+ */
+static const uint32_t GODEC_RECORDING_MAGIC = 0x43524447; // "GDRC" when read as bytes
+static const uint16_t GODEC_RECORDING_VERSION = 1;
+
+struct RecordedMessage {
+    DecoderMessage_ptr mMsg;
+    uint64_t mArrivalNs;
+};
+
+class StreamRecorderComponent : public LoopProcessor {
+  public:
+    static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
+    static std::string describeThyself();
+    StreamRecorderComponent(std::string id, ComponentGraphConfig* configPt);
+    virtual ~StreamRecorderComponent();
+    void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
+
+  private:
+    void Start() override;
+    void ProcessLoop() override;
+    void WriteLoop();
+    // Throws what WriteLoop() ran into, if anything
+    void CheckWriteError();
+    bool RequiresConvStateInput() override { return false; }
+    bool EnforceInputsOutputs() override { return false; }
+
+    std::ofstream mOutFile;
+    channel<RecordedMessage> mWriteChannel;
+    boost::thread mWriteThread;
+    uint64_t mNumRecorded;
+    std::map<std::string, uint64_t> mNumDropped;
+    std::mutex mWriteErrorMutex;
+    std::string mWriteError;
+};
+
+}
@@ -0,0 +1,91 @@
+#include "StreamReplay.h"
+#include "StreamRecorder.h"
+#include <godec/ComponentGraph.h>
+#include <godec/WireFormat.h>
+#include <boost/chrono.hpp>
+
+namespace Godec {
+
+LoopProcessor* StreamReplayComponent::make(std::string id, ComponentGraphConfig* configPt) {
+    return new StreamReplayComponent(id, configPt);
+}
+std::string StreamReplayComponent::describeThyself() {
+    return "Plays back a recording made by StreamRecorder, either as fast as possible or with the original timing";
+}
+
+/* StreamReplayComponent::ExtendedDescription
+The source counterpart of StreamRecorder. The output slots are the names of the recorded streams, e.g. if the recorder had the "feats" stream connected, "outputs": { "feats": "replayed_feats" } makes the replayed messages available as "replayed_feats". Recorded streams that are not listed in "outputs" are skipped, which allows replaying only part of a recording.
+
+Messages come out in exactly the chunks and order they were recorded in. With "timing" set to "original", each message is held back until the same time after the start as it arrived after the start of the recording, otherwise ("as_fast_as_possible") they get pushed out immediately. The latter measures the raw throughput of the downstream components, the former reproduces the load pattern of a live run.
+*/
+
+StreamReplayComponent::StreamReplayComponent(std::string id, ComponentGraphConfig* configPt) :
+    LoopProcessor(id, configPt) {
+    mInputFile = configPt->get<std::string>("input_file", "Recording to play back");
+    std::string timing = configPt->get<std::string>("timing", "Timing of the playback (as_fast_as_possible, original)");
+    if (timing == "original") mOriginalTiming = true;
+    else if (timing == "as_fast_as_possible") mOriginalTiming = false;
+    else GODEC_ERR << getLPId(false) << ": Unknown timing '" << timing << "'";
+
+    mInFile.open(mInputFile, std::ios::binary);
+    if (!mInFile.is_open()) GODEC_ERR << getLPId(false) << ": Could not open recording " << mInputFile;
+    char headerBytes[sizeof(uint32_t) + sizeof(uint16_t)];
+    mInFile.read(headerBytes, sizeof(headerBytes));
+    if (mInFile.gcount() != sizeof(headerBytes)) GODEC_ERR << getLPId(false) << ": " << mInputFile << " is too short to be a recording";
+    WireReader header(headerBytes, sizeof(headerBytes));
+    if (header.readU32() != GODEC_RECORDING_MAGIC) GODEC_ERR << getLPId(false) << ": " << mInputFile << " is not a Godec stream recording";
+    uint16_t version = header.readU16();
+    if (version > GODEC_RECORDING_VERSION) GODEC_ERR << getLPId(false) << ": " << mInputFile << " has recording format version " << version << ", this Godec only understands up to " << GODEC_RECORDING_VERSION;
+
+    std::list<std::string> requiredOutputSlots;
+    // requiredOutputSlots.push_back(Slot: name of a recorded stream);  // For godec doc
+    initOutputs(requiredOutputSlots);
+    if (mOutputSlots.empty()) GODEC_ERR << getLPId(false) << ": No outputs defined, specify the recorded streams to play back";
+}
+
+StreamReplayComponent::~StreamReplayComponent() {}
+
+void StreamReplayComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {}
+
+bool StreamReplayComponent::readRecord(uint64_t& arrivalNs, std::vector<char>& msgBuffer) {
+    char recordHeader[2 * sizeof(uint64_t)];
+    mInFile.read(recordHeader, sizeof(recordHeader));
+    if (mInFile.gcount() == 0 && mInFile.eof()) return false;
+    if (mInFile.gcount() != sizeof(recordHeader)) GODEC_ERR << getLPId(false) << ": " << mInputFile << " is truncated";
+    WireReader reader(recordHeader, sizeof(recordHeader));
+    arrivalNs = reader.readU64();
+    uint64_t msgSize = reader.readU64();
+    msgBuffer.resize(msgSize);
+    mInFile.read(msgBuffer.data(), msgSize);
+    if ((uint64_t)mInFile.gcount() != msgSize) GODEC_ERR << getLPId(false) << ": " << mInputFile << " is truncated";
+    return true;
+}
+
+void StreamReplayComponent::ProcessLoop() {
+    auto startTime = boost::chrono::steady_clock::now();
+    std::vector<char> msgBuffer;
+    uint64_t arrivalNs;
+    uint64_t numReplayed = 0;
+    std::set<std::string> skippedStreams;
+    while (readRecord(arrivalNs, msgBuffer)) {
+        WireReader reader(msgBuffer.data(), msgBuffer.size());
+        DecoderMessage_ptr msg = GetComponentGraph()->WireToDecoderMsg(reader);
+        std::string stream = msg->getTag();
+        if (mOutputSlots.find(stream) == mOutputSlots.end()) {
+            skippedStreams.insert(stream);
+            continue;
+        }
+        if (mOriginalTiming) boost::this_thread::sleep_until(startTime + boost::chrono::nanoseconds(arrivalNs));
+        pushToOutputs(stream, msg);
+        numReplayed++;
+    }
+    std::stringstream summary;
+    summary << getLPId() << ": Replayed " << numReplayed << " messages";
+    for (auto it = skippedStreams.begin(); it != skippedStreams.end(); it++) {
+        summary << ", skipped stream '" << *it << "'";
+    }
+    GODEC_INFO << summary.str() << std::endl;
+    Shutdown();
+}
+
+}
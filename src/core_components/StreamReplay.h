@@ -0,0 +1,27 @@
+#pragma once
+#include <fstream>
+#include <godec/ChannelMessenger.h>
+#include "GodecMessages.h"
+
+namespace Godec {
+
+class StreamReplayComponent : public LoopProcessor {
+  public:
+    static LoopProcessor* make(std::string id, ComponentGraphConfig* configPt);
+    static std::string describeThyself();
+    StreamReplayComponent(std::string id, ComponentGraphConfig* configPt);
+    virtual ~StreamReplayComponent();
+    void ProcessMessage(const DecoderMessageBlock& msgBlock) override;
+
+  private:
+    void ProcessLoop() override;
+    bool RequiresConvStateInput() override { return false; }
+    bool EnforceInputsOutputs() override { return false; }
+    bool readRecord(uint64_t& arrivalNs, std::vector<char>& msgBuffer);
+
+    std::string mInputFile;
+    std::ifstream mInFile;
+    bool mOriginalTiming;
+};
+
+}
@@ -72,8 +72,7 @@ Submodule::Submodule(std::string id, ComponentGraphConfig* configPt) :
     for(auto v = outputsChild.begin(); v != outputsChild.end(); v++) {
         std::string endpointName = id + ComponentGraph::TREE_LEVEL_SEPARATOR + v.key();
         std::string slotName = v.key();
-        mPullThreads.push_back(boost::thread(&Submodule::PullThread, this, endpointName, slotName));
-        RegisterThreadForLogging(mPullThreads.back(), mLogPtr, isVerbose());
+        mPullThreads.push_back(startPlacedThread(boost::bind(&Submodule::PullThread, this, endpointName, slotName), "pull (" + slotName + ")"));
     }
 }
 
@@ -43,7 +43,7 @@ void SubsampleComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
     }
     if (outMatrixSize == 0) return;
 
-    Matrix outMatrix(mFeatsBuffer.rows(), outMatrixSize);
+    Matrix outMatrix = AcquireMatrix(mFeatsBuffer.rows(), outMatrixSize);
     std::vector<uint64_t> outTimings(outMatrix.cols());
 
     uint64_t lastAddedTime = 0;
@@ -69,10 +69,10 @@ void SubsampleComponent::ProcessMessage(const DecoderMessageBlock& msgBlock) {
     }
 
     mFeatsBuffer = (Matrix)mFeatsBuffer.rightCols(mFeatsBuffer.cols() - numInputFeatsToProcess);
-    mTimingsBuffer = std::vector<uint64_t>(mTimingsBuffer.begin() + numInputFeatsToProcess, mTimingsBuffer.end());
+    mTimingsBuffer.erase(mTimingsBuffer.begin(), mTimingsBuffer.begin() + numInputFeatsToProcess);
     pushToOutputs(SlotFeatures, FeaturesDecoderMessage::create(
                       lastAddedTime, convStateMsg->mUtteranceId,
-                      outMatrix, featsMsg->mFeatureNames, outTimings));
+                      std::move(outMatrix), featsMsg->mFeatureNames, std::move(outTimings)));
 
     if (convStateMsg->mLastChunkInUtt) {
         if (mFeatsBuffer.cols() != 0 || mTimingsBuffer.size() != 0) GODEC_ERR << "Last chunk in utt, but buffers are not empty!";
@@ -337,3 +337,405 @@ cnpy::NpyArray cnpy::npy_load(std::string fname) {
 
 
 
+
+void cnpy::npz_concat(std::string zipname, const std::vector<std::string>& partnames) {
+    FILE* out = fopen(zipname.c_str(),"wb");
+    if(!out) throw std::runtime_error("npz_concat: Unable to open file "+zipname);
+
+    std::vector<char> global_header;
+    std::vector<char> buffer(1 << 20);
+    size_t nrecs = 0;
+    size_t offset = 0;
+    for(size_t part_idx = 0; part_idx < partnames.size(); part_idx++) {
+        FILE* fp = fopen(partnames[part_idx].c_str(),"rb");
+        if(!fp) throw std::runtime_error("npz_concat: Unable to open file "+partnames[part_idx]);
+        uint16_t part_nrecs;
+        size_t part_header_size, part_header_offset;
+        parse_zip_footer(fp,part_nrecs,part_header_size,part_header_offset);
+
+        //the local headers and data go over unchanged
+        fseek(fp,0,SEEK_SET);
+        size_t left = part_header_offset;
+        while(left > 0) {
+            size_t res = fread(&buffer[0],sizeof(char),std::min(left,buffer.size()),fp);
+            if(res == 0) throw std::runtime_error("npz_concat: failed fread");
+            fwrite(&buffer[0],sizeof(char),res,out);
+            left -= res;
+        }
+
+        //the global header entries need their local header offsets moved
+        std::vector<char> part_header(part_header_size);
+        size_t res = fread(&part_header[0],sizeof(char),part_header_size,fp);
+        if(res != part_header_size) throw std::runtime_error("npz_concat: failed fread");
+        size_t pos = 0;
+        for(uint16_t rec = 0; rec < part_nrecs; rec++) {
+            if(pos + 46 > part_header_size) throw std::runtime_error("npz_concat: global header of "+partnames[part_idx]+" is truncated");
+            uint16_t name_len = *(uint16_t*) &part_header[pos+28];
+            uint16_t extra_field_len = *(uint16_t*) &part_header[pos+30];
+            uint16_t comment_len = *(uint16_t*) &part_header[pos+32];
+            *(uint32_t*) &part_header[pos+42] += (uint32_t) offset;
+            pos += 46 + name_len + extra_field_len + comment_len;
+        }
+        global_header.insert(global_header.end(),part_header.begin(),part_header.end());
+        nrecs += part_nrecs;
+        offset += part_header_offset;
+        fclose(fp);
+    }
+    if(nrecs > UINT16_MAX) throw std::runtime_error("npz_concat: too many arrays for "+zipname);
+
+    std::vector<char> footer;
+    footer += "PK"; //first part of sig
+    footer += (uint16_t) 0x0605; //second part of sig
+    footer += (uint16_t) 0; //number of this disk
+    footer += (uint16_t) 0; //disk where footer starts
+    footer += (uint16_t) nrecs; //number of records on this disk
+    footer += (uint16_t) nrecs; //total number of records
+    footer += (uint32_t) global_header.size(); //nbytes of global headers
+    footer += (uint32_t) offset; //offset of start of global headers
+    footer += (uint16_t) 0; //zip file comment length
+
+    if(!global_header.empty()) fwrite(&global_header[0],sizeof(char),global_header.size(),out);
+    fwrite(&footer[0],sizeof(char),footer.size(),out);
+    fclose(out);
+}
+
+template<typename T> static T read_le(const char* p) {
+    T val;
+    memcpy(&val,p,sizeof(T));
+    return val;
+}
+
+//Parses the header of an npy array in memory, returns the offset of the data
+static size_t parse_npy_buffer(const char* buffer, size_t size, cnpy::NpyInfo& info) {
+    if(size < 10 || memcmp(buffer,"\x93NUMPY",6) != 0) throw std::runtime_error("parse_npy_header: not an npy array");
+    uint8_t major_version = (uint8_t) buffer[6];
+    size_t header_start = major_version == 1 ? 10 : 12;
+    if(size < header_start) throw std::runtime_error("parse_npy_header: truncated header");
+    size_t header_len = major_version == 1 ? read_le<uint16_t>(buffer+8) : read_le<uint32_t>(buffer+8);
+    if(header_start + header_len > size) throw std::runtime_error("parse_npy_header: truncated header");
+    std::string header(buffer+header_start,header_len);
+
+    size_t loc1 = header.find("fortran_order");
+    if(loc1 == std::string::npos) throw std::runtime_error("parse_npy_header: failed to find header keyword: 'fortran_order'");
+    info.fortran_order = header.substr(loc1+16,4) == "True";
+
+    loc1 = header.find("(");
+    size_t loc2 = header.find(")");
+    if(loc1 == std::string::npos || loc2 == std::string::npos) throw std::runtime_error("parse_npy_header: failed to find header keyword: '(' or ')'");
+    info.shape.clear();
+    info.num_vals = 1;
+    size_t dim = 0;
+    bool in_number = false;
+    for(size_t pos = loc1+1; pos <= loc2; pos++) {
+        if(header[pos] >= '0' && header[pos] <= '9') {
+            dim = dim*10 + (header[pos]-'0');
+            in_number = true;
+        } else if(in_number) {
+            info.shape.push_back(dim);
+            info.num_vals *= dim;
+            dim = 0;
+            in_number = false;
+        }
+    }
+
+    loc1 = header.find("descr");
+    if(loc1 == std::string::npos || loc1+11 >= header.size()) throw std::runtime_error("parse_npy_header: failed to find header keyword: 'descr'");
+    loc1 += 9;
+    info.type = header[loc1+1];
+    info.word_size = atoi(header.c_str()+loc1+2);
+    if(header[loc1] == '>' && info.word_size > 1) throw std::runtime_error("parse_npy_header: big-endian arrays are not supported");
+    return header_start + header_len;
+}
+
+cnpy::npz_index::npz_index(std::string _fname) : fname(_fname) {
+    try {
+        file.open(fname);
+    } catch(const std::exception& e) {
+        throw std::runtime_error("npz_index: Unable to open file "+fname);
+    }
+    const char* base = file.data();
+    size_t size = file.size();
+
+    //the end of central directory record is last, unless the archive has a comment
+    if(size < 22) throw std::runtime_error("npz_index: "+fname+" is not a zip file");
+    size_t eocd = size-22;
+    size_t eocd_min = size > 22+65535 ? size-22-65535 : 0;
+    while(read_le<uint32_t>(base+eocd) != 0x06054b50) {
+        if(eocd == eocd_min) throw std::runtime_error("npz_index: "+fname+" is not a zip file");
+        eocd--;
+    }
+    uint64_t nrecs = read_le<uint16_t>(base+eocd+10);
+    uint64_t global_header_size = read_le<uint32_t>(base+eocd+12);
+    uint64_t global_header_offset = read_le<uint32_t>(base+eocd+16);
+    if(nrecs == 0xFFFF || global_header_size == 0xFFFFFFFF || global_header_offset == 0xFFFFFFFF) {
+        //zip64, which numpy writes for big arrays
+        if(eocd < 20 || read_le<uint32_t>(base+eocd-20) != 0x07064b50) throw std::runtime_error("npz_index: zip64 locator missing in "+fname);
+        uint64_t eocd64 = read_le<uint64_t>(base+eocd-20+8);
+        if(eocd64 + 56 > size || read_le<uint32_t>(base+eocd64) != 0x06064b50) throw std::runtime_error("npz_index: corrupt zip64 record in "+fname);
+        nrecs = read_le<uint64_t>(base+eocd64+32);
+        global_header_size = read_le<uint64_t>(base+eocd64+40);
+        global_header_offset = read_le<uint64_t>(base+eocd64+48);
+    }
+    if(global_header_offset + global_header_size > size) throw std::runtime_error("npz_index: global header of "+fname+" is truncated");
+
+    size_t pos = global_header_offset;
+    size_t global_header_end = global_header_offset + global_header_size;
+    for(uint64_t rec = 0; rec < nrecs; rec++) {
+        if(pos + 46 > global_header_end || read_le<uint32_t>(base+pos) != 0x02014b50) throw std::runtime_error("npz_index: corrupt global header in "+fname);
+        entry e;
+        e.compr_method = read_le<uint16_t>(base+pos+10);
+        e.compr_bytes = read_le<uint32_t>(base+pos+20);
+        e.uncompr_bytes = read_le<uint32_t>(base+pos+24);
+        uint16_t name_len = read_le<uint16_t>(base+pos+28);
+        uint16_t extra_field_len = read_le<uint16_t>(base+pos+30);
+        uint16_t comment_len = read_le<uint16_t>(base+pos+32);
+        e.local_header_offset = read_le<uint32_t>(base+pos+42);
+        if(pos + 46 + name_len + extra_field_len + comment_len > global_header_end) throw std::runtime_error("npz_index: corrupt global header in "+fname);
+        std::string varname(base+pos+46,name_len);
+
+        //the zip64 extra field has the values that didn't fit, in this order
+        const char* extra = base+pos+46+name_len;
+        for(size_t field = 0; field + 4 <= extra_field_len;) {
+            uint16_t field_id = read_le<uint16_t>(extra+field);
+            uint16_t field_len = read_le<uint16_t>(extra+field+2);
+            if(field_id == 0x0001) {
+                size_t val = field+4;
+                size_t val_end = std::min((size_t)extra_field_len,field+4+field_len);
+                if(e.uncompr_bytes == 0xFFFFFFFF && val+8 <= val_end) { e.uncompr_bytes = read_le<uint64_t>(extra+val); val += 8; }
+                if(e.compr_bytes == 0xFFFFFFFF && val+8 <= val_end) { e.compr_bytes = read_le<uint64_t>(extra+val); val += 8; }
+                if(e.local_header_offset == 0xFFFFFFFF && val+8 <= val_end) { e.local_header_offset = read_le<uint64_t>(extra+val); val += 8; }
+            }
+            field += 4 + field_len;
+        }
+
+        //erase the lagging .npy
+        if(varname.size() >= 4 && varname.compare(varname.size()-4,4,".npy") == 0) varname.erase(varname.size()-4);
+        if(entries.find(varname) == entries.end()) names.push_back(varname);
+        entries[varname] = e;
+        pos += 46 + name_len + extra_field_len + comment_len;
+    }
+}
+
+bool cnpy::npz_index::contains(const std::string& varname) const {
+    return entries.find(varname) != entries.end();
+}
+
+const cnpy::npz_index::entry& cnpy::npz_index::find(const std::string& varname) const {
+    auto it = entries.find(varname);
+    if(it == entries.end()) throw std::runtime_error("npz_index: Variable name "+varname+" not found in "+fname);
+    return it->second;
+}
+
+const char* cnpy::npz_index::entry_data(const entry& e) const {
+    const char* base = file.data();
+    if(e.local_header_offset + 30 > file.size() || read_le<uint32_t>(base+e.local_header_offset) != 0x04034b50) throw std::runtime_error("npz_index: corrupt local header in "+fname);
+    //the local extra field can differ from the one in the global header
+    size_t data_offset = e.local_header_offset + 30 + read_le<uint16_t>(base+e.local_header_offset+26) + read_le<uint16_t>(base+e.local_header_offset+28);
+    if(data_offset + e.compr_bytes > file.size()) throw std::runtime_error("npz_index: array data runs past the end of "+fname);
+    return base + data_offset;
+}
+
+const char* cnpy::npz_index::view(const std::string& varname, NpyInfo& info) const {
+    const entry& e = find(varname);
+    if(e.compr_method != 0) return nullptr;
+    const char* data = entry_data(e);
+    size_t header_size = parse_npy_buffer(data,e.compr_bytes,info);
+    if(header_size + info.num_vals*info.word_size > e.compr_bytes) throw std::runtime_error("npz_index: array "+varname+" in "+fname+" is truncated");
+    return data + header_size;
+}
+
+cnpy::NpyArray cnpy::npz_index::load(const std::string& varname, NpyInfo& info) const {
+    const entry& e = find(varname);
+    const char* data = entry_data(e);
+    size_t size = e.compr_bytes;
+    std::vector<char> buffer_uncompr;
+    if(e.compr_method == 8) {
+        if(e.compr_bytes > UINT32_MAX || e.uncompr_bytes > UINT32_MAX) throw std::runtime_error("npz_index: compressed array "+varname+" in "+fname+" is too big");
+        buffer_uncompr.resize(e.uncompr_bytes);
+        z_stream d_stream;
+        d_stream.zalloc = Z_NULL;
+        d_stream.zfree = Z_NULL;
+        d_stream.opaque = Z_NULL;
+        d_stream.avail_in = 0;
+        d_stream.next_in = Z_NULL;
+        if(inflateInit2(&d_stream, -MAX_WBITS) != Z_OK) throw std::runtime_error("npz_index: inflateInit2 failed");
+        d_stream.avail_in = e.compr_bytes;
+        d_stream.next_in = (Bytef*) data;
+        d_stream.avail_out = e.uncompr_bytes;
+        d_stream.next_out = (Bytef*) &buffer_uncompr[0];
+        int err = inflate(&d_stream, Z_FINISH);
+        inflateEnd(&d_stream);
+        if(err != Z_STREAM_END) throw std::runtime_error("npz_index: could not inflate array "+varname+" in "+fname);
+        data = &buffer_uncompr[0];
+        size = e.uncompr_bytes;
+    } else if(e.compr_method != 0) {
+        throw std::runtime_error("npz_index: array "+varname+" in "+fname+" uses an unsupported compression method");
+    }
+
+    size_t header_size = parse_npy_buffer(data,size,info);
+    NpyArray arr(info.shape,info.word_size,info.fortran_order);
+    if(header_size + arr.num_bytes() > size) throw std::runtime_error("npz_index: array "+varname+" in "+fname+" is truncated");
+    if(arr.num_bytes() > 0) memcpy(arr.data<char>(),data+header_size,arr.num_bytes());
+    return arr;
+}
+
+cnpy::npz_writer::npz_writer(std::string _zipname) : zipname(_zipname), nrecs(0), offset(0), in_array(false) {
+    fp = fopen(zipname.c_str(),"wb");
+    if(!fp) throw std::runtime_error("npz_writer: Unable to open file "+zipname);
+}
+
+cnpy::npz_writer::~npz_writer() {
+    try {
+        close();
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+std::vector<char> cnpy::npz_writer::npy_header(const std::vector<size_t>& shape, size_t min_size) const {
+    std::vector<char> dict;
+    dict += "{'descr': '";
+    dict += BigEndianTest();
+    dict += cur_type;
+    dict += std::to_string(cur_word_size);
+    dict += cur_fortran_order ? "', 'fortran_order': True, 'shape': (" : "', 'fortran_order': False, 'shape': (";
+    for(size_t i = 0; i < shape.size(); i++) {
+        if(i > 0) dict += ", ";
+        dict += std::to_string(shape[i]);
+    }
+    if(shape.size() == 1) dict += ",";
+    dict += "), }";
+    //pad with spaces so that preamble+dict is modulo 16 bytes (and at least min_size). preamble is 10 bytes. dict needs to end with \n
+    size_t size = 10 + dict.size() + 1;
+    size = std::max(size + (16 - size % 16) % 16, min_size);
+    dict.insert(dict.end(),size - 10 - dict.size(),' ');
+    dict.back() = '\n';
+
+    std::vector<char> header;
+    header += (char) 0x93;
+    header += "NUMPY";
+    header += (char) 0x01; //major version of numpy format
+    header += (char) 0x00; //minor version of numpy format
+    header += (uint16_t) dict.size();
+    header.insert(header.end(),dict.begin(),dict.end());
+    return header;
+}
+
+void cnpy::npz_writer::begin_array(std::string fname, char type, size_t word_size, bool fortran_order, const std::vector<size_t>& fixed_shape, const std::vector<size_t>* full_shape) {
+    if(fp == NULL) throw std::runtime_error("npz_writer: "+zipname+" is already closed");
+    if(in_array) throw std::runtime_error("npz_writer: array "+cur_fname+" hasn't been ended");
+    if(nrecs == UINT16_MAX) throw std::runtime_error("npz_writer: too many arrays for "+zipname);
+    in_array = true;
+    cur_fname = fname + ".npy";
+    cur_type = type;
+    cur_word_size = word_size;
+    cur_fortran_order = fortran_order;
+    cur_fixed_shape = fixed_shape;
+    cur_local_header_offset = offset;
+    cur_num_vals = 0;
+
+    //until end() knows the real size, the header has room for the largest one
+    std::vector<size_t> shape = fixed_shape;
+    if(full_shape != nullptr) shape = *full_shape;
+    else shape.insert(fortran_order ? shape.end() : shape.begin(),SIZE_MAX);
+    std::vector<char> header = npy_header(shape,0);
+    cur_npy_header_size = header.size();
+
+    //sizes and crc get filled in by end()
+    std::vector<char> local_header;
+    local_header += "PK"; //first part of sig
+    local_header += (uint16_t) 0x0403; //second part of sig
+    local_header += (uint16_t) 20; //min version to extract
+    local_header += (uint16_t) 0; //general purpose bit flag
+    local_header += (uint16_t) 0; //compression method
+    local_header += (uint16_t) 0; //file last mod time
+    local_header += (uint16_t) 0;     //file last mod date
+    local_header += (uint32_t) 0; //crc
+    local_header += (uint32_t) 0; //compressed size
+    local_header += (uint32_t) 0; //uncompressed size
+    local_header += (uint16_t) cur_fname.size(); //fname length
+    local_header += (uint16_t) 0; //extra field length
+    local_header += cur_fname;
+
+    fwrite(&local_header[0],sizeof(char),local_header.size(),fp);
+    fwrite(&header[0],sizeof(char),header.size(),fp);
+    offset += local_header.size() + header.size();
+}
+
+void cnpy::npz_writer::write_values(const void* data, size_t num_vals) {
+    if(!in_array) throw std::runtime_error("npz_writer: write() outside of begin() and end()");
+    size_t nbytes = num_vals*cur_word_size;
+    if(nbytes == 0) return;
+    cur_crc = crc32(cur_num_vals == 0 ? 0L : cur_crc,(const uint8_t*)data,nbytes);
+    if(fwrite(data,sizeof(char),nbytes,fp) != nbytes) throw std::runtime_error("npz_writer: failed fwrite to "+zipname);
+    cur_num_vals += num_vals;
+    offset += nbytes;
+}
+
+void cnpy::npz_writer::end() {
+    if(!in_array) throw std::runtime_error("npz_writer: end() without begin()");
+    in_array = false;
+    size_t slice_vals = std::accumulate(cur_fixed_shape.begin(),cur_fixed_shape.end(),(size_t)1,std::multiplies<size_t>());
+    if(slice_vals == 0 ? cur_num_vals != 0 : cur_num_vals % slice_vals != 0) throw std::runtime_error("npz_writer: number of values written to "+cur_fname+" doesn't fit its shape");
+    std::vector<size_t> shape = cur_fixed_shape;
+    shape.insert(cur_fortran_order ? shape.end() : shape.begin(),slice_vals == 0 ? 0 : cur_num_vals / slice_vals);
+    std::vector<char> header = npy_header(shape,cur_npy_header_size);
+    if(header.size() != cur_npy_header_size) throw std::runtime_error("npz_writer: npy header of "+cur_fname+" grew");
+
+    //the crc covers the npy header too, which is written before the data but only known now
+    uint32_t crc = crc32(0L,(const uint8_t*)&header[0],header.size());
+    if(cur_num_vals > 0) crc = crc32_combine(crc,cur_crc,cur_num_vals*cur_word_size);
+    size_t nbytes = header.size() + cur_num_vals*cur_word_size;
+    if(nbytes > UINT32_MAX || offset > UINT32_MAX) throw std::runtime_error("npz_writer: "+zipname+" would need zip64, which isn't supported");
+
+    std::vector<char> sizes;
+    sizes += (uint32_t) crc; //crc
+    sizes += (uint32_t) nbytes; //compressed size
+    sizes += (uint32_t) nbytes; //uncompressed size
+    fseek(fp,cur_local_header_offset+14,SEEK_SET);
+    fwrite(&sizes[0],sizeof(char),sizes.size(),fp);
+    fseek(fp,cur_local_header_offset+30+cur_fname.size(),SEEK_SET);
+    fwrite(&header[0],sizeof(char),header.size(),fp);
+    fseek(fp,offset,SEEK_SET);
+
+    global_header += "PK"; //first part of sig
+    global_header += (uint16_t) 0x0201; //second part of sig
+    global_header += (uint16_t) 20; //version made by
+    global_header += (uint16_t) 20; //min version to extract
+    global_header += (uint16_t) 0; //general purpose bit flag
+    global_header += (uint16_t) 0; //compression method
+    global_header += (uint16_t) 0; //file last mod time
+    global_header += (uint16_t) 0;     //file last mod date
+    global_header.insert(global_header.end(),sizes.begin(),sizes.end());
+    global_header += (uint16_t) cur_fname.size(); //fname length
+    global_header += (uint16_t) 0; //extra field length
+    global_header += (uint16_t) 0; //file comment length
+    global_header += (uint16_t) 0; //disk number where file starts
+    global_header += (uint16_t) 0; //internal file attributes
+    global_header += (uint32_t) 0; //external file attributes
+    global_header += (uint32_t) cur_local_header_offset; //relative offset of local file header
+    global_header += cur_fname;
+    nrecs++;
+}
+
+void cnpy::npz_writer::close() {
+    if(fp == NULL) return;
+    if(in_array) end();
+
+    std::vector<char> footer;
+    footer += "PK"; //first part of sig
+    footer += (uint16_t) 0x0605; //second part of sig
+    footer += (uint16_t) 0; //number of this disk
+    footer += (uint16_t) 0; //disk where footer starts
+    footer += (uint16_t) nrecs; //number of records on this disk
+    footer += (uint16_t) nrecs; //total number of records
+    footer += (uint32_t) global_header.size(); //nbytes of global headers
+    footer += (uint32_t) offset; //offset of start of global headers
+    footer += (uint16_t) 0; //zip file comment length
+
+    if(!global_header.empty()) fwrite(&global_header[0],sizeof(char),global_header.size(),fp);
+    fwrite(&footer[0],sizeof(char),footer.size(),fp);
+    int res = fclose(fp);
+    fp = NULL;
+    if(res != 0) throw std::runtime_error("npz_writer: failed to close "+zipname);
+}
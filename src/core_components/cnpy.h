@@ -20,6 +20,9 @@
 #include<memory>
 #include<stdint.h>
 #include<numeric>
+#include<functional>
+#include<algorithm>
+#include<boost/iostreams/device/mapped_file.hpp>
 
 namespace cnpy {
 
@@ -63,6 +66,44 @@ struct NpyArray {
 
 using npz_t = std::map<std::string, NpyArray>;
 
+//Header of an array. type is the numpy type character, e.g. 'f' for float32/float64 (told apart by word_size)
+struct NpyInfo {
+    std::vector<size_t> shape;
+    size_t word_size;
+    char type;
+    bool fortran_order;
+    size_t num_vals;
+};
+
+//Index of the arrays in an npz file, built once from the zip central directory, so that looking up an array does not scan the archive.
+//The file is memory-mapped, arrays that are stored uncompressed (np.savez, npz_save) are read straight out of the mapping
+class npz_index {
+  public:
+    npz_index(std::string fname);
+    bool contains(const std::string& varname) const;
+    //Array names, in archive order
+    const std::vector<std::string>& keys() const { return names; }
+    //Pointer to the array data inside the mapping, and its header. Returns nullptr (and leaves info alone) if the array is compressed
+    const char* view(const std::string& varname, NpyInfo& info) const;
+    //Copy of the array, inflated if it is compressed
+    NpyArray load(const std::string& varname, NpyInfo& info) const;
+
+  private:
+    struct entry {
+        uint16_t compr_method;
+        size_t local_header_offset;
+        size_t compr_bytes;
+        size_t uncompr_bytes;
+    };
+    const entry& find(const std::string& varname) const;
+    const char* entry_data(const entry& e) const;
+
+    std::string fname;
+    boost::iostreams::mapped_file_source file;
+    std::vector<std::string> names;
+    std::map<std::string, entry> entries;
+};
+
 char BigEndianTest();
 char map_type(const std::type_info& t);
 template<typename T> std::vector<char> create_npy_header(const std::vector<size_t>& shape);
@@ -72,6 +113,59 @@ void parse_zip_footer(FILE* fp, uint16_t& nrecs, size_t& global_header_size, siz
 npz_t npz_load(std::string fname);
 NpyArray npz_load(std::string fname, std::string varname);
 NpyArray npy_load(std::string fname);
+//Writes the arrays of the (uncompressed) npz files in partnames, in that order, into zipname. Same result as having npz_save'd them all into zipname
+void npz_concat(std::string zipname, const std::vector<std::string>& partnames);
+
+//Writes an npz file one array after the other, without re-reading the archive for each array like npz_save(..., "a") does.
+//The global header is kept in memory and written by close() (or the destructor), so the file is only a valid npz after that.
+//An array whose size isn't known up front can be written in pieces between begin() and end(). It grows along its last dimension
+//when in Fortran order, along its first in C order; fixed_shape are the other dimensions
+class npz_writer {
+  public:
+    npz_writer(std::string zipname);
+    ~npz_writer();
+
+    template<typename T> void save(std::string fname, const T* data, const std::vector<size_t>& shape, bool fortran_order = false) {
+        if(shape.empty()) throw std::runtime_error("npz_writer: arrays need at least one dimension");
+        std::vector<size_t> fixed_shape = shape;
+        fixed_shape.erase(fortran_order ? fixed_shape.end()-1 : fixed_shape.begin());
+        begin_array(fname,map_type(typeid(T)),sizeof(T),fortran_order,fixed_shape,&shape);
+        write_values(data,std::accumulate(shape.begin(),shape.end(),(size_t)1,std::multiplies<size_t>()));
+        end();
+    }
+    template<typename T> void begin(std::string fname, const std::vector<size_t>& fixed_shape, bool fortran_order = false) {
+        begin_array(fname,map_type(typeid(T)),sizeof(T),fortran_order,fixed_shape,nullptr);
+    }
+    template<typename T> void write(const T* data, size_t num_vals) {
+        if(map_type(typeid(T)) != cur_type || sizeof(T) != cur_word_size) throw std::runtime_error("npz_writer: type of the values doesn't match the array");
+        write_values(data,num_vals);
+    }
+    void end();
+    void close();
+
+  private:
+    void begin_array(std::string fname, char type, size_t word_size, bool fortran_order, const std::vector<size_t>& fixed_shape, const std::vector<size_t>* full_shape);
+    void write_values(const void* data, size_t num_vals);
+    std::vector<char> npy_header(const std::vector<size_t>& shape, size_t min_size) const;
+
+    std::string zipname;
+    FILE* fp;
+    std::vector<char> global_header;
+    uint16_t nrecs;
+    size_t offset;
+
+    //the array that is being written
+    bool in_array;
+    std::string cur_fname;
+    char cur_type;
+    size_t cur_word_size;
+    bool cur_fortran_order;
+    std::vector<size_t> cur_fixed_shape;
+    size_t cur_local_header_offset;
+    size_t cur_npy_header_size;
+    size_t cur_num_vals;
+    uint32_t cur_crc;
+};
 
 template<typename T> std::vector<char>& operator+=(std::vector<char>& lhs, const T rhs) {
     //write in little endian
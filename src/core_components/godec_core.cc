@@ -1,4 +1,5 @@
 #include "godec/version.h"
+#include <godec/ComponentGraph.h>
 #include "Energy.h"
 #include "NoiseAdd.h"
 #include "FeatureMerger.h"
@@ -7,6 +8,11 @@
 #include "Router.h"
 #include "Merger.h"
 #include "Subsample.h"
+#include "StreamRecorder.h"
+#include "StreamReplay.h"
+#include "BridgeSender.h"
+#include "BridgeReceiver.h"
+#include "ProcessHost.h"
 #include "Average.h"
 #include "SoundcardRecorder.h"
 #include "SoundcardPlayback.h"
@@ -46,6 +52,7 @@ extern "C" {
     JNIEXPORT LoopProcessor* GodecGetComponent(std::string compString, std::string id, ComponentGraphConfig* configPt) {
         if (compString == "ApiEndpoint") return ApiEndpoint::make(id,configPt);
         if (compString == "SubModule") return Submodule::make(id,configPt);
+        if (compString == "ProcessHost") return ProcessHostComponent::make(id,configPt);
         if (compString == "AudioPreProcessor") return AudioPreProcessorComponent::make(id,configPt);
         if (compString == "FileFeeder") return FileFeederComponent::make(id,configPt);
         if (compString == "FileWriter") return FileWriterComponent::make(id,configPt);
@@ -58,6 +65,10 @@ extern "C" {
         else if (compString == "Router") return RouterComponent::make(id,configPt);
         else if (compString == "Merger") return MergerComponent::make(id,configPt);
         else if (compString == "Subsample") return SubsampleComponent::make(id,configPt);
+        else if (compString == "StreamRecorder") return StreamRecorderComponent::make(id,configPt);
+        else if (compString == "StreamReplay") return StreamReplayComponent::make(id,configPt);
+        else if (compString == "BridgeSender") return BridgeSenderComponent::make(id,configPt);
+        else if (compString == "BridgeReceiver") return BridgeReceiverComponent::make(id,configPt);
         else if (compString == "SoundcardRecorder") return SoundcardRecorderComponent::make(id,configPt);
         else if (compString == "SoundcardPlayer") return SoundcardPlayerComponent::make(id,configPt);
         else if (compString == "Java") return JavaComponent::make(id,configPt);
@@ -79,10 +90,25 @@ extern "C" {
         std::cout << "Router: " << RouterComponent::describeThyself() << std::endl;
         std::cout << "Merger: " << MergerComponent::describeThyself() << std::endl;
         std::cout << "Subsample: " << SubsampleComponent::describeThyself() << std::endl;
+        std::cout << "StreamRecorder: " << StreamRecorderComponent::describeThyself() << std::endl;
+        std::cout << "StreamReplay: " << StreamReplayComponent::describeThyself() << std::endl;
+        std::cout << "BridgeSender: " << BridgeSenderComponent::describeThyself() << std::endl;
+        std::cout << "BridgeReceiver: " << BridgeReceiverComponent::describeThyself() << std::endl;
         std::cout << "SoundcardRecorder: " << SoundcardRecorderComponent::describeThyself() << std::endl;
         std::cout << "SoundcardPlayer: " << SoundcardPlayerComponent::describeThyself() << std::endl;
         std::cout << "Java: " << JavaComponent::describeThyself() << std::endl;
         std::cout << "Python: " << PythonComponent::describeThyself() << std::endl;
+        std::cout << "ProcessHost: " << ProcessHostComponent::describeThyself() << std::endl;
+    }
+
+    // Runs the worker processes of the core components, see ComponentGraph::RunWorker(). Only needed in libgodec_core, other libraries don't have to define it
+    JNIEXPORT int GodecRunWorker(std::string kind, std::string config) {
+#if !defined(ANDROID) && !defined(_MSC_VER)
+        if (kind == "python") return PythonComponent::RunWorkerProcess(json::parse(config));
+        if (kind == "process_host") return ProcessHostComponent::RunWorkerProcess(json::parse(config));
+#endif
+        GODEC_ERR << "Unknown worker process type '" << kind << "'";
+        return -1;
     }
 
     // For checking whether all libraries are of the same version
@@ -90,27 +116,27 @@ extern "C" {
         return GODEC_VERSION_STRING;
     }
 
+    // The message types this library can convert from Java, Python and the wire format. Godec registers them when it loads the library, so converting a pushed message is a single lookup
+    JNIEXPORT std::vector<GodecMessageConverter> GodecGetMessageConverters() {
+        return GetCoreMessageConverters();
+    }
+
+    // Only used for libraries that don't export GodecGetMessageConverters(), kept as the fallback for older libraries.
     // For messages that you want to shuttle across the JNI layer. If you have no custom messages, still define it but just return nullptr
     JNIEXPORT DecoderMessage_ptr GodecJNIToMsg(JNIEnv* env, jobject jMsg) {
-        jclass AudioDecoderMessageClass = env->FindClass("com/bbn/godec/AudioDecoderMessage");
-        jclass ConversationStateDecoderMessageClass = env->FindClass("com/bbn/godec/ConversationStateDecoderMessage");
-        jclass BinaryDecoderMessageClass = env->FindClass("com/bbn/godec/BinaryDecoderMessage");
-        jclass FeaturesDecoderMessageClass = env->FindClass("com/bbn/godec/FeaturesDecoderMessage");
-        jclass NbestDecoderMessageClass = env->FindClass("com/bbn/godec/NbestDecoderMessage");
-        jclass JsonDecoderMessageClass = env->FindClass("com/bbn/godec/JsonDecoderMessage");
-
+        const JNIIds& ids = GetJNIIds(env);
         DecoderMessage_ptr outMsg = nullptr;
-        if (env->IsInstanceOf(jMsg, AudioDecoderMessageClass)) {
+        if (env->IsInstanceOf(jMsg, ids.mAudioMsg)) {
             outMsg = AudioDecoderMessage::fromJNI(env, jMsg);
-        } else if (env->IsInstanceOf(jMsg, ConversationStateDecoderMessageClass)) {
+        } else if (env->IsInstanceOf(jMsg, ids.mConvStateMsg)) {
             outMsg = ConversationStateDecoderMessage::fromJNI(env, jMsg);
-        } else if (env->IsInstanceOf(jMsg, NbestDecoderMessageClass)) {
+        } else if (env->IsInstanceOf(jMsg, ids.mNbestMsg)) {
             outMsg = NbestDecoderMessage::fromJNI(env, jMsg);
-        } else if (env->IsInstanceOf(jMsg, BinaryDecoderMessageClass)) {
+        } else if (env->IsInstanceOf(jMsg, ids.mBinaryMsg)) {
             outMsg = BinaryDecoderMessage::fromJNI(env, jMsg);
-        } else if (env->IsInstanceOf(jMsg, FeaturesDecoderMessageClass)) {
+        } else if (env->IsInstanceOf(jMsg, ids.mFeaturesMsg)) {
             outMsg = FeaturesDecoderMessage::fromJNI(env, jMsg);
-        } else if (env->IsInstanceOf(jMsg, JsonDecoderMessageClass)) {
+        } else if (env->IsInstanceOf(jMsg, ids.mJsonMsg)) {
             outMsg = JsonDecoderMessage::fromJNI(env, jMsg);
         }
 
@@ -136,6 +162,10 @@ extern "C" {
             outMsg = FeaturesDecoderMessage::fromPython(pMsg);
         } else if (type == "JsonDecoderMessage") {
             outMsg = JsonDecoderMessage::fromPython(pMsg);
+        } else if (type == "MatrixDecoderMessage") {
+            outMsg = MatrixDecoderMessage::fromPython(pMsg);
+        } else if (type == "AudioInfoDecoderMessage") {
+            outMsg = AudioInfoDecoderMessage::fromPython(pMsg);
         }
 
         return outMsg;
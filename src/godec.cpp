@@ -1,7 +1,11 @@
 #include <godec/ComponentGraph.h>
 #include "core_components/ApiEndpoint.h"
+#include "core_components/GodecMessages.h"
+#include "core_components/FileFeeder.h"
+#include "core_components/cnpy.h"
 #include <jni.h>
 #include <thread>
+#include <mutex>
 #include <malloc.h>
 #ifdef ANDROID
 #include <pthread.h>
@@ -14,6 +18,9 @@
 
 #include <boost/program_options.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/format.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
 namespace po = boost::program_options;
 using namespace Godec;
 
@@ -47,7 +54,420 @@ void PrintUsage() {
               "Godec, the stream processing engine\n\n"
               "Usage:\n"
               "  godec [overrides] <json>    | Overrides are specified with '-x \"a.b=c\"', where a is top-level component, b its child parameter.\n"
-              "  godec list <core|libname>   | List available components in library. Library is looked up as libgodec_<libname>.so\n";
+              "  godec list <core|libname>   | List available components in library. Library is looked up as libgodec_<libname>.so\n"
+              "  godec wire_test [iterations]| Round-trip every core message type through the binary wire format, report throughput\n"
+              "  godec converter_test        | Check that the message converter registry hands each message type to the library that registered it\n"
+              "  godec [overrides] batch <instances> <json>\n"
+              "                              | Split the graph's analist by conversation and process the conversations on this many graph instances in parallel. Output files are the same as for a single run\n";
+}
+
+// One message of each core type, at sizes typical for a speech pipeline
+static std::vector<std::pair<std::string, DecoderMessage_ptr>> CreateWireTestMessages() {
+    std::vector<std::pair<std::string, DecoderMessage_ptr>> msgs;
+    Vector audio = Vector::Random(16000);
+    msgs.push_back(std::make_pair("AudioDecoderMessage", AudioDecoderMessage::create(16000, std::move(audio), 16000.0f, 1.0f)));
+    msgs.push_back(std::make_pair("AudioInfoDecoderMessage", AudioInfoDecoderMessage::create(16000, 16000.0f, 1.0f)));
+    std::vector<uint64_t> featTimes;
+    for(int frameIdx = 0; frameIdx < 100; frameIdx++) featTimes.push_back(160 * (frameIdx + 1));
+    msgs.push_back(std::make_pair("FeaturesDecoderMessage", FeaturesDecoderMessage::create(16000, "utt_1", Matrix::Random(40, 100), "RAW[0:39]%f", featTimes)));
+    msgs.push_back(std::make_pair("MatrixDecoderMessage", MatrixDecoderMessage::create(16000, Matrix(Matrix::Random(256, 256)))));
+    std::vector<std::vector<std::string>> text(10);
+    std::vector<std::vector<uint64_t>> words(10), alignment(10);
+    std::vector<std::vector<float>> confidences(10);
+    for(int entryIdx = 0; entryIdx < 10; entryIdx++) {
+        for(int wordIdx = 0; wordIdx < 20; wordIdx++) {
+            text[entryIdx].push_back("word" + std::to_string(wordIdx));
+            words[entryIdx].push_back(wordIdx);
+            alignment[entryIdx].push_back(800 * (wordIdx + 1));
+            confidences[entryIdx].push_back(1.0f / (entryIdx + 1));
+        }
+    }
+    msgs.push_back(std::make_pair("NbestDecoderMessage", NbestDecoderMessage::create(16000, text, words, alignment, confidences)));
+    msgs.push_back(std::make_pair("ConversationStateDecoderMessage", ConversationStateDecoderMessage::create(16000, "utt_1", true, "convo_1", false)));
+    std::vector<unsigned char> bytes(4096);
+    for(size_t byteIdx = 0; byteIdx < bytes.size(); byteIdx++) bytes[byteIdx] = (unsigned char)(byteIdx * 7);
+    msgs.push_back(std::make_pair("BinaryDecoderMessage", BinaryDecoderMessage::create(16000, bytes, "raw")));
+    json jsonObj;
+    jsonObj["utterance"] = "utt_1";
+    jsonObj["scores"] = {0.5, 0.25, 0.125};
+    msgs.push_back(std::make_pair("JsonDecoderMessage", JsonDecoderMessage::create(16000, jsonObj)));
+    for(auto it = msgs.begin(); it != msgs.end(); it++) {
+        DecoderMessage* msg = boost::const_pointer_cast<DecoderMessage>(it->second).get();
+        msg->setTag("wire_test");
+        msg->addDescriptor("speaker", "spk_1");
+        msg->addDescriptor("channel", "0");
+    }
+    return msgs;
+}
+
+template<typename EigenType>
+static bool SameEigen(const EigenType& a, const EigenType& b) {
+    return a.rows() == b.rows() && a.cols() == b.cols() && (a.size() == 0 || memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+// Compares field by field, re-encoding alone would miss a field the encoder and decoder both get wrong
+static bool SameWireTestMessage(const DecoderMessage& orig, const DecoderMessage& decoded) {
+    if (orig.getUUID() != decoded.getUUID() || orig.getTime() != decoded.getTime() || orig.getTag() != decoded.getTag() || orig.getDescriptors() != decoded.getDescriptors()) return false;
+    if (auto a = dynamic_cast<const AudioDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const AudioDecoderMessage*>(&decoded);
+        return b != nullptr && SameEigen(a->mAudio, b->mAudio) && a->mSampleRate == b->mSampleRate && a->mTicksPerSample == b->mTicksPerSample;
+    }
+    if (auto a = dynamic_cast<const AudioInfoDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const AudioInfoDecoderMessage*>(&decoded);
+        return b != nullptr && a->mSampleRate == b->mSampleRate && a->mTicksPerSample == b->mTicksPerSample;
+    }
+    if (auto a = dynamic_cast<const FeaturesDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const FeaturesDecoderMessage*>(&decoded);
+        return b != nullptr && SameEigen(a->mFeatures, b->mFeatures) && a->mFeatureTimestamps == b->mFeatureTimestamps && a->mFeatureNames == b->mFeatureNames && a->mUtteranceId == b->mUtteranceId;
+    }
+    if (auto a = dynamic_cast<const MatrixDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const MatrixDecoderMessage*>(&decoded);
+        return b != nullptr && SameEigen(a->mMat, b->mMat);
+    }
+    if (auto a = dynamic_cast<const NbestDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const NbestDecoderMessage*>(&decoded);
+        return b != nullptr && a->mWords == b->mWords && a->mAlignment == b->mAlignment && a->mText == b->mText && a->mConfidences == b->mConfidences;
+    }
+    if (auto a = dynamic_cast<const ConversationStateDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const ConversationStateDecoderMessage*>(&decoded);
+        return b != nullptr && a->mUtteranceId == b->mUtteranceId && a->mLastChunkInUtt == b->mLastChunkInUtt && a->mConvoId == b->mConvoId && a->mLastChunkInConvo == b->mLastChunkInConvo;
+    }
+    if (auto a = dynamic_cast<const BinaryDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const BinaryDecoderMessage*>(&decoded);
+        return b != nullptr && a->mData == b->mData && a->mFormat == b->mFormat;
+    }
+    if (auto a = dynamic_cast<const JsonDecoderMessage*>(&orig)) {
+        auto b = dynamic_cast<const JsonDecoderMessage*>(&decoded);
+        return b != nullptr && a->getJsonObj() == b->getJsonObj();
+    }
+    GODEC_ERR << "Wire test: Don't know how to compare " << orig.describeThyself();
+    return false;
+}
+
+// Errors out if a message doesn't survive the round trip
+static void RunWireTest(int numIterations) {
+    MessageConverterRegistry registry;
+    registry.addConverters("libgodec_core", GetCoreMessageConverters());
+    std::vector<std::pair<std::string, DecoderMessage_ptr>> msgs = CreateWireTestMessages();
+    WireWriter writer;
+    WireWriter reWriter;
+    for(auto it = msgs.begin(); it != msgs.end(); it++) {
+        const DecoderMessage& msg = *it->second;
+        writer.clear();
+        WriteWireMessage(writer, msg);
+        WireReader reader(writer.data(), writer.size());
+        DecoderMessage_ptr decoded = registry.fromWire(reader);
+        if (reader.remaining() != 0) GODEC_ERR << "Wire test: " << reader.remaining() << " bytes left over after decoding " << msg.describeThyself();
+        if (!SameWireTestMessage(msg, *decoded)) {
+            GODEC_ERR << "Wire test: Message changed in round trip.\nBefore: " << msg.describeThyself() << "After: " << decoded->describeThyself();
+        }
+        // The same message also has to encode to the same bytes again
+        reWriter.clear();
+        WriteWireMessage(reWriter, *decoded);
+        if (reWriter.size() != writer.size() || memcmp(reWriter.data(), writer.data(), writer.size()) != 0) {
+            GODEC_ERR << "Wire test: Decoded " << it->first << " encodes to different bytes";
+        }
+
+        boost::timer::cpu_timer encodeTimer;
+        for(int iteration = 0; iteration < numIterations; iteration++) {
+            writer.clear();
+            WriteWireMessage(writer, msg);
+        }
+        double encodeSeconds = encodeTimer.elapsed().wall / 1e9;
+        boost::timer::cpu_timer decodeTimer;
+        for(int iteration = 0; iteration < numIterations; iteration++) {
+            WireReader loopReader(writer.data(), writer.size());
+            registry.fromWire(loopReader);
+        }
+        double decodeSeconds = decodeTimer.elapsed().wall / 1e9;
+        double totalMB = (double)writer.size() * numIterations / 1e6;
+        encodeSeconds = std::max(encodeSeconds, 1e-9);
+        decodeSeconds = std::max(decodeSeconds, 1e-9);
+        std::cout << boost::format("%-32s %7d bytes, encode %8.1f MB/s %9.0f msg/s, decode %8.1f MB/s %9.0f msg/s")
+                  % it->first % writer.size() % (totalMB / encodeSeconds) % (numIterations / encodeSeconds) % (totalMB / decodeSeconds) % (numIterations / decodeSeconds) << std::endl;
+    }
+    // A matrix whose dimensions multiply out to 0 in 64 bits has to be rejected, not decoded as empty
+    writer.clear();
+    writer.writeU64((uint64_t)1 << 32);
+    writer.writeU64((uint64_t)1 << 32);
+    float noData = 0.0f;
+    writer.writeFloatBlock(&noData, 0);
+    bool rejected = false;
+    try {
+        WireReader reader(writer.data(), writer.size());
+        reader.readMatrix();
+    } catch (const std::exception& e) {
+        rejected = true;
+    }
+    if (!rejected) GODEC_ERR << "Wire test: Matrix with overflowing dimensions was accepted";
+    std::cout << "All " << msgs.size() << " message types passed the wire format round trip" << std::endl;
+}
+
+// Stands in for the wire format converter of a plugin library in RunConverterTest(). Decodes just like libgodec_core, but counts the calls
+static int sPluginConverterCalls = 0;
+static DecoderMessage_ptr PluginBinaryFromWire(WireReader& reader, uint16_t typeVersion, uint64_t time) {
+    sPluginConverterCalls++;
+    return BinaryDecoderMessage::fromWire(reader, typeVersion, time);
+}
+
+static void CheckRegistryRoundTrip(const MessageConverterRegistry& registry, const DecoderMessage& msg, const std::string& what) {
+    WireWriter writer;
+    WriteWireMessage(writer, msg);
+    WireReader reader(writer.data(), writer.size());
+    DecoderMessage_ptr decoded = registry.fromWire(reader);
+    if (!SameWireTestMessage(msg, *decoded)) {
+        GODEC_ERR << "Converter test: " << what << " changed the message.\nBefore: " << msg.describeThyself() << "After: " << decoded->describeThyself();
+    }
+}
+
+static bool RegistryRejects(std::function<void()> func) {
+    try {
+        func();
+    } catch (const std::exception& e) {
+        return true;
+    }
+    return false;
+}
+
+// Errors out if the message converter registry doesn't hand messages to the library that registered their type. Goes through the wire format, the Java and Python lookups work the same way
+static void RunConverterTest() {
+    std::vector<std::pair<std::string, DecoderMessage_ptr>> msgs = CreateWireTestMessages();
+
+    // libgodec_core loaded like the graph does it, through its GodecGetMessageConverters()
+    MessageConverterRegistry coreRegistry;
+    coreRegistry.addLibrary("libgodec_core", ComponentGraph::LoadGodecLibrary("libgodec_core"));
+    for(auto it = msgs.begin(); it != msgs.end(); it++) CheckRegistryRoundTrip(coreRegistry, *it->second, "libgodec_core decoding " + it->first);
+
+    GodecMessageConverter pluginConverter;
+    pluginConverter.mWireType = UUID_BinaryDecoderMessage;
+    pluginConverter.mFromWire = &PluginBinaryFromWire;
+    std::vector<GodecMessageConverter> pluginConverters(1, pluginConverter);
+    if (!RegistryRejects([&]() { coreRegistry.addConverters("libplugin", pluginConverters); })) GODEC_ERR << "Converter test: A second converter for the same message type was accepted";
+
+    // A plugin library that only gets loaded inside a submodule, whose registry gets merged into the top-level one. libgodec_core shows up on both levels
+    std::vector<GodecMessageConverter> coreConverters = GetCoreMessageConverters();
+    coreConverters.erase(std::remove_if(coreConverters.begin(), coreConverters.end(), [](const GodecMessageConverter& converter) { return converter.mWireType == UUID_BinaryDecoderMessage; }), coreConverters.end());
+    MessageConverterRegistry topRegistry;
+    topRegistry.addConverters("libgodec_core", coreConverters);
+    MessageConverterRegistry subRegistry;
+    subRegistry.addConverters("libgodec_core", coreConverters);
+    subRegistry.addConverters("libplugin", pluginConverters);
+    topRegistry.merge(subRegistry);
+    for(auto it = msgs.begin(); it != msgs.end(); it++) CheckRegistryRoundTrip(topRegistry, *it->second, "Merged registry decoding " + it->first);
+    if (sPluginConverterCalls != 1) GODEC_ERR << "Converter test: Plugin converter got called " << sPluginConverterCalls << " times, expected once for the BinaryDecoderMessage";
+
+    MessageConverterRegistry emptyRegistry;
+    if (!RegistryRejects([&]() { CheckRegistryRoundTrip(emptyRegistry, *msgs[0].second, "Empty registry"); })) GODEC_ERR << "Converter test: Empty registry decoded a message";
+    std::cout << "Message converter registry passed" << std::endl;
+}
+
+// A top-level FileWriter whose output "godec batch" has to merge
+struct BatchWriter {
+    std::string mName;
+    std::string mFileParam; // "output_file" or "npz_file"
+    std::string mFile;
+    bool mNpz;
+};
+
+// A run of consecutive analist lines with the same episode, the way FileFeeder sees it
+struct BatchConversation {
+    std::vector<std::string> mLines;
+    int64_t mFeedTime; // How far the FileFeeder's time advances over it, see its "time_offset"
+};
+
+// Runs the graph's analist on numInstances parallel graph instances in this process, so shared libraries (and whatever their components keep in static storage, e.g. models) only get loaded once.
+// Each conversation runs in a graph of its own, built by whichever of the numInstances threads is free, and its FileFeeder starts at the time the conversation has in a single run of the whole analist.
+// So the conversations get the same stream times as in a single run, and their FileWriter outputs, concatenated in analist order, are what a single run writes
+static void RunBatch(int numInstances, std::string jsonFile, const std::vector<std::pair<std::string, std::string>>& ov, bool quiet) {
+    if (numInstances < 1) GODEC_ERR << "batch: Number of instances needs to be at least 1";
+    jsonFile = boost::filesystem::absolute(jsonFile).string();
+    // Building a graph temporarily changes the working directory to the JSON's, while other graphs are already running. So all paths the batch hands to the instances are absolute
+    boost::filesystem::path jsonDir = boost::filesystem::path(jsonFile).parent_path();
+    auto resolveInJsonDir = [&jsonDir](std::string path) {
+        return boost::filesystem::absolute(path, jsonDir).string();
+    };
+
+    GlobalComponentGraphVals globals;
+    globals.put<bool>(LoopProcessor::QuietGodec, true);
+    ComponentGraphConfig config(ComponentGraph::TOPLEVEL_ID, jsonFile, &globals, nullptr);
+    config.AddSubtree(ComponentGraphConfig::FromOverrideList(ov)->GetPtree());
+    if (config.GetPtree().find("global_opts") != config.GetPtree().end()) {
+        ComponentGraphConfig globalsConfig("globals", config.GetPtree()["global_opts"], &config.globalVals, nullptr);
+        config.globalVals.loadGlobals(globalsConfig);
+    }
+
+    std::string feederName;
+    std::string analistFile;
+    std::string waveDir;
+    std::string waveExtension;
+    int audioFileCacheSize = AnalistFileFeeder::DefaultAudioFileCacheSize;
+    std::vector<BatchWriter> writers;
+    std::vector<std::pair<std::string, std::string>> pathOv; // The same for every instance
+    for(auto v = config.GetPtree().begin(); v != config.GetPtree().end(); v++) {
+        if (v.key().substr(0, 1) == "#" || v.key() == "global_opts" || !v.value().is_object()) continue;
+        ComponentGraphConfig compConfig(v.key(), v.value(), &config.globalVals, nullptr);
+        std::string componentType = compConfig.get<std::string>("type", "Component type");
+        if (componentType.substr(0, 5) == "core:") componentType = componentType.substr(5);
+        if (componentType == "FileFeeder") {
+            if (compConfig.get<std::string>("control_type", "") != "single_on_startup" || compConfig.get<std::string>("source_type", "") != "analist") continue;
+            if (feederName != "") GODEC_ERR << "batch: Both " << feederName << " and " << v.key() << " read an analist, only one FileFeeder can be split up";
+            feederName = v.key();
+            analistFile = resolveInJsonDir(compConfig.get<std::string>("input_file", ""));
+            waveDir = resolveInJsonDir(compConfig.get<std::string>("wave_dir", ""));
+            waveExtension = compConfig.get<std::string>("wave_extension", "");
+            if (compConfig.get_optional_READ_DECLARATION_BEFORE_USE<int>("audio_file_cache_size")) audioFileCacheSize = compConfig.get<int>("audio_file_cache_size", "");
+            pathOv.push_back(std::make_pair(feederName + ".wave_dir", waveDir));
+        } else if (componentType == "FileWriter") {
+            if (compConfig.get<std::string>("control_type", "") != "single_on_startup") GODEC_ERR << "batch: FileWriter " << v.key() << " needs to have control_type 'single_on_startup'";
+            std::string inputType = compConfig.get<std::string>("input_type", "");
+            BatchWriter writer;
+            writer.mName = v.key();
+            writer.mNpz = inputType == "features";
+            if (inputType == "audio") {
+                // One file per utterance, which the instances can write directly. The files get opened while the graph runs, so relative to the working directory, like in a single run
+                std::string prefix = compConfig.get<std::string>("output_file_prefix", "");
+                pathOv.push_back(std::make_pair(writer.mName + ".output_file_prefix", boost::filesystem::absolute(prefix).string()));
+                continue;
+            }
+            if (inputType == "json") {
+                std::string format = compConfig.get<std::string>("json_output_format", "");
+                // Their times are relative to the end of the last utterance the FileWriter got JSON for, which can be in an earlier conversation. A graph that only runs one conversation has not seen it
+                if (format == "ctm" || format == "fst_search") GODEC_ERR << "batch: FileWriter " << v.key() << " writes '" << format << "', which can not be split up by conversation";
+            }
+            writer.mFileParam = writer.mNpz ? "npz_file" : "output_file";
+            writer.mFile = resolveInJsonDir(compConfig.get<std::string>(writer.mFileParam, ""));
+            writers.push_back(writer);
+        }
+    }
+    if (feederName == "") GODEC_ERR << "batch: " << jsonFile << " has no top-level FileFeeder reading an analist";
+
+    // The FileFeeder's time advances by the bytes of audio it feeds, which is what reading the analist with it tells
+    std::vector<BatchConversation> conversations;
+    std::ifstream analistStream(analistFile);
+    if (analistStream.fail()) GODEC_ERR << "batch: Failed to open " << analistFile;
+    AnalistFileFeeder analistSizer(analistFile, waveDir, waveExtension, audioFileCacheSize);
+    std::string line;
+    std::string prevEpisodeName;
+    int64_t lineCount = 0;
+    while (std::getline(analistStream, line)) {
+        if (boost::algorithm::trim_copy(line) == "") continue;
+        lineCount++;
+        std::string parsedLine = line;
+        std::string waveFile, typeString, utteranceId, episodeName;
+        std::vector<int> channels;
+        int64_t beginSample, endSample;
+        double stretch;
+        parseAnalistLine(parsedLine, waveFile, channels, typeString, beginSample, endSample, stretch, utteranceId, episodeName);
+        // Without an ID, FileFeeder numbers the utterances by their line, which is only the same in the conversation's own analist if it is spelled out
+        if (utteranceId == "") line += " -o " + std::to_string(lineCount);
+
+        boost::shared_ptr<AudioFileReader> reader;
+        int64_t numSamples, beginSampleInFile;
+        int sampleWidth;
+        bool episodeDone, fileDone;
+        std::string formatString;
+        float chunkSeconds, offsetInFileSeconds;
+        if (!analistSizer.getNextUtterance(reader, numSamples, sampleWidth, utteranceId, episodeName, episodeDone, fileDone, waveFile, channels, formatString, chunkSeconds, beginSampleInFile, offsetInFileSeconds)) {
+            GODEC_ERR << "batch: Could not read line " << lineCount << " of " << analistFile;
+        }
+        if (conversations.empty() || episodeName != prevEpisodeName) conversations.push_back(BatchConversation{std::vector<std::string>(), 0});
+        conversations.back().mLines.push_back(line);
+        conversations.back().mFeedTime += numSamples*channels.size()*reader->bytesPerSample;
+        prevEpisodeName = episodeName;
+    }
+    if (conversations.empty()) GODEC_ERR << "batch: " << analistFile << " is empty";
+
+    // Each conversation's FileFeeder starts at the time the conversation has in a single run of the whole analist
+    std::vector<int64_t> convTimeOffset;
+    int64_t feedTimeBefore = 0;
+    for(auto convIt = conversations.begin(); convIt != conversations.end(); convIt++) {
+        convTimeOffset.push_back(feedTimeBefore);
+        feedTimeBefore += convIt->mFeedTime;
+    }
+
+    boost::filesystem::path tempDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("godec_batch_%%%%-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDir);
+    auto tempFile = [&tempDir](std::string name, size_t convIdx, std::string extension) {
+        return (tempDir / (name + "_" + std::to_string(convIdx) + extension)).string();
+    };
+
+    // Every instance takes the next conversation that nobody has taken yet, so a long conversation doesn't hold up the ones after it
+    std::mutex convMutex;
+    size_t nextConvIdx = 0;
+    bool instanceFailed = false;
+    std::string instanceError;
+    // Building a graph changes the working directory for a while, so only one gets built at a time
+    std::mutex buildMutex;
+    auto runInstance = [&]() {
+        while (true) {
+            size_t convIdx;
+            {
+                std::lock_guard<std::mutex> lock(convMutex);
+                if (nextConvIdx == conversations.size() || instanceFailed) return;
+                convIdx = nextConvIdx++;
+            }
+            try {
+                std::string convAnalist = tempFile(feederName, convIdx, ".analist");
+                {
+                    std::ofstream convAnalistStream(convAnalist);
+                    for(auto lineIt = conversations[convIdx].mLines.begin(); lineIt != conversations[convIdx].mLines.end(); lineIt++) convAnalistStream << *lineIt << std::endl;
+                }
+                std::vector<std::pair<std::string, std::string>> graphOv = ov;
+                graphOv.insert(graphOv.end(), pathOv.begin(), pathOv.end());
+                graphOv.push_back(std::make_pair(feederName + ".input_file", convAnalist));
+                graphOv.push_back(std::make_pair(feederName + ".!time_offset", std::to_string(convTimeOffset[convIdx])));
+                for(auto writerIt = writers.begin(); writerIt != writers.end(); writerIt++) {
+                    graphOv.push_back(std::make_pair(writerIt->mName + "." + writerIt->mFileParam, tempFile(writerIt->mName, convIdx, writerIt->mNpz ? ".npz" : ".part")));
+                }
+                GlobalComponentGraphVals graphGlobals;
+                graphGlobals.put<bool>(LoopProcessor::QuietGodec, quiet || convIdx != 0);
+                json endpoints;
+                ComponentGraph* graph;
+                {
+                    std::lock_guard<std::mutex> lock(buildMutex);
+                    graph = new ComponentGraph(ComponentGraph::TOPLEVEL_ID, jsonFile, ComponentGraphConfig::FromOverrideList(graphOv), endpoints, &graphGlobals);
+                }
+                graph->WaitTilShutdown();
+                delete graph;
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(convMutex);
+                // The error itself has already been logged where it happened
+                if (!instanceFailed) instanceError = "Conversation " + std::to_string(convIdx + 1) + " (analist line '" + conversations[convIdx].mLines.front() + "') failed. " + e.what();
+                instanceFailed = true;
+                return;
+            }
+        }
+    };
+    size_t numThreads = std::min((size_t)numInstances, conversations.size());
+    std::vector<std::thread> instanceThreads;
+    for(size_t threadIdx = 0; threadIdx < numThreads; threadIdx++) instanceThreads.push_back(std::thread(runInstance));
+    for(auto threadIt = instanceThreads.begin(); threadIt != instanceThreads.end(); threadIt++) threadIt->join();
+    if (instanceFailed) {
+        boost::filesystem::remove_all(tempDir);
+        GODEC_ERR << "batch: " << instanceError;
+    }
+
+    for(auto writerIt = writers.begin(); writerIt != writers.end(); writerIt++) {
+        std::vector<std::string> parts;
+        for(size_t convIdx = 0; convIdx < conversations.size(); convIdx++) {
+            std::string part = tempFile(writerIt->mName, convIdx, writerIt->mNpz ? ".npz" : ".part");
+            if (boost::filesystem::exists(part)) parts.push_back(part);
+        }
+        if (writerIt->mNpz) {
+            // Same as a single run, where the FileWriter only creates the file once it has features to write
+            boost::filesystem::remove(writerIt->mFile);
+            if (!parts.empty()) cnpy::npz_concat(writerIt->mFile, parts);
+        } else {
+            std::ofstream merged(writerIt->mFile, std::ios::binary);
+            if (merged.fail()) GODEC_ERR << "batch: Could not open " << writerIt->mFile << " for writing";
+            for(auto partIt = parts.begin(); partIt != parts.end(); partIt++) {
+                std::ifstream partStream(*partIt, std::ios::binary);
+                merged << partStream.rdbuf();
+            }
+        }
+    }
+    boost::filesystem::remove_all(tempDir);
+    if (!quiet) GODEC_INFO << "batch: Processed " << conversations.size() << " conversations on " << numThreads << " graph instances" << std::endl;
 }
 
 #ifndef ANDROID
@@ -72,7 +492,7 @@ int main(int argc, char** argv) {
     std::vector<std::string> posOpts;
     try {
         po::positional_options_description p;
-        p.add("pos_opts", 2);
+        p.add("pos_opts", 3);
         po::store(
             po::command_line_parser( argc, argv).
             options( desc ).
@@ -95,6 +515,34 @@ int main(int argc, char** argv) {
         ComponentGraph::ListComponents(posOpts[1]);
         _exit(0); // See beginning of file for explanation
     }
+    // Not for users, this is how components like Python (execution_mode worker_process) start their worker processes
+    if (jsonOrCommand == "_worker") {
+        if (posOpts.size() != 3) { PrintUsage(); exit(-1);}
+        int ret = -1;
+        try {
+            ret = ComponentGraph::RunWorker(posOpts[1], posOpts[2]);
+        } catch (const std::exception& e) {}
+        fflush(stdout);
+        fflush(stderr);
+        _exit(ret);
+    }
+    if (jsonOrCommand == "converter_test") {
+        try {
+            RunConverterTest();
+        } catch (const std::exception& e) {
+            _exit(-1);
+        }
+        _exit(0);
+    }
+    if (jsonOrCommand == "wire_test") {
+        int numIterations = posOpts.size() > 1 ? boost::lexical_cast<int>(posOpts[1]) : 1000;
+        try {
+            RunWireTest(numIterations);
+        } catch (const std::exception& e) {
+            _exit(-1);
+        }
+        _exit(0);
+    }
 
     // Transform override options into Godec required array
     std::vector<std::pair<std::string, std::string>> ov;
@@ -107,6 +555,16 @@ int main(int argc, char** argv) {
         ov.push_back(std::make_pair(key, val));
     }
 
+    if (jsonOrCommand == "batch") {
+        if (posOpts.size() != 3) { PrintUsage(); exit(-1);}
+        try {
+            RunBatch(boost::lexical_cast<int>(posOpts[1]), posOpts[2], ov, vm.count("q") == 1);
+        } catch (const std::exception& e) {
+            _exit(-1);
+        }
+        _exit(0);
+    }
+
     // Set up Java env variables when using the 'Java' component (not necessary for Android where this is already set up)
 #ifndef ANDROID
     if (vm.count("java_class_path")) {
@@ -176,7 +634,47 @@ int android_log_redirect() {
 
 boost::shared_ptr<ComponentGraph> globalGodecInstance;
 std::vector<std::string> globalGodecInjectedEndpoints;
+
+// Converts a list of slices into an ArrayList of HashMaps
+static jobject SlicesToJNI(JNIEnv* env, const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& mapList) {
+    const JNIIds& ids = GetJNIIds(env);
+    jobject jArrayListObject = env->NewObject(ids.mArrayList, ids.mArrayListInit, (jint)mapList.size());
+    for (auto it = mapList.begin(); it != mapList.end(); it++) {
+        auto& map = *it;
+        JNILocalFrame mapFrame(env, 1);
+        jobject jHashMapObject = env->NewObject(ids.mHashMap, ids.mHashMapInit, (jint)map.size());
+        for (auto mapIt = map.begin(); mapIt != map.end(); mapIt++) {
+            JNILocalFrame frame(env, 3);
+            auto msg = boost::const_pointer_cast<DecoderMessage>(mapIt->second);
+            env->CallObjectMethod(jHashMapObject, ids.mHashMapPut, env->NewStringUTF(mapIt->first.c_str()), msg->toJNI(env));
+        }
+        env->CallBooleanMethod(jArrayListObject, ids.mArrayListAdd, jHashMapObject);
+    }
+    return jArrayListObject;
+}
+
+// The callback delivery threads get attached on first use and stay attached (as daemons, so they don't keep the JVM alive)
+static JNIEnv* GetCallbackThreadJNIEnv(JavaVM* vm) {
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv((void**)&env, JNI_VERSION_1_6) == JNI_EDETACHED) {
+        if (vm->AttachCurrentThreadAsDaemon((void**)&env, NULL) != JNI_OK) GODEC_ERR << "Couldn't attach callback thread to JVM";
+    }
+    return env;
+}
+
 extern "C" {
+    // Resolve the JNI class and method IDs while we are on a thread that can see the Godec jar's class loader
+    JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* reserved) {
+        JNIEnv* env;
+        if (vm->GetEnv((void**)&env, JNI_VERSION_1_6) != JNI_OK) return JNI_ERR;
+        try {
+            GetJNIIds(env);
+        } catch (const std::exception& e) {
+            return JNI_ERR;
+        }
+        return JNI_VERSION_1_6;
+    }
+
     // Instantiate Godec
     JNIEXPORT void Java_com_bbn_godec_Godec_JLoadGodec( JNIEnv* env, jobject thiz, jobject jsonFile, jobject jOvs, jobject jPushEndpoints, jobject jPullEndpoints, jboolean quiet) {
 #ifdef ANDROID
@@ -284,64 +782,106 @@ extern "C" {
 
     // Pull message
     JNIEXPORT jobject Java_com_bbn_godec_Godec_JPullMessage( JNIEnv* env, jobject thiz, jstring jEndpointName, jfloat jMaxTimeout) {
-        const char* endpointName = env->GetStringUTFChars(jEndpointName,0);
+        // Copied, the name is still needed after the JNI string is released
+        const char* endpointNameChars = env->GetStringUTFChars(jEndpointName,0);
+        std::string endpointName(endpointNameChars);
+        env->ReleaseStringUTFChars(jEndpointName, endpointNameChars);
         unordered_map<std::string, DecoderMessage_ptr> map;
-        ChannelReturnResult res = globalGodecInstance->PullMessage(ComponentGraph::TOPLEVEL_ID+ComponentGraph::TREE_LEVEL_SEPARATOR+std::string(endpointName), jMaxTimeout, map);
-        env->ReleaseStringUTFChars(jEndpointName, endpointName);
+        ChannelReturnResult res = globalGodecInstance->PullMessage(ComponentGraph::TOPLEVEL_ID+ComponentGraph::TREE_LEVEL_SEPARATOR+endpointName, jMaxTimeout, map);
         if (res == ChannelClosed) {
-            throwChannelClosedException(env, endpointName);
+            throwChannelClosedException(env, endpointName.c_str());
             return NULL;
         }
         if (res == ChannelTimeout) {
             return NULL;
         }
-        jclass HashMapClass = env->FindClass("java/util/HashMap");
-        jmethodID jHashMapInit = env->GetMethodID(HashMapClass, "<init>", "()V");
-        jobject jHashMapObject = env->NewObject(HashMapClass, jHashMapInit);
-        jmethodID jPutMethod = env->GetMethodID(HashMapClass, "put", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+        const JNIIds& ids = GetJNIIds(env);
+        jobject jHashMapObject = env->NewObject(ids.mHashMap, ids.mHashMapInit, (jint)map.size());
         for (auto mapIt = map.begin(); mapIt != map.end(); mapIt++) {
-            std::string slot = mapIt->first;
+            JNILocalFrame frame(env, 3);
             auto msg = boost::const_pointer_cast<DecoderMessage>(mapIt->second);
-            env->CallObjectMethod(jHashMapObject, jPutMethod, env->NewStringUTF(slot.c_str()), msg->toJNI(env));
+            env->CallObjectMethod(jHashMapObject, ids.mHashMapPut, env->NewStringUTF(mapIt->first.c_str()), msg->toJNI(env));
+        }
+        return jHashMapObject;
+    }
+
+    // Pull message, writing audio/feature payloads into caller-provided direct buffers
+    JNIEXPORT jobject Java_com_bbn_godec_Godec_JPullMessageIntoBuffers( JNIEnv* env, jobject thiz, jstring jEndpointName, jfloat jMaxTimeout, jobject jTargetBuffers) {
+        const char* endpointNameChars = env->GetStringUTFChars(jEndpointName,0);
+        std::string endpointName(endpointNameChars);
+        env->ReleaseStringUTFChars(jEndpointName, endpointNameChars);
+        unordered_map<std::string, DecoderMessage_ptr> map;
+        ChannelReturnResult res = globalGodecInstance->PullMessage(ComponentGraph::TOPLEVEL_ID+ComponentGraph::TREE_LEVEL_SEPARATOR+endpointName, jMaxTimeout, map);
+        if (res == ChannelClosed) {
+            throwChannelClosedException(env, endpointName.c_str());
+            return NULL;
+        }
+        if (res == ChannelTimeout) {
+            return NULL;
+        }
+        const JNIIds& ids = GetJNIIds(env);
+        jobject jHashMapObject = env->NewObject(ids.mHashMap, ids.mHashMapInit, (jint)map.size());
+        for (auto mapIt = map.begin(); mapIt != map.end(); mapIt++) {
+            JNILocalFrame frame(env, 4);
+            auto msg = boost::const_pointer_cast<DecoderMessage>(mapIt->second);
+            jstring jSlot = env->NewStringUTF(mapIt->first.c_str());
+            jobject jTargetBuffer = env->CallObjectMethod(jTargetBuffers, ids.mHashMapGet, jSlot);
+            env->CallObjectMethod(jHashMapObject, ids.mHashMapPut, jSlot, msg->toJNIWithBuffer(env, jTargetBuffer));
         }
         return jHashMapObject;
     }
 
     // Pull all messages
     JNIEXPORT jobject Java_com_bbn_godec_Godec_JPullAllMessages( JNIEnv* env, jobject thiz, jstring jEndpointName, jfloat jMaxTimeout) {
-        const char* endpointName = env->GetStringUTFChars(jEndpointName,0);
+        const char* endpointNameChars = env->GetStringUTFChars(jEndpointName,0);
+        std::string endpointName(endpointNameChars);
+        env->ReleaseStringUTFChars(jEndpointName, endpointNameChars);
         std::vector<unordered_map<std::string, DecoderMessage_ptr>> mapList;
-        ChannelReturnResult res = globalGodecInstance->PullAllMessages(ComponentGraph::TOPLEVEL_ID+ComponentGraph::TREE_LEVEL_SEPARATOR+std::string(endpointName), jMaxTimeout, mapList);
-        env->ReleaseStringUTFChars(jEndpointName, endpointName);
+        ChannelReturnResult res = globalGodecInstance->PullAllMessages(ComponentGraph::TOPLEVEL_ID+ComponentGraph::TREE_LEVEL_SEPARATOR+endpointName, jMaxTimeout, mapList);
         if (res == ChannelClosed) {
-            throwChannelClosedException(env, endpointName);
+            throwChannelClosedException(env, endpointName.c_str());
             return NULL;
         }
         if (res == ChannelTimeout) {
             return NULL;
         }
-        jclass ArrayListClass = env->FindClass("java/util/ArrayList" );
-        jmethodID jArrayListInit = env->GetMethodID(ArrayListClass, "<init>", "()V");
-        jmethodID jArrayListAdd = env->GetMethodID(ArrayListClass, "add", "(Ljava/lang/Object;)Z");
-        jobject jArrayListObject = env->NewObject(ArrayListClass, jArrayListInit);
-
-        jclass HashMapClass = env->FindClass("java/util/HashMap");
-        jmethodID jHashMapInit = env->GetMethodID(HashMapClass, "<init>", "()V");
-        jmethodID jHashMapPut = env->GetMethodID(HashMapClass, "put", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
-
-        for (auto it = mapList.begin(); it != mapList.end(); it++) {
-            auto& map = *it;
-            jobject jHashMapObject = env->NewObject(HashMapClass, jHashMapInit);
-            for (auto mapIt = map.begin(); mapIt != map.end(); mapIt++) {
-                std::string slot = mapIt->first;
-                env->PushLocalFrame(2);
-                auto msg = boost::const_pointer_cast<DecoderMessage>(mapIt->second);
-                env->CallObjectMethod(jHashMapObject, jHashMapPut, env->NewStringUTF(slot.c_str()), msg->toJNI(env));
-                env->PopLocalFrame(NULL);
+        return SlicesToJNI(env, mapList);
+    }
+
+    // Register a listener that gets the endpoint's output pushed to it instead of it having to be pulled
+    JNIEXPORT void Java_com_bbn_godec_Godec_JSetListener( JNIEnv* env, jobject thiz, jstring jEndpointName, jobject jListener, jint maxSlicesPerCall) {
+        JavaVM* vm;
+        if (env->GetJavaVM(&vm) != JNI_OK) GODEC_ERR << "Could not get Java VM";
+        jclass listenerClass = env->GetObjectClass(jListener);
+        jmethodID onMessages = env->GetMethodID(listenerClass, "onMessages", "(Ljava/util/ArrayList;)V");
+        jmethodID onClosed = env->GetMethodID(listenerClass, "onClosed", "()V");
+        env->DeleteLocalRef(listenerClass);
+        if (onMessages == nullptr || onClosed == nullptr) GODEC_ERR << "Listener does not implement com.bbn.godec.GodecListener";
+        // Released once the endpoint is closed, which is the last call the listener gets
+        jobject listener = env->NewGlobalRef(jListener);
+
+        const char* endpointName = env->GetStringUTFChars(jEndpointName,0);
+        std::string endpointId = ComponentGraph::TOPLEVEL_ID+ComponentGraph::TREE_LEVEL_SEPARATOR+std::string(endpointName);
+        env->ReleaseStringUTFChars(jEndpointName, endpointName);
+        globalGodecInstance->SetApiEndpointCallback(endpointId,
+        [vm, listener, onMessages](const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices) {
+            JNIEnv* threadEnv = GetCallbackThreadJNIEnv(vm);
+            JNILocalFrame frame(threadEnv, 1);
+            threadEnv->CallVoidMethod(listener, onMessages, SlicesToJNI(threadEnv, slices));
+            if (threadEnv->ExceptionCheck()) {
+                threadEnv->ExceptionDescribe();
+                threadEnv->ExceptionClear();
             }
-            env->CallBooleanMethod(jArrayListObject, jArrayListAdd, jHashMapObject);
-        }
-        return jArrayListObject;
+        },
+        [vm, listener, onClosed]() {
+            JNIEnv* threadEnv = GetCallbackThreadJNIEnv(vm);
+            threadEnv->CallVoidMethod(listener, onClosed);
+            if (threadEnv->ExceptionCheck()) {
+                threadEnv->ExceptionDescribe();
+                threadEnv->ExceptionClear();
+            }
+            threadEnv->DeleteGlobalRef(listener);
+        }, maxSlicesPerCall);
     }
 
     // Shutdown
@@ -6,6 +6,7 @@
 #include <iostream>
 #include "TimeStream.h"
 #include "channel.h"
+#include "MessagePool.h"
 #ifndef ANDROID
 #include <Python.h>
 #endif
@@ -19,13 +20,15 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/optional.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/serialization/unordered_map.hpp>
 
 namespace Godec {
 
 class ComponentGraph;
-// The base message that all messages need to inherit from
-class DecoderMessage {
+class WireWriter;
+// The base message that all messages need to inherit from. Messages are always owned by a DecoderMessage_ptr, shared_from_this() is what e.g. lets a numpy view of the payload keep the message alive
+class DecoderMessage : public boost::enable_shared_from_this<DecoderMessage> {
   public:
 
     // Destructor
@@ -42,6 +45,14 @@ class DecoderMessage {
     // Convert the C++ message contents into a Java class via JNI. The method needs to be defined, but unless you plan
     // on actually passing it out, you can just define a dummy with a KALDI_ERR in it
     virtual jobject toJNI(JNIEnv* env) = 0;
+    // Same as toJNI(), but messages with a float payload (audio, features) copy it into the provided direct java.nio.FloatBuffer instead of a newly allocated Java array, if it fits
+    virtual jobject toJNIWithBuffer(JNIEnv* env, jobject directBuffer) { return toJNI(env); }
+
+    // Write the message-specific part of the binary wire format (see WireFormat.h); tag, time and descriptors are already taken care of. Bump getWireVersion()
+    // when changing the layout, and only ever append fields so older readers can still skip over them. A message type that can be decoded again
+    // also needs a "static DecoderMessage_ptr fromWire(WireReader& reader, uint16_t typeVersion, uint64_t time)", registered through GodecGetMessageConverters()
+    virtual void toWire(WireWriter& writer) const;
+    virtual uint16_t getWireVersion() const { return 1; }
 
 #ifndef ANDROID
     // Convert the C++ message contents into a Python object. The method needs to be defined, but unless you plan
@@ -94,6 +105,7 @@ class DecoderMessage {
     void addDescriptor(const std::string& key, const std::string& val) { mDescriptors[key] = val; }
     // Descriptors are free-form key/value pairs that describe auxiliary information about the message.
     std::string getDescriptor(const std::string& key) const { return mDescriptors.find(key) != mDescriptors.end() ? mDescriptors.at(key) : ""; }
+    const std::unordered_map<std::string, std::string>& getDescriptors() const { return mDescriptors; }
     std::string getFullDescriptorString() const {
         std::string out;
         for (auto it = mDescriptors.begin(); it != mDescriptors.end(); it++) {
@@ -143,6 +155,11 @@ struct RuntimeStats {
     unordered_map<std::string, float> mWaitedOn;
     boost::timer::cpu_timer mDetailedTimer;
     uint64_t mTotalNumTicks;
+    AllocationCounters mAllocations;
+    // Only filled in with count_slice_pool_misses
+    uint64_t mNumSlices;
+    uint64_t mSlicePoolMisses;
+    uint64_t mMaxSteadySlicePoolMisses;
 };
 
 // This is the structure holding a sliced-out block of messages
@@ -189,6 +206,8 @@ class LoopProcessor {
     void addInputSlotAndUUID(std::string slot, uuid _uuid);
     // Push out a message
     void pushToOutputs(std::string slot, DecoderMessage_ptr msg);
+    // Use this to start any additional threads inside the component. It applies the component's cpu_affinity/numa_node/thread_priority and registers the thread for logging
+    boost::thread startPlacedThread(boost::function<void()> func, const std::string& role);
 
     // ##### End of functions used inside component
 
@@ -221,6 +240,10 @@ class LoopProcessor {
     static std::string SlotCnetLattice;
     static std::string GatherRuntimeStats;
     static std::string QuietGodec;
+    static std::string CountSlicePoolMisses;
+    static std::string MaxSlicePoolMisses;
+    // Slices at the beginning during which the pools are still filling up, not counted towards the steady-state maximum
+    static const uint64_t SlicePoolMissWarmup;
     static std::string SlotTimeMap;
     static std::string SlotControl;
     static std::string SlotSearchOutput;
@@ -249,6 +272,10 @@ class LoopProcessor {
     void ProcessIgnoreDataMessageBlock(const DecoderMessageBlock& msgBlock);
     // The main function to override. It gets called every time a new contiguous chunk of messages is available. The map's keys are the slot names
     virtual void ProcessMessage(const DecoderMessageBlock& msgBlock) = 0;
+    // Components for which each call has a high fixed cost (e.g. calls into another language) can opt into receiving several consecutive slices at once. Call this inside the constructor, it reads the optional "batch_slices" and "batch_latency_ms" parameters
+    void enableSliceBatching(ComponentGraphConfig* pt);
+    // Gets called instead of ProcessMessage once slice batching is enabled. The blocks are in time order, the default just calls ProcessMessage on each of them
+    virtual void ProcessMessageBatch(const std::vector<DecoderMessageBlock>& msgBlocks);
     // Only in rare circumstances should you override this
     virtual void ProcessLoop();
     // Almost all components require convstate input except a few. Override this function if it is such a component
@@ -261,6 +288,7 @@ class LoopProcessor {
     bool mVerbose;
     bool mIsFinished;
     FILE* mLogPtr;
+    ThreadPlacement mThreadPlacement;
     int mNumStreams;
     static std::string SlotRoutingStream;
     static std::string SlotToRouteStream;
@@ -285,6 +313,16 @@ class LoopProcessor {
     // Stats
     void populateRuntimeStats();
     unordered_map<std::string, boost::shared_ptr<RuntimeStats> > mRuntimeStats;
+    void recordSlicePoolMisses(RuntimeStats& stats, uint64_t numMisses);
+    bool mCountSlicePoolMisses;
+    int64_t mMaxSlicePoolMisses;
+    // Slice batching
+    void flushSliceBatch();
+    float getSecondsUntilBatchDeadline();
+    int mBatchSlices;
+    float mBatchLatencyMs;
+    std::vector<DecoderMessageBlock> mPendingBatch;
+    boost::chrono::steady_clock::time_point mPendingBatchSince;
 };
 
 
@@ -1,15 +1,22 @@
 #pragma once
 #include <string>
 #include <mutex>
+#include <functional>
+#include <map>
 #include "ChannelMessenger.h"
+#include "WireFormat.h"
 
 namespace Godec {
 
 class ApiEndpoint;
 class SubModule;
+// Push-style delivery from an API endpoint, see ComponentGraph::SetApiEndpointCallback()
+typedef std::function<void(const std::vector<unordered_map<std::string, DecoderMessage_ptr>>& slices)> ApiEndpointSliceCallback;
+typedef std::function<void()> ApiEndpointClosedCallback;
 typedef LoopProcessor* (*GodecGetComponentFunc)(std::string, std::string, ComponentGraphConfig*);
 typedef void (*GodecListComponentsFunc)();
 typedef std::string (*GodecVersionFunc)();
+typedef int (*GodecRunWorkerFunc)(std::string kind, std::string config);
 typedef DecoderMessage_ptr (*GodecJNIToMsgFunc)(JNIEnv* env, jobject jMsg);
 #ifndef ANDROID
 typedef DecoderMessage_ptr (*GodecPythonToMsgFunc)(PyObject* pMsg);
@@ -22,6 +29,49 @@ void*
 #endif
 DllPtr;
 
+// A message type a component library can convert from Java, Python and/or the binary wire format. Libraries export a "GodecGetMessageConverters" function (GodecGetMessageConvertersFunc) returning one entry per message type they define, which gets registered when the library is loaded.
+// The Java side is keyed by the fully qualified class name (e.g. "com.bbn.godec.AudioDecoderMessage", subclasses get the converter of their closest registered superclass), the Python side by the "type" entry of the message dict, the wire format by the message UUID. An entry can cover any combination of these
+struct GodecMessageConverter {
+    std::string mJavaClass;
+    GodecJNIToMsgFunc mFromJNI = nullptr;
+#ifndef ANDROID
+    std::string mPythonType;
+    GodecPythonToMsgFunc mFromPython = nullptr;
+#endif
+    uuid mWireType{};
+    GodecWireToMsgFunc mFromWire = nullptr;
+};
+typedef std::vector<GodecMessageConverter> (*GodecGetMessageConvertersFunc)();
+
+// Maps Java classes and Python types to the converter of the library that defines them. Filled while the graph gets constructed, read-only afterwards.
+// Libraries that don't export GodecGetMessageConverters() still work through their GodecJNIToMsg()/GodecPythonToMsg() functions, which get tried in turn for any type that isn't registered
+class MessageConverterRegistry {
+  public:
+    void addLibrary(const std::string& dllName, DllPtr dllHandle);
+    void addConverters(const std::string& dllName, const std::vector<GodecMessageConverter>& converters);
+    void merge(const MessageConverterRegistry& other);
+    DecoderMessage_ptr fromJNI(JNIEnv* env, jobject jMsg) const;
+#ifndef ANDROID
+    DecoderMessage_ptr fromPython(PyObject* pMsg) const;
+#endif
+    // Decodes the next message from the reader, see WireFormat.h
+    DecoderMessage_ptr fromWire(WireReader& reader) const;
+  private:
+    GodecJNIToMsgFunc findJNIConverter(JNIEnv* env, jclass jMsgClass) const;
+    void clearJNIClassCache();
+    std::map<uuid, GodecWireToMsgFunc> mWireType2Converter;
+    unordered_map<std::string, GodecJNIToMsgFunc> mJavaClass2Converter;
+    std::map<std::string, GodecJNIToMsgFunc> mUnregisteredJNIConverters;
+    // What findJNIConverter() returned for each Java class fromJNI() has seen so far (nullptr: only the unregistered converters apply), so the class hierarchy only gets walked once per class.
+    // The classes are global references. Java classes can't be hashed from C++, but there are only ever a handful of message classes
+    mutable std::mutex mJNIClassCacheMutex;
+    mutable std::vector<std::pair<jclass, GodecJNIToMsgFunc>> mJNIClassCache;
+#ifndef ANDROID
+    unordered_map<std::string, GodecPythonToMsgFunc> mPythonType2Converter;
+    std::map<std::string, GodecPythonToMsgFunc> mUnregisteredPythonConverters;
+#endif
+};
+
 // The main component graph class. Note that when using Submodules, these classes are nested inside each other. Meaning, this class only ever contains one level of JSON
 class ComponentGraph {
   public:
@@ -36,9 +86,16 @@ class ComponentGraph {
     void PushMessage(std::string channelName, DecoderMessage_ptr msg);
     ChannelReturnResult PullMessage(std::string channelName, float maxTimeout, unordered_map<std::string, DecoderMessage_ptr>& newSlice);
     ChannelReturnResult PullAllMessages(std::string channelName, float maxTimeout, std::vector<unordered_map<std::string, DecoderMessage_ptr>>& newSlice);
+    // Alternative to polling with PullMessage()/PullAllMessages(): "onSlices" gets called from a small shared delivery pool as soon as the endpoint has new slices, with up to "maxSlicesPerCall" of them at once. Calls for one endpoint never overlap and arrive in order. "onClosed" (may be empty) is called once after the last slice, when the endpoint shuts down. Slices the endpoint produced before the callback was registered get delivered right away. While a few hundred slices are waiting for slow callbacks, the endpoint stops taking new ones, which holds up the graph. The callbacks must not call WaitTilShutdown() or otherwise block on the graph, the endpoint's shutdown waits for them
+    void SetApiEndpointCallback(std::string channelName, ApiEndpointSliceCallback onSlices, ApiEndpointClosedCallback onClosed, int maxSlicesPerCall);
     unordered_map<std::string, RuntimeStats> GetRuntimeStats();
     unordered_map<std::string, boost::shared_ptr<RuntimeStats> > getRuntimeStats();
     static void ListComponents(std::string dllName);
+    // Entry point of "godec _worker", the processes that some core components start with SpawnWorkerProcess() (see Ipc.h)
+    static int RunWorker(std::string kind, std::string config);
+    static DllPtr LoadGodecLibrary(std::string dllName);
+    std::vector<std::string> GetLoadedLibraries() const;
+    const MessageConverterRegistry& GetMessageConverters() const { return mMessageConverters; }
     static std::string API_ENDPOINT_SUFFIX;
     static std::string TOPLEVEL_ID;
     static std::string TREE_LEVEL_SEPARATOR;
@@ -47,6 +104,7 @@ class ComponentGraph {
 #ifndef ANDROID
     DecoderMessage_ptr PythonToDecoderMsg(PyObject *pMsg);
 #endif
+    DecoderMessage_ptr WireToDecoderMsg(WireReader& reader);
   private:
     static unordered_map < std::string, std::pair<boost::function<LoopProcessor*(std::string, ComponentGraphConfig*)>, boost::function<std::string()>>> GetComponentHash();
     std::mutex mComponentsMutex;
@@ -54,10 +112,10 @@ class ComponentGraph {
     unordered_map<std::string, ChannelPointerList*> mGlobalOutputSlots;
 
     LoopProcessor* LoadComponent(std::string compType, std::string compName, ComponentGraphConfig* compConfig);
-    static DllPtr LoadGodecLibrary(std::string dllName);
 
     std::string mId;
     boost::shared_ptr<unordered_map<std::string, DllPtr >> mGlobalDllName2Handle;
+    MessageConverterRegistry mMessageConverters;
 };
 
 } // namespace Godec
@@ -82,6 +82,22 @@ extern unordered_map<std::string, std::pair<bool, FILE*>> GlobalThreadId2LogHand
 
 void RegisterThreadForLogging(boost::thread& thread, FILE* logPtr, bool verbose);
 
+// Where a component's threads should run, as set by the "cpu_affinity", "numa_node" and "thread_priority" parameters
+struct ThreadPlacement {
+    ThreadPlacement() : mNumaNode(-1), mPriority(0) {}
+    std::vector<int> mCpus; // Empty means "all CPUs" (or all CPUs of mNumaNode, if that one is set)
+    int mNumaNode; // -1 means no NUMA preference
+    int mPriority; // 0 = OS default, 1..99 = real-time (SCHED_FIFO) priority, <0 = background (SCHED_BATCH)
+    bool isSet() const { return !mCpus.empty() || mNumaNode >= 0 || mPriority != 0; }
+    // Has to be called from inside the thread itself, before it does any work. Sets affinity and scheduling, returns a human-readable description of what was applied
+    std::string applyToCurrentThread() const;
+    // Has to be called from inside the thread itself, before it allocates its buffers. Makes allocations prefer mNumaNode
+    void bindMemoryOfCurrentThread() const;
+};
+
+// Parses a Linux-style CPU list, e.g. "0-3,8,10-11"
+std::vector<int> ParseCpuList(const std::string& cpuList);
+
 struct LogMessageEnvelope {
     enum Severity {
         kError = -1,
@@ -130,8 +146,105 @@ double TwoDigitsPrecisionRound(double x);
 
 void OverlayPropertyTrees(const json& tree1, const std::string& tree1Path, const json& tree2, const std::string& tree2Path, json& outTree);
 
-jobject CreateJNIVector(JNIEnv* env, Vector& data);
-jobject CreateJNIMatrix(JNIEnv* env, Matrix& data);
+// If "directBuffer" is a direct java.nio.FloatBuffer big enough for the data, the data gets copied into it and the returned Vector/Matrix wraps it. Otherwise a new float[] is allocated
+jobject CreateJNIVector(JNIEnv* env, Vector& data, jobject directBuffer = nullptr);
+jobject CreateJNIMatrix(JNIEnv* env, Matrix& data, jobject directBuffer = nullptr);
+// Copy a com.bbn.godec.Vector/Matrix into a pooled Eigen payload. Buffer-backed ones get copied in one go straight from the buffer's memory, array-backed ones a whole column at a time
+Vector JNIVectorToEigen(JNIEnv* env, jobject jVector);
+Matrix JNIMatrixToEigen(JNIEnv* env, jobject jMatrix);
+
+// Class references and method/field IDs of the Java classes the core messages get converted from and to. FindClass(), GetMethodID() and GetFieldID() are string lookups that are too slow to do for every message, so they are resolved once per process (in JNI_OnLoad when Godec is loaded from Java, otherwise on first use) and are valid on all threads afterwards
+struct JNIIds {
+    JNIIds(JNIEnv* env);
+
+    jclass mHashMap;
+    jmethodID mHashMapInit;
+    jmethodID mHashMapPut;
+    jmethodID mHashMapGet;
+    jmethodID mHashMapKeySet;
+    jclass mSet;
+    jmethodID mSetToArray;
+    jclass mArrayList;
+    jmethodID mArrayListInit;
+    jmethodID mArrayListAdd;
+    jmethodID mArrayListGet;
+    jmethodID mArrayListSize;
+    jclass mString;
+    jclass mClass;
+    jmethodID mClassGetName;
+
+    jclass mDecoderMessage;
+    jfieldID mDecoderMessageTag;
+    jfieldID mDecoderMessageTime;
+    jmethodID mDecoderMessageGetFullDescriptor;
+    jmethodID mDecoderMessageSetFullDescriptor;
+    jclass mVector;
+    jmethodID mVectorInit;
+    jmethodID mVectorInitBuffer;
+    jfieldID mVectorData;
+    jfieldID mVectorBuffer;
+    jclass mMatrix;
+    jmethodID mMatrixInit;
+    jmethodID mMatrixInitBuffer;
+    jfieldID mMatrixCols;
+    jfieldID mMatrixBuffer;
+    jfieldID mMatrixBufferRows;
+    jclass mBuffer;
+    jmethodID mBufferLimit;
+    jmethodID mBufferPosition;
+
+    jclass mAudioMsg;
+    jmethodID mAudioMsgInit;
+    jfieldID mAudioMsgAudio;
+    jfieldID mAudioMsgSampleRate;
+    jfieldID mAudioMsgTicksPerSample;
+    jclass mFeaturesMsg;
+    jmethodID mFeaturesMsgInit;
+    jfieldID mFeaturesMsgUtteranceId;
+    jfieldID mFeaturesMsgFeatureNames;
+    jfieldID mFeaturesMsgTimestamps;
+    jfieldID mFeaturesMsgFeatures;
+    jclass mNbestMsg;
+    jmethodID mNbestMsgInit;
+    jfieldID mNbestMsgEntries;
+    jclass mNbestEntry;
+    jmethodID mNbestEntryInit;
+    jfieldID mNbestEntryWords;
+    jfieldID mNbestEntryAlignment;
+    jfieldID mNbestEntryText;
+    jfieldID mNbestEntryConfidences;
+    jclass mConvStateMsg;
+    jmethodID mConvStateMsgInit;
+    jfieldID mConvStateMsgUtteranceId;
+    jfieldID mConvStateMsgConvoId;
+    jfieldID mConvStateMsgLastChunkInUtt;
+    jfieldID mConvStateMsgLastChunkInConvo;
+    jclass mBinaryMsg;
+    jmethodID mBinaryMsgInit;
+    jfieldID mBinaryMsgData;
+    jfieldID mBinaryMsgFormat;
+    jclass mJsonMsg;
+    jmethodID mJsonMsgInit;
+    jmethodID mJsonMsgToString;
+};
+const JNIIds& GetJNIIds(JNIEnv* env);
+
+// Scoped JNI local frame. The conversions create a handful of local references per message (and Nbests a few per word), which would otherwise pile up on threads that stay attached to the JVM
+class JNILocalFrame {
+  public:
+    JNILocalFrame(JNIEnv* env, jint capacity) : mEnv(env) {
+        if (mEnv->PushLocalFrame(capacity) != JNI_OK) GODEC_ERR << "Could not allocate JNI local frame of size " << capacity;
+    }
+    ~JNILocalFrame() { if (mEnv != nullptr) mEnv->PopLocalFrame(NULL); }
+    // Pops the frame, keeping "result" alive as a reference in the enclosing frame
+    jobject release(jobject result) {
+        JNIEnv* env = mEnv;
+        mEnv = nullptr;
+        return env->PopLocalFrame(result);
+    }
+  private:
+    JNIEnv* mEnv;
+};
 
 std::string StripCommentsFromJSON(std::string in);
 std::string Json2String(json js);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <boost/make_shared.hpp>
+#include "HelperFuncs.h"
+
+namespace Godec {
+
+// Allocation counters for a single component. The pools below count into the counters that are registered for the current thread (see SetThreadAllocationCounters), which for component threads is done by LoopProcessor::startPlacedThread when gather_runtime_stats is on
+struct AllocationCounters {
+    AllocationCounters() {}
+    AllocationCounters(const AllocationCounters& other) { *this = other; }
+    AllocationCounters& operator=(const AllocationCounters& other) {
+        mMessages = other.mMessages.load();
+        mPayloadsFresh = other.mPayloadsFresh.load();
+        mPayloadsReused = other.mPayloadsReused.load();
+        mPayloadBytesFresh = other.mPayloadBytesFresh.load();
+        return *this;
+    }
+    std::atomic<uint64_t> mMessages{0};
+    std::atomic<uint64_t> mPayloadsFresh{0};
+    std::atomic<uint64_t> mPayloadsReused{0};
+    std::atomic<uint64_t> mPayloadBytesFresh{0};
+};
+
+void SetThreadAllocationCounters(AllocationCounters* counters);
+AllocationCounters* GetThreadAllocationCounters();
+// Running count of message blocks and payloads the current thread had to get from the heap because the pools had nothing to hand out. This is what count_slice_pool_misses reports per slice
+uint64_t GetThreadPoolMisses();
+
+// Raw blocks for message objects (including their shared_ptr control block), bucketed into 16-byte size classes. Released blocks go onto a per-class free list and get handed out again, so in steady state creating a message does not touch malloc
+void* AllocateMessageBlock(std::size_t bytes);
+void ReleaseMessageBlock(void* block, std::size_t bytes);
+
+template<class T>
+class MessagePoolAllocator {
+  public:
+    typedef T value_type;
+    MessagePoolAllocator() {}
+    template<class U> MessagePoolAllocator(const MessagePoolAllocator<U>&) {}
+    T* allocate(std::size_t n) { return static_cast<T*>(AllocateMessageBlock(n * sizeof(T))); }
+    void deallocate(T* p, std::size_t n) { ReleaseMessageBlock(p, n * sizeof(T)); }
+    template<class U> bool operator==(const MessagePoolAllocator<U>&) const { return true; }
+    template<class U> bool operator!=(const MessagePoolAllocator<U>&) const { return false; }
+};
+
+// Creates a message with object and control block in a single pooled allocation. Use this instead of "new" inside message create() and clone() functions
+template<class T, class... Args>
+boost::shared_ptr<T> NewPooledMessage(Args&&... args) {
+    AllocationCounters* counters = GetThreadAllocationCounters();
+    if (counters != nullptr) counters->mMessages++;
+    return boost::allocate_shared<T>(MessagePoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+// Payload pool for the Eigen storage of messages. Buffers are keyed by their exact element count (Eigen only keeps its storage on resize() if the element count is unchanged), so a Matrix released as 40x100 can come back as 100x40. Released buffers are kept up to a per-size and an overall byte limit, everything beyond that is freed as usual
+Matrix AcquireMatrix(Eigen::Index rows, Eigen::Index cols);
+Vector AcquireVector(Eigen::Index size);
+void ReleasePayload(Matrix&& mat);
+void ReleasePayload(Vector&& vec);
+
+} // namespace Godec
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/chrono.hpp>
+#include "ChannelMessenger.h"
+
+namespace Godec {
+
+/*
+ * Buffered file output that does the actual writing on a dedicated thread, so that a slow disk does not stall the component (and with it everything upstream).
+ *
+ * The component appends into an in-memory buffer. A full buffer, or one that a flush policy says is due, gets handed to the writer thread, which writes it with a
+ * single unbuffered fwrite(), so that everything it has written has been handed to the OS. Only when more than "max_pending_kb" are waiting for the writer does
+ * write() block; that time is reported as time blocked on I/O.
+ *
+ * Flush policies (all optional, see OutputSinkOptions::FromConfig()):
+ *   "sink_buffer_kb"              Size of the buffers, a full buffer always goes to the writer
+ *   "sink_flush_ms"               Data does not sit in the buffer for longer than this (0 = no time limit)
+ *   "sink_flush_on_utterance_end" endOfUtterance() hands over the buffer
+ *
+ * One sink writes one file at a time; open() starts the next one, on the same writer thread. A write error on the writer thread surfaces as GODEC_ERR on the next call.
+ */
+
+struct OutputSinkOptions {
+    OutputSinkOptions() : mBufferBytes(1 << 20), mMaxPendingBytes(16 << 20), mFlushMs(0), mFlushOnUtteranceEnd(false) {}
+    // Reads the optional "sink_..." parameters, everything not specified keeps the default
+    static OutputSinkOptions FromConfig(ComponentGraphConfig* configPt);
+
+    size_t mBufferBytes;
+    size_t mMaxPendingBytes;
+    int64_t mFlushMs;
+    bool mFlushOnUtteranceEnd;
+};
+
+class OutputSink {
+  public:
+    // "owner" (can be NULL) is used to start the writer thread with the component's thread placement
+    OutputSink(const OutputSinkOptions& options, LoopProcessor* owner, std::string id);
+    ~OutputSink();
+
+    // Starts writing a new file, the previous one gets closed
+    void open(std::string fileName);
+    void write(const char* data, size_t size);
+    void write(const std::string& data) { write(data.data(), data.size()); }
+    // Overwrites already written bytes of the current file (e.g. a header whose sizes are only known at the end)
+    void patch(uint64_t offset, const char* data, size_t size);
+    // Position of the next write() relative to the start of the current file
+    uint64_t tell() const { return mFilePos; }
+    void endOfUtterance();
+    // Hands over whatever is buffered and waits until it has been written
+    void flush();
+    void closeFile();
+    // Writes everything out and stops the writer thread
+    void close();
+
+    uint64_t getBytesWritten();
+    double getSecondsBlocked();
+    double getSecondsWriting();
+    std::string describeStats();
+
+  private:
+    enum OpType {
+        OpOpen,
+        OpData,
+        OpPatch,
+        OpClose
+    };
+    struct Op {
+        OpType mType;
+        std::vector<char> mData;
+        uint64_t mOffset;
+        std::string mFileName;
+    };
+    void WriteLoop();
+    void Enqueue(Op& op, boost::unique_lock<boost::mutex>& lock);
+    void HandOverCurrent(boost::unique_lock<boost::mutex>& lock);
+    void CheckError();
+
+    OutputSinkOptions mOptions;
+    std::string mId;
+    bool mFileOpen;
+    uint64_t mFilePos;
+
+    boost::mutex mMutex;
+    boost::condition_variable mCond;
+    std::deque<Op> mQueue;
+    std::vector<std::vector<char>> mFreeBuffers;
+    std::vector<char> mCurrent;
+    boost::chrono::steady_clock::time_point mCurrentSince;
+    size_t mPendingBytes;
+    bool mWriterBusy;
+    bool mStop;
+    std::string mError;
+    boost::thread mWriteThread;
+
+    uint64_t mBytesWritten;
+    boost::chrono::nanoseconds mBlocked;
+    boost::chrono::nanoseconds mWriting;
+};
+
+}
@@ -4,6 +4,8 @@
 #include <map>
 #include <vector>
 #include <list>
+#include <float.h>
+#include <boost/chrono.hpp>
 #include "HelperFuncs.h"
 
 namespace Godec {
@@ -31,18 +33,29 @@ class SingleTimeStream : public  std::vector<DecoderMessage_ptr> {
 // All streams together
 class TimeStreams {
   public:
+    TimeStreams();
     void setIdVerbose(std::string _id, bool verbose_) { mId = _id; mVerbose = verbose_; }
+    // Hold back slices until they span at least minSliceTicks, or until maxSliceLatencyMs has passed (<0 = no deadline)
+    void setCoalescing(int64_t minSliceTicks, float maxSliceLatencyMs);
+    // How long the caller can wait for new input before a held-back slice is due. FLT_MAX when nothing is held back
+    float getSecondsUntilDeadline();
     void addMessage(DecoderMessage_ptr msg, std::string slot);
     void addStream(std::string streamName);
     std::string getLeastFilledSlot();
     std::string print();
-    unordered_map<std::string, DecoderMessage_ptr> getNewCoherent(int64_t& cutoff);
+    // "flush" releases held-back slices regardless of their size
+    unordered_map<std::string, DecoderMessage_ptr> getNewCoherent(int64_t& cutoff, bool flush = false);
     SingleTimeStream& getStream(std::string slot) { return mStream[slot]; }
     bool isEmpty();
   private:
+    bool shouldReleaseSlice(uint64_t sliceTime, int64_t previousCutoff);
     std::map<std::string, SingleTimeStream> mStream;
     std::string mId;
     bool mVerbose;
+    int64_t mMinSliceTicks;
+    float mMaxSliceLatencyMs;
+    bool mIsHolding;
+    boost::chrono::steady_clock::time_point mHoldingSince;
 };
 
 } // namespace Godec
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/endian/conversion.hpp>
+#include "ChannelMessenger.h"
+
+namespace Godec {
+
+/*
+ * Compact binary encoding of DecoderMessages, for shipping them between processes or writing them to disk.
+ *
+ * A message on the wire is an envelope followed by the message body:
+ *
+ *   uint32  magic ("GDWM")
+ *   uint16  wire format version (GODEC_WIRE_FORMAT_VERSION)
+ *   uint16  message type version (DecoderMessage::getWireVersion())
+ *   16 bytes message type UUID
+ *   uint64  body size in bytes
+ *   body    time, tag and descriptors (sorted by key), then whatever the message type's toWire() writes
+ *
+ * All numbers are little-endian. Float and integer arrays are written as raw blocks that start on a 16-byte boundary (relative to the start of the buffer), so
+ * a matrix goes in and out with a single memcpy, and a reader that has the buffer mmap'ed can also point straight into it.
+ * Decoders must skip anything they don't know at the end of a body, which is how a message type can append fields in a later type version without breaking older readers.
+ */
+
+static const uint32_t GODEC_WIRE_MAGIC = 0x4d574447; // "GDWM" when read as bytes
+static const uint16_t GODEC_WIRE_FORMAT_VERSION = 1;
+static const size_t GODEC_WIRE_BLOCK_ALIGNMENT = 16;
+
+// Appends to a byte buffer that can be reused across messages (clear() keeps the allocation)
+class WireWriter {
+  public:
+    WireWriter() : mExternalThreshold(SIZE_MAX), mExternalBytes(0) {}
+    void clear() { mBuffer.clear(); mExternal.clear(); mExternalBytes = 0; }
+    const char* data() const {
+        if (!mExternal.empty()) GODEC_ERR << "WireWriter: Encoded message references external blocks, use segments() instead of data()";
+        return mBuffer.data();
+    }
+    size_t size() const { return mBuffer.size() + mExternalBytes; }
+
+    // For scatter-gather output: Byte arrays, float and integer blocks of at least "minBytes" bytes are not copied into the buffer, the writer only keeps a pointer to them.
+    // The data they point to (usually the payload of the message being encoded) has to stay alive until the segments have been sent
+    void setExternalBlockThreshold(size_t minBytes) { mExternalThreshold = minBytes; }
+    struct Segment {
+        const char* mData;
+        size_t mSize;
+    };
+    // The encoded bytes as a sequence of pieces, alternating between the buffer and external blocks
+    void appendSegments(std::vector<Segment>& out) const;
+
+    void writeU8(uint8_t val) { writeRaw(&val, 1); }
+    void writeU16(uint16_t val) { boost::endian::native_to_little_inplace(val); writeRaw(&val, sizeof(val)); }
+    void writeU32(uint32_t val) { boost::endian::native_to_little_inplace(val); writeRaw(&val, sizeof(val)); }
+    void writeU64(uint64_t val) { boost::endian::native_to_little_inplace(val); writeRaw(&val, sizeof(val)); }
+    void writeFloat(float val) { uint32_t bits; memcpy(&bits, &val, sizeof(bits)); writeU32(bits); }
+    void writeBool(bool val) { writeU8(val ? 1 : 0); }
+    void writeString(const std::string& val) { writeU64(val.size()); writeRaw(val.data(), val.size()); }
+    void writeBytes(const void* data, size_t numBytes) { writeU64(numBytes); writeBlock(data, numBytes); }
+    // Element count, then the elements as an aligned block
+    void writeFloatBlock(const float* data, size_t count);
+    void writeU64Block(const uint64_t* data, size_t count);
+    void writeMatrix(const Matrix& mat); // rows, cols, column-major float block
+
+    // For back-patching sizes
+    void patchU64(size_t offset, uint64_t val) { boost::endian::native_to_little_inplace(val); memcpy(&mBuffer[bufferOffset(offset)], &val, sizeof(val)); }
+    void writeRaw(const void* data, size_t numBytes) {
+        if (numBytes == 0) return;
+        size_t offset = mBuffer.size();
+        mBuffer.resize(offset + numBytes);
+        memcpy(&mBuffer[offset], data, numBytes);
+    }
+  private:
+    struct ExternalBlock {
+        size_t mBufferOffset; // Where in the buffer the block logically sits
+        const char* mData;
+        size_t mSize;
+    };
+    void align();
+    void writeBlock(const void* data, size_t numBytes);
+    size_t bufferOffset(size_t offset) const;
+    std::vector<char> mBuffer;
+    std::vector<ExternalBlock> mExternal;
+    size_t mExternalThreshold;
+    size_t mExternalBytes;
+};
+
+// Reads from a buffer it doesn't own. Running past the end is an error rather than undefined behavior, since the data might come from a file or another process
+class WireReader {
+  public:
+    WireReader(const char* data, size_t size) : mData(data), mSize(size), mPos(0) {}
+    size_t position() const { return mPos; }
+    size_t remaining() const { return mSize - mPos; }
+    void seek(size_t pos) { if (pos > mSize) GODEC_ERR << "WireReader: Seeking past the end of the buffer"; mPos = pos; }
+
+    uint8_t readU8() { uint8_t val; readRaw(&val, 1); return val; }
+    uint16_t readU16() { uint16_t val; readRaw(&val, sizeof(val)); return boost::endian::little_to_native(val); }
+    uint32_t readU32() { uint32_t val; readRaw(&val, sizeof(val)); return boost::endian::little_to_native(val); }
+    uint64_t readU64() { uint64_t val; readRaw(&val, sizeof(val)); return boost::endian::little_to_native(val); }
+    float readFloat() { uint32_t bits = readU32(); float val; memcpy(&val, &bits, sizeof(val)); return val; }
+    bool readBool() { return readU8() != 0; }
+    std::string readString();
+    std::vector<unsigned char> readBytes();
+    // The element count of the next block. Read it, allocate, then read the block itself
+    size_t readBlockSize() { return (size_t)readU64(); }
+    void readFloatBlock(float* out, size_t count);
+    void readU64Block(uint64_t* out, size_t count);
+    std::vector<float> readFloatVector();
+    std::vector<uint64_t> readU64Vector();
+    Matrix readMatrix(); // Payload comes from the message pool
+
+    void readRaw(void* out, size_t numBytes) {
+        if (numBytes > remaining()) GODEC_ERR << "WireReader: Message is truncated, wanted " << numBytes << " bytes but only " << remaining() << " are left";
+        if (numBytes == 0) return;
+        memcpy(out, mData + mPos, numBytes);
+        mPos += numBytes;
+    }
+  private:
+    void align();
+    const char* mData;
+    size_t mSize;
+    size_t mPos;
+};
+
+struct WireMessageHeader {
+    uuid mType;
+    uint16_t mTypeVersion;
+    uint64_t mBodySize;
+};
+
+// Decodes what toWire() wrote for one message type. The common time/tag/descriptor part has already been read by then, the caller sets tag and descriptors on the returned message
+typedef DecoderMessage_ptr (*GodecWireToMsgFunc)(WireReader& reader, uint16_t typeVersion, uint64_t time);
+
+// Writes envelope and body of a message. The message type needs to implement toWire()
+void WriteWireMessage(WireWriter& writer, const DecoderMessage& msg);
+// Reads and checks the envelope, leaves the reader at the start of the body
+WireMessageHeader ReadWireMessageHeader(WireReader& reader);
+// Reads the rest of the message with the given decoder. Leaves the reader at the end of the body, even if the decoder didn't consume all of it
+DecoderMessage_ptr ReadWireMessageBody(WireReader& reader, const WireMessageHeader& header, GodecWireToMsgFunc decoder);
+
+} // namespace Godec
@@ -69,8 +69,28 @@ class channel {
         getCv.notify_all();
     }
 
+    // Like put(), but returns false instead of waiting when the channel is full
+    bool tryPut(const item i) {
+        boost::unique_lock<boost::mutex> lock(m);
+        if (mRefCounter == 0) GODEC_ERR << "Channel " << mId << ": Somebody is trying push even though ref counter is 0!";
+        if (mQueue.size() >= maxItems) return false;
+        mQueue.push_back(i);
+        getCv.notify_all();
+        return true;
+    }
+
     int32_t getNumItems() { return (int32_t)mQueue.size(); }
 
+    // Waits until no more than "numItems" items are queued. False on timeout
+    bool waitForNumItemsAtMost(int32_t numItems, float maxTimeout) {
+        boost::unique_lock<boost::mutex> lock(m);
+        maxTimeout = std::min(maxTimeout, 60.0f * 60 * 24);
+        const boost::system_time timeLong = boost::get_system_time() + boost::posix_time::milliseconds((long)(1000.0f*maxTimeout));
+        return putCv.timed_wait(lock, timeLong, [&]() {
+            return (int32_t)mQueue.size() <= numItems;
+        });
+    }
+
     ChannelReturnResult get(item& out) {
         return get(out, FLT_MAX);
     }
@@ -94,6 +114,7 @@ class channel {
             if (!waitResult) return ChannelTimeout;
         }
         if (seenItAll()) return ChannelClosed;
+        if (mQueue.empty()) return ChannelTimeout; // Zero timeout on an empty queue
         out = mQueue.front();
         mQueue.pop_front();
         putCv.notify_all();
@@ -0,0 +1,37 @@
+import sys
+import json
+import traceback
+
+# For batch.test: Sums up the audio chunks of each utterance into one JSON message with the utterance's end time, samples and ticks per sample.
+# How the chunks are cut depends on how fast the components happen to run, what they add up to has to be the same for the batch and the single run
+class BatchTest:
+  def __init__(self, config, stdout, stderr, verbose):
+    sys.stdout = stdout
+    sys.stderr = stderr
+    self.numSamples = 0
+    self.ticksPerSample = set()
+
+  def ProcessMessage(self, msgHash):
+    try:
+      audio = msgHash['preproc_audio']
+      convState = msgHash['conversation_state']
+      self.numSamples += int(audio['audio'].shape[0])
+      self.ticksPerSample.add(round(audio['ticks_per_sample'], 3))
+      if not convState['last_chunk_in_utt']:
+        return {}
+      times = {
+        'utterance_id': convState['utterance_id'],
+        'conversation_id': convState['convo_id'],
+        'time': audio['time'],
+        'num_samples': self.numSamples,
+        'ticks_per_sample': sorted(self.ticksPerSample)
+      }
+      self.numSamples = 0
+      self.ticksPerSample = set()
+      return {'times': {'type': 'JsonDecoderMessage', 'tag': audio['tag'], 'time': audio['time'], 'descriptor': '', 'json': json.dumps(times)}}
+    except:
+      print(traceback.format_exc())
+      raise
+    finally:
+      sys.stdout.flush()
+      sys.stderr.flush()
@@ -0,0 +1,333 @@
+#!/usr/bin/env python3
+# Minimal FLAC encoder for the tests (https://xiph.org/flac/format.html), so that test FLAC files can be made from the test WAVs
+# without any codec libraries. It uses every subframe type, all stereo decorrelation modes and both residual coding methods; with
+# --exhaustive it cycles through them frame by frame instead of picking the smallest, so that a test file covers all of them.
+
+import argparse
+import hashlib
+import struct
+import wave
+
+import numpy as np
+
+SAMPLE_RATE_CODES = {88200: 1, 176400: 2, 192000: 3, 8000: 4, 16000: 5, 22050: 6, 24000: 7, 32000: 8, 44100: 9, 48000: 10, 96000: 11}
+
+
+def crc_table(bits, poly):
+    table = []
+    top = 1 << (bits - 1)
+    mask = (1 << bits) - 1
+    for idx in range(256):
+        crc = idx << (bits - 8)
+        for _ in range(8):
+            crc = ((crc << 1) ^ poly) & mask if crc & top else (crc << 1) & mask
+        table.append(crc)
+    return table
+
+
+CRC8_TABLE = crc_table(8, 0x07)
+CRC16_TABLE = crc_table(16, 0x8005)
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc = CRC8_TABLE[crc ^ byte]
+    return crc
+
+
+def crc16(data):
+    crc = 0
+    for byte in data:
+        crc = ((crc << 8) & 0xFFFF) ^ CRC16_TABLE[(crc >> 8) ^ byte]
+    return crc
+
+
+class BitWriter:
+    def __init__(self):
+        self.parts = []
+        self.num_bits = 0
+
+    def write(self, value, num_bits):
+        if num_bits > 0:
+            self.parts.append(format(int(value) & ((1 << num_bits) - 1), '0%db' % num_bits))
+            self.num_bits += num_bits
+
+    def write_bits(self, bit_string):
+        self.parts.append(bit_string)
+        self.num_bits += len(bit_string)
+
+    def align(self):
+        self.write(0, -self.num_bits % 8)
+
+    def to_bytes(self):
+        bits = ''.join(self.parts)
+        return int(bits, 2).to_bytes(len(bits) // 8, 'big') if bits else b''
+
+
+def utf8_number(value):
+    if value < 0x80:
+        return bytes([value])
+    num_bytes = 2
+    while value >= (1 << (5 * num_bytes + 1)):
+        num_bytes += 1
+    out = [((0xFF << (8 - num_bytes)) & 0xFF) | (value >> (6 * (num_bytes - 1)))]
+    for idx in range(num_bytes - 2, -1, -1):
+        out.append(0x80 | ((value >> (6 * idx)) & 0x3F))
+    return bytes(out)
+
+
+def rice_cost(residual, order, block_size):
+    """Cheapest partition order and Rice parameters for the residual, as (bits, partition order, parameters)"""
+    folded = np.where(residual >= 0, 2 * residual, -2 * residual - 1).astype(np.int64)
+    best = None
+    ks = np.arange(15)
+    for partition_order in range(0, 5):
+        partition_size = block_size >> partition_order
+        if (partition_size << partition_order) != block_size or partition_size < order or partition_size < 1:
+            break
+        bits = 0
+        params = []
+        start = 0
+        for partition_idx in range(1 << partition_order):
+            end = partition_size * (partition_idx + 1) - order
+            part = folded[start:end]
+            costs = (part[:, None] >> ks).sum(axis=0) + len(part) * (ks + 1)
+            k = int(np.argmin(costs))
+            bits += int(costs[k]) + 5
+            params.append(k)
+            start = end
+        if best is None or bits < best[0]:
+            best = (bits, partition_order, params)
+    return best
+
+
+def write_residual(writer, residual, order, block_size, partition_order, params, method):
+    writer.write(method, 2)
+    writer.write(partition_order, 4)
+    partition_size = block_size >> partition_order
+    folded = np.where(residual >= 0, 2 * residual, -2 * residual - 1).astype(np.int64)
+    start = 0
+    for partition_idx, k in enumerate(params):
+        end = partition_size * (partition_idx + 1) - order
+        part = folded[start:end]
+        if partition_idx == len(params) - 1 and k > 0 and len(part) > 0 and int(part.max()) < 16:
+            # Exercise the escape code: small values stored verbatim with 5 bits each
+            writer.write(15 if method == 0 else 31, 4 if method == 0 else 5)
+            writer.write(5, 5)
+            for val in residual[start:end]:
+                writer.write(int(val), 5)
+        else:
+            writer.write(k, 4 if method == 0 else 5)
+            suffix = '0%db' % k if k > 0 else None
+            writer.write_bits(''.join('0' * (int(u) >> k) + '1' + (format(int(u) & ((1 << k) - 1), suffix) if suffix else '') for u in part))
+        start = end
+
+
+def fixed_residual(samples, order):
+    return np.diff(samples, n=order)
+
+
+def lpc_coefficients(samples, order, precision):
+    if len(samples) <= 2 * order:
+        return None
+    x = samples.astype(np.float64)
+    history = np.stack([x[order - 1 - j:len(x) - 1 - j] for j in range(order)], axis=1)
+    coefs, _, _, _ = np.linalg.lstsq(history, x[order:], rcond=None)
+    max_coef = np.abs(coefs).max()
+    if max_coef == 0:
+        return None
+    shift = min(15, max(0, precision - 1 - int(np.ceil(np.log2(max_coef + 1e-9))) - 1))
+    limit = 1 << (precision - 1)
+    quantized = np.clip(np.round(coefs * (1 << shift)), -limit, limit - 1).astype(np.int64)
+    return quantized, shift
+
+
+def lpc_residual(samples, quantized, shift):
+    order = len(quantized)
+    samples = samples.astype(np.int64)
+    prediction = np.zeros(len(samples) - order, dtype=np.int64)
+    for j in range(order):
+        prediction += quantized[j] * samples[order - 1 - j:len(samples) - 1 - j]
+    return samples[order:] - (prediction >> shift)
+
+
+def pick(options, choice):
+    """The smallest of the (bits, ...) options, or the one at index "choice" (modulo the number of options)"""
+    return min(options, key=lambda o: o[0]) if choice is None else options[choice % len(options)]
+
+
+def encode_subframe(samples, bps, choice):
+    """Returns (bits, function writing the subframe)"""
+    block_size = len(samples)
+    samples = samples.astype(np.int64)
+    if np.all(samples == samples[0]):
+        return 8 + bps, lambda w: (w.write(0, 8), w.write(int(samples[0]), bps))
+
+    wasted = 0
+    combined = int(np.bitwise_or.reduce(samples))
+    while not (combined >> wasted) & 1:
+        wasted += 1
+    shifted = samples >> wasted
+    sub_bps = bps - wasted
+
+    def header(w, type_code):
+        w.write(0, 1)
+        w.write(type_code, 6)
+        if wasted:
+            w.write(1, 1)
+            w.write_bits('0' * (wasted - 1) + '1')
+        else:
+            w.write(0, 1)
+
+    candidates = [(8 + wasted + sub_bps * block_size, lambda w: (header(w, 1), [w.write(int(v), sub_bps) for v in shifted]))]
+    for order in range(0, 5):
+        if order >= block_size:
+            break
+        residual = fixed_residual(shifted, order)
+        bits, partition_order, params = rice_cost(residual, order, block_size)
+
+        def write_fixed(w, order=order, residual=residual, partition_order=partition_order, params=params):
+            header(w, 8 + order)
+            for v in shifted[:order]:
+                w.write(int(v), sub_bps)
+            write_residual(w, residual, order, block_size, partition_order, params, 0)
+        candidates.append((8 + wasted + order * sub_bps + 6 + bits, write_fixed))
+    precision = 12
+    for order in (2, 8, 12):
+        lpc = lpc_coefficients(shifted, order, precision)
+        if lpc is None:
+            continue
+        quantized, shift = lpc
+        residual = lpc_residual(shifted, quantized, shift)
+        bits, partition_order, params = rice_cost(residual, order, block_size)
+
+        def write_lpc(w, order=order, quantized=quantized, shift=shift, residual=residual, partition_order=partition_order, params=params):
+            header(w, 31 + order)
+            for v in shifted[:order]:
+                w.write(int(v), sub_bps)
+            w.write(precision - 1, 4)
+            w.write(shift, 5)
+            for c in quantized:
+                w.write(int(c), precision)
+            write_residual(w, residual, order, block_size, partition_order, params, 1)
+        candidates.append((8 + wasted + order * sub_bps + 9 + order * precision + 6 + bits, write_lpc))
+    return pick(candidates, choice)
+
+
+def block_size_code(block_size):
+    if block_size == 192:
+        return 1, None
+    for code in range(2, 6):
+        if block_size == 576 << (code - 2):
+            return code, None
+    for code in range(8, 16):
+        if block_size == 256 << (code - 8):
+            return code, None
+    if block_size <= 256:
+        return 6, struct.pack('>B', block_size - 1)
+    return 7, struct.pack('>H', block_size - 1)
+
+
+def encode_frame(channels, number, variable, sample_rate, bps, choice):
+    block_size = len(channels[0])
+    if len(channels) == 2:
+        left, right = channels[0].astype(np.int64), channels[1].astype(np.int64)
+        side = left - right
+        mid = (left + right) >> 1
+        left_sub = encode_subframe(left, bps, choice)
+        right_sub = encode_subframe(right, bps, None if choice is None else choice + 1)
+        side_sub = encode_subframe(side, bps + 1, None if choice is None else choice + 2)
+        mid_sub = encode_subframe(mid, bps, None if choice is None else choice + 3)
+        modes = [(left_sub[0] + right_sub[0], 1, [left_sub, right_sub]),
+                 (left_sub[0] + side_sub[0], 8, [left_sub, side_sub]),
+                 (side_sub[0] + right_sub[0], 9, [side_sub, right_sub]),
+                 (mid_sub[0] + side_sub[0], 10, [mid_sub, side_sub])]
+        _, channel_code, subframes = pick(modes, choice)
+    else:
+        channel_code = len(channels) - 1
+        subframes = [encode_subframe(c.astype(np.int64), bps, None if choice is None else choice + idx) for idx, c in enumerate(channels)]
+
+    bs_code, bs_extra = block_size_code(block_size)
+    rate_code = SAMPLE_RATE_CODES.get(sample_rate, 0)
+    size_code = {8: 1, 12: 2, 16: 4, 20: 5, 24: 6}.get(bps, 0)
+    header = bytearray([0xFF, 0xF9 if variable else 0xF8, (bs_code << 4) | rate_code, (channel_code << 4) | (size_code << 1)])
+    header += utf8_number(number)
+    if bs_extra:
+        header += bs_extra
+    header.append(crc8(header))
+
+    writer = BitWriter()
+    for _, write in subframes:
+        write(writer)
+    writer.align()
+    frame = bytes(header) + writer.to_bytes()
+    return frame + struct.pack('>H', crc16(frame))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Encodes a 16 bit PCM WAV file as FLAC')
+    parser.add_argument('wav')
+    parser.add_argument('flac')
+    parser.add_argument('--block-size', type=int, default=4096)
+    parser.add_argument('--variable', action='store_true', help='Vary the block size from frame to frame')
+    parser.add_argument('--exhaustive', action='store_true', help='Cycle through the subframe types and stereo modes instead of picking the smallest')
+    parser.add_argument('--seek-interval', type=int, default=0, help='Samples between seek points, 0 for no seek table')
+    args = parser.parse_args()
+
+    with wave.open(args.wav) as wav:
+        if wav.getsampwidth() != 2:
+            raise ValueError('Only 16 bit WAV files are supported')
+        num_channels = wav.getnchannels()
+        sample_rate = wav.getframerate()
+        raw = wav.readframes(wav.getnframes())
+    bps = 16
+    samples = np.frombuffer(raw, dtype='<i2').reshape(-1, num_channels)
+    total = samples.shape[0]
+
+    block_sizes = [args.block_size, args.block_size // 3 + 1, 192, args.block_size * 2] if args.variable else [args.block_size]
+    frames = []
+    positions = []
+    start = 0
+    offset = 0
+    while start < total:
+        block_size = min(block_sizes[len(frames) % len(block_sizes)], total - start)
+        number = start if args.variable else len(frames)
+        frame = encode_frame([samples[start:start + block_size, c] for c in range(num_channels)], number, args.variable, sample_rate, bps, len(frames) if args.exhaustive else None)
+        positions.append((start, offset, block_size))
+        frames.append(frame)
+        offset += len(frame)
+        start += block_size
+
+    metadata = []
+    streaminfo = BitWriter()
+    streaminfo.write(min(block_sizes) if args.variable else args.block_size, 16)
+    streaminfo.write(max(block_sizes) if args.variable else args.block_size, 16)
+    streaminfo.write(min(len(f) for f in frames), 24)
+    streaminfo.write(max(len(f) for f in frames), 24)
+    streaminfo.write(sample_rate, 20)
+    streaminfo.write(num_channels - 1, 3)
+    streaminfo.write(bps - 1, 5)
+    streaminfo.write(total, 36)
+    metadata.append((0, streaminfo.to_bytes() + hashlib.md5(samples.astype('<i2').tobytes()).digest()))
+    if args.seek_interval > 0:
+        points = []
+        for target in range(0, total, args.seek_interval):
+            point = max(p for p in positions if p[0] <= target)
+            if not points or points[-1][0] != point[0]:
+                points.append(point)
+        table = b''.join(struct.pack('>QQH', *p) for p in points)
+        table += struct.pack('>QQH', 0xFFFFFFFFFFFFFFFF, 0, 0)
+        metadata.append((3, table))
+    metadata.append((1, bytes(100)))
+
+    with open(args.flac, 'wb') as out:
+        out.write(b'fLaC')
+        for idx, (block_type, data) in enumerate(metadata):
+            out.write(bytes([block_type | (0x80 if idx == len(metadata) - 1 else 0)]) + len(data).to_bytes(3, 'big') + data)
+        for frame in frames:
+            out.write(frame)
+
+
+if __name__ == '__main__':
+    main()
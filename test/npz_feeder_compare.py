@@ -0,0 +1,20 @@
+import sys
+import numpy as np
+
+# The arrays npz_feeder_test.json wrote back out have to be the ones it fed, in the order of the keys list, as float32
+written = np.load(sys.argv[1])
+keys = [line.strip().split(":") for line in open("npz_feeder_test.npz_keys") if line.strip() != ""]
+if written.files != [key for npzFile, key in keys]:
+  sys.stderr.write("Written keys "+str(written.files)+" are not the fed ones\n")
+  sys.stderr.flush()
+  exit(-1)
+for npzFile, key in keys:
+  orig = np.load(npzFile)[key]
+  if written[key].dtype != np.float32 or written[key].shape != orig.shape:
+    sys.stderr.write("Array "+key+" from "+npzFile+" came back as "+str(written[key].dtype)+" "+str(written[key].shape)+", fed was "+str(orig.dtype)+" "+str(orig.shape)+"\n")
+    sys.stderr.flush()
+    exit(-1)
+  if not np.array_equal(written[key], orig.astype(np.float32)):
+    sys.stderr.write("Array "+key+" from "+npzFile+" has different values\n")
+    sys.stderr.flush()
+    exit(-1)
@@ -29,7 +29,12 @@ class PythonTest:
       if (self.verbose):
         print("ProcessMessage was called with features of shape "+str(msgHash['features']['features'].shape))
         print("Ignore data is set to "+str(msgHash['conversation_state']['descriptor']))
-      msgHash['features']['features'] *= self.mult_fac
+      feats = msgHash['features']['features']
+      if feats.flags.writeable:
+        feats *= self.mult_fac
+      else:
+        # With "zero_copy_inputs" the incoming arrays are read-only views of the Godec message, so create a new one
+        msgHash['features']['features'] = feats * self.mult_fac
       del msgHash['conversation_state']
   
     except:
@@ -41,3 +46,22 @@ class PythonTest:
       sys.stderr.flush() 
     return msgHash
 
+  # Optional. With "batch_slices" set in the JSON, Godec hands over several consecutive slices in one call, which saves the per-call overhead and allows for vectorizing across slices. Has to return one dict per slice
+  def ProcessMessageBatch(self, msgHashes):
+    try:
+      if (self.verbose):
+        print("ProcessMessageBatch was called with "+str(len(msgHashes))+" slices")
+      feats = [msgHash['features']['features'] for msgHash in msgHashes]
+      allFeats = np.concatenate(feats, axis=1) * self.mult_fac
+      splitPoints = np.cumsum([f.shape[1] for f in feats])[:-1]
+      for msgHash, scaledFeats in zip(msgHashes, np.split(allFeats, splitPoints, axis=1)):
+        msgHash['features']['features'] = scaledFeats
+        del msgHash['conversation_state']
+
+    except:
+      print(traceback.format_exc())
+      raise
+    finally:
+      sys.stdout.flush()
+      sys.stderr.flush()
+    return msgHashes